@@ -38,6 +38,7 @@ static alpm_pkg_t *tpkg = NULL;
 static GString *toutput = NULL;
 
 static PkBackendJob* pkalpm_current_job = NULL;
+static gulong pkalpm_cancel_hook = 0;
 const gchar *pkalpm_dirname = NULL;
 
 static gchar *
@@ -744,9 +745,9 @@ pk_alpm_transaction_event_cb (alpm_event_t *event)
 }
 
 static void
-pk_alpm_transaction_cancelled_cb (GCancellable *object, gpointer data)
+pk_alpm_transaction_cancelled_cb (PkBackendJob *job, gpointer data)
 {
-	PkBackend *backend = pk_backend_job_get_backend (PK_BACKEND_JOB (data));
+	PkBackend *backend = pk_backend_job_get_backend (job);
 	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
 	alpm_trans_interrupt (priv->alpm);
 }
@@ -775,9 +776,9 @@ pk_alpm_transaction_initialize (PkBackendJob* job, alpm_transflag_t flags, const
 	alpm_option_set_dlcb (priv->alpm, pk_alpm_transaction_dlcb);
 	alpm_option_set_totaldlcb (priv->alpm, pk_alpm_transaction_totaldlcb);
 
-	g_cancellable_connect (pk_backend_job_get_cancellable (job),
-			       G_CALLBACK (pk_alpm_transaction_cancelled_cb),
-			       job, NULL);
+	pkalpm_cancel_hook = pk_backend_job_add_cancel_hook (job,
+							     pk_alpm_transaction_cancelled_cb,
+							     NULL, NULL);
 
 	return TRUE;
 }
@@ -1100,6 +1101,8 @@ pk_alpm_transaction_end (PkBackendJob *job, GError **error)
 		pk_alpm_transaction_output_end ();
 
 	g_assert (pkalpm_current_job);
+	pk_backend_job_remove_cancel_hook (job, pkalpm_cancel_hook);
+	pkalpm_cancel_hook = 0;
 	pkalpm_current_job = NULL;
 
 	if (alpm_trans_release (priv->alpm) < 0) {
@@ -22,8 +22,10 @@
 #include "apt-cache-file.h"
 
 #include <sstream>
+#include <sys/stat.h>
 #include <cstdio>
 #include <apt-pkg/algorithms.h>
+#include <apt-pkg/configuration.h>
 #include <apt-pkg/progress.h>
 #include <apt-pkg/upgrade.h>
 
@@ -360,36 +362,35 @@ bool AptCacheFile::isRemovingEssentialPackages()
 
 pkgCache::VerIterator AptCacheFile::resolvePkgID(const gchar *packageId)
 {
-    gchar **parts;
+    PkPackageIdView view;
     pkgCache::PkgIterator pkg;
 
-    parts = pk_package_id_split(packageId);
-    pkg = (*this)->FindPkg(parts[PK_PACKAGE_ID_NAME], parts[PK_PACKAGE_ID_ARCH]);
+    // resolving is hot, so look at the ID in place rather than splitting it
+    if (!pk_package_id_view_init(&view, packageId)) {
+        return pkgCache::VerIterator();
+    }
+    pkg = (*this)->FindPkg(std::string(view.name, view.name_len),
+                           std::string(view.arch, view.arch_len));
 
     // Ignore packages that could not be found or that exist only due to dependencies.
     if (pkg.end() || (pkg.VersionList().end() && pkg.ProvidesList().end())) {
-        g_strfreev(parts);
         return pkgCache::VerIterator();
     }
 
     const pkgCache::VerIterator &ver = findVer(pkg);
     // check to see if the provided package isn't virtual too
     if (ver.end() == false &&
-            strcmp(ver.VerStr(), parts[PK_PACKAGE_ID_VERSION]) == 0) {
-        g_strfreev(parts);
+            pk_package_id_part_equal(view.version, view.version_len, ver.VerStr())) {
         return ver;
     }
 
     const pkgCache::VerIterator &candidateVer = findCandidateVer(pkg);
     // check to see if the provided package isn't virtual too
     if (candidateVer.end() == false &&
-            strcmp(candidateVer.VerStr(), parts[PK_PACKAGE_ID_VERSION]) == 0) {
-        g_strfreev(parts);
+            pk_package_id_part_equal(view.version, view.version_len, candidateVer.VerStr())) {
         return candidateVer;
     }
 
-    g_strfreev (parts);
-
     return ver;
 }
 
@@ -513,9 +514,115 @@ void AptCacheFile::tryToRemove(pkgProblemResolver &Fix,
     Fix.Clear(Pkg);
     Fix.Protect(Pkg);
     Fix.Remove(Pkg);
+    markDelete(Pkg);
+}
+
+void AptCacheFile::markDelete(const pkgCache::PkgIterator &pkg)
+{
     // TODO this is false since PackageKit can't
     // tell it want's o purge
-    GetDepCache()->MarkDelete(Pkg, false);
+    GetDepCache()->MarkDelete(pkg, false);
+}
+
+AptSolution *AptCacheFile::saveSolution()
+{
+    pkgDepCache *depCache = GetDepCache();
+    AptSolution *solution = new AptSolution;
+
+    for (pkgCache::PkgIterator pkg = depCache->PkgBegin(); !pkg.end(); ++pkg) {
+        const pkgDepCache::StateCache &state = (*depCache)[pkg];
+        const bool reinstall = (state.iFlags & pkgDepCache::ReInstall) != 0;
+        if (!state.Install() && !state.Delete() && !reinstall) {
+            continue;
+        }
+
+        AptSolutionChange change;
+        change.name = pkg.Name();
+        change.arch = pkg.Arch();
+        change.remove = state.Delete();
+        change.reinstall = reinstall;
+        change.autoInstalled = (state.Flags & pkgCache::Flag::Auto) != 0;
+        if (!change.remove) {
+            const pkgCache::VerIterator &ver = state.InstVerIter(depCache->GetCache());
+            if (ver.end()) {
+                delete solution;
+                return nullptr;
+            }
+            change.version = ver.VerStr();
+        }
+        solution->push_back(change);
+    }
+
+    // only auto flags changed, which are not worth keeping
+    if (solution->empty()) {
+        delete solution;
+        return nullptr;
+    }
+    return solution;
+}
+
+bool AptCacheFile::applySolution(const AptSolution &solution)
+{
+    pkgDepCache *depCache = GetDepCache();
+    pkgDepCache::ActionGroup group(*depCache);
+
+    for (const AptSolutionChange &change : solution) {
+        const pkgCache::PkgIterator &pkg = depCache->FindPkg(change.name, change.arch);
+        if (pkg.end()) {
+            return false;
+        }
+
+        if (change.remove) {
+            markDelete(pkg);
+            continue;
+        }
+
+        pkgCache::VerIterator ver;
+        for (ver = pkg.VersionList(); !ver.end(); ++ver) {
+            if (change.version == ver.VerStr()) {
+                break;
+            }
+        }
+        if (ver.end()) {
+            return false;
+        }
+
+        // the resolver already pulled in the dependencies
+        depCache->SetCandidateVersion(ver);
+        if (change.reinstall) {
+            depCache->SetReInstall(pkg, true);
+        } else {
+            depCache->MarkInstall(pkg, false, 0, true);
+        }
+        depCache->MarkAuto(pkg, change.autoInstalled);
+    }
+
+    return depCache->BrokenCount() == 0;
+}
+
+std::string AptCacheFile::solutionGeneration()
+{
+    std::string generation;
+
+    // dpkg replaces the status file on every change, and the package
+    // cache is rebuilt when the sources change
+    for (const char *file : { "Dir::State::status", "Dir::Cache::pkgcache" }) {
+        const std::string path = _config->FindFile(file);
+        struct stat st;
+        if (path.empty() || stat(path.c_str(), &st) != 0) {
+            return std::string();
+        }
+        generation += std::to_string(st.st_ino) + ":" +
+                std::to_string(st.st_mtim.tv_sec) + "." +
+                std::to_string(st.st_mtim.tv_nsec) + ":" +
+                std::to_string(st.st_size) + ";";
+    }
+    return generation;
+}
+
+void AptCacheFile::freeSolution(gpointer solution)
+{
+    delete static_cast<AptSolution*>(solution);
 }
 
 std::string AptCacheFile::debParser(std::string descr)
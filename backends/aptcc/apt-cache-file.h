@@ -27,6 +27,22 @@
 #include <apt-pkg/progress.h>
 #include <pk-backend.h>
 
+#include <string>
+#include <vector>
+
+/**
+ * A package the dependency solver marked for a change
+ */
+struct AptSolutionChange {
+    std::string name;
+    std::string arch;
+    std::string version;
+    bool remove;
+    bool reinstall;
+    bool autoInstalled;
+};
+typedef std::vector<AptSolutionChange> AptSolution;
+
 class pkgProblemResolver;
 class AptCacheFile : public pkgCacheFile
 {
@@ -142,8 +158,32 @@ public:
     void tryToRemove(pkgProblemResolver &Fix,
                      const pkgCache::VerIterator &ver);
 
+    /**
+     * Saves the changes marked in the dependency cache, so a later
+     * transaction can mark them again without running the resolver
+     * @returns the solution, or nullptr if nothing is going to be installed
+     * or removed
+     */
+    AptSolution *saveSolution();
+
+    /**
+     * Marks the changes of a saved solution
+     * @returns false if the solution no longer applies cleanly, in which
+     * case the marks are left as they are
+     */
+    bool applySolution(const AptSolution &solution);
+
+    /**
+     * Identifies the dpkg status and package cache a solution is found with
+     * @returns an empty string if the files cannot be checked
+     */
+    static std::string solutionGeneration();
+
+    static void freeSolution(gpointer solution);
+
 private:
     void buildPkgRecords();
+    void markDelete(const pkgCache::PkgIterator &pkg);
     static std::string debParser(std::string descr);
 
     pkgRecords *m_packageRecords;
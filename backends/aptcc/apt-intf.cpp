@@ -2193,15 +2193,9 @@ PkgList AptIntf::resolveLocalFiles(gchar **localDebs)
     return ret;
 }
 
-bool AptIntf::runTransaction(const PkgList &install, const PkgList &remove, const PkgList &update,
-                             bool fixBroken, PkBitfield flags, bool autoremove)
+bool AptIntf::solveTransaction(const PkgList &install, const PkgList &remove, const PkgList &update,
+                               bool autoremove)
 {
-    //cout << "runTransaction" << simulate << remove << endl;
-
-    pk_backend_job_set_status (m_job, PK_STATUS_ENUM_RUNNING);
-
-    bool simulate = pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
-
     // Enter the special broken fixing mode if the user specified arguments
     // THIS mode will run if fixBroken is false and the cache has broken packages
     bool BrokenFix = false;
@@ -2278,6 +2272,40 @@ bool AptIntf::runTransaction(const PkgList &install, const PkgList &remove, cons
         }
     }
 
+    return true;
+}
+
+bool AptIntf::runTransaction(const PkgList &install, const PkgList &remove, const PkgList &update,
+                             bool fixBroken, PkBitfield flags, bool autoremove)
+{
+    //cout << "runTransaction" << simulate << remove << endl;
+
+    pk_backend_job_set_status (m_job, PK_STATUS_ENUM_RUNNING);
+
+    bool simulate = pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
+    PkBackend *backend = PK_BACKEND(pk_backend_job_get_backend(m_job));
+    const std::string generation = AptCacheFile::solutionGeneration();
+
+    // Reuse the changes the simulate worked out if nothing changed since
+    bool solved = false;
+    if (!simulate && !generation.empty()) {
+        AptSolution *solution = static_cast<AptSolution*>(pk_backend_take_solution(backend,
+                                                                                   m_job,
+                                                                                   generation.c_str()));
+        if (solution != nullptr) {
+            solved = m_cache->applySolution(*solution);
+            AptCacheFile::freeSolution(solution);
+            if (!solved) {
+                g_debug("The simulated solution does not apply, solving again");
+                (*m_cache)->Init(nullptr);
+            }
+        }
+    }
+
+    if (!solved && !solveTransaction(install, remove, update, autoremove)) {
+        return false;
+    }
+
     // Prepare for the restart thing
     struct stat restartStatStart;
     if (g_file_test(REBOOT_REQUIRED, G_FILE_TEST_EXISTS)) {
@@ -2288,6 +2316,15 @@ bool AptIntf::runTransaction(const PkgList &install, const PkgList &remove, cons
     // will just calculate the trusted packages
     const auto ret = installPackages(flags);
 
+    // Keep what was solved so the real transaction can skip the resolver
+    if (ret && simulate && !generation.empty()) {
+        AptSolution *solution = m_cache->saveSolution();
+        if (solution != nullptr) {
+            pk_backend_add_solution(backend, m_job, generation.c_str(),
+                                    solution, AptCacheFile::freeSolution);
+        }
+    }
+
     if (g_file_test(REBOOT_REQUIRED, G_FILE_TEST_EXISTS)) {
         struct stat restartStat;
         g_stat(REBOOT_REQUIRED, &restartStat);
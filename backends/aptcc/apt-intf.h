@@ -252,6 +252,14 @@ private:
      *  interprets dpkg status fd
      */
     void updateInterface(int readFd, int writeFd);
+
+    /**
+     *  marks the packages to install/remove/update and runs the resolver
+     */
+    bool solveTransaction(const PkgList &install,
+                          const PkgList &remove,
+                          const PkgList &update,
+                          bool autoremove);
     PkgList checkChangedPackages(bool emitChanged);
     pkgCache::VerIterator findTransactionPackage(const std::string &name);
 
@@ -59,6 +59,7 @@ typedef struct {
 	GMutex		 sack_mutex;
 	GTimer		*repos_timer;
 	gchar		*release_ver;
+	guint		 sack_generation;
 } PkBackendDnfPrivate;
 
 typedef struct {
@@ -68,8 +69,16 @@ typedef struct {
 	PkBackend	*backend;
 	PkBitfield	 transaction_flags;
 	HyGoal		 goal;
+	DnfSack		*sack;		/* of goal, when it can be reused */
+	gboolean	 goal_solved;
 } PkBackendDnfJobData;
 
+typedef struct {
+	DnfSack		*sack;
+	DnfTransaction	*transaction;
+	HyGoal		 goal;
+} PkBackendDnfSolution;
+
 const gchar *
 pk_backend_get_description (PkBackend *backend)
 {
@@ -97,6 +106,9 @@ pk_backend_sack_cache_invalidate (PkBackend *backend, const gchar *why)
 	g_autoptr(GList) values = NULL;
 	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->sack_mutex);
 
+	/* any kept solution was found with the old sacks */
+	priv->sack_generation++;
+
 	/* set all the cached sacks as invalid */
 	values = g_hash_table_get_values (priv->sack_cache);
 	for (l = values; l != NULL; l = l->next) {
@@ -108,6 +120,28 @@ pk_backend_sack_cache_invalidate (PkBackend *backend, const gchar *why)
 	}
 }
 
+static gboolean
+pk_backend_sack_cache_item_invalid_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	DnfSackCacheItem *cache_item = value;
+	return !cache_item->valid;
+}
+
+void
+pk_backend_standby (PkBackend *backend)
+{
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->sack_mutex);
+	guint removed;
+
+	/* invalid sacks are otherwise only freed when the key is next used */
+	removed = g_hash_table_foreach_remove (priv->sack_cache,
+					       pk_backend_sack_cache_item_invalid_cb,
+					       NULL);
+	g_debug ("dropped %u invalid sacks, keeping %u",
+		 removed, g_hash_table_size (priv->sack_cache));
+}
+
 static void
 pk_backend_yum_repos_changed_cb (DnfRepoLoader *repo_loader, PkBackend *backend)
 {
@@ -496,6 +530,8 @@ pk_backend_stop_job (PkBackend *backend, PkBackendJob *job)
 		g_object_unref (job_data->context);
 	if (job_data->goal != NULL)
 		hy_goal_free (job_data->goal);
+	if (job_data->sack != NULL)
+		g_object_unref (job_data->sack);
 	g_free (job_data);
 	pk_backend_job_set_user_data (job, NULL);
 }
@@ -1754,18 +1790,28 @@ dnf_utils_find_package_ids (DnfSack *sack, gchar **package_ids, GError **error)
 				      g_free, (GDestroyNotify) g_object_unref);
 	query = hy_query_create (sack);
 	for (i = 0; package_ids[i] != NULL; i++) {
-		g_auto(GStrv) split = NULL;
+		PkPackageIdView view;
+		g_autofree gchar *id = NULL;
+
+		/* terminate the parts in a single copy of the ID rather
+		 * than allocating a strv for each one */
+		id = g_strdup (package_ids[i]);
+		if (!pk_package_id_view_init (&view, id))
+			continue;
+		id[view.name_len] = '\0';
+		id[view.version - view.name + view.version_len] = '\0';
+		id[view.arch - view.name + view.arch_len] = '\0';
+
 		hy_query_clear (query);
-		split = pk_package_id_split (package_ids[i]);
-		reponame = split[PK_PACKAGE_ID_DATA];
+		reponame = view.data;
 		if (g_strcmp0 (reponame, "installed") == 0 ||
 		    g_str_has_prefix (reponame, "installed:"))
 			reponame = HY_SYSTEM_REPO_NAME;
 		else if (g_strcmp0 (reponame, "local") == 0)
 			reponame = HY_CMDLINE_REPO_NAME;
-		hy_query_filter (query, HY_PKG_NAME, HY_EQ, split[PK_PACKAGE_ID_NAME]);
-		hy_query_filter (query, HY_PKG_EVR, HY_EQ, split[PK_PACKAGE_ID_VERSION]);
-		hy_query_filter (query, HY_PKG_ARCH, HY_EQ, split[PK_PACKAGE_ID_ARCH]);
+		hy_query_filter (query, HY_PKG_NAME, HY_EQ, view.name);
+		hy_query_filter (query, HY_PKG_EVR, HY_EQ, view.version);
+		hy_query_filter (query, HY_PKG_ARCH, HY_EQ, view.arch);
 		hy_query_filter (query, HY_PKG_REPONAME, HY_EQ, reponame);
 		pkglist = hy_query_run (query);
 
@@ -2488,6 +2534,44 @@ pk_backend_get_download_rpms (HyGoal goal)
 	return g_steal_pointer (&download_rpms);
 }
 
+static void
+pk_backend_dnf_solution_free (PkBackendDnfSolution *solution)
+{
+	if (solution->goal != NULL)
+		hy_goal_free (solution->goal);
+	g_object_unref (solution->transaction);
+	g_object_unref (solution->sack);
+	g_free (solution);
+}
+
+static gchar *
+pk_backend_dnf_get_generation (PkBackend *backend)
+{
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->sack_mutex);
+	return g_strdup_printf ("%u", priv->sack_generation);
+}
+
+/* keep the depsolved goal of a simulate for the real transaction */
+static void
+pk_backend_add_dnf_solution (PkBackendJob *job)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfSolution *solution;
+	g_autofree gchar *generation = NULL;
+
+	if (job_data->sack == NULL)
+		return;
+
+	solution = g_new0 (PkBackendDnfSolution, 1);
+	solution->sack = g_steal_pointer (&job_data->sack);
+	solution->goal = g_steal_pointer (&job_data->goal);
+	solution->transaction = g_object_ref (job_data->transaction);
+	generation = pk_backend_dnf_get_generation (job_data->backend);
+	pk_backend_add_solution (job_data->backend, job, generation, solution,
+				 (GDestroyNotify) pk_backend_dnf_solution_free);
+}
+
 static gboolean
 pk_backend_transaction_run (PkBackendJob *job,
 			    DnfState *state,
@@ -2521,13 +2605,16 @@ pk_backend_transaction_run (PkBackendJob *job,
 
 	dnf_transaction_set_flags (job_data->transaction, flags);
 
-	state_local = dnf_state_get_child (state);
-	ret = dnf_transaction_depsolve (job_data->transaction,
-					job_data->goal,
-					state_local,
-					error);
-	if (!ret)
-		return FALSE;
+	/* the simulate already depsolved the goal */
+	if (!job_data->goal_solved) {
+		state_local = dnf_state_get_child (state);
+		ret = dnf_transaction_depsolve (job_data->transaction,
+						job_data->goal,
+						state_local,
+						error);
+		if (!ret)
+			return FALSE;
+	}
 
 	/* done */
 	if (!dnf_state_done (state, error))
@@ -2542,6 +2629,7 @@ pk_backend_transaction_run (PkBackendJob *job,
 						       error);
 		if (!ret)
 			return FALSE;
+		pk_backend_add_dnf_solution (job);
 		return dnf_state_done (state, error);
 	}
 
@@ -2565,6 +2653,41 @@ pk_backend_transaction_run (PkBackendJob *job,
 	return dnf_state_done (state, error);
 }
 
+/*
+ * pk_backend_commit_dnf_solution:
+ *
+ * Commits the goal the simulate solved if the client passed its token and
+ * nothing changed since.
+ *
+ * Return value: %FALSE if the goal has to be built and solved again
+ */
+static gboolean
+pk_backend_commit_dnf_solution (PkBackendJob *job)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfSolution *solution;
+	g_autofree gchar *generation = NULL;
+	g_autoptr(GError) error = NULL;
+
+	generation = pk_backend_dnf_get_generation (job_data->backend);
+	solution = pk_backend_take_solution (job_data->backend, job, generation);
+	if (solution == NULL)
+		return FALSE;
+
+	/* the transaction already knows what to download */
+	g_set_object (&job_data->transaction, solution->transaction);
+	dnf_transaction_set_uid (job_data->transaction,
+				 pk_backend_job_get_uid (job));
+	job_data->sack = g_object_ref (solution->sack);
+	job_data->goal = g_steal_pointer (&solution->goal);
+	job_data->goal_solved = TRUE;
+	pk_backend_dnf_solution_free (solution);
+
+	if (!pk_backend_transaction_run (job, job_data->state, &error))
+		pk_backend_job_error_code (job, error->code, "%s", error->message);
+	return TRUE;
+}
+
 static void
 pk_backend_repo_remove_thread (PkBackendJob *job,
 			       GVariant *params,
@@ -2825,6 +2948,10 @@ pk_backend_remove_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 	pk_backend_job_set_percentage (job, 0);
 
+	/* the simulate already worked out what to do */
+	if (pk_backend_commit_dnf_solution (job))
+		return;
+
 	/* set state */
 	ret = dnf_state_set_steps (job_data->state, NULL,
 				   3, /* add repos */
@@ -2905,6 +3032,7 @@ pk_backend_remove_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 
 	/* remove packages */
 	job_data->goal = hy_goal_create (sack);
+	job_data->sack = g_object_ref (sack);
 	for (i = 0; package_ids[i] != NULL; i++) {
 		pkg = g_hash_table_lookup (hash, package_ids[i]);
 		if (pkg == NULL) {
@@ -2972,6 +3100,10 @@ pk_backend_install_packages_thread (PkBackendJob *job, GVariant *params, gpointe
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 	pk_backend_job_set_percentage (job, 0);
 
+	/* the simulate already worked out what to do */
+	if (pk_backend_commit_dnf_solution (job))
+		return;
+
 	/* set state */
 	ret = dnf_state_set_steps (job_data->state, NULL,
 				   3, /* add repos */
@@ -3093,6 +3225,7 @@ pk_backend_install_packages_thread (PkBackendJob *job, GVariant *params, gpointe
 
 	/* install packages */
 	job_data->goal = hy_goal_create (sack);
+	job_data->sack = g_object_ref (sack);
 	for (i = 0; package_ids[i] != NULL; i++) {
 		pkg = g_hash_table_lookup (hash, package_ids[i]);
 		if (pkg == NULL) {
@@ -3161,6 +3294,10 @@ pk_backend_install_files_thread (PkBackendJob *job, GVariant *params, gpointer u
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 	pk_backend_job_set_percentage (job, 0);
 
+	/* the simulate already worked out what to do */
+	if (pk_backend_commit_dnf_solution (job))
+		return;
+
 	/* set state */
 	ret = dnf_state_set_steps (job_data->state, NULL,
 				   50, /* add repos */
@@ -3214,6 +3351,7 @@ pk_backend_install_files_thread (PkBackendJob *job, GVariant *params, gpointer u
 
 	/* install packages */
 	job_data->goal = hy_goal_create (sack);
+	job_data->sack = g_object_ref (sack);
 	for (i = 0; i < array->len; i++) {
 		pkg = g_ptr_array_index (array, i);
 		hy_goal_install (job_data->goal, pkg);
@@ -3272,6 +3410,10 @@ pk_backend_update_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 	pk_backend_job_set_percentage (job, 0);
 
+	/* the simulate already worked out what to do */
+	if (pk_backend_commit_dnf_solution (job))
+		return;
+
 	/* set state */
 	ret = dnf_state_set_steps (job_data->state, NULL,
 				   9, /* add repos */
@@ -3318,6 +3460,7 @@ pk_backend_update_packages_thread (PkBackendJob *job, GVariant *params, gpointer
 
 	/* install packages */
 	job_data->goal = hy_goal_create (sack);
+	job_data->sack = g_object_ref (sack);
 	for (i = 0; package_ids[i] != NULL; i++) {
 		pkg = g_hash_table_lookup (hash, package_ids[i]);
 		if (pkg == NULL) {
@@ -497,7 +497,7 @@ pk_backend_install_thread (PkBackendJob *job, GVariant *params, gpointer user_da
 	while (TRUE) {
 
 		/* check cancelled */
-		if (g_cancellable_is_cancelled (job_data->cancellable)) {
+		if (pk_backend_job_is_cancelled (job)) {
 			pk_backend_job_error_code (job,
 						   PK_ERROR_ENUM_TRANSACTION_CANCELLED,
 						   "The task was stopped successfully");
@@ -528,8 +528,8 @@ pk_backend_install_thread (PkBackendJob *job, GVariant *params, gpointer user_da
 		job_data->progress_percentage += 1;
 		pk_backend_job_set_percentage (job, job_data->progress_percentage);
 
-		/* sleep 100 milliseconds */
-		g_usleep (100000);
+		/* sleep 100 milliseconds, waking up if cancelled */
+		pk_backend_job_wait_cancelled (job, 100);
 	}
 
 	/* unlock backend again */
@@ -698,8 +698,11 @@ pk_backend_refresh_cache_thread (PkBackendJob *job, GVariant *params, gpointer u
 
 	while (TRUE) {
 
+		/* safe point, wait here while a foreground transaction runs */
+		pk_backend_job_check_suspended (job);
+
 		/* check cancelled */
-		if (g_cancellable_is_cancelled (job_data->cancellable)) {
+		if (pk_backend_job_is_cancelled (job)) {
 			pk_backend_job_error_code (job,
 						   PK_ERROR_ENUM_TRANSACTION_CANCELLED,
 						   "The task was stopped successfully");
@@ -714,8 +717,8 @@ pk_backend_refresh_cache_thread (PkBackendJob *job, GVariant *params, gpointer u
 		job_data->progress_percentage += 10;
 		pk_backend_job_set_percentage (job, job_data->progress_percentage);
 
-		/* sleep 500 milliseconds */
-		g_usleep (500000);
+		/* sleep 500 milliseconds, waking up if cancelled */
+		pk_backend_job_wait_cancelled (job, 500);
 	}
 
 	/* unlock backend again */
@@ -894,11 +897,9 @@ pk_backend_search_groups (PkBackend *backend, PkBackendJob *job, PkBitfield filt
 static void
 pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
-	guint i;
 	const gchar *locale;
 	PkRoleEnum role;
 	PkBitfield filters;
-	PkBackendDummyJobData *job_data = pk_backend_job_get_user_data (job);
 	g_autofree gchar **search = NULL;
 
 	role = pk_backend_job_get_role (job);
@@ -911,15 +912,12 @@ pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer us
 			       &search);
 	}
 
-	/* delay, checking cancelled */
-	for (i = 0; i < 1000; i++) {
-		if (g_cancellable_is_cancelled (job_data->cancellable)) {
-			pk_backend_job_error_code (job,
-						   PK_ERROR_ENUM_TRANSACTION_CANCELLED,
-						   "The task was stopped successfully");
-			return;
-		}
-		g_usleep (2000);
+	/* delay, waking up if cancelled */
+	if (pk_backend_job_wait_cancelled (job, 2000)) {
+		pk_backend_job_error_code (job,
+					   PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+					   "The task was stopped successfully");
+		return;
 	}
 
 	locale = pk_backend_job_get_locale (job);
@@ -967,7 +965,7 @@ pk_backend_update_packages_download_thread (PkBackendJob *job, GVariant *params,
 	while (TRUE) {
 
 		/* check cancelled */
-		if (g_cancellable_is_cancelled (job_data->cancellable)) {
+		if (pk_backend_job_is_cancelled (job)) {
 			pk_backend_job_error_code (job,
 						   PK_ERROR_ENUM_TRANSACTION_CANCELLED,
 						   "The task was stopped successfully");
@@ -1051,8 +1049,8 @@ pk_backend_update_packages_download_thread (PkBackendJob *job, GVariant *params,
 		job_data->progress_percentage += 1;
 		pk_backend_job_set_percentage (job, job_data->progress_percentage);
 
-		/* sleep 200 milliseconds */
-		g_usleep (200000);
+		/* sleep 200 milliseconds, waking up if cancelled */
+		pk_backend_job_wait_cancelled (job, 200);
 	}
 
 	/* unlock backend again */
@@ -1593,6 +1591,12 @@ pk_backend_supports_parallelization (PkBackend *backend)
 	return TRUE;
 }
 
+PkBitfield
+pk_backend_get_resumable_roles (PkBackend *backend)
+{
+	return pk_bitfield_value (PK_ROLE_ENUM_REFRESH_CACHE);
+}
+
 const gchar *
 pk_backend_get_description (PkBackend *backend)
 {
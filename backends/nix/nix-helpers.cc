@@ -19,6 +19,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include "nix-helpers.hh"
 
 // find drv based on attrpath and system
@@ -72,12 +78,12 @@ nix_get_drvs_from_ids (EvalState & state, DrvInfos drvs, gchar** package_ids)
 	return _drvs;
 }
 
-// return false if drvinfo doesn't conflicts with a filter
+// return false if the package conflicts with a filter
 bool
-nix_filter_drv (EvalState & state, DrvInfo & drv, const Settings & settings, PkBitfield filters)
+nix_filter_package (const NixPackage & package, const Settings & settings, PkBitfield filters)
 {
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_VISIBLE) || pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_VISIBLE))
-		if (!drv.hasFailed ())
+		if (!package.failed)
 		{
 			if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_VISIBLE))
 				return FALSE;
@@ -89,7 +95,7 @@ nix_filter_drv (EvalState & state, DrvInfo & drv, const Settings & settings, PkB
 		}
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_ARCH) || pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_ARCH))
-		if (drv.querySystem() == settings.thisSystem)
+		if (package.system == settings.thisSystem)
 		{
 			if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_ARCH))
 				return FALSE;
@@ -103,6 +109,264 @@ nix_filter_drv (EvalState & state, DrvInfo & drv, const Settings & settings, PkB
 	return TRUE;
 }
 
+// generate package id from an index entry
+gchar*
+nix_package_id (const NixPackage & package)
+{
+	DrvName name (package.name);
+
+	return pk_package_id_build (
+		name.name.c_str (),
+		name.version.c_str (),
+		package.system.c_str (),
+		package.attrPath.c_str ()
+	);
+}
+
+// number of packages processed between progress and cancellation checks
+static const size_t nix_match_block_size = 1024;
+
+// extract the metadata needed for searching from evaluated derivations
+//
+// querying the metadata evaluates the derivations lazily, and EvalState
+// isn't thread-safe, so this has to run in a single thread
+//
+// the job may be suspended between blocks; if it is cancelled the index is
+// incomplete and must not be saved
+NixPackages
+nix_get_packages_from_drvs (PkBackendJob* job, DrvInfos & drvs)
+{
+	NixPackages packages;
+	size_t n = 0;
+
+	packages.reserve (drvs.size ());
+	for (auto & drv : drvs)
+	{
+		packages.push_back ({
+			drv.attrPath,
+			drv.queryName (),
+			drv.querySystem (),
+			drv.queryMetaString ("description"),
+			drv.hasFailed ()
+		});
+
+		if (job != NULL && ++n % nix_match_block_size == 0)
+		{
+			if (!pk_backend_job_check_suspended (job))
+				break;
+			pk_backend_job_set_percentage (job, n * 100 / drvs.size ());
+		}
+	}
+
+	return packages;
+}
+
+// each worker thread gets at least this many packages, so small indexes are
+// scanned serially in the job thread
+static const size_t nix_match_worker_size = 16 * nix_match_block_size;
+
+// upper bound for the worker threads of a single search
+static const size_t nix_match_max_workers = 4;
+
+// run match over the package index and return the matching packages in
+// index order; large indexes are split over a few worker threads
+//
+// match may be called concurrently and must not touch the EvalState
+std::vector<const NixPackage*>
+nix_match_packages (PkBackendJob* job, const NixPackages & packages, const std::function<bool (const NixPackage &)> & match)
+{
+	size_t nThreads = std::min ({
+		(size_t) std::max (1u, std::thread::hardware_concurrency ()),
+		nix_match_max_workers,
+		std::max ((size_t) 1, packages.size () / nix_match_worker_size)
+	});
+	size_t chunk = (packages.size () + nThreads - 1) / nThreads;
+	std::vector<std::vector<const NixPackage*>> results (nThreads);
+	std::vector<std::thread> workers;
+	std::atomic<size_t> done (0);
+
+	auto worker = [&] (size_t n)
+	{
+		size_t begin = std::min (n * chunk, packages.size ());
+		size_t end = std::min (begin + chunk, packages.size ());
+
+		for (size_t i = begin; i < end; i += nix_match_block_size)
+		{
+			if (pk_backend_job_is_cancelled (job))
+				break;
+
+			size_t blockEnd = std::min (i + nix_match_block_size, end);
+			for (size_t j = i; j < blockEnd; j++)
+				if (match (packages[j]))
+					results[n].push_back (&packages[j]);
+
+			done += blockEnd - i;
+
+			// the job thread reports the progress of all workers
+			if (n == 0)
+				pk_backend_job_set_percentage (job, done * 100 / packages.size ());
+		}
+	};
+
+	for (size_t n = 1; n < nThreads; n++)
+		workers.emplace_back (worker, n);
+	worker (0);
+	for (auto & thread : workers)
+		thread.join ();
+
+	std::vector<const NixPackage*> matches;
+	for (auto & result : results)
+		matches.insert (matches.end (), result.begin (), result.end ());
+
+	return matches;
+}
+
+// names of the derivations installed in the profile, for installed checks
+std::unordered_set<string>
+nix_get_installed_names (EvalState & state, const Path & profile)
+{
+	std::unordered_set<string> names;
+
+	for (auto & drv : queryInstalled (state, profile))
+		names.insert (drv.queryName ());
+
+	return names;
+}
+
+// the index is valid as long as the nix expressions in ~/.nix-defexpr point
+// to the same store paths, i.e. until a channel is updated
+static string
+nix_get_index_key (const Path & homedir)
+{
+	std::vector<string> targets;
+	Path defexpr = homedir + "/.nix-defexpr";
+	const gchar* entry;
+
+	GDir* dir = g_dir_open (defexpr.c_str (), 0, NULL);
+	if (dir == NULL)
+		return "";
+
+	while ((entry = g_dir_read_name (dir)) != NULL)
+	{
+		gchar* target = realpath ((defexpr + "/" + entry).c_str (), NULL);
+		if (target != NULL)
+		{
+			targets.push_back (string (entry) + "=" + target);
+			free (target);
+		}
+	}
+	g_dir_close (dir);
+
+	std::sort (targets.begin (), targets.end ());
+
+	string key;
+	for (auto & target : targets)
+		key += target + ";";
+
+	return key;
+}
+
+static string
+nix_get_index_path ()
+{
+	return string (LOCALSTATEDIR) + "/cache/PackageKit/nix/packages";
+}
+
+// index fields are separated by tabs, one derivation per line
+static string
+nix_index_field (const string & value)
+{
+	string field (value);
+
+	for (auto & c : field)
+		if (c == '\t' || c == '\n')
+			c = ' ';
+
+	return field;
+}
+
+// load the package index written by nix_save_package_index, if it belongs
+// to the current channels
+bool
+nix_load_package_index (const Path & homedir, NixPackages & packages)
+{
+	g_autofree gchar* contents = NULL;
+	gsize length;
+
+	string key = nix_get_index_key (homedir);
+	if (key.empty ())
+		return false;
+
+	if (!g_file_get_contents (nix_get_index_path ().c_str (), &contents, &length, NULL))
+		return false;
+
+	const gchar* line = contents;
+	const gchar* end = contents + length;
+	const gchar* eol = (const gchar*) memchr (line, '\n', end - line);
+	if (eol == NULL || key.compare (0, string::npos, line, eol - line) != 0)
+		return false;
+
+	NixPackages loaded;
+	for (line = eol + 1; line < end; line = eol + 1)
+	{
+		eol = (const gchar*) memchr (line, '\n', end - line);
+		if (eol == NULL)
+			eol = end;
+
+		const gchar* fields[5];
+		const gchar* field = line;
+		guint n = 0;
+		for (const gchar* c = line; c < eol && n < G_N_ELEMENTS (fields) - 1; c++)
+			if (*c == '\t')
+			{
+				fields[n++] = field;
+				field = c + 1;
+			}
+		fields[n++] = field;
+		if (n != G_N_ELEMENTS (fields))
+			return false;
+
+		loaded.push_back ({
+			string (fields[0], fields[1] - fields[0] - 1),
+			string (fields[1], fields[2] - fields[1] - 1),
+			string (fields[2], fields[3] - fields[2] - 1),
+			string (fields[4], eol - fields[4]),
+			fields[3][0] == '1'
+		});
+	}
+
+	packages.swap (loaded);
+	return true;
+}
+
+// save the package index so that searches don't have to evaluate the
+// nix expressions again after a restart
+void
+nix_save_package_index (const Path & homedir, const NixPackages & packages)
+{
+	g_autoptr (GError) error = NULL;
+
+	string key = nix_get_index_key (homedir);
+	if (key.empty ())
+		return;
+
+	string contents (key + "\n");
+	for (auto & package : packages)
+	{
+		contents += nix_index_field (package.attrPath) + "\t";
+		contents += nix_index_field (package.name) + "\t";
+		contents += nix_index_field (package.system) + "\t";
+		contents += package.failed ? "1\t" : "0\t";
+		contents += nix_index_field (package.description) + "\n";
+	}
+
+	Path path = nix_get_index_path ();
+	g_autofree gchar* dir = g_path_get_dirname (path.c_str ());
+	g_mkdir_with_parents (dir, 0755);
+	if (!g_file_set_contents (path.c_str (), contents.c_str (), contents.size (), &error))
+		g_warning ("failed to save the package index: %s", error->message);
+}
+
 // get current state
 EvalState*
 nix_get_state ()
@@ -143,10 +407,28 @@ nix_get_profile (PkBackendJob* job)
 	return homedir + "/.nix-profile";
 }
 
+typedef struct {
+	PkBackendJobThreadFunc	 func;
+	gpointer		 data;
+} PkNixRunHelper;
+
+// let checkInterrupt () in the evaluator abort the job's thread on cancel
+static void
+pk_nix_run_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	PkNixRunHelper *helper = (PkNixRunHelper *) user_data;
+
+	interruptCheck = [job] () { return (bool) pk_backend_job_is_cancelled (job); };
+	helper->func (job, params, helper->data);
+	interruptCheck = nullptr;
+}
+
 // run func in a thread
 void
 pk_nix_run (PkBackendJob *job, PkStatusEnum status, PkBackendJobThreadFunc func, gpointer data)
 {
+	PkNixRunHelper *helper;
+
 	g_return_if_fail (func != NULL);
 
 	pk_backend_job_set_percentage (job, 0);
@@ -154,7 +436,10 @@ pk_nix_run (PkBackendJob *job, PkStatusEnum status, PkBackendJobThreadFunc func,
 	pk_backend_job_set_status (job, status);
 	pk_backend_job_set_started (job, TRUE);
 
-	pk_backend_job_thread_create (job, func, data, NULL);
+	helper = g_new0 (PkNixRunHelper, 1);
+	helper->func = func;
+	helper->data = data;
+	pk_backend_job_thread_create (job, pk_nix_run_thread, helper, g_free);
 }
 
 // emit an error if error not NULL
@@ -170,6 +455,12 @@ pk_nix_error_emit (PkBackendJob* job, GError* error)
 gboolean
 pk_nix_finish (PkBackendJob* job, GError* error)
 {
+	if (pk_backend_job_is_cancelled (job)) {
+		pk_backend_job_error_code (job, PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+					   "The task was cancelled");
+		return FALSE;
+	}
+
 	if (error != NULL) {
 		pk_nix_error_emit (job, error);
 		return FALSE;
@@ -25,6 +25,10 @@
 #include <pwd.h>
 #include <glib.h>
 
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
 #include <pk-backend.h>
 #include <pk-backend-job.h>
 
@@ -54,8 +58,38 @@ nix_drv_package_id (DrvInfo & drv);
 DrvInfo
 nix_find_drv (EvalState & state, DrvInfos drvs, gchar* package_id);
 
+// evaluated metadata of a derivation, as stored in the package index
+struct NixPackage
+{
+	string attrPath;
+	string name; // name with version, as returned by DrvInfo::queryName
+	string system;
+	string description;
+	bool failed;
+};
+
+typedef std::vector<NixPackage> NixPackages;
+
+NixPackages
+nix_get_packages_from_drvs (PkBackendJob* job, DrvInfos & drvs);
+
+std::vector<const NixPackage*>
+nix_match_packages (PkBackendJob* job, const NixPackages & packages, const std::function<bool (const NixPackage &)> & match);
+
+bool
+nix_load_package_index (const Path & homedir, NixPackages & packages);
+
+void
+nix_save_package_index (const Path & homedir, const NixPackages & packages);
+
+gchar*
+nix_package_id (const NixPackage & package);
+
 bool
-nix_filter_drv (EvalState & state, DrvInfo & drv, const Settings & settings, PkBitfield filters);
+nix_filter_package (const NixPackage & package, const Settings & settings, PkBitfield filters);
+
+std::unordered_set<string>
+nix_get_installed_names (EvalState & state, const Path & profile);
 
 Path
 nix_get_profile (PkBackendJob* job);
@@ -22,6 +22,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <gio/gio.h>
+#include <memory>
+#include <mutex>
 
 #include "nix-helpers.hh"
 #include "nix-lib-plus.hh"
@@ -33,6 +35,67 @@ typedef struct {
 static PkBackendNixPrivate* priv;
 static EvalState* state;
 static DrvInfos drvs;
+static std::shared_ptr<const NixPackages> packageIndex;
+static std::mutex packageIndexMutex;
+
+// get the package index, evaluating the nix expressions only if there is no
+// saved index for the current channels. The index is shared, so a refresh
+// doesn't invalidate it under running searches.
+static std::shared_ptr<const NixPackages>
+nix_get_packages (PkBackendJob* job)
+{
+	std::lock_guard<std::mutex> lock (packageIndexMutex);
+
+	if (!packageIndex)
+	{
+		auto packages = std::make_shared<NixPackages> ();
+
+		if (!nix_load_package_index (priv->roothome, *packages))
+		{
+			// possibly slow call
+			if (drvs.empty ())
+				drvs = nix_get_all_derivations (*state, priv->roothome);
+
+			*packages = nix_get_packages_from_drvs (job, drvs);
+			if (pk_backend_job_is_cancelled (job))
+				return packages;
+			nix_save_package_index (priv->roothome, *packages);
+		}
+		packageIndex = packages;
+	}
+
+	return packageIndex;
+}
+
+// emit the packages of the index accepted by match and the filters; the
+// index is scanned on all CPUs, the packages are emitted in index order
+static void
+nix_emit_matching_packages (PkBackendJob* job, const NixPackages & packages, const std::unordered_set<string> & installedNames, PkBitfield filters, const std::function<bool (const NixPackage &)> & match)
+{
+	auto matches = nix_match_packages (job, packages, [&] (const NixPackage & package)
+	{
+		if (!match (package) || !nix_filter_package (package, settings, filters))
+			return false;
+
+		bool installed = installedNames.count (package.name) > 0;
+
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && !installed)
+			return false;
+
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && installed)
+			return false;
+
+		return true;
+	});
+
+	for (auto package : matches)
+		pk_backend_job_package (
+			job,
+			installedNames.count (package->name) ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE,
+			nix_package_id (*package),
+			package->description.c_str ()
+		);
+}
 
 void
 pk_backend_initialize (GKeyFile* conf, PkBackend* backend)
@@ -187,6 +250,18 @@ pk_backend_get_roles (PkBackend* backend)
 	);
 }
 
+// downloads keep the paths already built, and a refresh keeps the
+// derivations already read, while a foreground transaction runs
+PkBitfield
+pk_backend_get_resumable_roles (PkBackend* backend)
+{
+	return pk_bitfield_from_enums (
+		PK_ROLE_ENUM_DOWNLOAD_PACKAGES,
+		PK_ROLE_ENUM_REFRESH_CACHE,
+		-1
+	);
+}
+
 gchar **
 pk_backend_get_mime_types (PkBackend* backend)
 {
@@ -261,48 +336,13 @@ pk_backend_get_packages_thread (PkBackendJob* job, GVariant* params, gpointer p)
 
 	try
 	{
-		// possibly slow call
-		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+		auto packages = nix_get_packages (job);
 
 		auto profile = nix_get_profile (job);
-		DrvInfos installedDrvs = queryInstalled (*state, profile);
-
-		int n = 0;
-		double percentFactor = 100 / drvs.size ();
-
-		for (auto drv : drvs)
-		{
-			if (pk_backend_job_is_cancelled (job))
-				break;
-
-			pk_backend_job_set_percentage (job, (n++) * percentFactor);
-
-			if (!nix_filter_drv (*state, drv, settings, filters))
-				continue;
-
-			auto info = PK_INFO_ENUM_AVAILABLE;
-
-			for (auto _drv : installedDrvs)
-				if (_drv.queryName() == drv.queryName())
-				{
-					info = PK_INFO_ENUM_INSTALLED;
-					break;
-				}
-
-			if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-				continue;
-
-			if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
-				continue;
+		auto installedNames = nix_get_installed_names (*state, profile);
 
-			pk_backend_job_package (
-				job,
-				info,
-				nix_drv_package_id (drv),
-				drv.queryMetaString ("description").c_str ()
-			);
-		}
+		nix_emit_matching_packages (job, *packages, installedNames, filters,
+			[] (const NixPackage & package) { return true; });
 	}
 	catch (std::exception & e)
 	{
@@ -328,12 +368,10 @@ pk_backend_resolve_thread (PkBackendJob* job, GVariant* params, gpointer p)
 
 	try
 	{
-		// possibly slow call
-		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+		auto packages = nix_get_packages (job);
 
 		auto profile = nix_get_profile (job);
-		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_get_installed_names (*state, profile);
 
 		for (; *search != NULL; ++search)
 		{
@@ -342,22 +380,15 @@ pk_backend_resolve_thread (PkBackendJob* job, GVariant* params, gpointer p)
 
 			DrvName searchName (*search);
 
-			for (auto drv : drvs)
+			for (auto & package : *packages)
 			{
-				DrvName drvName (drv.queryName());
+				DrvName drvName (package.name);
 				if (searchName.matches (drvName))
 				{
-					if (!nix_filter_drv (*state, drv, settings, filters))
+					if (!nix_filter_package (package, settings, filters))
 						continue;
 
-					auto info = PK_INFO_ENUM_AVAILABLE;
-
-					for (auto _drv : installedDrvs)
-						if (_drv.queryName() == drv.queryName())
-						{
-							info = PK_INFO_ENUM_INSTALLED;
-							break;
-						}
+					auto info = installedNames.count (package.name) ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE;
 
 					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
 						continue;
@@ -368,8 +399,8 @@ pk_backend_resolve_thread (PkBackendJob* job, GVariant* params, gpointer p)
 					pk_backend_job_package (
 						job,
 						info,
-						nix_drv_package_id (drv),
-						drv.queryMetaString ("description").c_str ()
+						nix_package_id (package),
+						package.description.c_str ()
 					);
 				}
 			}
@@ -399,46 +430,19 @@ pk_backend_search_names_thread (PkBackendJob* job, GVariant* params, gpointer p)
 
 	try
 	{
-		// possibly slow call
-		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+		auto packages = nix_get_packages (job);
 
 		auto profile = nix_get_profile (job);
-		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_get_installed_names (*state, profile);
 
 		for (; *search != NULL; ++search)
 		{
 			if (pk_backend_job_is_cancelled (job))
 				break;
 
-			for (auto drv : drvs)
-				if (drv.queryName().find(*search) != -1)
-				{
-					if (!nix_filter_drv (*state, drv, settings, filters))
-						continue;
-
-					auto info = PK_INFO_ENUM_AVAILABLE;
-
-					for (auto _drv : installedDrvs)
-						if (_drv.queryName() == drv.queryName())
-						{
-							info = PK_INFO_ENUM_INSTALLED;
-							break;
-						}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					pk_backend_job_package (
-						job,
-						info,
-						nix_drv_package_id (drv),
-						drv.queryMetaString ("description").c_str ()
-					);
-				}
+			string needle (*search);
+			nix_emit_matching_packages (job, *packages, installedNames, filters,
+				[&] (const NixPackage & package) { return package.name.find (needle) != string::npos; });
 		}
 	}
 	catch (std::exception & e)
@@ -465,46 +469,19 @@ pk_backend_search_details_thread (PkBackendJob* job, GVariant* params, gpointer
 
 	try
 	{
-		// possibly slow call
-		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+		auto packages = nix_get_packages (job);
 
 		auto profile = nix_get_profile (job);
-		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_get_installed_names (*state, profile);
 
 		for (; *value != NULL; ++value)
 		{
 			if (pk_backend_job_is_cancelled (job))
 				break;
 
-			for (auto drv : drvs)
-				if (drv.queryMetaString ("description").find (*value) != -1)
-				{
-					if (!nix_filter_drv (*state, drv, settings, filters))
-						continue;
-
-					auto info = PK_INFO_ENUM_AVAILABLE;
-
-					for (auto _drv : installedDrvs)
-						if (_drv.queryName() == drv.queryName())
-						{
-							info = PK_INFO_ENUM_INSTALLED;
-							break;
-						}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					pk_backend_job_package (
-						job,
-						info,
-						nix_drv_package_id (drv),
-						drv.queryMetaString ("description").c_str ()
-					);
-				}
+			string needle (*value);
+			nix_emit_matching_packages (job, *packages, installedNames, filters,
+				[&] (const NixPackage & package) { return package.description.find (needle) != string::npos; });
 		}
 	}
 	catch (std::exception & e)
@@ -529,6 +506,17 @@ pk_backend_refresh_cache_thread (PkBackendJob* job, GVariant* params, gpointer p
 	{
 		state = nix_get_state ();
 		drvs = nix_get_all_derivations (*state, priv->roothome);
+
+		auto packages = std::make_shared<NixPackages> (nix_get_packages_from_drvs (job, drvs));
+
+		// keep the old index rather than an incomplete one
+		if (!pk_backend_job_is_cancelled (job))
+		{
+			nix_save_package_index (priv->roothome, *packages);
+
+			std::lock_guard<std::mutex> lock (packageIndexMutex);
+			packageIndex = packages;
+		}
 	}
 	catch (std::exception & e)
 	{
@@ -857,7 +845,8 @@ pk_backend_download_packages_thread (PkBackendJob* job, GVariant* params, gpoint
 		PathSet paths;
 		for (auto drv : _drvs)
 		{
-			if (pk_backend_job_is_cancelled (job))
+			// blocks here while suspended
+			if (!pk_backend_job_check_suspended (job))
 				break;
 
 			pk_backend_job_package (
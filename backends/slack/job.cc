@@ -21,13 +21,31 @@ filter_package (PkBitfield filters, bool is_installed)
 }
 
 static std::string
-generate_query(PkBitfield filters)
+generate_query(const gchar *column, PkBitfield filters)
 {
 	std::string query(
 			"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
-			"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-			"WHERE p1.%s LIKE '%%%q%%' AND p1.ext NOT LIKE 'obsolete' AND p1.repo_order = "
-			"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)");
+			"p1.full_name FROM ");
+
+	/* Names and descriptions are looked up in the full-text index, the
+	 * package group is matched against the package list directly */
+	if (g_strcmp0 (column, "cat"))
+	{
+		query.append(
+				"pkglist_fts AS s JOIN pkglist AS p1 ON p1.rowid = s.rowid "
+				"JOIN best_repo AS b ON b.name = p1.name AND b.repo_order = p1.repo_order "
+				"JOIN repos AS r ON r.repo_order = p1.repo_order "
+				"WHERE s.%s LIKE '%%%q%%'");
+	}
+	else
+	{
+		query.append(
+				"pkglist AS p1 "
+				"JOIN best_repo AS b ON b.name = p1.name AND b.repo_order = p1.repo_order "
+				"JOIN repos AS r ON r.repo_order = p1.repo_order "
+				"WHERE p1.%s LIKE '%%%q%%'");
+	}
+	query.append(" AND p1.ext NOT LIKE 'obsolete'");
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION))
 	{
@@ -63,8 +81,9 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 	g_variant_get (params, "(t^a&s)", &filters, &vals);
 	gchar *search = g_strjoinv ("%", vals);
 
-	gchar *query = sqlite3_mprintf (slack::generate_query(filters).c_str(),
-			user_data, search);
+	auto column = static_cast<const gchar *> (user_data);
+	gchar *query = sqlite3_mprintf (slack::generate_query(column, filters).c_str(),
+			column, search);
 
 	sqlite3_stmt *stmt;
 	if ((sqlite3_prepare_v2 (job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
@@ -17,6 +17,9 @@ using namespace slack;
 
 static GSList *repos = NULL;
 
+/* Number of simultaneous connections used to download the repository metadata */
+static const glong max_connections = 4;
+
 void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 {
 	gchar *path, **groups;
@@ -84,6 +87,12 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 		g_error("Failed to update database: %s", path);
 	}
 
+	/* Databases created by older versions don't have the search tables yet */
+	if (!create_search_index(db))
+	{
+		g_warning("Failed to create the search index: %s", sqlite3_errmsg(db));
+	}
+
 	g_object_unref(file_info);
 	g_object_unref(conf_file);
 	sqlite3_close_v2(db);
@@ -268,8 +277,10 @@ pk_backend_search_files_thread(PkBackendJob *job, GVariant *params, gpointer use
 	search = g_strjoinv("%", vals);
 
 	query = sqlite3_mprintf("SELECT (p.name || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
-							"p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p NATURAL JOIN repos AS r "
-							"WHERE f.filename LIKE '%%%q%%' GROUP BY f.full_name", search);
+							"p.full_name FROM filelist_fts AS s JOIN filelist AS f ON f.rowid = s.rowid "
+							"JOIN pkglist AS p ON p.full_name = f.full_name "
+							"JOIN repos AS r ON r.repo_order = p.repo_order "
+							"WHERE s.filename LIKE '%%%q%%' GROUP BY f.full_name", search);
 
 	if ((sqlite3_prepare_v2(job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
 	{
@@ -412,9 +423,10 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 
 	if ((sqlite3_prepare_v2(job_data->db,
 							"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
-						   	"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @search AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
+						   	"p1.full_name FROM pkglist AS p1 "
+							"JOIN best_repo AS b ON b.name = p1.name AND b.repo_order = p1.repo_order "
+							"JOIN repos AS r ON r.repo_order = p1.repo_order "
+							"WHERE p1.name LIKE @search",
 							-1,
 							&stmt,
 							NULL) == SQLITE_OK)) {
@@ -752,9 +764,10 @@ pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user
 
 	if ((sqlite3_prepare_v2(job_data->db,
 							"SELECT p1.full_name, p1.name, p1.ver, p1.arch, r.repo, p1.summary, p1.ext "
-							"FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @name AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
+							"FROM pkglist AS p1 "
+							"JOIN best_repo AS b ON b.name = p1.name AND b.repo_order = p1.repo_order "
+							"JOIN repos AS r ON r.repo_order = p1.repo_order "
+							"WHERE p1.name LIKE @name",
 							-1,
 							&stmt,
 							NULL) != SQLITE_OK))
@@ -994,13 +1007,19 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 	/* Download repository */
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD_REPOSITORY);
 
-	for (GSList *l = file_list; l; l = g_slist_next(l))
+	if (get_files(file_list, max_connections, pk_backend_job_get_cancellable(job)))
 	{
-		get_file(&job_data->curl, static_cast<gchar **> (l->data)[0],
-				static_cast<gchar **> (l->data)[1]);
+		g_warning("Some repository files couldn't be downloaded");
 	}
 	g_slist_free_full(file_list, (GDestroyNotify)g_strfreev);
 
+	if (pk_backend_job_is_cancelled(job))
+	{
+		pk_backend_job_error_code(job, PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+		                          "The cache refresh was cancelled");
+		goto out;
+	}
+
 	/* Refresh cache */
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_REFRESH_CACHE);
 
@@ -1008,6 +1027,10 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 	{
 		static_cast<Pkgtools *> (l->data)->generate_cache (job, tmp_dir_name);
 	}
+	if (!update_search_index(job_data->db))
+	{
+		pk_backend_job_error_code(job, PK_ERROR_ENUM_INTERNAL_ERROR, "%s", sqlite3_errmsg(job_data->db));
+	}
 
 out:
 	sqlite3_finalize(stmt);
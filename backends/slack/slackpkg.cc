@@ -9,6 +9,123 @@ namespace slack {
 
 GHashTable *Slackpkg::cat_map = NULL;
 
+namespace {
+
+/* A part of the file list passed from the thread decompressing and parsing
+ * a MANIFEST to the thread inserting it into the database */
+struct ManifestBatch
+{
+	GStringChunk *strings;
+	GPtrArray *rows; /* Pairs of the package full name and the file name */
+	gboolean last;
+};
+
+struct ManifestPipe
+{
+	BZFILE *manifest_bz2;
+	GAsyncQueue *filled;
+	GAsyncQueue *free;
+};
+
+/* Number of files in a batch and number of batches that can be in flight */
+const guint manifest_batch_size = 4096;
+const guint manifest_batch_count = 4;
+
+}
+
+/*
+ * slack::Slackpkg::manifest_read:
+ * @data: a #ManifestPipe.
+ *
+ * Decompress and parse the manifest, passing the found files in batches to
+ * the inserting thread. The last batch sent is marked as such.
+ *
+ * The lines are scanned in place in the read buffer; only the names stored
+ * in the batch are copied.
+ */
+gpointer
+Slackpkg::manifest_read (gpointer data) noexcept
+{
+	gint err = BZ_OK, read_len;
+	gsize buf_len = 0, name_len, full_name_len = 0;
+	gchar buf[max_buf_size], full_name[max_buf_size];
+	const gchar *line, *eol, *end, *name, *pkg_filename;
+	const gchar *batch_full_name = NULL;
+	gboolean has_package = FALSE, skip_line = FALSE;
+	auto pipe = static_cast<ManifestPipe *> (data);
+	auto batch = static_cast<ManifestBatch *> (g_async_queue_pop(pipe->free));
+
+	while (err == BZ_OK)
+	{
+		read_len = BZ2_bzRead(&err, pipe->manifest_bz2, buf + buf_len, max_buf_size - buf_len);
+		if ((err != BZ_OK) && (err != BZ_STREAM_END))
+		{
+			break;
+		}
+		buf_len += read_len;
+		end = buf + buf_len;
+
+		for (line = buf; line != end; line = (eol == end) ? end : eol + 1)
+		{
+			eol = static_cast<const gchar *> (memchr(line, '\n', end - line));
+			if (!eol)
+			{
+				if (err != BZ_STREAM_END) /* The last line can be incomplete */
+				{
+					break;
+				}
+				eol = end;
+			}
+			if (skip_line)
+			{ /* The rest of a line that didn't fit into the buffer */
+				skip_line = FALSE;
+				continue;
+			}
+
+			if (manifest_package(line, eol - line, &name, &name_len))
+			{
+				if ((has_package = (name != NULL)))
+				{
+					memcpy(full_name, name, name_len);
+					full_name_len = name_len;
+				}
+				batch_full_name = NULL;
+			}
+			else if (has_package && (pkg_filename = manifest_file(line, eol - line)))
+			{
+				if (!batch_full_name)
+				{
+					batch_full_name = g_string_chunk_insert_len(batch->strings, full_name, full_name_len);
+				}
+				g_ptr_array_add(batch->rows, const_cast<gchar *> (batch_full_name));
+				g_ptr_array_add(batch->rows,
+						g_string_chunk_insert_len(batch->strings, pkg_filename, eol - pkg_filename));
+
+				if (batch->rows->len >= manifest_batch_size * 2)
+				{ /* Blocks if the inserting thread is behind */
+					g_async_queue_push(pipe->filled, batch);
+					batch = static_cast<ManifestBatch *> (g_async_queue_pop(pipe->free));
+					batch_full_name = NULL;
+				}
+			}
+		}
+
+		/* Move the incomplete line to the buffer beginning */
+		buf_len = end - line;
+		memmove(buf, line, buf_len);
+		if (buf_len == max_buf_size)
+		{
+			buf_len = 0;
+			skip_line = TRUE;
+		}
+	}
+
+	batch->last = TRUE;
+	g_async_queue_push(pipe->filled, batch);
+
+	return NULL;
+}
+
 /*
  * slack::Slackpkg::manifest:
  * @job:      a #PkBackendJob.
@@ -16,20 +133,20 @@ GHashTable *Slackpkg::cat_map = NULL;
  * @filename: manifest filename
  *
  * Parse the manifest file and save the file list in the database.
+ * Decompression and parsing run in a separate thread, so they overlap with
+ * the database inserts.
  */
 void
 Slackpkg::manifest (PkBackendJob *job,
 		const gchar *tmpl, gchar *filename) noexcept
 {
 	FILE *manifest;
-	gint err, read_len;
-	guint pos;
-	gchar buf[max_buf_size], *path, *pkg_filename, *rest = NULL, *start;
-	gchar *full_name = NULL;
-	gchar **line, **lines;
-	BZFILE *manifest_bz2;
-	GRegex *pkg_expr = NULL, *file_expr = NULL;
-	GMatchInfo *match_info;
+	gint err;
+	gchar *path;
+	gboolean last;
+	GThread *reader;
+	ManifestPipe pipe;
+	ManifestBatch *batch;
 	sqlite3_stmt *statement = NULL;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
@@ -44,24 +161,7 @@ Slackpkg::manifest (PkBackendJob *job,
 	{
 		return;
 	}
-	if (!(manifest_bz2 = BZ2_bzReadOpen(&err, manifest, 0, 0, NULL, 0)))
-	{
-		goto out;
-	}
-
-	/* Prepare regular expressions */
-	pkg_expr = g_regex_new("^\\|\\|[[:blank:]]+Package:[[:blank:]]+.+\\/(.+)\\.(t[blxg]z$)?",
-	                       static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
-	                       static_cast<GRegexMatchFlags> (0),
-	                       NULL);
-	file_expr = g_regex_new("^[-bcdlps][-r][-w][-xsS][-r][-w][-xsS][-r][-w]"
-	                        "[-xtT][[:space:]][^[:space:]]+[[:space:]]+"
-	                        "[[:digit:]]+[[:space:]][[:digit:]-]+[[:space:]]"
-	                        "[[:digit:]:]+[[:space:]](?!install\\/|\\.)(.*)",
-	                        static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
-	                        static_cast<GRegexMatchFlags> (0),
-	                        NULL);
-	if (!(file_expr) || !(pkg_expr))
+	if (!(pipe.manifest_bz2 = BZ2_bzReadOpen(&err, manifest, 0, 0, NULL, 0)))
 	{
 		goto out;
 	}
@@ -73,79 +173,62 @@ Slackpkg::manifest (PkBackendJob *job,
 						   &statement,
 						   NULL) != SQLITE_OK)
 	{
+		BZ2_bzReadClose(&err, pipe.manifest_bz2);
 		goto out;
 	}
 
+	pipe.filled = g_async_queue_new();
+	pipe.free = g_async_queue_new();
+	for (guint i = 0; i < manifest_batch_count; i++)
+	{
+		batch = g_new0(ManifestBatch, 1);
+		batch->strings = g_string_chunk_new(max_buf_size);
+		batch->rows = g_ptr_array_sized_new(manifest_batch_size * 2);
+		g_async_queue_push(pipe.free, batch);
+	}
+	reader = g_thread_new("slack-manifest", Slackpkg::manifest_read, &pipe);
+
 	sqlite3_exec(job_data->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
-	while ((read_len = BZ2_bzRead(&err, manifest_bz2, buf, max_buf_size - 1)))
+	do
 	{
-		if ((err != BZ_OK) && (err != BZ_STREAM_END))
-		{
-			break;
-		}
-		buf[read_len] = '\0';
-
-		/* Split the read text into lines */
-		lines = g_strsplit(buf, "\n", 0);
-		if (rest)
-		{ /* Add to the first line rest characters from the previous read operation */
-			start = lines[0];
-			lines[0] = g_strconcat(rest, lines[0], NULL);
-			g_free(start);
-			g_free(rest);
-		}
-		if (err != BZ_STREAM_END) /* The last line can be incomplete */
+		batch = static_cast<ManifestBatch *> (g_async_queue_pop(pipe.filled));
+
+		for (guint i = 0; i < batch->rows->len; i += 2)
 		{
-			pos = g_strv_length(lines) - 1;
-			rest = lines[pos];
-			lines[pos] = NULL;
+			sqlite3_bind_text(statement, 1,
+					static_cast<const gchar *> (g_ptr_array_index(batch->rows, i)),
+					-1, SQLITE_STATIC);
+			sqlite3_bind_text(statement, 2,
+					static_cast<const gchar *> (g_ptr_array_index(batch->rows, i + 1)),
+					-1, SQLITE_STATIC);
+			sqlite3_step(statement);
+			sqlite3_clear_bindings(statement);
+			sqlite3_reset(statement);
 		}
-		for (line = lines; *line; line++)
-		{
-			if (g_regex_match(pkg_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
-			{
-				if (g_match_info_get_match_count(match_info) > 2)
-				{ /* If the extension matches */
-					g_free(full_name);
-					full_name = g_match_info_fetch(match_info, 1);
-				}
-				else
-				{
-					full_name = NULL;
-				}
-			}
-			g_match_info_free(match_info);
+		last = batch->last;
 
-			match_info = NULL;
-			if (full_name && g_regex_match(file_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
-			{
-				pkg_filename = g_match_info_fetch(match_info, 1);
-				sqlite3_bind_text(statement, 1, full_name, -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(statement, 2, pkg_filename, -1, SQLITE_TRANSIENT);
-				sqlite3_step(statement);
-				sqlite3_clear_bindings(statement);
-				sqlite3_reset(statement);
-				g_free(pkg_filename);
-			}
-			g_match_info_free(match_info);
-		}
-		g_strfreev(lines);
+		/* Give the batch back to the reader */
+		g_string_chunk_clear(batch->strings);
+		g_ptr_array_set_size(batch->rows, 0);
+		g_async_queue_push(pipe.free, batch);
 	}
-
+	while (!last);
 	sqlite3_exec(job_data->db, "END TRANSACTION", NULL, NULL, NULL);
-	g_free(full_name);
-	BZ2_bzReadClose(&err, manifest_bz2);
 
-out:
-	sqlite3_finalize(statement);
-	if (file_expr)
-	{
-		g_regex_unref(file_expr);
-	}
-	if (pkg_expr)
+	g_thread_join(reader);
+	BZ2_bzReadClose(&err, pipe.manifest_bz2);
+
+	while ((batch = static_cast<ManifestBatch *> (g_async_queue_try_pop(pipe.free))))
 	{
-		g_regex_unref(pkg_expr);
+		g_string_chunk_free(batch->strings);
+		g_ptr_array_free(batch->rows, TRUE);
+		g_free(batch);
 	}
+	g_async_queue_unref(pipe.free);
+	g_async_queue_unref(pipe.filled);
+
+out:
+	sqlite3_finalize(statement);
 	fclose(manifest);
 }
 
@@ -21,6 +21,7 @@ private:
 	static const std::size_t max_buf_size = 8192;
 	gchar **priority = NULL;
 
+	static gpointer manifest_read (gpointer data) noexcept;
 	void manifest (PkBackendJob *job,
 			const gchar *tmpl, gchar *filename) noexcept;
 };
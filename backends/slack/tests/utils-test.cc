@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include "utils.h"
+
+using namespace slack;
+
+static void
+slack_test_search_index ()
+{
+	sqlite3 *db;
+	sqlite3_stmt *stmt;
+
+	g_assert_cmpint (sqlite3_open (":memory:", &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db,
+				"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE, name VARCHAR NOT NULL, "
+				"desc TEXT DEFAULT '', repo_order INTEGER, PRIMARY KEY (name, repo_order));"
+				"CREATE TABLE filelist (full_name VARCHAR NOT NULL, filename VARCHAR NOT NULL, "
+				"PRIMARY KEY (full_name, filename));"
+				"INSERT INTO pkglist VALUES ('foo-1.0-x86_64-1', 'foo', 'Foo tool', 2);"
+				"INSERT INTO pkglist VALUES ('foo-1.1-x86_64-1', 'foo', 'Foo tool', 1);"
+				"INSERT INTO filelist VALUES ('foo-1.0-x86_64-1', 'usr/bin/foo');",
+				NULL, NULL, NULL), ==, SQLITE_OK);
+
+	g_assert_true (create_search_index (db));
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"SELECT repo_order FROM best_repo WHERE name = 'foo'",
+				-1, &stmt, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_ROW);
+	g_assert_cmpint (sqlite3_column_int (stmt, 0), ==, 1);
+	sqlite3_finalize (stmt);
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"SELECT f.full_name FROM filelist_fts AS s "
+				"JOIN filelist AS f ON f.rowid = s.rowid WHERE s.filename LIKE '%bin/fo%'",
+				-1, &stmt, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_ROW);
+	g_assert_cmpstr ((const gchar *) sqlite3_column_text (stmt, 0), ==, "foo-1.0-x86_64-1");
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_DONE);
+	sqlite3_finalize (stmt);
+
+	/* The index follows the regenerated package list */
+	g_assert_cmpint (sqlite3_exec (db,
+				"DELETE FROM pkglist WHERE repo_order = 1;"
+				"INSERT INTO pkglist VALUES ('bar-2.0-noarch-1', 'bar', 'Bar library', 1);",
+				NULL, NULL, NULL), ==, SQLITE_OK);
+	g_assert_true (update_search_index (db));
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+				"SELECT p.full_name FROM pkglist_fts AS s "
+				"JOIN pkglist AS p ON p.rowid = s.rowid WHERE s.desc LIKE '%library%'",
+				-1, &stmt, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_ROW);
+	g_assert_cmpstr ((const gchar *) sqlite3_column_text (stmt, 0), ==, "bar-2.0-noarch-1");
+	sqlite3_finalize (stmt);
+
+	sqlite3_close (db);
+}
+
+static void
+slack_test_get_files ()
+{
+	gchar *tmp_dir, *contents = NULL, **source_dest;
+	GSList *file_list = NULL;
+	GError *err = NULL;
+
+	tmp_dir = g_dir_make_tmp ("slack-test-XXXXXX", &err);
+	g_assert_no_error (err);
+
+	/* Serve the repository files from a local file:// mirror */
+	for (guint i = 0; i < 3; i++)
+	{
+		gchar *name = g_strdup_printf ("file%u", i);
+		gchar *path = g_build_filename (tmp_dir, name, NULL);
+
+		g_assert_true (g_file_set_contents (path, name, -1, NULL));
+
+		source_dest = static_cast<gchar **> (g_malloc_n (3, sizeof (gchar *)));
+		source_dest[0] = g_strconcat ("file://", path, NULL);
+		source_dest[1] = g_strconcat (path, ".downloaded", NULL);
+		source_dest[2] = NULL;
+		file_list = g_slist_prepend (file_list, source_dest);
+
+		g_free (path);
+		g_free (name);
+	}
+	source_dest = static_cast<gchar **> (g_malloc_n (3, sizeof (gchar *)));
+	source_dest[0] = g_strconcat ("file://", tmp_dir, "/missing", NULL);
+	source_dest[1] = g_build_filename (tmp_dir, "missing.downloaded", NULL);
+	source_dest[2] = NULL;
+	file_list = g_slist_prepend (file_list, source_dest);
+
+	g_assert_cmpuint (get_files (file_list, 2, NULL), ==, 1);
+
+	for (GSList *l = file_list->next; l; l = g_slist_next (l))
+	{
+		source_dest = static_cast<gchar **> (l->data);
+
+		g_assert_true (g_file_get_contents (source_dest[1], &contents, NULL, NULL));
+		g_assert_true (g_str_has_suffix (source_dest[0], contents));
+		g_free (contents);
+	}
+
+	for (GSList *l = file_list; l; l = g_slist_next (l))
+	{
+		source_dest = static_cast<gchar **> (l->data);
+
+		g_unlink (source_dest[0] + strlen ("file://"));
+		g_unlink (source_dest[1]);
+	}
+	g_slist_free_full (file_list, (GDestroyNotify) g_strfreev);
+	g_rmdir (tmp_dir);
+	g_free (tmp_dir);
+}
+
+static void
+slack_test_manifest_package ()
+{
+	const gchar *line, *full_name;
+	gsize full_name_len;
+
+	line = "||   Package:  ./a/aaa_base-14.2-x86_64-5.txz";
+	g_assert_true (manifest_package (line, strlen (line), &full_name, &full_name_len));
+	g_assert_nonnull (full_name);
+	g_assert_cmpint (strncmp (full_name, "aaa_base-14.2-x86_64-5", full_name_len), ==, 0);
+	g_assert_cmpuint (full_name_len, ==, strlen ("aaa_base-14.2-x86_64-5"));
+
+	line = "||   Package:  ./a/aaa_base-14.2-x86_64-5.tar";
+	g_assert_true (manifest_package (line, strlen (line), &full_name, &full_name_len));
+	g_assert_null (full_name);
+
+	line = "||";
+	g_assert_false (manifest_package (line, strlen (line), &full_name, &full_name_len));
+	line = "++========================================";
+	g_assert_false (manifest_package (line, strlen (line), &full_name, &full_name_len));
+}
+
+static void
+slack_test_manifest_file ()
+{
+	const gchar *line;
+
+	line = "-rw-r--r-- root/root       245 2016-06-25 20:43 etc/motd";
+	g_assert_cmpstr (manifest_file (line, strlen (line)), ==, "etc/motd");
+	line = "lrwxrwxrwx root/root         0 2016-06-25 20:43 usr/lib64/libz.so -> libz.so.1";
+	g_assert_cmpstr (manifest_file (line, strlen (line)), ==, "usr/lib64/libz.so -> libz.so.1");
+	line = "-rwsr-xr-t root/root         0 2016-06-25 20:43 usr/bin/with space";
+	g_assert_cmpstr (manifest_file (line, strlen (line)), ==, "usr/bin/with space");
+
+	line = "drwxr-xr-x root/root         0 2016-06-25 20:43 ./";
+	g_assert_null (manifest_file (line, strlen (line)));
+	line = "-rw-r--r-- root/root      1234 2016-06-25 20:43 install/doinst.sh";
+	g_assert_null (manifest_file (line, strlen (line)));
+	line = "-rw-r--r-- root/root      12x4 2016-06-25 20:43 etc/bad";
+	g_assert_null (manifest_file (line, strlen (line)));
+	line = "xrw-r--r-- root/root       245 2016-06-25 20:43 etc/bad";
+	g_assert_null (manifest_file (line, strlen (line)));
+	line = "||   Package:  ./a/aaa_base-14.2-x86_64-5.txz";
+	g_assert_null (manifest_file (line, strlen (line)));
+}
+
+static GSList *
+slack_test_append_transfer (GSList *file_list, const gchar *source, const gchar *dest)
+{
+	auto source_dest = static_cast<gchar **> (g_malloc_n (3, sizeof (gchar *)));
+
+	source_dest[0] = g_strconcat ("file://", source, NULL);
+	source_dest[1] = g_strdup (dest);
+	source_dest[2] = NULL;
+
+	return g_slist_append (file_list, source_dest);
+}
+
+static void
+slack_test_get_files_shared_dest ()
+{
+	gchar *tmp_dir, *first, *second, *missing, *shared, *broken, *sub_dir, *in_dir;
+	gchar *contents = NULL;
+	GSList *file_list = NULL;
+	GError *err = NULL;
+
+	tmp_dir = g_dir_make_tmp ("slack-test-XXXXXX", &err);
+	g_assert_no_error (err);
+
+	first = g_build_filename (tmp_dir, "first", NULL);
+	second = g_build_filename (tmp_dir, "second", NULL);
+	missing = g_build_filename (tmp_dir, "missing", NULL);
+	shared = g_build_filename (tmp_dir, "PACKAGES.TXT", NULL);
+	broken = g_build_filename (tmp_dir, "broken", NULL);
+	sub_dir = g_build_filename (tmp_dir, "sub", NULL);
+	in_dir = g_build_filename (sub_dir, "first", NULL);
+	g_assert_true (g_file_set_contents (first, "first\n", -1, NULL));
+	g_assert_true (g_file_set_contents (second, "second\n", -1, NULL));
+	g_assert_cmpint (g_mkdir (sub_dir, 0755), ==, 0);
+
+	/* Transfers sharing a destination are concatenated in list order,
+	 * a directory destination keeps the source file name */
+	file_list = slack_test_append_transfer (file_list, first, shared);
+	file_list = slack_test_append_transfer (file_list, second, shared);
+	file_list = slack_test_append_transfer (file_list, first, sub_dir);
+	g_assert_cmpuint (get_files (file_list, 2, NULL), ==, 0);
+	g_slist_free_full (file_list, (GDestroyNotify) g_strfreev);
+	file_list = NULL;
+
+	g_assert_true (g_file_get_contents (shared, &contents, NULL, NULL));
+	g_assert_cmpstr (contents, ==, "first\nsecond\n");
+	g_free (contents);
+	g_unlink (shared);
+
+	g_assert_true (g_file_get_contents (in_dir, &contents, NULL, NULL));
+	g_assert_cmpstr (contents, ==, "first\n");
+	g_free (contents);
+	g_unlink (in_dir);
+
+	/* A failed transfer leaves no incomplete destination behind */
+	file_list = slack_test_append_transfer (file_list, first, broken);
+	file_list = slack_test_append_transfer (file_list, missing, broken);
+	g_assert_cmpuint (get_files (file_list, 2, NULL), ==, 1);
+	g_slist_free_full (file_list, (GDestroyNotify) g_strfreev);
+	g_assert_false (g_file_test (broken, G_FILE_TEST_EXISTS));
+
+	g_rmdir (sub_dir);
+	g_unlink (first);
+	g_unlink (second);
+	g_rmdir (tmp_dir);
+
+	g_free (in_dir);
+	g_free (sub_dir);
+	g_free (broken);
+	g_free (shared);
+	g_free (missing);
+	g_free (second);
+	g_free (first);
+	g_free (tmp_dir);
+}
+
+static gpointer
+slack_test_cancel_thread (gpointer user_data)
+{
+	g_usleep (100 * G_TIME_SPAN_MILLISECOND);
+	g_cancellable_cancel (G_CANCELLABLE (user_data));
+	return NULL;
+}
+
+static void
+slack_test_get_files_cancel ()
+{
+	gchar *tmp_dir, *dest, **source_dest;
+	GSList *file_list = NULL;
+	GSocket *server;
+	GSocketAddress *address;
+	GInetAddress *loopback;
+	GCancellable *cancellable;
+	GThread *thread;
+	GError *err = NULL;
+	gint64 start;
+
+	tmp_dir = g_dir_make_tmp ("slack-test-XXXXXX", &err);
+	g_assert_no_error (err);
+	dest = g_build_filename (tmp_dir, "PACKAGES.TXT", NULL);
+
+	/* A server that accepts the connection but never answers, so the
+	 * transfer only ends when it is cancelled */
+	server = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_STREAM,
+			G_SOCKET_PROTOCOL_TCP, &err);
+	g_assert_no_error (err);
+	loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+	address = g_inet_socket_address_new (loopback, 0);
+	g_assert_true (g_socket_bind (server, address, TRUE, &err));
+	g_assert_no_error (err);
+	g_assert_true (g_socket_listen (server, &err));
+	g_assert_no_error (err);
+	g_object_unref (address);
+	address = g_socket_get_local_address (server, &err);
+	g_assert_no_error (err);
+
+	source_dest = static_cast<gchar **> (g_malloc_n (3, sizeof (gchar *)));
+	source_dest[0] = g_strdup_printf ("http://127.0.0.1:%u/PACKAGES.TXT",
+			g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (address)));
+	source_dest[1] = g_strdup (dest);
+	source_dest[2] = NULL;
+	file_list = g_slist_append (file_list, source_dest);
+
+	cancellable = g_cancellable_new ();
+	thread = g_thread_new ("slack-test-cancel", slack_test_cancel_thread, cancellable);
+
+	start = g_get_monotonic_time ();
+	g_assert_cmpuint (get_files (file_list, 2, cancellable), ==, 1);
+	g_test_message ("get_files returned %" G_GINT64_FORMAT " ms after the start",
+			(g_get_monotonic_time () - start) / G_TIME_SPAN_MILLISECOND);
+	g_thread_join (thread);
+
+	/* Neither the destination nor the part file is left behind */
+	g_assert_false (g_file_test (dest, G_FILE_TEST_EXISTS));
+	g_assert_cmpint (g_rmdir (tmp_dir), ==, 0);
+
+	g_slist_free_full (file_list, (GDestroyNotify) g_strfreev);
+	g_object_unref (cancellable);
+	g_object_unref (address);
+	g_object_unref (loopback);
+	g_object_unref (server);
+	g_free (dest);
+	g_free (tmp_dir);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/slack/utils/search_index", slack_test_search_index);
+	g_test_add_func("/slack/utils/get_files", slack_test_get_files);
+	g_test_add_func("/slack/utils/get_files_shared_dest", slack_test_get_files_shared_dest);
+	g_test_add_func("/slack/utils/get_files_cancel", slack_test_get_files_cancel);
+	g_test_add_func("/slack/utils/manifest_package", slack_test_manifest_package);
+	g_test_add_func("/slack/utils/manifest_file", slack_test_manifest_file);
+
+	return g_test_run();
+}
@@ -1,3 +1,4 @@
+#include <glib/gstdio.h>
 #include <sqlite3.h>
 #include <string.h>
 #include "utils.h"
@@ -66,6 +67,224 @@ get_file (CURL **curl, gchar *source_url, gchar *dest)
 	return ret;
 }
 
+struct Transfer
+{
+	CURL *curl;
+	FILE *fout;
+	gchar *dest;
+	gchar *part;
+	CURLcode result;
+};
+
+/**
+ * slack::append_file:
+ * @source: the file to copy.
+ * @dest: the file to append to.
+ *
+ * Appends @source to @dest a buffer at a time.
+ *
+ * Returns: %TRUE on success.
+ **/
+static gboolean
+append_file (const gchar *source, const gchar *dest)
+{
+	gchar buffer[8192];
+	gsize length;
+	gboolean ret = TRUE;
+	FILE *fin, *fout;
+
+	if ((fin = fopen(source, "rb")) == NULL)
+	{
+		return FALSE;
+	}
+	if ((fout = fopen(dest, "ab")) == NULL)
+	{
+		fclose(fin);
+		return FALSE;
+	}
+	while ((length = fread(buffer, 1, sizeof(buffer), fin)) > 0)
+	{
+		if (fwrite(buffer, 1, length, fout) != length)
+		{
+			ret = FALSE;
+			break;
+		}
+	}
+	if (ferror(fin))
+	{
+		ret = FALSE;
+	}
+	fclose(fin);
+	if (fclose(fout) != 0)
+	{
+		ret = FALSE;
+	}
+	return ret;
+}
+
+static void
+get_files_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	curl_multi_wakeup(static_cast<CURLM *> (user_data));
+}
+
+/**
+ * slack::get_files:
+ * @file_list: List of string arrays, each containing the source url and the
+ *             destination file name or directory.
+ * @max_connections: Maximum number of simultaneous connections.
+ * @cancellable: (nullable): A #GCancellable to abort the transfers with.
+ *
+ * Download all files in @file_list concurrently. Transfers exceeding
+ * @max_connections are queued until a connection is free.
+ *
+ * Each transfer is written to its own part file. The parts are appended to
+ * their destinations in list order when all transfers are done, so several
+ * sources can share a destination as with get_file(). A destination is
+ * removed if any of its transfers failed, rather than left incomplete.
+ *
+ * Cancelling @cancellable wakes up the transfer loop, which then stops and
+ * counts all transfers as failed.
+ *
+ * Returns: Number of the files that couldn't be downloaded.
+ **/
+guint
+get_files (GSList *file_list, glong max_connections, GCancellable *cancellable)
+{
+	CURLM *multi;
+	CURLMsg *msg;
+	CURLMcode mc;
+	gint running, queued;
+	guint failed = 0;
+	gulong cancel_id = 0;
+	gboolean cancelled;
+	GArray *transfers;
+	GPtrArray *failed_dests;
+
+	if (!(multi = curl_multi_init()))
+	{
+		return g_slist_length(file_list);
+	}
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, max_connections);
+	transfers = g_array_new(FALSE, TRUE, sizeof(Transfer));
+	failed_dests = g_ptr_array_new_with_free_func(g_free);
+
+	for (GSList *l = file_list; l; l = g_slist_next(l))
+	{
+		auto source_dest = static_cast<gchar **> (l->data);
+		Transfer transfer = { NULL, NULL, NULL, NULL, CURLE_OK };
+
+		if (g_file_test(source_dest[1], G_FILE_TEST_IS_DIR))
+		{
+			transfer.dest = g_strconcat(source_dest[1],
+			                            g_strrstr(source_dest[0], "/"),
+			                            NULL);
+		}
+		else
+		{
+			transfer.dest = g_strdup(source_dest[1]);
+		}
+		transfer.part = g_strdup_printf("%s.part%u", transfer.dest, transfers->len);
+
+		if ((transfer.fout = fopen(transfer.part, "wb")) == NULL)
+		{
+			transfer.result = CURLE_WRITE_ERROR;
+		}
+		else if (!(transfer.curl = curl_easy_init()))
+		{
+			transfer.result = CURLE_FAILED_INIT;
+		}
+		else
+		{
+			curl_easy_setopt(transfer.curl, CURLOPT_FOLLOWLOCATION, 1L);
+			curl_easy_setopt(transfer.curl, CURLOPT_FAILONERROR, 1L);
+			curl_easy_setopt(transfer.curl, CURLOPT_URL, source_dest[0]);
+			curl_easy_setopt(transfer.curl, CURLOPT_WRITEDATA, transfer.fout);
+			curl_easy_setopt(transfer.curl, CURLOPT_PRIVATE, GUINT_TO_POINTER(transfers->len));
+			curl_multi_add_handle(multi, transfer.curl);
+		}
+		g_array_append_val(transfers, transfer);
+	}
+
+	if (cancellable != NULL)
+	{
+		cancel_id = g_cancellable_connect(cancellable,
+		                                  G_CALLBACK(get_files_cancelled_cb),
+		                                  multi, NULL);
+	}
+	do
+	{
+		mc = curl_multi_perform(multi, &running);
+		if ((mc == CURLM_OK) && running
+		    && !g_cancellable_is_cancelled(cancellable))
+		{
+			mc = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+		}
+		while ((msg = curl_multi_info_read(multi, &queued)))
+		{
+			gchar *priv = NULL;
+
+			if (msg->msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+			g_array_index(transfers, Transfer, GPOINTER_TO_UINT(priv)).result = msg->data.result;
+		}
+	}
+	while (running && (mc == CURLM_OK)
+	       && !g_cancellable_is_cancelled(cancellable));
+	g_cancellable_disconnect(cancellable, cancel_id);
+	cancelled = g_cancellable_is_cancelled(cancellable);
+
+	for (guint i = 0; i < transfers->len; i++)
+	{
+		auto transfer = &g_array_index(transfers, Transfer, i);
+
+		if (transfer->curl != NULL)
+		{
+			curl_multi_remove_handle(multi, transfer->curl);
+			curl_easy_cleanup(transfer->curl);
+		}
+		if (transfer->fout != NULL)
+		{
+			fclose(transfer->fout);
+		}
+		if (cancelled)
+		{
+			transfer->result = CURLE_ABORTED_BY_CALLBACK;
+		}
+
+		if ((mc == CURLM_OK) && (transfer->result == CURLE_OK)
+		    && !append_file(transfer->part, transfer->dest))
+		{
+			transfer->result = CURLE_WRITE_ERROR;
+		}
+		if ((mc == CURLM_OK) && (transfer->result != CURLE_OK))
+		{
+			failed++;
+			g_ptr_array_add(failed_dests, g_strdup(transfer->dest));
+		}
+		g_unlink(transfer->part);
+		g_free(transfer->part);
+		g_free(transfer->dest);
+	}
+	if (mc != CURLM_OK)
+	{
+		failed = g_slist_length(file_list);
+	}
+	for (guint i = 0; i < failed_dests->len; i++)
+	{
+		g_unlink(static_cast<gchar *> (g_ptr_array_index(failed_dests, i)));
+	}
+
+	g_ptr_array_free(failed_dests, TRUE);
+	g_array_free(transfers, TRUE);
+	curl_multi_cleanup(multi);
+
+	return failed;
+}
+
 /**
  * slack::split_package_name:
  * Got the name of a package, without version-arch-release data.
@@ -217,6 +436,225 @@ is_installed (const gchar *pkg_fullname)
 	return ret;
 }
 
+/**
+ * slack::manifest_package:
+ * @line: A MANIFEST line without the line terminator.
+ * @len: Length of @line.
+ * @full_name: Return location for the package full name.
+ * @full_name_len: Return location for the length of @full_name.
+ *
+ * Checks whether @line is a package header like
+ * "||   Package:  ./a/aaa_base-14.2-x86_64-5.txz". If the header names a
+ * package archive, @full_name is set to the archive name without the
+ * directory and the extension. It points into @line and isn't
+ * null-terminated. Otherwise @full_name is set to %NULL.
+ *
+ * Returns: %TRUE if @line is a package header, %FALSE otherwise.
+ **/
+gboolean
+manifest_package (const gchar *line, gsize len,
+		const gchar **full_name, gsize *full_name_len)
+{
+	const gchar *end = line + len, *it, *slash = NULL;
+	gsize base_len;
+
+	if ((len < 3) || (line[0] != '|') || (line[1] != '|')
+	 || ((line[2] != ' ') && (line[2] != '\t')))
+	{
+		return FALSE;
+	}
+	for (it = line + 3; (it != end) && ((*it == ' ') || (*it == '\t')); it++);
+
+	if (((gsize) (end - it) < 9) || strncmp(it, "Package:", 8)
+	 || ((it[8] != ' ') && (it[8] != '\t')))
+	{
+		return FALSE;
+	}
+	for (it += 9; (it != end) && ((*it == ' ') || (*it == '\t')); it++);
+
+	*full_name = NULL;
+	*full_name_len = 0;
+
+	/* The archive name follows the last slash and ends with .t[blxg]z */
+	for (const gchar *p = it; p != end; p++)
+	{
+		if (*p == '/')
+		{
+			slash = p;
+		}
+	}
+	if ((slash == NULL) || (slash == it))
+	{
+		return TRUE;
+	}
+	base_len = end - slash - 1;
+	if ((base_len > 4) && (end[-4] == '.') && (end[-3] == 't')
+	 && (end[-2] != '\0') && strchr("blxg", end[-2]) && (end[-1] == 'z'))
+	{
+		*full_name = slash + 1;
+		*full_name_len = base_len - 4;
+	}
+	return TRUE;
+}
+
+/**
+ * slack::manifest_file:
+ * @line: A MANIFEST line without the line terminator.
+ * @len: Length of @line.
+ *
+ * Checks whether @line is a file entry in "ls -l" format like
+ * "-rw-r--r-- root/root 245 2016-06-25 20:43 etc/motd". Entries in the
+ * install/ directory and relative entries starting with a dot are skipped.
+ *
+ * Returns: The beginning of the file name within @line, the name ends at
+ *          the end of @line. %NULL if @line isn't a file entry.
+ **/
+const gchar *
+manifest_file (const gchar *line, gsize len)
+{
+	static const gchar *const mode[] = {
+		"-bcdlps", "-r", "-w", "-xsS", "-r", "-w", "-xsS", "-r", "-w", "-xtT"
+	};
+	const gchar *end = line + len, *it = line, *start;
+
+	if (len < G_N_ELEMENTS(mode) + 1)
+	{
+		return NULL;
+	}
+	for (gsize i = 0; i < G_N_ELEMENTS(mode); i++, it++)
+	{
+		if ((*it == '\0') || !strchr(mode[i], *it))
+		{
+			return NULL;
+		}
+	}
+	if (!g_ascii_isspace(*it++))
+	{
+		return NULL;
+	}
+
+	/* Owner */
+	for (start = it; (it != end) && !g_ascii_isspace(*it); it++);
+	if ((it == start) || (it == end))
+	{
+		return NULL;
+	}
+	for (; (it != end) && g_ascii_isspace(*it); it++);
+
+	/* Size */
+	for (start = it; (it != end) && g_ascii_isdigit(*it); it++);
+	if ((it == start) || (it == end) || !g_ascii_isspace(*it++))
+	{
+		return NULL;
+	}
+
+	/* Date */
+	for (start = it; (it != end) && (g_ascii_isdigit(*it) || (*it == '-')); it++);
+	if ((it == start) || (it == end) || !g_ascii_isspace(*it++))
+	{
+		return NULL;
+	}
+
+	/* Time */
+	for (start = it; (it != end) && (g_ascii_isdigit(*it) || (*it == ':')); it++);
+	if ((it == start) || (it == end) || !g_ascii_isspace(*it++))
+	{
+		return NULL;
+	}
+
+	if (((it != end) && (*it == '.'))
+	 || (((gsize) (end - it) >= 8) && !strncmp(it, "install/", 8)))
+	{
+		return NULL;
+	}
+	return it;
+}
+
+/**
+ * slack::create_search_index:
+ * @db: Metadata database.
+ *
+ * Creates the full-text search tables over the package and file lists, the
+ * table holding the preferred repository for each package name and the
+ * indexes used by the search queries, unless they exist already. A newly
+ * created index is filled from the current cache content.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+create_search_index (sqlite3 *db)
+{
+	gboolean exists;
+	sqlite3_stmt *stmt;
+
+	if (sqlite3_prepare_v2(db,
+	                       "SELECT 1 FROM sqlite_master WHERE name = 'best_repo'",
+	                       -1,
+	                       &stmt,
+	                       NULL) != SQLITE_OK)
+	{
+		return FALSE;
+	}
+	exists = sqlite3_step(stmt) == SQLITE_ROW;
+	sqlite3_finalize(stmt);
+
+	if (exists)
+	{
+		return TRUE;
+	}
+
+	/* The trigram tokenizer lets LIKE '%...%' patterns use the index */
+	if (sqlite3_exec(db,
+	                 "CREATE VIRTUAL TABLE IF NOT EXISTS pkglist_fts USING fts5"
+	                 "(name, \"desc\", content = 'pkglist', tokenize = 'trigram');"
+	                 "CREATE VIRTUAL TABLE IF NOT EXISTS filelist_fts USING fts5"
+	                 "(filename, content = 'filelist', tokenize = 'trigram');"
+	                 "CREATE TABLE IF NOT EXISTS best_repo "
+	                 "(name VARCHAR PRIMARY KEY, repo_order INTEGER NOT NULL);"
+	                 "CREATE INDEX IF NOT EXISTS pkglist_repo_order ON pkglist (repo_order);",
+	                 NULL,
+	                 NULL,
+	                 NULL) != SQLITE_OK)
+	{
+		return FALSE;
+	}
+
+	return update_search_index (db);
+}
+
+/**
+ * slack::update_search_index:
+ * @db: Metadata database.
+ *
+ * Rebuilds the search tables created by create_search_index() after the
+ * package and file lists have been regenerated.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+update_search_index (sqlite3 *db)
+{
+	gint ret;
+
+	sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	ret = sqlite3_exec(db,
+	                   "DELETE FROM best_repo;"
+	                   "INSERT INTO best_repo (name, repo_order) "
+	                   "SELECT name, MIN(repo_order) FROM pkglist GROUP BY name;"
+	                   "INSERT INTO pkglist_fts (pkglist_fts) VALUES ('rebuild');"
+	                   "INSERT INTO filelist_fts (filelist_fts) VALUES ('rebuild');",
+	                   NULL,
+	                   NULL,
+	                   NULL);
+	sqlite3_exec(db,
+	             ret == SQLITE_OK ? "END TRANSACTION" : "ROLLBACK TRANSACTION",
+	             NULL,
+	             NULL,
+	             NULL);
+
+	return ret == SQLITE_OK;
+}
+
 /**
  * slack::cmp_repo:
  **/
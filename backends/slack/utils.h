@@ -2,6 +2,7 @@
 #define __SLACK_UTILS_H
 
 #include <curl/curl.h>
+#include <sqlite3.h>
 #include <pk-backend.h>
 #include <pk-backend-job.h>
 
@@ -17,10 +18,22 @@ struct JobData
 
 CURLcode get_file (CURL **curl, gchar *source_url, gchar *dest);
 
+guint get_files (GSList *file_list, glong max_connections,
+		GCancellable *cancellable);
+
 gchar **split_package_name (const gchar *pkg_filename);
 
 PkInfoEnum is_installed (const gchar *pkg_fullname);
 
+gboolean manifest_package (const gchar *line, gsize len,
+		const gchar **full_name, gsize *full_name_len);
+
+const gchar *manifest_file (const gchar *line, gsize len);
+
+gboolean create_search_index (sqlite3 *db);
+
+gboolean update_search_index (sqlite3 *db);
+
 extern "C" {
 
 gint cmp_repo (gconstpointer a, gconstpointer b);
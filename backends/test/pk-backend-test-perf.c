@@ -0,0 +1,332 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A synthetic backend for benchmarking the daemon. It has no real packages,
+ * just "perfN" for N up to the package count, and is tuned with these
+ * environment variables (the daemon must be run with --keep-environment):
+ *
+ *   PK_TEST_PERF_PACKAGES	number of packages, default 1000
+ *   PK_TEST_PERF_SUMMARY_SIZE	length of each package summary, default 64
+ *   PK_TEST_PERF_RATE		packages emitted per second, default 0 (no limit)
+ *   PK_TEST_PERF_LATENCY	ms to wait before the first result, default 0
+ *   PK_TEST_PERF_DEPENDS	extra packages pulled in per install, default 10
+ */
+
+#include <gmodule.h>
+#include <glib.h>
+#include <string.h>
+#include <pk-backend.h>
+#include <pk-backend-job.h>
+
+typedef struct {
+	guint		 packages;
+	guint		 rate;
+	guint		 latency;
+	guint		 depends;
+	gchar		*summary;
+} PkBackendTestPerfPrivate;
+
+typedef struct {
+	gint64		 start;
+	guint		 emitted;
+} PkBackendTestPerfJobData;
+
+static PkBackendTestPerfPrivate *priv;
+
+static guint
+pk_backend_test_perf_getenv (const gchar *name, guint default_value)
+{
+	const gchar *tmp = g_getenv (name);
+	if (tmp == NULL)
+		return default_value;
+	return (guint) g_ascii_strtoull (tmp, NULL, 10);
+}
+
+const gchar *
+pk_backend_get_description (PkBackend *backend)
+{
+	return "Test-Perf";
+}
+
+void
+pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
+{
+	guint summary_size;
+
+	priv = g_new0 (PkBackendTestPerfPrivate, 1);
+	priv->packages = pk_backend_test_perf_getenv ("PK_TEST_PERF_PACKAGES", 1000);
+	priv->rate = pk_backend_test_perf_getenv ("PK_TEST_PERF_RATE", 0);
+	priv->latency = pk_backend_test_perf_getenv ("PK_TEST_PERF_LATENCY", 0);
+	priv->depends = pk_backend_test_perf_getenv ("PK_TEST_PERF_DEPENDS", 10);
+	summary_size = pk_backend_test_perf_getenv ("PK_TEST_PERF_SUMMARY_SIZE", 64);
+	priv->summary = g_malloc (summary_size + 1);
+	memset (priv->summary, 's', summary_size);
+	priv->summary[summary_size] = '\0';
+	g_debug ("backend: %u packages, %u/s, %ums latency",
+		 priv->packages, priv->rate, priv->latency);
+}
+
+void
+pk_backend_destroy (PkBackend *backend)
+{
+	g_free (priv->summary);
+	g_free (priv);
+}
+
+PkBitfield
+pk_backend_get_groups (PkBackend *backend)
+{
+	return pk_bitfield_value (PK_GROUP_ENUM_SYSTEM);
+}
+
+PkBitfield
+pk_backend_get_filters (PkBackend *backend)
+{
+	return pk_bitfield_from_enums (PK_FILTER_ENUM_INSTALLED,
+				       PK_FILTER_ENUM_NOT_INSTALLED,
+				       -1);
+}
+
+gchar **
+pk_backend_get_mime_types (PkBackend *backend)
+{
+	const gchar *mime_types[] = { NULL };
+	return g_strdupv ((gchar **) mime_types);
+}
+
+gboolean
+pk_backend_supports_parallelization (PkBackend *backend)
+{
+	return TRUE;
+}
+
+void
+pk_backend_start_job (PkBackend *backend, PkBackendJob *job)
+{
+	PkBackendTestPerfJobData *job_data = g_new0 (PkBackendTestPerfJobData, 1);
+	pk_backend_job_set_user_data (job, job_data);
+}
+
+void
+pk_backend_stop_job (PkBackend *backend, PkBackendJob *job)
+{
+	g_free (pk_backend_job_get_user_data (job));
+	pk_backend_job_set_user_data (job, NULL);
+}
+
+void
+pk_backend_cancel (PkBackend *backend, PkBackendJob *job)
+{
+	/* the threads check this between packages */
+}
+
+/* even packages are installed, odd ones are available */
+static PkInfoEnum
+pk_backend_test_perf_get_info (guint idx)
+{
+	return (idx % 2 == 0) ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE;
+}
+
+static gboolean
+pk_backend_test_perf_filter (PkBitfield filters, guint idx)
+{
+	PkInfoEnum info = pk_backend_test_perf_get_info (idx);
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED))
+		return info == PK_INFO_ENUM_INSTALLED;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED))
+		return info != PK_INFO_ENUM_INSTALLED;
+	return TRUE;
+}
+
+/* "perf42" or "perf42;1.0-42;x86_64;perf" -> 42 */
+static gboolean
+pk_backend_test_perf_parse (const gchar *search, guint *idx)
+{
+	gchar *endptr = NULL;
+	guint64 tmp;
+
+	if (!g_str_has_prefix (search, "perf"))
+		return FALSE;
+	tmp = g_ascii_strtoull (search + 4, &endptr, 10);
+	if (endptr == search + 4 || (*endptr != '\0' && *endptr != ';'))
+		return FALSE;
+	if (tmp >= priv->packages)
+		return FALSE;
+	*idx = tmp;
+	return TRUE;
+}
+
+/* first result after the configured latency, then at the configured rate */
+static gboolean
+pk_backend_test_perf_wait (PkBackendJob *job)
+{
+	PkBackendTestPerfJobData *job_data = pk_backend_job_get_user_data (job);
+	gint64 due;
+	gint64 now;
+
+	if (job_data->start == 0) {
+		job_data->start = g_get_monotonic_time ();
+		if (priv->latency > 0)
+			g_usleep (priv->latency * 1000);
+		job_data->start += priv->latency * 1000;
+	}
+	if (priv->rate > 0) {
+		due = job_data->start + (gint64) job_data->emitted * G_USEC_PER_SEC / priv->rate;
+		now = g_get_monotonic_time ();
+		if (due > now)
+			g_usleep (due - now);
+	}
+	return !pk_backend_job_is_cancelled (job);
+}
+
+static gboolean
+pk_backend_test_perf_emit (PkBackendJob *job, PkInfoEnum info, guint idx)
+{
+	PkBackendTestPerfJobData *job_data = pk_backend_job_get_user_data (job);
+	gchar package_id[64];
+
+	if (!pk_backend_test_perf_wait (job))
+		return FALSE;
+	g_snprintf (package_id, sizeof (package_id),
+		    "perf%u;1.0-%u;x86_64;perf", idx, idx);
+	pk_backend_job_package (job, info, package_id, priv->summary);
+	job_data->emitted++;
+	return TRUE;
+}
+
+static void
+pk_backend_get_packages_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	PkBitfield filters;
+	guint i;
+
+	g_variant_get (params, "(t)", &filters);
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+	for (i = 0; i < priv->packages; i++) {
+		if (!pk_backend_test_perf_filter (filters, i))
+			continue;
+		if (!pk_backend_test_perf_emit (job, pk_backend_test_perf_get_info (i), i))
+			return;
+	}
+}
+
+void
+pk_backend_get_packages (PkBackend *backend, PkBackendJob *job, PkBitfield filters)
+{
+	pk_backend_job_thread_create (job, pk_backend_get_packages_thread, NULL, NULL);
+}
+
+static void
+pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	PkBitfield filters;
+	gchar name[32];
+	guint i;
+	guint j;
+	g_autofree gchar **values = NULL;
+
+	g_variant_get (params, "(t^a&s)", &filters, &values);
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+	for (i = 0; i < priv->packages; i++) {
+		if (!pk_backend_test_perf_filter (filters, i))
+			continue;
+		g_snprintf (name, sizeof (name), "perf%u", i);
+		for (j = 0; values[j] != NULL; j++) {
+			if (strstr (name, values[j]) == NULL)
+				break;
+		}
+		if (values[j] != NULL)
+			continue;
+		if (!pk_backend_test_perf_emit (job, pk_backend_test_perf_get_info (i), i))
+			return;
+	}
+}
+
+void
+pk_backend_search_names (PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
+{
+	pk_backend_job_thread_create (job, pk_backend_search_names_thread, NULL, NULL);
+}
+
+static void
+pk_backend_resolve_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	PkBitfield filters;
+	guint i;
+	guint idx;
+	g_autofree gchar **search = NULL;
+
+	g_variant_get (params, "(t^a&s)", &filters, &search);
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+	for (i = 0; search[i] != NULL; i++) {
+		if (!pk_backend_test_perf_parse (search[i], &idx))
+			continue;
+		if (!pk_backend_test_perf_filter (filters, idx))
+			continue;
+		if (!pk_backend_test_perf_emit (job, pk_backend_test_perf_get_info (idx), idx))
+			return;
+	}
+}
+
+void
+pk_backend_resolve (PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **packages)
+{
+	pk_backend_job_thread_create (job, pk_backend_resolve_thread, NULL, NULL);
+}
+
+static void
+pk_backend_install_packages_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	PkBitfield transaction_flags;
+	guint i;
+	guint j;
+	guint idx;
+	guint len;
+	g_autofree gchar **package_ids = NULL;
+
+	g_variant_get (params, "(t^a&s)", &transaction_flags, &package_ids);
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_DEP_RESOLVE);
+
+	/* every package pulls in the ones after it */
+	len = g_strv_length (package_ids);
+	for (i = 0; i < len; i++) {
+		if (!pk_backend_test_perf_parse (package_ids[i], &idx)) {
+			pk_backend_job_error_code (job, PK_ERROR_ENUM_PACKAGE_NOT_FOUND,
+						   "%s not found", package_ids[i]);
+			return;
+		}
+		pk_backend_job_set_percentage (job, i * 100 / len);
+		for (j = 0; j <= priv->depends; j++) {
+			if (!pk_backend_test_perf_emit (job, PK_INFO_ENUM_INSTALLING,
+							(idx + j) % priv->packages))
+				return;
+		}
+	}
+	pk_backend_job_set_percentage (job, 100);
+}
+
+void
+pk_backend_install_packages (PkBackend *backend, PkBackendJob *job,
+			     PkBitfield transaction_flags, gchar **package_ids)
+{
+	pk_backend_job_thread_create (job, pk_backend_install_packages_thread, NULL, NULL);
+}
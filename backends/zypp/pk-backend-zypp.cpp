@@ -912,19 +912,21 @@ zypp_get_package_by_id (const gchar *package_id)
 		return sat::Solvable::noSolvable;
 	}
 
-	gchar **id_parts = pk_package_id_split(package_id);
-	const gchar *arch = id_parts[PK_PACKAGE_ID_ARCH];
-	if (!arch)
-		arch = "noarch";
-	bool want_source = !g_strcmp0 (arch, "source");
-	
+	PkPackageIdView view;
+	if (!pk_package_id_view_init (&view, package_id))
+		return sat::Solvable::noSolvable;
+	const string name (view.name, view.name_len);
+	const string arch = view.arch_len > 0 ? string (view.arch, view.arch_len) : string ("noarch");
+	const bool want_source = arch == "source";
+	const bool want_installed = g_str_has_prefix (view.data, "installed");
+
 	sat::Solvable package;
 
 	ResPool pool = ResPool::instance();
 
 	// Iterate over the resolvables and mark the one we want to check its dependencies
-	for (ResPool::byName_iterator it = pool.byNameBegin (id_parts[PK_PACKAGE_ID_NAME]);
-	     it != pool.byNameEnd (id_parts[PK_PACKAGE_ID_NAME]); ++it) {
+	for (ResPool::byName_iterator it = pool.byNameBegin (name);
+	     it != pool.byNameEnd (name); ++it) {
 		
 		sat::Solvable pkg = it->satSolvable();
 		//MIL << "match " << package_id << " " << pkg << endl;
@@ -934,27 +936,27 @@ zypp_get_package_by_id (const gchar *package_id)
 			continue;
 		}
 
-		if (!want_source && (isKind<SrcPackage>(pkg) || g_strcmp0 (pkg.arch().c_str(), arch))) {
+		if (!want_source && (isKind<SrcPackage>(pkg) || pkg.arch().asString() != arch)) {
 			//MIL << "not a matching arch\n";
 			continue;
 		}
 
 		const string &ver = pkg.edition ().asString();
-		if (g_strcmp0 (ver.c_str (), id_parts[PK_PACKAGE_ID_VERSION])) {
+		if (!pk_package_id_part_equal (view.version, view.version_len, ver.c_str ())) {
 			//MIL << "not a matching version\n";
 			continue;
 		}
 
 		if (!pkg.isSystem()) {
-			if (!strncmp(id_parts[PK_PACKAGE_ID_DATA], "installed", 9)) {
+			if (want_installed) {
 				//MIL << "pkg is not installed\n";
 				continue;
 			}
-			if (g_strcmp0(pkg.repository().alias().c_str(), id_parts[PK_PACKAGE_ID_DATA])) {
+			if (g_strcmp0(pkg.repository().alias().c_str(), view.data)) {
 				//MIL << "repo does not match\n";
 				continue;
 			}
-		} else if (strncmp(id_parts[PK_PACKAGE_ID_DATA], "installed", 9)) {
+		} else if (!want_installed) {
 			//MIL << "pkg installed\n";
 			continue;
 		}
@@ -964,7 +966,6 @@ zypp_get_package_by_id (const gchar *package_id)
 		break;
 	}
 
-	g_strfreev (id_parts);
 	return package;
 }
 
@@ -55,6 +55,7 @@ typedef struct {
 	PkBitfield	 filters;
 	guint		 defered_status_id;
 	PkStatusEnum	 defered_status;
+	guint		 packages_streamed;
 } PkConsoleCtx;
 
 /**
@@ -132,6 +133,27 @@ pk_console_package_cb (PkPackage *package, PkConsoleCtx *ctx)
 		 pk_package_get_summary (package));
 }
 
+static void
+pk_console_package_stream_cb (PkPackage *package, gpointer data)
+{
+	PkConsoleCtx *ctx = (PkConsoleCtx *) data;
+
+	/* the results start with the first package */
+	if (ctx->packages_streamed++ == 0) {
+		if (ctx->defered_status_id > 0) {
+			g_source_remove (ctx->defered_status_id);
+			ctx->defered_status_id = 0;
+		}
+		if (ctx->is_console) {
+			pk_progress_bar_end (ctx->progressbar);
+		} else {
+			/* TRANSLATORS: the results from the transaction */
+			g_print ("%s\n", _("Results:"));
+		}
+	}
+	pk_console_package_cb (package, ctx);
+}
+
 static void
 pk_console_transaction_cb (PkTransactionPast *item, PkConsoleCtx *ctx)
 {
@@ -537,6 +559,10 @@ pk_console_progress_cb (PkProgress *progress, PkProgressType type, gpointer data
 	g_autofree gchar *package_id = NULL;
 	g_autofree gchar *printable = NULL;
 
+	/* the packages are being printed */
+	if (ctx->packages_streamed > 0)
+		return;
+
 	/* role */
 	if (type == PK_PROGRESS_TYPE_ROLE) {
 		g_object_get (progress,
@@ -652,7 +678,9 @@ pk_console_finished_cb (GObject *object, GAsyncResult *res, gpointer data)
 	g_autoptr(PkResults) results = NULL;
 
 	/* no more progress */
-	if (ctx->is_console) {
+	if (ctx->packages_streamed > 0) {
+		/* already printed with the first package */
+	} else if (ctx->is_console) {
 		pk_progress_bar_end (ctx->progressbar);
 	} else {
 		/* TRANSLATORS: the results from the transaction */
@@ -717,7 +745,7 @@ pk_console_finished_cb (GObject *object, GAsyncResult *res, gpointer data)
 	}
 
 	/* special case */
-	if (array->len == 0 &&
+	if (array->len == 0 && ctx->packages_streamed == 0 &&
 	    (role == PK_ROLE_ENUM_GET_UPDATES ||
 	     role == PK_ROLE_ENUM_UPDATE_PACKAGES)) {
 		/* TRANSLATORS: print a message when there are no updates */
@@ -1459,6 +1487,7 @@ pk_console_get_summary (PkConsoleCtx *ctx)
 	g_string_append_printf (string, "  %s\n", "offline-trigger");
 	g_string_append_printf (string, "  %s\n", "offline-cancel");
 	g_string_append_printf (string, "  %s\n", "offline-status");
+	g_string_append_printf (string, "  %s\n", "stats");
 	g_string_append_printf (string, "  %s\n", "quit");
 	return g_string_free (string, FALSE);
 }
@@ -1538,6 +1567,62 @@ pk_console_offline_status (GError **error)
 	return TRUE;
 }
 
+static void
+pk_console_print_latencies (const gchar *title, GVariantIter *iter)
+{
+	const gchar *name;
+	guint64 count, p50, p90, p99, max;
+
+	g_print ("%-20s %8s %10s %10s %10s %10s\n",
+		 title, "count", "p50/ms", "p90/ms", "p99/ms", "max/ms");
+	while (g_variant_iter_next (iter, "(&sttttt)", &name, &count, &p50, &p90, &p99, &max)) {
+		g_print ("%-20s %8" G_GUINT64_FORMAT " %10.1f %10.1f %10.1f %10.1f\n",
+			 name, count,
+			 p50 / 1000.f, p90 / 1000.f, p99 / 1000.f, max / 1000.f);
+	}
+}
+
+static gboolean
+pk_console_stats (GError **error)
+{
+	const gchar *name;
+	guint64 count, bytes;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(GVariantIter) phases = NULL;
+	g_autoptr(GVariantIter) roles = NULL;
+	g_autoptr(GVariantIter) signals = NULL;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+	if (connection == NULL)
+		return FALSE;
+	value = g_dbus_connection_call_sync (connection,
+					     PK_DBUS_SERVICE,
+					     PK_DBUS_PATH,
+					     PK_DBUS_INTERFACE_DEBUG,
+					     "GetStats",
+					     NULL,
+					     G_VARIANT_TYPE ("(a(sttttt)a(sttttt)a(stt))"),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1,
+					     NULL,
+					     error);
+	if (value == NULL)
+		return FALSE;
+	g_variant_get (value, "(a(sttttt)a(sttttt)a(stt))", &phases, &roles, &signals);
+
+	pk_console_print_latencies ("Phase", phases);
+	g_print ("\n");
+	pk_console_print_latencies ("Role", roles);
+	g_print ("\n");
+	g_print ("%-24s %10s %12s\n", "Signal", "count", "bytes");
+	while (g_variant_iter_next (signals, "(&stt)", &name, &count, &bytes)) {
+		g_print ("%-24s %10" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT "\n",
+			 name, count, bytes);
+	}
+	return TRUE;
+}
+
 static gboolean
 pk_console_set_proxy (PkConsoleCtx *ctx, GError **error)
 {
@@ -1768,6 +1853,17 @@ main (int argc, char *argv[])
 	/* start polkit tty agent to listen for password requests */
 	pk_polkit_agent_open ();
 
+	/* print the packages of listing commands as they arrive */
+	if (strcmp (mode, "search") == 0 ||
+	    strcmp (mode, "resolve") == 0 ||
+	    strcmp (mode, "what-provides") == 0 ||
+	    strcmp (mode, "get-updates") == 0 ||
+	    strcmp (mode, "get-packages") == 0) {
+		pk_client_set_package_callback (PK_CLIENT (ctx->task),
+						pk_console_package_stream_cb,
+						ctx);
+	}
+
 	/* parse the big list */
 	if (strcmp (mode, "search") == 0) {
 		if (value == NULL) {
@@ -2300,6 +2396,12 @@ main (int argc, char *argv[])
 		if (!ret)
 			ctx->retval = error->code;
 
+	} else if (strcmp (mode, "stats") == 0) {
+
+		run_mainloop = FALSE;
+		if (!pk_console_stats (&error))
+			ctx->retval = EXIT_FAILURE;
+
 	} else if (strcmp (mode, "get-transactions") == 0) {
 		pk_client_get_old_transactions_async (PK_CLIENT (ctx->task),
 						      10,
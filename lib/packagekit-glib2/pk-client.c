@@ -38,12 +38,14 @@
 
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-client-helper.h>
+#include <packagekit-glib2/pk-client-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-control.h>
 #include <packagekit-glib2/pk-debug.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
+#include <packagekit-glib2/pk-results-private.h>
 
 static void     pk_client_finalize	(GObject     *object);
 
@@ -66,6 +68,9 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	guint			 cache_age;
+	gchar			*solution_token;
+	PkClientPackageCallback	 package_callback;
+	gpointer		 package_user_data;
 };
 
 enum {
@@ -101,6 +106,7 @@ typedef struct {
 	gchar				*distro_id;
 	gchar				*transaction_id;
 	gchar				*value;
+	gchar				*solution_token;
 	gpointer			 progress_user_data;
 	gpointer			 user_data;
 	guint				 number;
@@ -114,11 +120,18 @@ typedef struct {
 	PkClient			*client;
 	PkProgress			*progress;
 	PkProgressCallback		 progress_callback;
+	PkClientPackageCallback		 package_callback;
+	gpointer			 package_user_data;
 	PkResults			*results;
 	PkRoleEnum			 role;
 	PkSigTypeEnum			 type;
 	PkUpgradeKindEnum		 upgrade_kind;
 	guint				 refcount;
+	guint				 signal_id;
+	gboolean			 hints_pending;
+	GError				*hints_error;
+	gboolean			 finish_pending;
+	GError				*finish_error;
 	PkClientHelper			*client_helper;
 } PkClientState;
 
@@ -538,6 +551,15 @@ pk_client_set_property_value (PkClientState *state,
 		return;
 	}
 
+	/* solution-token */
+	if (g_strcmp0 (key, "SolutionToken") == 0) {
+		const gchar *tmp = g_variant_get_string (value, NULL);
+		/* only set when a simulate finishes */
+		if (state->results != NULL && tmp[0] != '\0')
+			pk_results_set_solution_token (state->results, tmp);
+		return;
+	}
+
 	/* uid */
 	if (g_strcmp0 (key, "Uid") == 0) {
 		ret = pk_progress_set_uid (state->progress,
@@ -561,12 +583,12 @@ pk_client_cancel_cb (GObject *source_object,
 		     GAsyncResult *res,
 		     gpointer user_data)
 {
-	GDBusProxy *proxy = G_DBUS_PROXY (source_object);
+	GDBusConnection *connection = G_DBUS_CONNECTION (source_object);
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GVariant) value = NULL;
 
 	/* get the result */
-	value = g_dbus_proxy_call_finish (proxy, res, &error);
+	value = g_dbus_connection_call_finish (connection, res, &error);
 	if (value == NULL) {
 		/* there's not really a lot we can do here */
 		g_warning ("failed to cancel: %s", error->message);
@@ -581,19 +603,26 @@ static void
 pk_client_cancellable_cancel_cb (GCancellable *cancellable, PkClientState *state)
 {
 	/* dbus method has not yet fired */
-	if (state->proxy == NULL) {
+	if (state->proxy == NULL && state->signal_id == 0) {
 		g_debug ("Cancelled, but no proxy, not sure what to do here");
 		return;
 	}
 
 	/* takeover the call with the cancel method */
 	g_debug ("cancelling %s", state->tid);
-	g_dbus_proxy_call (state->proxy, "Cancel",
-			   NULL,
-			   G_DBUS_CALL_FLAGS_NONE,
-			   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-			   NULL,
-			   pk_client_cancel_cb, NULL);
+	g_dbus_connection_call (state->proxy != NULL ?
+					g_dbus_proxy_get_connection (state->proxy) :
+					state->client->priv->connection,
+				PK_DBUS_SERVICE,
+				state->tid,
+				PK_DBUS_INTERFACE_TRANSACTION,
+				"Cancel",
+				NULL,
+				NULL,
+				G_DBUS_CALL_FLAGS_NONE,
+				PK_CLIENT_DBUS_METHOD_TIMEOUT,
+				NULL,
+				pk_client_cancel_cb, NULL);
 }
 
 /*
@@ -640,6 +669,18 @@ pk_client_state_finish (PkClientState *state, const GError *error)
 	gboolean ret;
 	g_autoptr(GError) error_local = NULL;
 
+	/* the SetHints reply still needs the state, and can fail the request */
+	if (state->hints_pending) {
+		if (!state->finish_pending && error != NULL)
+			state->finish_error = g_error_copy (error);
+		state->finish_pending = TRUE;
+		return;
+	}
+	if (state->hints_error != NULL) {
+		state->ret = FALSE;
+		error = state->hints_error;
+	}
+
 	/* force finished (if not already set) so clients can update the UI's */
 	ret = pk_progress_set_status (state->progress, PK_STATUS_ENUM_FINISHED);
 	if (ret && state->progress_callback != NULL) {
@@ -664,6 +705,10 @@ pk_client_state_finish (PkClientState *state, const GError *error)
 						      state);
 		g_object_unref (G_OBJECT (state->proxy));
 	}
+	if (state->signal_id > 0) {
+		g_dbus_connection_signal_unsubscribe (state->client->priv->connection,
+						      state->signal_id);
+	}
 
 	if (state->proxy_props != NULL)
 		g_object_unref (G_OBJECT (state->proxy_props));
@@ -698,6 +743,9 @@ pk_client_state_finish (PkClientState *state, const GError *error)
 	g_free (state->repo_id);
 	g_strfreev (state->search);
 	g_free (state->value);
+	g_free (state->solution_token);
+	g_clear_error (&state->hints_error);
+	g_clear_error (&state->finish_error);
 	g_free (state->tid);
 	g_free (state->distro_id);
 	g_free (state->transaction_id);
@@ -737,23 +785,21 @@ pk_client_properties_changed_cb (GDBusProxy *proxy,
 }
 
 /*
- * pk_client_signal_package:
+ * pk_client_create_package:
  */
-static void
-pk_client_signal_package (PkClientState *state,
+static PkPackage *
+pk_client_create_package (PkClientState *state,
 			  PkInfoEnum info_enum,
 			  const gchar *package_id,
 			  const gchar *summary)
 {
-	gboolean ret;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkPackage) package = NULL;
 
-	/* create virtual package */
 	package = pk_package_new ();
 	if (!pk_package_set_id (package, package_id, &error)) {
 		g_warning ("failed to set package id for %s", package_id);
-		return;
+		return NULL;
 	}
 	g_object_set (package,
 		      "info", info_enum,
@@ -761,10 +807,42 @@ pk_client_signal_package (PkClientState *state,
 		      "role", state->role,
 		      "transaction-id", state->transaction_id,
 		      NULL);
+	return g_steal_pointer (&package);
+}
 
-	/* add to results */
-	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
-		pk_results_add_package (state->results, package);
+/*
+ * pk_client_signal_package:
+ */
+static void
+pk_client_signal_package (PkClientState *state,
+			  PkInfoEnum info_enum,
+			  const gchar *package_id,
+			  const gchar *summary)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkPackage) package = NULL;
+
+	/* hand the package over as it arrives rather than keeping it */
+	if (state->package_callback != NULL && info_enum != PK_INFO_ENUM_FINISHED) {
+		package = pk_client_create_package (state, info_enum, package_id, summary);
+		if (package == NULL)
+			return;
+		state->package_callback (package, state->package_user_data);
+
+	/* add to results, the PkPackage is only created if it is asked for */
+	} else if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED) {
+		if (!pk_results_add_package_data (state->results,
+						  info_enum,
+						  package_id,
+						  summary,
+						  state->role,
+						  state->transaction_id,
+						  &error)) {
+			g_warning ("failed to set package id for %s", package_id);
+			return;
+		}
+	}
 
 	/* only emit progress for verb packages */
 	switch (info_enum) {
@@ -779,6 +857,11 @@ pk_client_signal_package (PkClientState *state,
 	case PK_INFO_ENUM_PREPARING:
 	case PK_INFO_ENUM_DECOMPRESSING:
 	case PK_INFO_ENUM_FINISHED:
+		/* create virtual package */
+		if (package == NULL)
+			package = pk_client_create_package (state, info_enum, package_id, summary);
+		if (package == NULL)
+			return;
 		ret = pk_progress_set_package_id (state->progress, package_id);
 		if (state->progress_callback != NULL && ret) {
 			state->progress_callback (state->progress,
@@ -1389,6 +1472,38 @@ pk_client_signal_cb (GDBusProxy *proxy,
 		return;
 }
 
+/*
+ * pk_client_connection_signal_cb:
+ **/
+static void
+pk_client_connection_signal_cb (GDBusConnection *connection,
+				const gchar *sender_name,
+				const gchar *object_path,
+				const gchar *interface_name,
+				const gchar *signal_name,
+				GVariant *parameters,
+				gpointer user_data)
+{
+	PkClientState *state = (PkClientState *) user_data;
+	const gchar *interface_tmp;
+	g_autoptr(GVariant) changed_properties = NULL;
+
+	/* the properties are not loaded up front, as they only change
+	 * once the transaction has been started */
+	if (g_strcmp0 (interface_name, "org.freedesktop.DBus.Properties") == 0) {
+		if (g_strcmp0 (signal_name, "PropertiesChanged") != 0)
+			return;
+		g_variant_get (parameters, "(&s@a{sv}as)",
+			       &interface_tmp, &changed_properties, NULL);
+		if (g_strcmp0 (interface_tmp, PK_DBUS_INTERFACE_TRANSACTION) != 0)
+			return;
+		pk_client_properties_changed_cb (NULL, changed_properties, NULL, state);
+		return;
+	}
+	if (g_strcmp0 (interface_name, PK_DBUS_INTERFACE_TRANSACTION) == 0)
+		pk_client_signal_cb (NULL, sender_name, signal_name, parameters, state);
+}
+
 /*
  * pk_client_proxy_connect:
  **/
@@ -1426,13 +1541,13 @@ pk_client_method_cb (GObject *source_object,
 		     GAsyncResult *res,
 		     gpointer user_data)
 {
-	GDBusProxy *proxy = G_DBUS_PROXY (source_object);
+	GDBusConnection *connection = G_DBUS_CONNECTION (source_object);
 	PkClientState *state = (PkClientState *) user_data;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GVariant) value = NULL;
 
 	/* get the result */
-	value = g_dbus_proxy_call_finish (proxy, res, &error);
+	value = g_dbus_connection_call_finish (connection, res, &error);
 	if (value == NULL) {
 		/* fix up the D-Bus error */
 		pk_client_fixup_dbus_error (error);
@@ -1469,21 +1584,59 @@ pk_client_set_hints_cb (GObject *source_object,
 			GAsyncResult *res,
 			gpointer user_data)
 {
-	GDBusProxy *proxy = G_DBUS_PROXY (source_object);
+	GDBusConnection *connection = G_DBUS_CONNECTION (source_object);
 	PkClientState *state = (PkClientState *) user_data;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GVariant) value = NULL;
 
-	/* get the result */
-	value = g_dbus_proxy_call_finish (proxy, res, &error);
+	/* the role method has already been called without waiting for this,
+	 * so fail the request when it finishes */
+	value = g_dbus_connection_call_finish (connection, res, &error);
 	if (value == NULL) {
-		/* fix up the D-Bus error */
-		pk_client_fixup_dbus_error (error);
-		pk_client_state_finish (state, error);
-		return;
+		g_warning ("failed to set hints: %s", error->message);
+		state->hints_error = g_steal_pointer (&error);
 	}
+	state->hints_pending = FALSE;
+
+	/* it finished while we were waiting */
+	if (state->finish_pending)
+		pk_client_state_finish (state, state->finish_error);
+}
+
+/*
+ * pk_client_call_method:
+ *
+ * Calls a method on the transaction of @state without a #GDBusProxy.
+ **/
+static void
+pk_client_call_method (PkClientState *state,
+		       const gchar *method_name,
+		       GVariant *parameters,
+		       GAsyncReadyCallback callback)
+{
+	g_dbus_connection_call (state->client->priv->connection,
+				PK_DBUS_SERVICE,
+				state->tid,
+				PK_DBUS_INTERFACE_TRANSACTION,
+				method_name,
+				parameters,
+				NULL,
+				G_DBUS_CALL_FLAGS_NONE,
+				PK_CLIENT_DBUS_METHOD_TIMEOUT,
+				state->cancellable,
+				callback,
+				state);
+}
 
+/*
+ * pk_client_call_role:
+ **/
+static void
+pk_client_call_role (PkClientState *state)
+{
 	/* we'll have results from now on */
+	state->package_callback = state->client->priv->package_callback;
+	state->package_user_data = state->client->priv->package_user_data;
 	state->results = pk_results_new ();
 	g_object_set (state->results,
 		      "role", state->role,
@@ -1493,357 +1646,229 @@ pk_client_set_hints_cb (GObject *source_object,
 
 	/* do this async, although this should be pretty fast anyway */
 	if (state->role == PK_ROLE_ENUM_RESOLVE) {
-		g_dbus_proxy_call (state->proxy, "Resolve",
-				   g_variant_new ("(t^a&s)",
-						  state->filters,
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "Resolve",
+				       g_variant_new ("(t^a&s)",
+						      state->filters,
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_SEARCH_NAME) {
-		g_dbus_proxy_call (state->proxy, "SearchNames",
-				   g_variant_new ("(t^a&s)",
-						  state->filters,
-						  state->search),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "SearchNames",
+				       g_variant_new ("(t^a&s)",
+						      state->filters,
+						      state->search),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_SEARCH_DETAILS) {
-		g_dbus_proxy_call (state->proxy, "SearchDetails",
-				   g_variant_new ("(t^a&s)",
-						  state->filters,
-						  state->search),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "SearchDetails",
+				       g_variant_new ("(t^a&s)",
+						      state->filters,
+						      state->search),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_SEARCH_GROUP) {
-		g_dbus_proxy_call (state->proxy, "SearchGroups",
-				   g_variant_new ("(t^a&s)",
-						  state->filters,
-						  state->search),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "SearchGroups",
+				       g_variant_new ("(t^a&s)",
+						      state->filters,
+						      state->search),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_SEARCH_FILE) {
-		g_dbus_proxy_call (state->proxy, "SearchFiles",
-				   g_variant_new ("(t^a&s)",
-						  state->filters,
-						  state->search),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "SearchFiles",
+				       g_variant_new ("(t^a&s)",
+						      state->filters,
+						      state->search),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_GET_DETAILS) {
-		g_dbus_proxy_call (state->proxy, "GetDetails",
-				   g_variant_new ("(^a&s)",
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetDetails",
+				       g_variant_new ("(^a&s)",
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_DETAILS_LOCAL) {
-		g_dbus_proxy_call (state->proxy, "GetDetailsLocal",
-				   g_variant_new ("(^a&s)",
-						  state->files),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetDetailsLocal",
+				       g_variant_new ("(^a&s)",
+						      state->files),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->files),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_FILES_LOCAL) {
-		g_dbus_proxy_call (state->proxy, "GetFilesLocal",
-				   g_variant_new ("(^a&s)",
-						  state->files),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetFilesLocal",
+				       g_variant_new ("(^a&s)",
+						      state->files),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->files),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_UPDATE_DETAIL) {
-		g_dbus_proxy_call (state->proxy, "GetUpdateDetail",
-				   g_variant_new ("(^a&s)",
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetUpdateDetail",
+				       g_variant_new ("(^a&s)",
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_OLD_TRANSACTIONS) {
-		g_dbus_proxy_call (state->proxy, "GetOldTransactions",
-				   g_variant_new ("(u)",
-						  state->number),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetOldTransactions",
+				       g_variant_new ("(u)",
+						      state->number),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_DOWNLOAD_PACKAGES) {
-		g_dbus_proxy_call (state->proxy, "DownloadPackages",
-				   g_variant_new ("(b^a&s)",
-						  (state->directory == NULL),
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "DownloadPackages",
+				       g_variant_new ("(b^a&s)",
+						      (state->directory == NULL),
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_UPDATES) {
-		g_dbus_proxy_call (state->proxy, "GetUpdates",
-				   g_variant_new ("(t)",
-						  state->filters),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetUpdates",
+				       g_variant_new ("(t)",
+						      state->filters),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_DEPENDS_ON) {
-		g_dbus_proxy_call (state->proxy, "DependsOn",
-				   g_variant_new ("(t^a&sb)",
-						  state->filters,
-						  state->package_ids,
-						  state->recursive),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "DependsOn",
+				       g_variant_new ("(t^a&sb)",
+						      state->filters,
+						      state->package_ids,
+						      state->recursive),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 
 	} else if (state->role == PK_ROLE_ENUM_REQUIRED_BY) {
-		g_dbus_proxy_call (state->proxy, "RequiredBy",
-				   g_variant_new ("(t^a&sb)",
-						  state->filters,
-						  state->package_ids,
-						  state->recursive),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RequiredBy",
+				       g_variant_new ("(t^a&sb)",
+						      state->filters,
+						      state->package_ids,
+						      state->recursive),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_PACKAGES) {
-		g_dbus_proxy_call (state->proxy, "GetPackages",
-				   g_variant_new ("(t)",
-						  state->filters),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetPackages",
+				       g_variant_new ("(t)",
+						      state->filters),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_WHAT_PROVIDES) {
-		g_dbus_proxy_call (state->proxy, "WhatProvides",
-				   g_variant_new ("(t^a&s)",
-						  state->filters,
-						  state->search),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "WhatProvides",
+				       g_variant_new ("(t^a&s)",
+						      state->filters,
+						      state->search),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_GET_DISTRO_UPGRADES) {
-		g_dbus_proxy_call (state->proxy, "GetDistroUpgrades",
-				   NULL,
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetDistroUpgrades",
+				       NULL,
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_GET_FILES) {
-		g_dbus_proxy_call (state->proxy, "GetFiles",
-				   g_variant_new ("(^a&s)",
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetFiles",
+				       g_variant_new ("(^a&s)",
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_GET_CATEGORIES) {
-		g_dbus_proxy_call (state->proxy, "GetCategories",
-				   NULL,
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetCategories",
+				       NULL,
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_REMOVE_PACKAGES) {
-		g_dbus_proxy_call (state->proxy, "RemovePackages",
-				   g_variant_new ("(t^a&sbb)",
-						  state->transaction_flags,
-						  state->package_ids,
-						  state->allow_deps,
-						  state->autoremove),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RemovePackages",
+				       g_variant_new ("(t^a&sbb)",
+						      state->transaction_flags,
+						      state->package_ids,
+						      state->allow_deps,
+						      state->autoremove),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_REFRESH_CACHE) {
-		g_dbus_proxy_call (state->proxy, "RefreshCache",
-				   g_variant_new ("(b)",
-						  state->force),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RefreshCache",
+				       g_variant_new ("(b)",
+						      state->force),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
-		g_dbus_proxy_call (state->proxy, "InstallPackages",
-				   g_variant_new ("(t^a&s)",
-						  state->transaction_flags,
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "InstallPackages",
+				       g_variant_new ("(t^a&s)",
+						      state->transaction_flags,
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_INSTALL_SIGNATURE) {
-		g_dbus_proxy_call (state->proxy, "InstallSignature",
-				   g_variant_new ("(uss)",
-						  state->type,
-						  state->key_id,
-						  state->package_id),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "InstallSignature",
+				       g_variant_new ("(uss)",
+						      state->type,
+						      state->key_id,
+						      state->package_id),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
-		g_dbus_proxy_call (state->proxy, "UpdatePackages",
-				   g_variant_new ("(t^a&s)",
-						  state->transaction_flags,
-						  state->package_ids),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "UpdatePackages",
+				       g_variant_new ("(t^a&s)",
+						      state->transaction_flags,
+						      state->package_ids),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->package_ids),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_INSTALL_FILES) {
-		g_dbus_proxy_call (state->proxy, "InstallFiles",
-				   g_variant_new ("(t^a&s)",
-						  state->transaction_flags,
-						  state->files),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "InstallFiles",
+				       g_variant_new ("(t^a&s)",
+						      state->transaction_flags,
+						      state->files),
+				       pk_client_method_cb);
 		g_object_set (state->results,
 			      "inputs", g_strv_length (state->files),
 			      NULL);
 	} else if (state->role == PK_ROLE_ENUM_ACCEPT_EULA) {
-		g_dbus_proxy_call (state->proxy, "AcceptEula",
-				   g_variant_new ("(s)",
-						  state->eula_id),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "AcceptEula",
+				       g_variant_new ("(s)",
+						      state->eula_id),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_GET_REPO_LIST) {
-		g_dbus_proxy_call (state->proxy, "GetRepoList",
-				   g_variant_new ("(t)",
-						  state->filters),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "GetRepoList",
+				       g_variant_new ("(t)",
+						      state->filters),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_REPO_ENABLE) {
-		g_dbus_proxy_call (state->proxy, "RepoEnable",
-				   g_variant_new ("(sb)",
-						  state->repo_id,
-						  state->enabled),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RepoEnable",
+				       g_variant_new ("(sb)",
+						      state->repo_id,
+						      state->enabled),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_REPO_SET_DATA) {
-		g_dbus_proxy_call (state->proxy, "RepoSetData",
-				   g_variant_new ("(sss)",
-						  state->repo_id,
-						  state->parameter ? state->parameter : "",
-						  state->value ? state->value : ""),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RepoSetData",
+				       g_variant_new ("(sss)",
+						      state->repo_id,
+						      state->parameter ? state->parameter : "",
+						      state->value ? state->value : ""),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_REPO_REMOVE) {
-		g_dbus_proxy_call (state->proxy, "RepoRemove",
-				   g_variant_new ("(tsb)",
-						  state->transaction_flags,
-						  state->repo_id,
-						  state->autoremove),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RepoRemove",
+				       g_variant_new ("(tsb)",
+						      state->transaction_flags,
+						      state->repo_id,
+						      state->autoremove),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_UPGRADE_SYSTEM) {
-		g_dbus_proxy_call (state->proxy, "UpgradeSystem",
-				   g_variant_new ("(tsu)",
-						  state->transaction_flags,
-						  state->distro_id,
-						  state->upgrade_kind),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "UpgradeSystem",
+				       g_variant_new ("(tsu)",
+						      state->transaction_flags,
+						      state->distro_id,
+						      state->upgrade_kind),
+				       pk_client_method_cb);
 	} else if (state->role == PK_ROLE_ENUM_REPAIR_SYSTEM) {
-		g_dbus_proxy_call (state->proxy, "RepairSystem",
-				   g_variant_new ("(t)",
-						  state->transaction_flags),
-				   G_DBUS_CALL_FLAGS_NONE,
-				   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-				   state->cancellable,
-				   pk_client_method_cb,
-				   state);
+		pk_client_call_method (state, "RepairSystem",
+				       g_variant_new ("(t)",
+						      state->transaction_flags),
+				       pk_client_method_cb);
 	} else {
 		g_assert_not_reached ();
 	}
@@ -2002,25 +2027,14 @@ pk_client_create_helper_socket (PkClientState *state)
 }
 
 /*
- * pk_client_get_proxy_cb:
+ * pk_client_set_hints:
  **/
 static void
-pk_client_get_proxy_cb (GObject *object,
-			GAsyncResult *res,
-			gpointer user_data)
+pk_client_set_hints (PkClientState *state)
 {
 	gchar *hint;
-	PkClientState *state = (PkClientState *) user_data;
-	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 
-	state->proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
-	if (state->proxy == NULL)
-		g_error ("Cannot connect to PackageKit on %s", state->tid);
-
-	/* connect */
-	pk_client_proxy_connect (state);
-
 	/* get hints */
 	array = g_ptr_array_new_with_free_func (g_free);
 
@@ -2047,6 +2061,13 @@ pk_client_get_proxy_cb (GObject *object,
 		g_ptr_array_add (array, hint);
 	}
 
+	/* reuse the solution of a simulate */
+	if (state->solution_token != NULL) {
+		hint = g_strdup_printf ("solution-token=%s",
+					state->solution_token);
+		g_ptr_array_add (array, hint);
+	}
+
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
 	    state->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
@@ -2057,21 +2078,75 @@ pk_client_get_proxy_cb (GObject *object,
 			g_ptr_array_add (array, hint);
 	}
 
-	/* set hints */
+	/* set hints, the state is kept until the reply arrives */
 	g_ptr_array_add (array, NULL);
-	g_dbus_proxy_call (state->proxy, "SetHints",
-			   g_variant_new ("(^a&s)",
-					  array->pdata),
-			   G_DBUS_CALL_FLAGS_NONE,
-			   PK_CLIENT_DBUS_METHOD_TIMEOUT,
-			   state->cancellable,
-			   pk_client_set_hints_cb,
-			   state);
+	state->hints_pending = TRUE;
+	g_dbus_connection_call (state->client->priv->connection,
+				PK_DBUS_SERVICE,
+				state->tid,
+				PK_DBUS_INTERFACE_TRANSACTION,
+				"SetHints",
+				g_variant_new ("(^a&s)",
+					       array->pdata),
+				NULL,
+				G_DBUS_CALL_FLAGS_NONE,
+				PK_CLIENT_DBUS_METHOD_TIMEOUT,
+				NULL,
+				pk_client_set_hints_cb,
+				state);
+}
+
+/*
+ * pk_client_start_transaction:
+ **/
+static void
+pk_client_start_transaction (PkClientState *state)
+{
+	/* listen to the transaction object rather than creating a proxy
+	 * for it, which would get all the properties first */
+	state->signal_id = g_dbus_connection_signal_subscribe (state->client->priv->connection,
+							       PK_DBUS_SERVICE,
+							       NULL,
+							       NULL,
+							       state->tid,
+							       NULL,
+							       G_DBUS_SIGNAL_FLAGS_NONE,
+							       pk_client_connection_signal_cb,
+							       state,
+							       NULL);
+
+	/* the daemon handles the calls in order, so do not wait for the
+	 * hints to be set before starting the role */
+	pk_client_set_hints (state);
+	pk_client_call_role (state);
 
 	/* track state */
 	g_ptr_array_add (state->client->priv->calls, state);
 }
 
+/*
+ * pk_client_get_bus_cb:
+ **/
+static void
+pk_client_get_bus_cb (GObject *object, GAsyncResult *res, PkClientState *state)
+{
+	GDBusConnection *connection;
+	g_autoptr(GError) error = NULL;
+
+	connection = g_bus_get_finish (res, &error);
+	if (connection == NULL) {
+		pk_client_state_finish (state, error);
+		return;
+	}
+
+	/* another transaction may have got it first */
+	if (state->client->priv->connection == NULL)
+		state->client->priv->connection = connection;
+	else
+		g_object_unref (connection);
+	pk_client_start_transaction (state);
+}
+
 /*
  * pk_client_get_tid_cb:
  **/
@@ -2089,16 +2164,15 @@ pk_client_get_tid_cb (GObject *object, GAsyncResult *res, PkClientState *state)
 
 	pk_progress_set_transaction_id (state->progress, state->tid);
 
-	/* get a connection to the transaction interface */
-	g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
-				  G_DBUS_PROXY_FLAGS_NONE,
-				  NULL,
-				  PK_DBUS_SERVICE,
-				  state->tid,
-				  PK_DBUS_INTERFACE_TRANSACTION,
-				  state->cancellable,
-				  pk_client_get_proxy_cb,
-				  state);
+	/* all the transactions use the same connection */
+	if (state->client->priv->connection == NULL) {
+		g_bus_get (G_BUS_TYPE_SYSTEM,
+			   state->cancellable,
+			   (GAsyncReadyCallback) pk_client_get_bus_cb,
+			   state);
+		return;
+	}
+	pk_client_start_transaction (state);
 }
 
 /**
@@ -3450,6 +3524,7 @@ pk_client_remove_packages_async (PkClient *client,
 							       NULL);
 	}
 	state->transaction_flags = transaction_flags;
+	state->solution_token = g_strdup (client->priv->solution_token);
 	state->allow_deps = allow_deps;
 	state->autoremove = autoremove;
 	state->package_ids = g_strdupv (package_ids);
@@ -3586,6 +3661,7 @@ pk_client_install_packages_async (PkClient *client, PkBitfield transaction_flags
 							       NULL);
 	}
 	state->transaction_flags = transaction_flags;
+	state->solution_token = g_strdup (client->priv->solution_token);
 	state->package_ids = g_strdupv (package_ids);
 	state->progress_callback = progress_callback;
 	state->progress_user_data = progress_user_data;
@@ -3726,6 +3802,7 @@ pk_client_update_packages_async (PkClient *client,
 							       NULL);
 	}
 	state->transaction_flags = transaction_flags;
+	state->solution_token = g_strdup (client->priv->solution_token);
 	state->package_ids = g_strdupv (package_ids);
 	state->progress_callback = progress_callback;
 	state->progress_user_data = progress_user_data;
@@ -3876,6 +3953,7 @@ pk_client_install_files_async (PkClient *client,
 							       NULL);
 	}
 	state->transaction_flags = transaction_flags;
+	state->solution_token = g_strdup (client->priv->solution_token);
 	state->progress_callback = progress_callback;
 	state->progress_user_data = progress_user_data;
 	state->progress = pk_progress_new ();
@@ -4688,7 +4766,7 @@ pk_client_cancel_all_dbus_methods (PkClient *client)
 	array = client->priv->calls;
 	for (i = 0; i < array->len; i++) {
 		state = g_ptr_array_index (array, i);
-		if (state->proxy == NULL)
+		if (state->proxy == NULL && state->signal_id == 0)
 			continue;
 		g_debug ("cancel in flight call");
 		g_cancellable_cancel (state->cancellable);
@@ -4697,6 +4775,23 @@ pk_client_cancel_all_dbus_methods (PkClient *client)
 	return TRUE;
 }
 
+/*
+ * pk_client_set_solution_token:
+ * @client: a valid #PkClient instance
+ * @solution_token: a token returned by a simulate, or %NULL
+ *
+ * Sets the token passed with the next install, update or remove, so the
+ * daemon can reuse the dependency solution of the simulate rather than
+ * solving again. The token is copied when the transaction is started.
+ **/
+void
+pk_client_set_solution_token (PkClient *client, const gchar *solution_token)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+	g_free (client->priv->solution_token);
+	client->priv->solution_token = g_strdup (solution_token);
+}
+
 /**
  * pk_client_set_locale:
  * @client: a valid #PkClient instance
@@ -4854,6 +4949,33 @@ pk_client_get_cache_age (PkClient *client)
 	return client->priv->cache_age;
 }
 
+/**
+ * pk_client_set_package_callback:
+ * @client: a valid #PkClient instance
+ * @package_callback: (scope notified) (nullable): the function to run for each package, or %NULL
+ * @package_user_data: data to pass to @package_callback
+ *
+ * Sets a function that is given each package as the transaction emits it.
+ * The packages are then not kept in the #PkResults, so a client that only
+ * looks at each package once does not have to hold all of them in memory
+ * or wait for the transaction to finish before it can use them. The other
+ * results are still returned as before.
+ *
+ * The function is used for the transactions started after it is set, until
+ * it is set to %NULL.
+ *
+ * Since: 1.2.1
+ **/
+void
+pk_client_set_package_callback (PkClient *client,
+				PkClientPackageCallback package_callback,
+				gpointer package_user_data)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+	client->priv->package_callback = package_callback;
+	client->priv->package_user_data = package_user_data;
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4952,8 +5074,11 @@ pk_client_finalize (GObject *object)
 	pk_client_cancel_all_dbus_methods (client);
 
 	g_free (client->priv->locale);
+	g_free (client->priv->solution_token);
 	g_object_unref (priv->control);
 	g_ptr_array_unref (priv->calls);
+	if (priv->connection != NULL)
+		g_object_unref (priv->connection);
 
 	G_OBJECT_CLASS (pk_client_parent_class)->finalize (object);
 }
@@ -105,6 +105,19 @@ struct _PkClientClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkClientPackageCallback:
+ * @package: the package the transaction emitted
+ * @user_data: user data passed to pk_client_set_package_callback()
+ *
+ * Function called for each package as the transaction emits it, when the
+ * packages are not kept in the #PkResults.
+ *
+ * Since: 1.2.1
+ */
+typedef void	(*PkClientPackageCallback)	(PkPackage		*package,
+						 gpointer		 user_data);
+
 GQuark		 pk_client_error_quark			(void);
 GType		 pk_client_get_type		  	(void);
 PkClient	*pk_client_new				(void);
@@ -429,6 +442,9 @@ gboolean	 pk_client_get_idle			(PkClient		*client);
 void		 pk_client_set_cache_age		(PkClient		*client,
 							 guint			 cache_age);
 guint		 pk_client_get_cache_age		(PkClient		*client);
+void		 pk_client_set_package_callback		(PkClient		*client,
+							 PkClientPackageCallback package_callback,
+							 gpointer		 package_user_data);
 
 G_END_DECLS
 
@@ -32,6 +32,9 @@ G_BEGIN_DECLS
 
 gchar		*pk_get_distro_name			(GError		**error);
 gchar		*pk_get_distro_version_id		(GError		**error);
+const gchar	*pk_ref_string_new_intern		(const gchar	*str);
+const gchar	*pk_ref_string_acquire			(const gchar	*str);
+void		 pk_ref_string_release			(const gchar	*str);
 
 G_END_DECLS
 
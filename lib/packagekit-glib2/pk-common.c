@@ -362,3 +362,95 @@ pk_get_distro_version_id (GError **error)
 
 	return version_id;
 }
+
+/* the string data follows the reference count in the same allocation */
+typedef struct {
+	guint		 refcount;
+	gchar		 str[];
+} PkRefString;
+
+#define PK_REF_STRING(s)	((PkRefString *) ((s) - G_STRUCT_OFFSET (PkRefString, str)))
+
+static GMutex		 pk_ref_string_mutex;
+static GHashTable	*pk_ref_string_pool = NULL;
+
+/**
+ * pk_ref_string_new_intern:
+ * @str: a string, or %NULL
+ *
+ * Gets a shared copy of the string from a pool, so that the package-id
+ * parts and summaries that are repeated over many packages are only
+ * stored once. This is like g_ref_string_new_intern(), which needs a
+ * newer GLib than we depend on.
+ *
+ * Return value: the interned string, free with pk_ref_string_release()
+ **/
+const gchar *
+pk_ref_string_new_intern (const gchar *str)
+{
+	PkRefString *ref;
+	const gchar *interned;
+	gsize len;
+
+	if (str == NULL)
+		return NULL;
+
+	g_mutex_lock (&pk_ref_string_mutex);
+	if (pk_ref_string_pool == NULL)
+		pk_ref_string_pool = g_hash_table_new (g_str_hash, g_str_equal);
+	interned = g_hash_table_lookup (pk_ref_string_pool, str);
+	if (interned != NULL) {
+		PK_REF_STRING (interned)->refcount++;
+	} else {
+		len = strlen (str);
+		ref = g_malloc (sizeof (PkRefString) + len + 1);
+		ref->refcount = 1;
+		memcpy (ref->str, str, len + 1);
+		interned = ref->str;
+		g_hash_table_add (pk_ref_string_pool, ref->str);
+	}
+	g_mutex_unlock (&pk_ref_string_mutex);
+	return interned;
+}
+
+/**
+ * pk_ref_string_acquire:
+ * @str: a string from pk_ref_string_new_intern(), or %NULL
+ *
+ * Takes another reference to an interned string.
+ *
+ * Return value: @str, free with pk_ref_string_release()
+ **/
+const gchar *
+pk_ref_string_acquire (const gchar *str)
+{
+	if (str == NULL)
+		return NULL;
+	g_mutex_lock (&pk_ref_string_mutex);
+	PK_REF_STRING (str)->refcount++;
+	g_mutex_unlock (&pk_ref_string_mutex);
+	return str;
+}
+
+/**
+ * pk_ref_string_release:
+ * @str: a string from pk_ref_string_new_intern(), or %NULL
+ *
+ * Drops a reference to an interned string, removing it from the pool when
+ * it is no longer used.
+ **/
+void
+pk_ref_string_release (const gchar *str)
+{
+	PkRefString *ref;
+
+	if (str == NULL)
+		return;
+	g_mutex_lock (&pk_ref_string_mutex);
+	ref = PK_REF_STRING (str);
+	if (--ref->refcount == 0) {
+		g_hash_table_remove (pk_ref_string_pool, str);
+		g_free (ref);
+	}
+	g_mutex_unlock (&pk_ref_string_mutex);
+}
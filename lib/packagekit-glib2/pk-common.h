@@ -67,6 +67,13 @@ G_BEGIN_DECLS
  */
 #define	PK_DBUS_INTERFACE_OFFLINE	"org.freedesktop.PackageKit.Offline"
 
+/**
+ * PK_DBUS_INTERFACE_DEBUG:
+ *
+ * The DBUS interface for PackageKit daemon statistics
+ */
+#define	PK_DBUS_INTERFACE_DEBUG		"org.freedesktop.PackageKit.Debug"
+
 /**
  * PK_PACKAGE_LIST_FILENAME:
  *
@@ -69,6 +69,7 @@ struct _PkControlPrivate
 	gboolean		 locked;
 	PkNetworkEnum		 network_state;
 	gchar			*distro_id;
+	guint			 cache_generation;
 	guint			 watch_id;
 };
 
@@ -97,6 +98,7 @@ enum {
 	PROP_NETWORK_STATE,
 	PROP_CONNECTED,
 	PROP_DISTRO_ID,
+	PROP_CACHE_GENERATION,
 	PROP_LAST
 };
 
@@ -292,6 +294,14 @@ pk_control_set_property_value (PkControl *control,
 		g_object_notify (G_OBJECT(control), "network-state");
 		return;
 	}
+	if (g_strcmp0 (key, "CacheGeneration") == 0) {
+		tmp_uint = g_variant_get_uint32 (value);
+		if (control->priv->cache_generation == tmp_uint)
+			return;
+		control->priv->cache_generation = tmp_uint;
+		g_object_notify (G_OBJECT(control), "cache-generation");
+		return;
+	}
 	if (g_strcmp0 (key, "DistroId") == 0) {
 		tmp_str = g_variant_get_string (value, NULL);
 		/* we don't want distro specific results in 'make check' */
@@ -2099,6 +2109,9 @@ pk_control_get_property (GObject *object, guint prop_id, GValue *value, GParamSp
 	case PROP_DISTRO_ID:
 		g_value_set_string (value, priv->distro_id);
 		break;
+	case PROP_CACHE_GENERATION:
+		g_value_set_uint (value, priv->cache_generation);
+		break;
 	case PROP_CONNECTED:
 		g_value_set_boolean (value, priv->connected);
 		break;
@@ -2273,6 +2286,20 @@ pk_control_class_init (PkControlClass *klass)
 				     G_PARAM_READWRITE);
 	g_object_class_install_property (object_class, PROP_DISTRO_ID, pspec);
 
+	/**
+	 * PkControl:cache-generation:
+	 *
+	 * Changes whenever the daemon drops its cached GetUpdates and
+	 * GetPackages results, so clients can skip asking again while the
+	 * value stays the same.
+	 *
+	 * Since: 1.2.1
+	 */
+	pspec = g_param_spec_uint ("cache-generation", NULL, NULL,
+				   0, G_MAXUINT, 0,
+				   G_PARAM_READWRITE);
+	g_object_class_install_property (object_class, PROP_CACHE_GENERATION, pspec);
+
 	/**
 	 * PkControl:connected:
 	 *
@@ -27,10 +27,137 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib.h>
 
 #include <packagekit-glib2/pk-package-id.h>
 
+/**
+ * pk_package_id_view_init:
+ * @view: a #PkPackageIdView to fill in
+ * @package_id: the ; delimited PackageID to parse
+ *
+ * Finds the parts of a PackageID without copying it, checking the correct
+ * number of delimiters are present. @view is only valid for as long as
+ * @package_id is.
+ *
+ * Return value: %TRUE if the PackageID was well formed
+ *
+ * Since: 1.2.1
+ **/
+gboolean
+pk_package_id_view_init (PkPackageIdView *view, const gchar *package_id)
+{
+	const gchar *parts[4];
+	const gchar *p;
+	guint cnt = 0;
+
+	g_return_val_if_fail (view != NULL, FALSE);
+
+	if (package_id == NULL)
+		return FALSE;
+
+	/* find each delimiter ';' */
+	parts[0] = package_id;
+	for (p = package_id; *p != '\0'; p++) {
+		if (*p != ';')
+			continue;
+		if (++cnt > 3)
+			return FALSE;
+		parts[cnt] = p + 1;
+	}
+	if (cnt != 3)
+		return FALSE;
+
+	/* name has to be valid */
+	if (parts[0][0] == ';')
+		return FALSE;
+
+	view->name = parts[PK_PACKAGE_ID_NAME];
+	view->name_len = parts[PK_PACKAGE_ID_VERSION] - parts[PK_PACKAGE_ID_NAME] - 1;
+	view->version = parts[PK_PACKAGE_ID_VERSION];
+	view->version_len = parts[PK_PACKAGE_ID_ARCH] - parts[PK_PACKAGE_ID_VERSION] - 1;
+	view->arch = parts[PK_PACKAGE_ID_ARCH];
+	view->arch_len = parts[PK_PACKAGE_ID_DATA] - parts[PK_PACKAGE_ID_ARCH] - 1;
+	view->data = parts[PK_PACKAGE_ID_DATA];
+	view->data_len = p - parts[PK_PACKAGE_ID_DATA];
+	return TRUE;
+}
+
+/**
+ * pk_package_id_view_hash:
+ * @view: a #PkPackageIdView
+ *
+ * Hashes the PackageID, giving the same value as g_str_hash() would for
+ * the whole PackageID.
+ *
+ * Return value: the hash value
+ *
+ * Since: 1.2.1
+ **/
+guint
+pk_package_id_view_hash (const PkPackageIdView *view)
+{
+	const gchar *parts[4] = { view->name, view->version, view->arch, view->data };
+	const gsize lens[4] = { view->name_len, view->version_len, view->arch_len, view->data_len };
+	const signed char *p;
+	guint32 h = 5381;
+	guint i;
+
+	for (i = 0; i < 4; i++) {
+		if (i > 0)
+			h = (h << 5) + h + ';';
+		for (p = (const signed char *) parts[i];
+		     p < (const signed char *) parts[i] + lens[i]; p++)
+			h = (h << 5) + h + *p;
+	}
+	return h;
+}
+
+/**
+ * pk_package_id_part_equal:
+ * @part: the start of a part of a PackageID, e.g. from #PkPackageIdView
+ * @part_len: the length of @part
+ * @str: a nul terminated string
+ *
+ * Compares a part of a PackageID with a string.
+ *
+ * Return value: %TRUE if the part and @str are the same
+ *
+ * Since: 1.2.1
+ **/
+gboolean
+pk_package_id_part_equal (const gchar *part, gsize part_len, const gchar *str)
+{
+	if (str == NULL)
+		return FALSE;
+	return strncmp (part, str, part_len) == 0 && str[part_len] == '\0';
+}
+
+/**
+ * pk_package_id_view_equal:
+ * @view1: a #PkPackageIdView
+ * @view2: a #PkPackageIdView
+ *
+ * Compares two PackageIDs part by part.
+ *
+ * Return value: %TRUE if all the parts are the same
+ *
+ * Since: 1.2.1
+ **/
+gboolean
+pk_package_id_view_equal (const PkPackageIdView *view1, const PkPackageIdView *view2)
+{
+	return view1->name_len == view2->name_len &&
+	       view1->version_len == view2->version_len &&
+	       view1->arch_len == view2->arch_len &&
+	       view1->data_len == view2->data_len &&
+	       memcmp (view1->name, view2->name, view1->name_len) == 0 &&
+	       memcmp (view1->version, view2->version, view1->version_len) == 0 &&
+	       memcmp (view1->arch, view2->arch, view1->arch_len) == 0 &&
+	       memcmp (view1->data, view2->data, view1->data_len) == 0;
+}
+
 /**
  * pk_package_id_split:
  * @package_id: the ; delimited PackageID to split
@@ -38,6 +165,9 @@
  * Splits a PackageID into the correct number of parts, checking the correct
  * number of delimiters are present.
  *
+ * Callers that only need to read the parts should use
+ * pk_package_id_view_init(), which does not allocate.
+ *
  * Return value: (transfer full): a GStrv or %NULL if invalid, use g_strfreev() to free
  *
  * Since: 0.5.3
@@ -45,22 +175,19 @@
 gchar **
 pk_package_id_split (const gchar *package_id)
 {
-	gchar **sections = NULL;
-
-	if (package_id == NULL)
-		goto out;
+	PkPackageIdView view;
+	gchar **sections;
 
-	/* split by delimeter ';' */
-	sections = g_strsplit (package_id, ";", -1);
-	if (g_strv_length (sections) != 4)
-		goto out;
+	if (!pk_package_id_view_init (&view, package_id))
+		return NULL;
 
-	/* name has to be valid */
-	if (sections[0][0] != '\0')
-		return sections;
-out:
-	g_strfreev (sections);
-	return NULL;
+	sections = g_new (gchar *, 5);
+	sections[PK_PACKAGE_ID_NAME] = g_strndup (view.name, view.name_len);
+	sections[PK_PACKAGE_ID_VERSION] = g_strndup (view.version, view.version_len);
+	sections[PK_PACKAGE_ID_ARCH] = g_strndup (view.arch, view.arch_len);
+	sections[PK_PACKAGE_ID_DATA] = g_strndup (view.data, view.data_len);
+	sections[4] = NULL;
+	return sections;
 }
 
 /**
@@ -76,23 +203,18 @@ out:
 gboolean
 pk_package_id_check (const gchar *package_id)
 {
-	g_auto(GStrv) sections = NULL;
-	gboolean ret;
+	PkPackageIdView view;
 
 	/* NULL check */
 	if (package_id == NULL)
 		return FALSE;
 
 	/* UTF8 */
-	ret = g_utf8_validate (package_id, -1, NULL);
-	if (!ret)
+	if (!g_utf8_validate (package_id, -1, NULL))
 		return FALSE;
 
 	/* correct number of sections */
-	sections = pk_package_id_split (package_id);
-	if (sections == NULL)
-		return FALSE;
-	return TRUE;
+	return pk_package_id_view_init (&view, package_id);
 }
 
 /**
@@ -125,12 +247,12 @@ pk_package_id_build (const gchar *name, const gchar *version,
  * pk_arch_base_ix86:
  **/
 static gboolean
-pk_arch_base_ix86 (const gchar *arch)
+pk_arch_base_ix86 (const gchar *arch, gsize arch_len)
 {
-	if (g_strcmp0 (arch, "i386") == 0 ||
-	    g_strcmp0 (arch, "i486") == 0 ||
-	    g_strcmp0 (arch, "i586") == 0 ||
-	    g_strcmp0 (arch, "i686") == 0)
+	if (pk_package_id_part_equal (arch, arch_len, "i386") ||
+	    pk_package_id_part_equal (arch, arch_len, "i486") ||
+	    pk_package_id_part_equal (arch, arch_len, "i586") ||
+	    pk_package_id_part_equal (arch, arch_len, "i686"))
 		return TRUE;
 	return FALSE;
 }
@@ -139,11 +261,14 @@ pk_arch_base_ix86 (const gchar *arch)
  * pk_package_id_equal_fuzzy_arch_section:
  **/
 static gboolean
-pk_package_id_equal_fuzzy_arch_section (const gchar *arch1, const gchar *arch2)
+pk_package_id_equal_fuzzy_arch_section (const PkPackageIdView *view1,
+					const PkPackageIdView *view2)
 {
-	if (g_strcmp0 (arch1, arch2) == 0)
+	if (view1->arch_len == view2->arch_len &&
+	    memcmp (view1->arch, view2->arch, view1->arch_len) == 0)
 		return TRUE;
-	if (pk_arch_base_ix86 (arch1) && pk_arch_base_ix86 (arch2))
+	if (pk_arch_base_ix86 (view1->arch, view1->arch_len) &&
+	    pk_arch_base_ix86 (view2->arch, view2->arch_len))
 		return TRUE;
 	return FALSE;
 }
@@ -163,14 +288,17 @@ pk_package_id_equal_fuzzy_arch_section (const gchar *arch1, const gchar *arch2)
 gboolean
 pk_package_id_equal_fuzzy_arch (const gchar *package_id1, const gchar *package_id2)
 {
-	g_auto(GStrv) sections1 = NULL;
-	g_auto(GStrv) sections2 = NULL;
-
-	sections1 = pk_package_id_split (package_id1);
-	sections2 = pk_package_id_split (package_id2);
-	if (g_strcmp0 (sections1[0], sections2[0]) == 0 &&
-	    g_strcmp0 (sections1[1], sections2[1]) == 0 &&
-	    pk_package_id_equal_fuzzy_arch_section (sections1[2], sections2[2]))
+	PkPackageIdView view1;
+	PkPackageIdView view2;
+
+	if (!pk_package_id_view_init (&view1, package_id1) ||
+	    !pk_package_id_view_init (&view2, package_id2))
+		return FALSE;
+	if (view1.name_len == view2.name_len &&
+	    memcmp (view1.name, view2.name, view1.name_len) == 0 &&
+	    view1.version_len == view2.version_len &&
+	    memcmp (view1.version, view2.version, view1.version_len) == 0 &&
+	    pk_package_id_equal_fuzzy_arch_section (&view1, &view2))
 		return TRUE;
 	return FALSE;
 }
@@ -188,31 +316,26 @@ pk_package_id_equal_fuzzy_arch (const gchar *package_id1, const gchar *package_i
 gchar *
 pk_package_id_to_printable (const gchar *package_id)
 {
-	g_auto(GStrv) parts = NULL;
-	gchar *value = NULL;
-	GString *string = NULL;
+	PkPackageIdView view;
+	GString *string;
 
 	/* invalid */
-	if (package_id == NULL)
-		goto out;
-
-	/* split */
-	parts = pk_package_id_split (package_id);
-	if (parts == NULL)
-		goto out;
+	if (!pk_package_id_view_init (&view, package_id))
+		return NULL;
 
 	/* name */
-	string = g_string_new (parts[PK_PACKAGE_ID_NAME]);
+	string = g_string_new_len (view.name, view.name_len);
 
 	/* version if present */
-	if (parts[PK_PACKAGE_ID_VERSION][0] != '\0')
-		g_string_append_printf (string, "-%s", parts[PK_PACKAGE_ID_VERSION]);
+	if (view.version_len > 0) {
+		g_string_append_c (string, '-');
+		g_string_append_len (string, view.version, view.version_len);
+	}
 
 	/* arch if present */
-	if (parts[PK_PACKAGE_ID_ARCH][0] != '\0')
-		g_string_append_printf (string, ".%s", parts[PK_PACKAGE_ID_ARCH]);
-out:
-	if (string != NULL)
-		value = g_string_free (string, FALSE);
-	return value;
+	if (view.arch_len > 0) {
+		g_string_append_c (string, '.');
+		g_string_append_len (string, view.arch, view.arch_len);
+	}
+	return g_string_free (string, FALSE);
 }
@@ -58,6 +58,33 @@ G_BEGIN_DECLS
  */
 #define PK_PACKAGE_ID_DATA	3
 
+/**
+ * PkPackageIdView:
+ * @name: the start of the name in the PackageID
+ * @name_len: the length of the name
+ * @version: the start of the version in the PackageID
+ * @version_len: the length of the version
+ * @arch: the start of the architecture in the PackageID
+ * @arch_len: the length of the architecture
+ * @data: the start of the data in the PackageID
+ * @data_len: the length of the data
+ *
+ * The parts of a PackageID, pointing into the original string rather than
+ * copying it. The parts are not nul terminated, apart from the data.
+ *
+ * Since: 1.2.1
+ **/
+typedef struct {
+	const gchar	*name;
+	gsize		 name_len;
+	const gchar	*version;
+	gsize		 version_len;
+	const gchar	*arch;
+	gsize		 arch_len;
+	const gchar	*data;
+	gsize		 data_len;
+} PkPackageIdView;
+
 gchar		*pk_package_id_build			(const gchar		*name,
 							 const gchar		*version,
 							 const gchar		*arch,
@@ -67,6 +94,14 @@ gchar		**pk_package_id_split			(const gchar		*package_id);
 gchar		*pk_package_id_to_printable		(const gchar		*package_id);
 gboolean	 pk_package_id_equal_fuzzy_arch		(const gchar		*package_id1,
 							 const gchar		*package_id2);
+gboolean	 pk_package_id_view_init		(PkPackageIdView	*view,
+							 const gchar		*package_id);
+guint		 pk_package_id_view_hash		(const PkPackageIdView	*view);
+gboolean	 pk_package_id_view_equal		(const PkPackageIdView	*view1,
+							 const PkPackageIdView	*view2);
+gboolean	 pk_package_id_part_equal		(const gchar		*part,
+							 gsize			 part_len,
+							 const gchar		*str);
 G_END_DECLS
 
 #endif /* __PK_PACKAGE_ID_H */
@@ -30,10 +30,12 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib-object.h>
 #include <gio/gio.h>
 
 #include <packagekit-glib2/pk-package-sack.h>
+#include <packagekit-glib2/pk-package-sack-private.h>
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
@@ -48,11 +50,28 @@ static void     pk_package_sack_finalize	(GObject     *object);
  * PkPackageSackPrivate:
  *
  * Private #PkPackageSack data
+ *
+ * The packages are stored as one array per field rather than as #PkPackage
+ * objects, with the strings copied into a #GStringChunk and the version,
+ * arch, data and transaction ID shared between all the packages that use
+ * them. A #PkPackage is only created when something asks for one, and from
+ * then on the object holds the data for that package.
  **/
 struct _PkPackageSackPrivate
 {
-	GHashTable		*table;
-	GPtrArray		*array;
+	GArray			*infos;		/* of guint8 */
+	GArray			*roles;		/* of guint8 */
+	GPtrArray		*names;		/* in strings */
+	GPtrArray		*versions;	/* interned in strings */
+	GPtrArray		*archs;		/* interned in strings */
+	GPtrArray		*datas;		/* interned in strings */
+	GPtrArray		*summaries;	/* in strings */
+	GPtrArray		*transaction_ids; /* interned in strings */
+	GPtrArray		*packages;	/* of PkPackage or NULL, or NULL */
+	GStringChunk		*strings;
+	GString			*scratch;
+	GHashTable		*table;		/* package-id:index+1, or NULL */
+	GHashTable		*name_arch_table; /* "name;arch":GArray of index, or NULL */
 	PkClient		*client;
 };
 
@@ -63,6 +82,430 @@ enum {
 
 G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 
+/*
+ * pk_package_sack_package_free:
+ **/
+static void
+pk_package_sack_package_free (gpointer data)
+{
+	if (data != NULL)
+		g_object_unref (data);
+}
+
+/*
+ * pk_package_sack_peek_package:
+ *
+ * Returns the #PkPackage for the row if one has been created.
+ **/
+static PkPackage *
+pk_package_sack_peek_package (PkPackageSack *sack, guint idx)
+{
+	if (sack->priv->packages == NULL)
+		return NULL;
+	return g_ptr_array_index (sack->priv->packages, idx);
+}
+
+/*
+ * pk_package_sack_get_row_info:
+ **/
+static PkInfoEnum
+pk_package_sack_get_row_info (PkPackageSack *sack, guint idx)
+{
+	PkPackage *package = pk_package_sack_peek_package (sack, idx);
+	if (package != NULL)
+		return pk_package_get_info (package);
+	return g_array_index (sack->priv->infos, guint8, idx);
+}
+
+/*
+ * pk_package_sack_get_row_name:
+ **/
+static const gchar *
+pk_package_sack_get_row_name (PkPackageSack *sack, guint idx)
+{
+	PkPackage *package = pk_package_sack_peek_package (sack, idx);
+	if (package != NULL)
+		return pk_package_get_name (package);
+	return g_ptr_array_index (sack->priv->names, idx);
+}
+
+/*
+ * pk_package_sack_get_row_arch:
+ **/
+static const gchar *
+pk_package_sack_get_row_arch (PkPackageSack *sack, guint idx)
+{
+	PkPackage *package = pk_package_sack_peek_package (sack, idx);
+	if (package != NULL)
+		return pk_package_get_arch (package);
+	return g_ptr_array_index (sack->priv->archs, idx);
+}
+
+/*
+ * pk_package_sack_get_row_summary:
+ **/
+static const gchar *
+pk_package_sack_get_row_summary (PkPackageSack *sack, guint idx)
+{
+	PkPackage *package = pk_package_sack_peek_package (sack, idx);
+	if (package != NULL)
+		return pk_package_get_summary (package);
+	return g_ptr_array_index (sack->priv->summaries, idx);
+}
+
+/*
+ * pk_package_sack_get_row_id:
+ *
+ * Return value: the package-id, free with g_free()
+ **/
+static gchar *
+pk_package_sack_get_row_id (PkPackageSack *sack, guint idx)
+{
+	PkPackage *package = pk_package_sack_peek_package (sack, idx);
+	PkPackageSackPrivate *priv = sack->priv;
+
+	if (package != NULL)
+		return g_strdup (pk_package_get_id (package));
+	return g_strjoin (";",
+			  (const gchar *) g_ptr_array_index (priv->names, idx),
+			  (const gchar *) g_ptr_array_index (priv->versions, idx),
+			  (const gchar *) g_ptr_array_index (priv->archs, idx),
+			  (const gchar *) g_ptr_array_index (priv->datas, idx),
+			  NULL);
+}
+
+/*
+ * pk_package_sack_get_package:
+ *
+ * Returns the #PkPackage for the row, creating it if required.
+ **/
+static PkPackage *
+pk_package_sack_get_package (PkPackageSack *sack, guint idx)
+{
+	PkPackage *package;
+	PkPackageSackPrivate *priv = sack->priv;
+	g_autofree gchar *package_id = NULL;
+
+	package = pk_package_sack_peek_package (sack, idx);
+	if (package != NULL)
+		return package;
+
+	if (priv->packages == NULL) {
+		priv->packages = g_ptr_array_new_with_free_func (pk_package_sack_package_free);
+		g_ptr_array_set_size (priv->packages, priv->infos->len);
+	}
+
+	/* the package-id was checked when it was added */
+	package_id = pk_package_sack_get_row_id (sack, idx);
+	package = pk_package_new ();
+	pk_package_set_id (package, package_id, NULL);
+	g_object_set (package,
+		      "info", g_array_index (priv->infos, guint8, idx),
+		      "summary", g_ptr_array_index (priv->summaries, idx),
+		      "role", g_array_index (priv->roles, guint8, idx),
+		      "transaction-id", g_ptr_array_index (priv->transaction_ids, idx),
+		      NULL);
+	g_ptr_array_index (priv->packages, idx) = package;
+	return package;
+}
+
+/*
+ * pk_package_sack_get_table:
+ *
+ * The package-id lookup table is only built when something searches the
+ * sack, as most results are just read in order.
+ **/
+static GHashTable *
+pk_package_sack_get_table (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	gchar *package_id;
+	guint i;
+
+	if (priv->table != NULL)
+		return priv->table;
+	priv->table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < priv->infos->len; i++) {
+		package_id = pk_package_sack_get_row_id (sack, i);
+		if (package_id == NULL)
+			continue;
+		g_hash_table_insert (priv->table, package_id, GUINT_TO_POINTER (i + 1));
+	}
+	return priv->table;
+}
+
+/*
+ * pk_package_sack_name_arch_key:
+ *
+ * Builds the key of the name and arch index in the scratch buffer.
+ **/
+static const gchar *
+pk_package_sack_name_arch_key (PkPackageSack *sack,
+			       const gchar *name, gsize name_len,
+			       const gchar *arch, gsize arch_len)
+{
+	GString *scratch = sack->priv->scratch;
+
+	g_string_truncate (scratch, 0);
+	g_string_append_len (scratch, name, name_len);
+	g_string_append_c (scratch, ';');
+	if (arch != NULL)
+		g_string_append_len (scratch, arch, arch_len);
+	return scratch->str;
+}
+
+/*
+ * pk_package_sack_name_arch_table_add:
+ **/
+static void
+pk_package_sack_name_arch_table_add (PkPackageSack *sack, guint idx)
+{
+	GArray *rows;
+	const gchar *arch;
+	const gchar *key;
+	const gchar *name;
+
+	name = pk_package_sack_get_row_name (sack, idx);
+	if (name == NULL)
+		return;
+	arch = pk_package_sack_get_row_arch (sack, idx);
+	key = pk_package_sack_name_arch_key (sack, name, strlen (name),
+					     arch, arch != NULL ? strlen (arch) : 0);
+	rows = g_hash_table_lookup (sack->priv->name_arch_table, key);
+	if (rows == NULL) {
+		rows = g_array_sized_new (FALSE, FALSE, sizeof (guint), 1);
+		g_hash_table_insert (sack->priv->name_arch_table, g_strdup (key), rows);
+	}
+	g_array_append_val (rows, idx);
+}
+
+/*
+ * pk_package_sack_find_name_arch:
+ *
+ * The name and arch index is only built when something searches the sack
+ * that way, and is then kept until a package is removed or the sack is
+ * sorted. Packages that are added afterwards are added to it.
+ *
+ * Return value: the rows with the name and arch in sack order, or %NULL
+ **/
+static GArray *
+pk_package_sack_find_name_arch (PkPackageSack *sack,
+				const gchar *name, gsize name_len,
+				const gchar *arch, gsize arch_len)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	guint i;
+
+	if (priv->name_arch_table == NULL) {
+		priv->name_arch_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+							       g_free, (GDestroyNotify) g_array_unref);
+		for (i = 0; i < priv->infos->len; i++)
+			pk_package_sack_name_arch_table_add (sack, i);
+	}
+	return g_hash_table_lookup (priv->name_arch_table,
+				    pk_package_sack_name_arch_key (sack,
+								   name, name_len,
+								   arch, arch_len));
+}
+
+/*
+ * pk_package_sack_split_id:
+ *
+ * Splits the package-id into a scratch buffer that is reused for every
+ * package, so adding a package does not allocate.
+ **/
+static gboolean
+pk_package_sack_split_id (PkPackageSack *sack,
+			  const gchar *package_id,
+			  const gchar **split,
+			  GError **error)
+{
+	GString *scratch = sack->priv->scratch;
+	guint cnt = 0;
+	gsize i;
+
+	g_string_assign (scratch, package_id);
+	split[0] = scratch->str;
+	for (i = 0; i < scratch->len; i++) {
+		if (scratch->str[i] != ';')
+			continue;
+		if (++cnt > 3)
+			break;
+		scratch->str[i] = '\0';
+		split[cnt] = &scratch->str[i + 1];
+	}
+	if (cnt != 3) {
+		g_set_error (error, 1, 0, "invalid number of sections %i", cnt);
+		return FALSE;
+	}
+
+	/* name has to be valid */
+	if (split[PK_PACKAGE_ID_NAME][0] == '\0') {
+		g_set_error_literal (error, 1, 0, "name invalid");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * pk_package_sack_add_row:
+ * @package: the #PkPackage holding the data, or %NULL to use the other arguments
+ **/
+static void
+pk_package_sack_add_row (PkPackageSack *sack,
+			 PkPackage *package,
+			 PkInfoEnum info,
+			 const gchar **split,
+			 const gchar *summary,
+			 PkRoleEnum role,
+			 const gchar *transaction_id)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	guint idx = priv->infos->len;
+	guint8 tmp;
+
+	tmp = info;
+	g_array_append_val (priv->infos, tmp);
+	tmp = role;
+	g_array_append_val (priv->roles, tmp);
+	if (split != NULL) {
+		g_ptr_array_add (priv->names,
+				 g_string_chunk_insert (priv->strings, split[PK_PACKAGE_ID_NAME]));
+		g_ptr_array_add (priv->versions,
+				 g_string_chunk_insert_const (priv->strings, split[PK_PACKAGE_ID_VERSION]));
+		g_ptr_array_add (priv->archs,
+				 g_string_chunk_insert_const (priv->strings, split[PK_PACKAGE_ID_ARCH]));
+		g_ptr_array_add (priv->datas,
+				 g_string_chunk_insert_const (priv->strings, split[PK_PACKAGE_ID_DATA]));
+	} else {
+		g_ptr_array_add (priv->names, NULL);
+		g_ptr_array_add (priv->versions, NULL);
+		g_ptr_array_add (priv->archs, NULL);
+		g_ptr_array_add (priv->datas, NULL);
+	}
+	g_ptr_array_add (priv->summaries,
+			 summary != NULL ? g_string_chunk_insert (priv->strings, summary) : NULL);
+	g_ptr_array_add (priv->transaction_ids,
+			 transaction_id != NULL ? g_string_chunk_insert_const (priv->strings, transaction_id) : NULL);
+
+	/* only keep an array of objects once there are any */
+	if (package != NULL && priv->packages == NULL) {
+		priv->packages = g_ptr_array_new_with_free_func (pk_package_sack_package_free);
+		g_ptr_array_set_size (priv->packages, idx);
+	}
+	if (priv->packages != NULL)
+		g_ptr_array_add (priv->packages, package != NULL ? g_object_ref (package) : NULL);
+
+	/* keep the lookup tables up to date if they have been built */
+	if (priv->table != NULL) {
+		gchar *package_id = pk_package_sack_get_row_id (sack, idx);
+		if (package_id != NULL)
+			g_hash_table_insert (priv->table, package_id, GUINT_TO_POINTER (idx + 1));
+	}
+	if (priv->name_arch_table != NULL)
+		pk_package_sack_name_arch_table_add (sack, idx);
+}
+
+/*
+ * pk_package_sack_copy_row:
+ *
+ * Adds the row of @sack to @dest without creating a #PkPackage for it.
+ **/
+static void
+pk_package_sack_copy_row (PkPackageSack *sack, guint idx, PkPackageSack *dest)
+{
+	PkPackage *package = pk_package_sack_peek_package (sack, idx);
+	PkPackageSackPrivate *priv = sack->priv;
+	const gchar *split[4];
+
+	if (package != NULL) {
+		pk_package_sack_add_row (dest, package, PK_INFO_ENUM_UNKNOWN,
+					 NULL, NULL, PK_ROLE_ENUM_UNKNOWN, NULL);
+		return;
+	}
+	split[PK_PACKAGE_ID_NAME] = g_ptr_array_index (priv->names, idx);
+	split[PK_PACKAGE_ID_VERSION] = g_ptr_array_index (priv->versions, idx);
+	split[PK_PACKAGE_ID_ARCH] = g_ptr_array_index (priv->archs, idx);
+	split[PK_PACKAGE_ID_DATA] = g_ptr_array_index (priv->datas, idx);
+	pk_package_sack_add_row (dest, NULL,
+				 g_array_index (priv->infos, guint8, idx),
+				 split,
+				 g_ptr_array_index (priv->summaries, idx),
+				 g_array_index (priv->roles, guint8, idx),
+				 g_ptr_array_index (priv->transaction_ids, idx));
+}
+
+/*
+ * pk_package_sack_move_row:
+ *
+ * Moves the row at @src to the earlier position @dest, which must not hold
+ * a #PkPackage.
+ **/
+static void
+pk_package_sack_move_row (PkPackageSack *sack, guint src, guint dest)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+
+	g_array_index (priv->infos, guint8, dest) = g_array_index (priv->infos, guint8, src);
+	g_array_index (priv->roles, guint8, dest) = g_array_index (priv->roles, guint8, src);
+	g_ptr_array_index (priv->names, dest) = g_ptr_array_index (priv->names, src);
+	g_ptr_array_index (priv->versions, dest) = g_ptr_array_index (priv->versions, src);
+	g_ptr_array_index (priv->archs, dest) = g_ptr_array_index (priv->archs, src);
+	g_ptr_array_index (priv->datas, dest) = g_ptr_array_index (priv->datas, src);
+	g_ptr_array_index (priv->summaries, dest) = g_ptr_array_index (priv->summaries, src);
+	g_ptr_array_index (priv->transaction_ids, dest) = g_ptr_array_index (priv->transaction_ids, src);
+	if (priv->packages != NULL) {
+		g_ptr_array_index (priv->packages, dest) = g_ptr_array_index (priv->packages, src);
+		g_ptr_array_index (priv->packages, src) = NULL;
+	}
+}
+
+/*
+ * pk_package_sack_set_size:
+ **/
+static void
+pk_package_sack_set_size (PkPackageSack *sack, guint len)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+
+	g_array_set_size (priv->infos, len);
+	g_array_set_size (priv->roles, len);
+	g_ptr_array_set_size (priv->names, len);
+	g_ptr_array_set_size (priv->versions, len);
+	g_ptr_array_set_size (priv->archs, len);
+	g_ptr_array_set_size (priv->datas, len);
+	g_ptr_array_set_size (priv->summaries, len);
+	g_ptr_array_set_size (priv->transaction_ids, len);
+	if (priv->packages != NULL)
+		g_ptr_array_set_size (priv->packages, len);
+	g_clear_pointer (&priv->table, g_hash_table_unref);
+	g_clear_pointer (&priv->name_arch_table, g_hash_table_unref);
+}
+
+/*
+ * pk_package_sack_remove_row:
+ **/
+static void
+pk_package_sack_remove_row (PkPackageSack *sack, guint idx)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+
+	g_array_remove_index (priv->infos, idx);
+	g_array_remove_index (priv->roles, idx);
+	g_ptr_array_remove_index (priv->names, idx);
+	g_ptr_array_remove_index (priv->versions, idx);
+	g_ptr_array_remove_index (priv->archs, idx);
+	g_ptr_array_remove_index (priv->datas, idx);
+	g_ptr_array_remove_index (priv->summaries, idx);
+	g_ptr_array_remove_index (priv->transaction_ids, idx);
+	if (priv->packages != NULL)
+		g_ptr_array_remove_index (priv->packages, idx);
+
+	/* the indexes have moved */
+	g_clear_pointer (&priv->table, g_hash_table_unref);
+	g_clear_pointer (&priv->name_arch_table, g_hash_table_unref);
+}
+
 /**
  * pk_package_sack_clear:
  * @sack: a valid #PkPackageSack instance
@@ -76,8 +519,8 @@ pk_package_sack_clear (PkPackageSack *sack)
 {
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
 
-	g_ptr_array_set_size (sack->priv->array, 0);
-	g_hash_table_remove_all (sack->priv->table);
+	pk_package_sack_set_size (sack, 0);
+	g_string_chunk_clear (sack->priv->strings);
 }
 
 /**
@@ -95,7 +538,7 @@ pk_package_sack_get_size (PkPackageSack *sack)
 {
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), 0);
 
-	return sack->priv->array->len;
+	return sack->priv->infos->len;
 }
 
 /**
@@ -112,18 +555,15 @@ gchar **
 pk_package_sack_get_ids (PkPackageSack *sack)
 {
 	gchar **package_ids;
-	GPtrArray *array;
 	guint i;
-	PkPackage *package;
+	guint len;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
 
-	array = sack->priv->array;
-	package_ids = g_new0 (gchar *, array->len + 1);
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		package_ids[i] = g_strdup (pk_package_get_id (package));
-	}
+	len = sack->priv->infos->len;
+	package_ids = g_new0 (gchar *, len + 1);
+	for (i = 0; i < len; i++)
+		package_ids[i] = pk_package_sack_get_row_id (sack, i);
 	return package_ids;
 }
 
@@ -131,7 +571,8 @@ pk_package_sack_get_ids (PkPackageSack *sack)
  * pk_package_sack_get_array:
  * @sack: a valid #PkPackageSack instance
  *
- * Gets the package array from the sack
+ * Gets the package array from the sack, creating the #PkPackage objects
+ * that have not been needed before.
  *
  * Return value: (element-type PkPackage) (transfer container): A #GPtrArray, free with g_ptr_array_unref().
  *
@@ -140,8 +581,17 @@ pk_package_sack_get_ids (PkPackageSack *sack)
 GPtrArray *
 pk_package_sack_get_array (PkPackageSack *sack)
 {
+	GPtrArray *array;
+	guint i;
+	guint len;
+
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
-	return g_ptr_array_ref (sack->priv->array);
+
+	len = sack->priv->infos->len;
+	array = g_ptr_array_new_full (len, g_object_unref);
+	for (i = 0; i < len; i++)
+		g_ptr_array_add (array, g_object_ref (pk_package_sack_get_package (sack, i)));
+	return array;
 }
 
 /**
@@ -160,8 +610,6 @@ PkPackageSack *
 pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 {
 	PkPackageSack *results;
-	PkPackage *package;
-	PkInfoEnum info_tmp;
 	guint i;
 	PkPackageSackPrivate *priv = sack->priv;
 
@@ -171,11 +619,9 @@ pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 	results = pk_package_sack_new ();
 
 	/* add each that matches the info enum */
-	for (i = 0; i < priv->array->len; i++) {
-		package = g_ptr_array_index (priv->array, i);
-		info_tmp = pk_package_get_info (package);
-		if (info_tmp == info)
-			pk_package_sack_add_package (results, package);
+	for (i = 0; i < priv->infos->len; i++) {
+		if (pk_package_sack_get_row_info (sack, i) == info)
+			pk_package_sack_copy_row (sack, i, results);
 	}
 
 	return results;
@@ -209,8 +655,8 @@ pk_package_sack_filter (PkPackageSack *sack, PkPackageSackFilterFunc filter_cb,
 	results = pk_package_sack_new ();
 
 	/* add each that matches the info enum */
-	for (i = 0; i < priv->array->len; i++) {
-		package = g_ptr_array_index (priv->array, i);
+	for (i = 0; i < priv->infos->len; i++) {
+		package = pk_package_sack_get_package (sack, i);
 		if (filter_cb (package, user_data))
 			pk_package_sack_add_package (results, package);
 	}
@@ -234,13 +680,45 @@ pk_package_sack_add_package (PkPackageSack *sack, PkPackage *package)
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
-	/* add to array */
-	g_ptr_array_add (sack->priv->array,
-			 g_object_ref (package));
-	g_hash_table_insert (sack->priv->table,
-			     (gpointer) pk_package_get_id (package),
-			     (gpointer) package);
+	/* the caller may change the object, so keep it */
+	pk_package_sack_add_row (sack, package, PK_INFO_ENUM_UNKNOWN,
+				 NULL, NULL, PK_ROLE_ENUM_UNKNOWN, NULL);
+	return TRUE;
+}
 
+/*
+ * pk_package_sack_add_package_data:
+ * @sack: a valid #PkPackageSack instance
+ * @info: the #PkInfoEnum
+ * @package_id: a package_id descriptor
+ * @summary: the package summary, or %NULL
+ * @role: the #PkRoleEnum of the transaction that emitted the package
+ * @transaction_id: the transaction ID, or %NULL
+ * @error: a #GError to put the error code and message in, or %NULL
+ *
+ * Adds a package to the sack without creating a #PkPackage until one is
+ * needed.
+ *
+ * Return value: %TRUE if the package was added to the sack
+ **/
+gboolean
+pk_package_sack_add_package_data (PkPackageSack *sack,
+				  PkInfoEnum info,
+				  const gchar *package_id,
+				  const gchar *summary,
+				  PkRoleEnum role,
+				  const gchar *transaction_id,
+				  GError **error)
+{
+	const gchar *split[4];
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!pk_package_sack_split_id (sack, package_id, split, error))
+		return FALSE;
+	pk_package_sack_add_row (sack, NULL, info, split, summary, role, transaction_id);
 	return TRUE;
 }
 
@@ -261,20 +739,17 @@ pk_package_sack_add_package_by_id (PkPackageSack *sack,
 				   const gchar *package_id,
 				   GError **error)
 {
-	g_autoptr(PkPackage) package = NULL;
-
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (package_id != NULL, FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-	/* create new object */
-	package = pk_package_new ();
-	if (!pk_package_set_id (package, package_id, error))
-		return FALSE;
-
-	/* add to array, array will own object */
-	pk_package_sack_add_package (sack, package);
-	return TRUE;
+	return pk_package_sack_add_package_data (sack,
+						 PK_INFO_ENUM_UNKNOWN,
+						 package_id,
+						 NULL,
+						 PK_ROLE_ENUM_UNKNOWN,
+						 NULL,
+						 error);
 }
 
 /*
@@ -287,10 +762,8 @@ pk_package_sack_add_packages_from_line (PkPackageSack *sack,
 {
 	PkInfoEnum info;
 	g_autoptr(GError) error_local = NULL;
-	g_autoptr(PkPackage) package = NULL;
 	g_auto(GStrv) pdata = NULL;
 
-	package = pk_package_new ();
 	pdata = g_strsplit (package_str, "\t", -1);
 	if (g_strv_length (pdata) != 3) {
 		g_set_error (error, 1, 0, "invalid package-info line: %s", package_str);
@@ -298,16 +771,12 @@ pk_package_sack_add_packages_from_line (PkPackageSack *sack,
 	}
 
 	info = pk_info_enum_from_string (pdata[0]);
-	g_object_set (package,
-		      "info", info,
-		      "summary", pdata[2],
-		      NULL);
-	if (!pk_package_set_id (package, pdata[1], &error_local)) {
+	if (!pk_package_sack_add_package_data (sack, info, pdata[1], pdata[2],
+					       PK_ROLE_ENUM_UNKNOWN, NULL,
+					       &error_local)) {
 		g_set_error (error, 1, 0, "invalid package-id in package-info line: %s", pdata[1]);
 		return FALSE;
 	}
-	if (!pk_package_sack_add_package (sack, package))
-		g_set_error (error, 1, 0, "could not add package '%s' to package-sack!", pdata[1]);
 	return TRUE;
 }
 
@@ -371,17 +840,16 @@ pk_package_sack_to_file (PkPackageSack *sack, GFile *file, GError **error)
 {
 	gboolean ret;
 	guint i;
-	PkPackage *pkg;
 	g_autoptr(GString) string = NULL;
 
 	string = g_string_new ("");
-	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg = g_ptr_array_index (sack->priv->array, i);
+	for (i = 0; i < sack->priv->infos->len; i++) {
+		g_autofree gchar *package_id = pk_package_sack_get_row_id (sack, i);
 		g_string_append_printf (string,
 					"%s\t%s\t%s\n",
-					pk_info_enum_to_string (pk_package_get_info (pkg)),
-					pk_package_get_id (pkg),
-					pk_package_get_summary (pkg));
+					pk_info_enum_to_string (pk_package_sack_get_row_info (sack, i)),
+					package_id,
+					pk_package_sack_get_row_summary (sack, i));
 	}
 	ret = g_file_replace_contents (file,
 				       string->str,
@@ -411,12 +879,21 @@ pk_package_sack_to_file (PkPackageSack *sack, GFile *file, GError **error)
 gboolean
 pk_package_sack_remove_package (PkPackageSack *sack, PkPackage *package)
 {
+	guint i;
+
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
-	/* remove from array */
-	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
-	return g_ptr_array_remove (sack->priv->array, package);
+	/* only rows that have an object can match */
+	if (sack->priv->packages == NULL)
+		return FALSE;
+	for (i = 0; i < sack->priv->packages->len; i++) {
+		if (g_ptr_array_index (sack->priv->packages, i) == package) {
+			pk_package_sack_remove_row (sack, i);
+			return TRUE;
+		}
+	}
+	return FALSE;
 }
 
 /**
@@ -435,18 +912,15 @@ gboolean
 pk_package_sack_remove_package_by_id (PkPackageSack *sack,
 				      const gchar *package_id)
 {
-	PkPackage *package;
 	guint i;
-	GPtrArray *array;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (package_id != NULL, FALSE);
 
-	array = sack->priv->array;
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		if (g_strcmp0 (package_id, pk_package_get_id (package)) == 0) {
-			pk_package_sack_remove_package (sack, package);
+	for (i = 0; i < sack->priv->infos->len; i++) {
+		g_autofree gchar *package_id_tmp = pk_package_sack_get_row_id (sack, i);
+		if (g_strcmp0 (package_id, package_id_tmp) == 0) {
+			pk_package_sack_remove_row (sack, i);
 			return TRUE;
 		}
 	}
@@ -471,26 +945,30 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 				  PkPackageSackFilterFunc filter_cb,
 				  gpointer user_data)
 {
-	gboolean ret = FALSE;
 	PkPackage *package;
-	gint i;
+	guint i;
+	guint len = 0;
 	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (filter_cb != NULL, FALSE);
 
-	/* add each that matches the info enum */
-	for (i = 0; i < (gint) priv->array->len; i++) {
-		package = g_ptr_array_index (priv->array, i);
+	/* move each package that is kept down over the ones that are not */
+	for (i = 0; i < priv->infos->len; i++) {
+		package = pk_package_sack_get_package (sack, i);
 		if (!filter_cb (package, user_data)) {
-			ret = TRUE;
-			pk_package_sack_remove_package (sack, package);
-
-			/* ensure we pick up subsequent matches */
-			i--;
+			g_ptr_array_index (priv->packages, i) = NULL;
+			g_object_unref (package);
+			continue;
 		}
+		if (len != i)
+			pk_package_sack_move_row (sack, i, len);
+		len++;
 	}
-	return ret;
+	if (len == priv->infos->len)
+		return FALSE;
+	pk_package_sack_set_size (sack, len);
+	return TRUE;
 }
 
 /**
@@ -508,16 +986,16 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 PkPackage *
 pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 {
-	PkPackage *package = NULL;
+	guint idx;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
 	g_return_val_if_fail (package_id != NULL, NULL);
 
-	package = g_hash_table_lookup (sack->priv->table, package_id);
-	if (package != NULL)
-		g_object_ref (package);
-
-	return package;
+	idx = GPOINTER_TO_UINT (g_hash_table_lookup (pk_package_sack_get_table (sack),
+						     package_id));
+	if (idx == 0)
+		return NULL;
+	return g_object_ref (pk_package_sack_get_package (sack, idx - 1));
 }
 
 /**
@@ -535,83 +1013,207 @@ pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 PkPackage *
 pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_id)
 {
-	PkPackage *pkg_tmp;
-	guint i;
-	g_auto(GStrv) split = NULL;
+	GArray *rows;
+	PkPackageIdView view;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
 	g_return_val_if_fail (package_id != NULL, NULL);
 
 	/* does the package name feature in the array */
-	split = pk_package_id_split (package_id);
-	if (split == NULL)
+	if (!pk_package_id_view_init (&view, package_id))
+		return NULL;
+	rows = pk_package_sack_find_name_arch (sack,
+					       view.name, view.name_len,
+					       view.arch, view.arch_len);
+	if (rows == NULL)
+		return NULL;
+	return g_object_ref (pk_package_sack_get_package (sack, g_array_index (rows, guint, 0)));
+}
+
+/**
+ * pk_package_sack_find_all_by_name_arch:
+ * @sack: a valid #PkPackageSack instance
+ * @name: a package name
+ * @arch: a package architecture, e.g. "x86_64"
+ *
+ * Finds all the packages in a sack with the package name and architecture,
+ * for instance each version of a package.
+ *
+ * Return value: (element-type PkPackage) (transfer container): the packages in sack order, free with g_ptr_array_unref()
+ *
+ * Since: 1.2.1
+ **/
+GPtrArray *
+pk_package_sack_find_all_by_name_arch (PkPackageSack *sack,
+				       const gchar *name,
+				       const gchar *arch)
+{
+	GArray *rows;
+	GPtrArray *array;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+	g_return_val_if_fail (arch != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func (g_object_unref);
+	rows = pk_package_sack_find_name_arch (sack, name, strlen (name), arch, strlen (arch));
+	if (rows == NULL)
+		return array;
+	for (i = 0; i < rows->len; i++) {
+		PkPackage *package = pk_package_sack_get_package (sack, g_array_index (rows, guint, i));
+		g_ptr_array_add (array, g_object_ref (package));
+	}
+	return array;
+}
+
+/*
+ * pk_package_sack_find_row_name_arch:
+ *
+ * Finds the rows of @other with the name and arch of a row of @sack.
+ **/
+static GArray *
+pk_package_sack_find_row_name_arch (PkPackageSack *sack, guint idx, PkPackageSack *other)
+{
+	const gchar *arch;
+	const gchar *name;
+
+	name = pk_package_sack_get_row_name (sack, idx);
+	if (name == NULL)
 		return NULL;
-	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg_tmp = g_ptr_array_index (sack->priv->array, i);
-		if (g_strcmp0 (pk_package_get_name (pkg_tmp),
-			       split[PK_PACKAGE_ID_NAME]) == 0 &&
-		    g_strcmp0 (pk_package_get_arch (pkg_tmp),
-			       split[PK_PACKAGE_ID_ARCH]) == 0) {
-			return g_object_ref (pkg_tmp);
+	arch = pk_package_sack_get_row_arch (sack, idx);
+	return pk_package_sack_find_name_arch (other,
+					       name, strlen (name),
+					       arch, arch != NULL ? strlen (arch) : 0);
+}
+
+/**
+ * pk_package_sack_filter_by_name_arch:
+ * @sack: a valid #PkPackageSack instance
+ * @other: a valid #PkPackageSack instance
+ *
+ * Returns a new package sack with the packages of @sack that have the same
+ * name and architecture as a package in @other, for instance the installed
+ * packages that have an update. This builds an index of @other once rather
+ * than searching it for every package.
+ *
+ * Return value: (transfer full): a new #PkPackageSack, free with g_object_unref()
+ *
+ * Since: 1.2.1
+ **/
+PkPackageSack *
+pk_package_sack_filter_by_name_arch (PkPackageSack *sack, PkPackageSack *other)
+{
+	PkPackageSack *results;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (other), NULL);
+
+	results = pk_package_sack_new ();
+	for (i = 0; i < sack->priv->infos->len; i++) {
+		if (pk_package_sack_find_row_name_arch (sack, i, other) != NULL)
+			pk_package_sack_copy_row (sack, i, results);
+	}
+	return results;
+}
+
+/**
+ * pk_package_sack_join_by_name_arch:
+ * @sack: a valid #PkPackageSack instance
+ * @other: a valid #PkPackageSack instance
+ * @join_cb: (scope call): a #PkPackageSackJoinFunc, called for each pair
+ * @user_data: user data to pass to @join_cb
+ *
+ * Calls @join_cb for each package of @sack with each package of @other that
+ * has the same name and architecture, in the order of @sack and then
+ * @other. Neither sack can be changed from @join_cb.
+ *
+ * Return value: the number of pairs @join_cb was called for
+ *
+ * Since: 1.2.1
+ **/
+guint
+pk_package_sack_join_by_name_arch (PkPackageSack *sack,
+				   PkPackageSack *other,
+				   PkPackageSackJoinFunc join_cb,
+				   gpointer user_data)
+{
+	GArray *rows;
+	PkPackage *package;
+	guint cnt = 0;
+	guint i;
+	guint j;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), 0);
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (other), 0);
+	g_return_val_if_fail (join_cb != NULL, 0);
+
+	for (i = 0; i < sack->priv->infos->len; i++) {
+		rows = pk_package_sack_find_row_name_arch (sack, i, other);
+		if (rows == NULL)
+			continue;
+		package = pk_package_sack_get_package (sack, i);
+		for (j = 0; j < rows->len; j++) {
+			cnt++;
+			if (!join_cb (package,
+				      pk_package_sack_get_package (other, g_array_index (rows, guint, j)),
+				      user_data))
+				return cnt;
 		}
 	}
-	return NULL;
+	return cnt;
 }
 
+typedef struct {
+	PkPackageSack		*sack;
+	gchar			**package_ids;
+} PkPackageSackSortHelper;
+
 /*
  * pk_package_sack_sort_compare_name_func:
  **/
 static gint
-pk_package_sack_sort_compare_name_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_name_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	const gchar *package_id1;
-	const gchar *package_id2;
-	g_auto(GStrv) split1 = NULL;
-	g_auto(GStrv) split2 = NULL;
-
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	split1 = pk_package_id_split (package_id1);
-	split2 = pk_package_id_split (package_id2);
-	return g_strcmp0 (split1[PK_PACKAGE_ID_NAME], split2[PK_PACKAGE_ID_NAME]);
+	PkPackageSackSortHelper *helper = (PkPackageSackSortHelper *) user_data;
+	return g_strcmp0 (pk_package_sack_get_row_name (helper->sack, *((const guint *) a)),
+			  pk_package_sack_get_row_name (helper->sack, *((const guint *) b)));
 }
 
 /*
  * pk_package_sack_sort_compare_package_id_func:
  **/
 static gint
-pk_package_sack_sort_compare_package_id_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_package_id_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	const gchar *package_id1;
-	const gchar *package_id2;
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	return g_strcmp0 (package_id1, package_id2);
+	PkPackageSackSortHelper *helper = (PkPackageSackSortHelper *) user_data;
+	return g_strcmp0 (helper->package_ids[*((const guint *) a)],
+			  helper->package_ids[*((const guint *) b)]);
 }
 
 /*
  * pk_package_sack_sort_compare_summary_func:
  **/
 static gint
-pk_package_sack_sort_compare_summary_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_summary_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	const gchar *summary1;
-	const gchar *summary2;
-	summary1 = pk_package_get_summary (*a);
-	summary2 = pk_package_get_summary (*b);
-	return g_strcmp0 (summary1, summary2);
+	PkPackageSackSortHelper *helper = (PkPackageSackSortHelper *) user_data;
+	return g_strcmp0 (pk_package_sack_get_row_summary (helper->sack, *((const guint *) a)),
+			  pk_package_sack_get_row_summary (helper->sack, *((const guint *) b)));
 }
 
 /*
  * pk_package_sack_sort_compare_info_func:
  **/
 static gint
-pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
+pk_package_sack_sort_compare_info_func (gconstpointer a, gconstpointer b, gpointer user_data)
 {
+	PkPackageSackSortHelper *helper = (PkPackageSackSortHelper *) user_data;
 	PkInfoEnum info1;
 	PkInfoEnum info2;
-	info1 = pk_package_get_info (*a);
-	info2 = pk_package_get_info (*b);
+	info1 = pk_package_sack_get_row_info (helper->sack, *((const guint *) a));
+	info2 = pk_package_sack_get_row_info (helper->sack, *((const guint *) b));
 	if (info1 == info2)
 		return 0;
 	else if (info1 > info2)
@@ -619,6 +1221,41 @@ pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
 	return 1;
 }
 
+/*
+ * pk_package_sack_sort_ptr_array:
+ **/
+static GPtrArray *
+pk_package_sack_sort_ptr_array (GPtrArray *array, const guint *order, GDestroyNotify free_func)
+{
+	GPtrArray *sorted;
+	guint i;
+
+	sorted = g_ptr_array_new_full (array->len, free_func);
+	for (i = 0; i < array->len; i++)
+		g_ptr_array_add (sorted, g_ptr_array_index (array, order[i]));
+
+	/* the new array owns the elements now */
+	g_ptr_array_set_free_func (array, NULL);
+	g_ptr_array_unref (array);
+	return sorted;
+}
+
+/*
+ * pk_package_sack_sort_byte_array:
+ **/
+static GArray *
+pk_package_sack_sort_byte_array (GArray *array, const guint *order)
+{
+	GArray *sorted;
+	guint i;
+
+	sorted = g_array_sized_new (FALSE, FALSE, sizeof (guint8), array->len);
+	for (i = 0; i < array->len; i++)
+		g_array_append_val (sorted, g_array_index (array, guint8, order[i]));
+	g_array_unref (array);
+	return sorted;
+}
+
 /**
  * pk_package_sack_sort:
  * @sack: a valid #PkPackageSack instance
@@ -631,15 +1268,50 @@ pk_package_sack_sort_compare_info_func (PkPackage **a, PkPackage **b)
 void
 pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 {
+	GCompareDataFunc func;
+	PkPackageSackPrivate *priv = sack->priv;
+	PkPackageSackSortHelper helper = { sack, NULL };
+	guint i;
+	guint len;
+	g_autofree guint *order = NULL;
+
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
+
 	if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_name_func);
+		func = pk_package_sack_sort_compare_name_func;
 	else if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_package_id_func);
+		func = pk_package_sack_sort_compare_package_id_func;
 	else if (type == PK_PACKAGE_SACK_SORT_TYPE_SUMMARY)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_summary_func);
+		func = pk_package_sack_sort_compare_summary_func;
 	else if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
-		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_info_func);
+		func = pk_package_sack_sort_compare_info_func;
+	else
+		return;
+
+	/* sort the row numbers, then put each field in that order */
+	len = priv->infos->len;
+	order = g_new (guint, len);
+	for (i = 0; i < len; i++)
+		order[i] = i;
+	if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
+		helper.package_ids = pk_package_sack_get_ids (sack);
+	g_qsort_with_data (order, len, sizeof (guint), func, &helper);
+	g_strfreev (helper.package_ids);
+
+	priv->infos = pk_package_sack_sort_byte_array (priv->infos, order);
+	priv->roles = pk_package_sack_sort_byte_array (priv->roles, order);
+	priv->names = pk_package_sack_sort_ptr_array (priv->names, order, NULL);
+	priv->versions = pk_package_sack_sort_ptr_array (priv->versions, order, NULL);
+	priv->archs = pk_package_sack_sort_ptr_array (priv->archs, order, NULL);
+	priv->datas = pk_package_sack_sort_ptr_array (priv->datas, order, NULL);
+	priv->summaries = pk_package_sack_sort_ptr_array (priv->summaries, order, NULL);
+	priv->transaction_ids = pk_package_sack_sort_ptr_array (priv->transaction_ids, order, NULL);
+	if (priv->packages != NULL) {
+		priv->packages = pk_package_sack_sort_ptr_array (priv->packages, order,
+								 pk_package_sack_package_free);
+	}
+	g_clear_pointer (&priv->table, g_hash_table_unref);
+	g_clear_pointer (&priv->name_arch_table, g_hash_table_unref);
 }
 
 /**
@@ -663,9 +1335,14 @@ pk_package_sack_get_total_bytes (PkPackageSack *sack)
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 
-	array = sack->priv->array;
+	/* only packages that have had details merged in have a size */
+	array = sack->priv->packages;
+	if (array == NULL)
+		return 0;
 	for (i = 0; i < array->len; i++) {
 		package = g_ptr_array_index (array, i);
+		if (package == NULL)
+			continue;
 		g_object_get (package,
 			      "size", &bytes_tmp,
 			      NULL);
@@ -675,30 +1352,6 @@ pk_package_sack_get_total_bytes (PkPackageSack *sack)
 	return bytes;
 }
 
-/*
- * pk_package_sack_get_package_ids:
- **/
-static gchar **
-pk_package_sack_get_package_ids (PkPackageSack *sack)
-{
-	const gchar *id;
-	gchar **package_ids;
-	const GPtrArray *array;
-	PkPackage *package;
-	guint i;
-
-	/* create array of package_ids */
-	array = sack->priv->array;
-	package_ids = g_new0 (gchar *, array->len+1);
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		id = pk_package_get_id (package);
-		package_ids[i] = g_strdup (id);
-	}
-
-	return package_ids;
-}
-
 typedef struct {
 	PkPackageSack		*sack;
 	GCancellable		*cancellable;
@@ -825,7 +1478,7 @@ pk_package_sack_resolve_async (PkPackageSack *sack, GCancellable *cancellable,
 	state->ret = FALSE;
 
 	/* start resolve async */
-	package_ids = pk_package_sack_get_package_ids (sack);
+	package_ids = pk_package_sack_get_ids (sack);
 	pk_client_resolve_async (sack->priv->client,
 				 pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), package_ids,
 				 cancellable, progress_callback, progress_user_data,
@@ -960,7 +1613,7 @@ pk_package_sack_get_details_async (PkPackageSack *sack, GCancellable *cancellabl
 	state->ret = FALSE;
 
 	/* start details async */
-	package_ids = pk_package_sack_get_package_ids (sack);
+	package_ids = pk_package_sack_get_ids (sack);
 	pk_client_get_details_async (sack->priv->client, package_ids,
 				     cancellable, progress_callback, progress_user_data,
 				     (GAsyncReadyCallback) pk_package_sack_get_details_cb, state);
@@ -1096,7 +1749,7 @@ pk_package_sack_get_update_detail_async (PkPackageSack *sack, GCancellable *canc
 	state->ret = FALSE;
 
 	/* start update_detail async */
-	package_ids = pk_package_sack_get_package_ids (sack);
+	package_ids = pk_package_sack_get_ids (sack);
 	pk_client_get_update_detail_async (sack->priv->client, package_ids,
 					   cancellable, progress_callback, progress_user_data,
 					   (GAsyncReadyCallback) pk_package_sack_get_update_detail_cb, state);
@@ -1141,8 +1794,16 @@ pk_package_sack_init (PkPackageSack *sack)
 	sack->priv = PK_PACKAGE_SACK_GET_PRIVATE (sack);
 	priv = sack->priv;
 
-	priv->table = g_hash_table_new (g_str_hash, g_str_equal);
-	priv->array = g_ptr_array_new_with_free_func (g_object_unref);
+	priv->infos = g_array_new (FALSE, FALSE, sizeof (guint8));
+	priv->roles = g_array_new (FALSE, FALSE, sizeof (guint8));
+	priv->names = g_ptr_array_new ();
+	priv->versions = g_ptr_array_new ();
+	priv->archs = g_ptr_array_new ();
+	priv->datas = g_ptr_array_new ();
+	priv->summaries = g_ptr_array_new ();
+	priv->transaction_ids = g_ptr_array_new ();
+	priv->strings = g_string_chunk_new (4096);
+	priv->scratch = g_string_new (NULL);
 	priv->client = pk_client_new ();
 }
 
@@ -1155,8 +1816,22 @@ pk_package_sack_finalize (GObject *object)
 	PkPackageSack *sack = PK_PACKAGE_SACK (object);
 	PkPackageSackPrivate *priv = sack->priv;
 
-	g_ptr_array_unref (priv->array);
-	g_hash_table_unref (priv->table);
+	g_array_unref (priv->infos);
+	g_array_unref (priv->roles);
+	g_ptr_array_unref (priv->names);
+	g_ptr_array_unref (priv->versions);
+	g_ptr_array_unref (priv->archs);
+	g_ptr_array_unref (priv->datas);
+	g_ptr_array_unref (priv->summaries);
+	g_ptr_array_unref (priv->transaction_ids);
+	if (priv->packages != NULL)
+		g_ptr_array_unref (priv->packages);
+	if (priv->table != NULL)
+		g_hash_table_unref (priv->table);
+	if (priv->name_arch_table != NULL)
+		g_hash_table_unref (priv->name_arch_table);
+	g_string_chunk_free (priv->strings);
+	g_string_free (priv->scratch, TRUE);
 	g_object_unref (priv->client);
 
 	G_OBJECT_CLASS (pk_package_sack_parent_class)->finalize (object);
@@ -103,6 +103,22 @@ PkPackageSack	*pk_package_sack_new			(void);
 typedef gboolean (*PkPackageSackFilterFunc)		(PkPackage		*package,
 							 gpointer		 user_data);
 
+/**
+ * PkPackageSackJoinFunc:
+ * @package: the package from the first sack
+ * @other: the package from the second sack with the same name and arch
+ * @user_data: User data supplied when the callback was registered
+ *
+ * Function called for each pair of packages joined from two #PkPackageSack's.
+ *
+ * Return value: %FALSE to stop joining packages.
+ *
+ * Since: 1.2.1
+ */
+typedef gboolean (*PkPackageSackJoinFunc)		(PkPackage		*package,
+							 PkPackage		*other,
+							 gpointer		 user_data);
+
 /* managing the array */
 void		 pk_package_sack_clear			(PkPackageSack		*sack);
 gchar		**pk_package_sack_get_ids		(PkPackageSack		*sack);
@@ -132,6 +148,15 @@ PkPackage	*pk_package_sack_find_by_id		(PkPackageSack		*sack,
 							 const gchar		*package_id);
 PkPackage	*pk_package_sack_find_by_id_name_arch	(PkPackageSack		*sack,
 							 const gchar		*package_id);
+GPtrArray	*pk_package_sack_find_all_by_name_arch	(PkPackageSack		*sack,
+							 const gchar		*name,
+							 const gchar		*arch);
+PkPackageSack	*pk_package_sack_filter_by_name_arch	(PkPackageSack		*sack,
+							 PkPackageSack		*other);
+guint		 pk_package_sack_join_by_name_arch	(PkPackageSack		*sack,
+							 PkPackageSack		*other,
+							 PkPackageSackJoinFunc	 join_cb,
+							 gpointer		 user_data);
 PkPackageSack	*pk_package_sack_filter_by_info		(PkPackageSack		*sack,
 							 PkInfoEnum		 info);
 PkPackageSack	*pk_package_sack_filter			(PkPackageSack		*sack,
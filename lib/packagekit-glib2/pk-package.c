@@ -34,6 +34,7 @@
 
 #include <packagekit-glib2/pk-package.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
 #include <packagekit-glib2/pk-package-id.h>
@@ -50,10 +51,10 @@ static void     pk_package_finalize	(GObject     *object);
 struct _PkPackagePrivate
 {
 	PkInfoEnum		 info;
-	gchar			*package_id;
+	const gchar		*package_id;	/* interned */
 	gchar			*package_id_data;
-	const gchar		*package_id_split[4];
-	gchar			*summary;
+	const gchar		*package_id_split[4]; /* data is interned */
+	const gchar		*summary;	/* interned */
 	gchar			*license;
 	PkGroupEnum		 group;
 	gchar			*description;
@@ -121,8 +122,9 @@ pk_package_equal (PkPackage *package1, PkPackage *package2)
 {
 	g_return_val_if_fail (PK_IS_PACKAGE (package1), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package2), FALSE);
-	return (g_strcmp0 (package1->priv->summary, package2->priv->summary) == 0 &&
-	        g_strcmp0 (package1->priv->package_id, package2->priv->package_id) == 0 &&
+	/* the strings are interned, so equal strings have the same address */
+	return (package1->priv->summary == package2->priv->summary &&
+	        package1->priv->package_id == package2->priv->package_id &&
 	        package1->priv->info == package2->priv->info);
 }
 
@@ -142,7 +144,7 @@ pk_package_equal_id (PkPackage *package1, PkPackage *package2)
 {
 	g_return_val_if_fail (PK_IS_PACKAGE (package1), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package2), FALSE);
-	return (g_strcmp0 (package1->priv->package_id, package2->priv->package_id) == 0);
+	return package1->priv->package_id == package2->priv->package_id;
 }
 
 /**
@@ -162,6 +164,7 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 {
 	PkPackagePrivate *priv = package->priv;
 	gboolean ret;
+	gsize data_offset = 0;
 	guint cnt = 0;
 	guint i;
 
@@ -169,21 +172,18 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	/* free old data */
-	g_free (priv->package_id);
+	pk_ref_string_release (priv->package_id);
+	pk_ref_string_release (priv->package_id_split[PK_PACKAGE_ID_DATA]);
 	g_free (priv->package_id_data);
-
-	/* copy the package-id into package_id_data, change the ';' into '\0'
-	 * and reference the pointers in the const gchar * array */
-	priv->package_id = g_strdup (package_id);
-	priv->package_id_data = g_strdup (package_id);
-	priv->package_id_split[0] = priv->package_id_data;
-	for (i = 0; priv->package_id_data[i] != '\0'; i++) {
-		if (package_id[i] == ';') {
-			if (++cnt > 3)
-				continue;
-			priv->package_id_split[cnt] = &priv->package_id_data[i+1];
-			priv->package_id_data[i] = '\0';
-		}
+	priv->package_id_data = NULL;
+	for (i = 0; i < 4; i++)
+		priv->package_id_split[i] = NULL;
+
+	/* the same package-id is kept by the backend, transaction and results */
+	priv->package_id = pk_ref_string_new_intern (package_id);
+	for (i = 0; package_id[i] != '\0'; i++) {
+		if (package_id[i] == ';' && ++cnt == 3)
+			data_offset = i + 1;
 	}
 	if (cnt != 3) {
 		ret = FALSE;
@@ -192,11 +192,25 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 	}
 
 	/* name has to be valid */
-	ret = (priv->package_id_split[0][0] != '\0');
+	ret = (package_id[0] != ';');
 	if (!ret) {
 		g_set_error_literal (error, 1, 0, "name invalid");
 		goto out;
 	}
+
+	/* copy the name, version and arch into package_id_data, change the
+	 * ';' into '\0' and reference the pointers in the const gchar * array;
+	 * the data is the same repo for many packages so it is shared */
+	priv->package_id_data = g_strndup (package_id, data_offset - 1);
+	priv->package_id_split[0] = priv->package_id_data;
+	for (i = 0, cnt = 0; priv->package_id_data[i] != '\0'; i++) {
+		if (priv->package_id_data[i] == ';') {
+			priv->package_id_split[++cnt] = &priv->package_id_data[i+1];
+			priv->package_id_data[i] = '\0';
+		}
+	}
+	priv->package_id_split[PK_PACKAGE_ID_DATA] =
+		pk_ref_string_new_intern (package_id + data_offset);
 out:
 	return ret;
 }
@@ -232,8 +246,7 @@ pk_package_parse (PkPackage *package, const gchar *data, GError **error)
 	package->priv->info = pk_info_enum_from_string (sections[0]);
 	if (!pk_package_set_id (package, sections[1], error))
 		return FALSE;
-	g_free (package->priv->summary);
-	package->priv->summary = g_strdup (sections[2]);
+	pk_package_set_summary (package, sections[2]);
 	return TRUE;
 }
 
@@ -283,8 +296,8 @@ void
 pk_package_set_summary (PkPackage *package, const gchar *summary)
 {
 	g_return_if_fail (PK_IS_PACKAGE (package));
-	g_free (package->priv->summary);
-	package->priv->summary = g_strdup (summary);
+	pk_ref_string_release (package->priv->summary);
+	package->priv->summary = pk_ref_string_new_intern (summary);
 }
 
 /**
@@ -828,8 +841,9 @@ pk_package_finalize (GObject *object)
 	PkPackage *package = PK_PACKAGE (object);
 	PkPackagePrivate *priv = package->priv;
 
-	g_free (priv->package_id);
-	g_free (priv->summary);
+	pk_ref_string_release (priv->package_id);
+	pk_ref_string_release (priv->package_id_split[PK_PACKAGE_ID_DATA]);
+	pk_ref_string_release (priv->summary);
 	g_free (priv->license);
 	g_free (priv->description);
 	g_free (priv->url);
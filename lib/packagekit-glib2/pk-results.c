@@ -34,6 +34,8 @@
 #include <glib-object.h>
 
 #include <packagekit-glib2/pk-results.h>
+#include <packagekit-glib2/pk-results-private.h>
+#include <packagekit-glib2/pk-package-sack-private.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
 
@@ -66,6 +68,7 @@ struct _PkResultsPrivate
 	GPtrArray		*media_change_required_array;
 	GPtrArray		*repo_detail_array;
 	PkPackageSack		*package_sack;
+	gchar			*solution_token;
 };
 
 enum {
@@ -181,6 +184,36 @@ pk_results_set_exit_code (PkResults *results, PkExitEnum exit_enum)
 	return TRUE;
 }
 
+/*
+ * pk_results_set_solution_token:
+ * @results: a valid #PkResults instance
+ * @solution_token: the token the daemon returned for a simulated transaction
+ *
+ * Saves the token that lets the real transaction reuse the dependency
+ * solution of a simulate.
+ **/
+void
+pk_results_set_solution_token (PkResults *results, const gchar *solution_token)
+{
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	g_free (results->priv->solution_token);
+	results->priv->solution_token = g_strdup (solution_token);
+}
+
+/*
+ * pk_results_get_solution_token:
+ * @results: a valid #PkResults instance
+ *
+ * Return value: the solution token of a simulated transaction, or %NULL
+ **/
+const gchar *
+pk_results_get_solution_token (PkResults *results)
+{
+	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	return results->priv->solution_token;
+}
+
 /**
  * pk_results_add_package:
  * @results: a valid #PkResults instance
@@ -207,6 +240,44 @@ pk_results_add_package (PkResults *results, PkPackage *item)
 	return TRUE;
 }
 
+/*
+ * pk_results_add_package_data:
+ * @results: a valid #PkResults instance
+ * @info: the #PkInfoEnum
+ * @package_id: a package_id descriptor
+ * @summary: the package summary, or %NULL
+ * @role: the #PkRoleEnum of the transaction that emitted the package
+ * @transaction_id: the transaction ID, or %NULL
+ * @error: a #GError to put the error code and message in, or %NULL
+ *
+ * Adds a package to the results set without creating a #PkPackage, which
+ * is only done if pk_results_get_package_array() is called.
+ *
+ * Return value: %TRUE if the value was set
+ **/
+gboolean
+pk_results_add_package_data (PkResults *results,
+			     PkInfoEnum info,
+			     const gchar *package_id,
+			     const gchar *summary,
+			     PkRoleEnum role,
+			     const gchar *transaction_id,
+			     GError **error)
+{
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	/* do not allow finished types */
+	if (info == PK_INFO_ENUM_FINISHED) {
+		g_set_error_literal (error, 1, 0,
+				     "Finished packages cannot be added to PkResults");
+		return FALSE;
+	}
+	return pk_package_sack_add_package_data (results->priv->package_sack,
+						 info, package_id, summary,
+						 role, transaction_id, error);
+}
+
 /**
  * pk_results_add_details:
  * @results: a valid #PkResults instance
@@ -932,6 +1003,7 @@ pk_results_finalize (GObject *object)
 	g_ptr_array_unref (priv->media_change_required_array);
 	g_ptr_array_unref (priv->repo_detail_array);
 	g_object_unref (priv->package_sack);
+	g_free (priv->solution_token);
 	if (results->priv->progress != NULL)
 		g_object_unref (results->priv->progress);
 	if (results->priv->error_code != NULL)
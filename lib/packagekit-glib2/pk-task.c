@@ -30,9 +30,11 @@
 #include <gio/gio.h>
 
 #include <packagekit-glib2/pk-task.h>
+#include <packagekit-glib2/pk-client-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
+#include <packagekit-glib2/pk-results-private.h>
 
 static void     pk_task_finalize	(GObject     *object);
 
@@ -99,6 +101,7 @@ typedef struct {
 	gchar				*repo_id;
 	gchar				*transaction_id;
 	gchar				**values;
+	gchar				*solution_token;
 	PkBitfield			 filters;
 	PkUpgradeKindEnum		 upgrade_kind;
 	guint				 retry_id;
@@ -175,6 +178,7 @@ pk_task_generic_state_finish (PkTaskState *state, const GError *error)
 	g_free (state->distro_id);
 	g_free (state->repo_id);
 	g_free (state->transaction_id);
+	g_free (state->solution_token);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
 	g_strfreev (state->packages);
@@ -210,6 +214,10 @@ pk_task_do_async_action (PkTaskState *state)
 				PK_TRANSACTION_FLAG_ENUM_ALLOW_DOWNGRADE);
 	}
 
+	/* let the daemon reuse the solution of the simulate, once */
+	pk_client_set_solution_token (PK_CLIENT (state->task), state->solution_token);
+	g_clear_pointer (&state->solution_token, g_free);
+
 	/* do the correct action */
 	if (state->role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
 		pk_client_install_packages_async (PK_CLIENT(state->task), transaction_flags, state->package_ids,
@@ -316,6 +324,7 @@ pk_task_do_async_action (PkTaskState *state)
 	} else {
 		g_assert_not_reached ();
 	}
+	pk_client_set_solution_token (PK_CLIENT (state->task), NULL);
 }
 
 /*
@@ -373,6 +382,10 @@ pk_task_simulate_ready_cb (GObject *source_object, GAsyncResult *res, PkTaskStat
 	/* we own a copy now */
 	state->results = g_object_ref (results);
 
+	/* the real transaction can skip solving again if nothing changed */
+	g_free (state->solution_token);
+	state->solution_token = g_strdup (pk_results_get_solution_token (results));
+
 	/* get exit code */
 	state->exit_enum = pk_results_get_exit_code (state->results);
 	if (state->exit_enum == PK_EXIT_ENUM_NEED_UNTRUSTED) {
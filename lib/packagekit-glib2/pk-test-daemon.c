@@ -723,6 +723,68 @@ pk_test_client_func (void)
 #endif
 }
 
+static PkResults *_package_callback_results = NULL;
+
+static void
+pk_test_client_package_callback_cb (PkPackage *package, gpointer user_data)
+{
+	GPtrArray *package_ids = (GPtrArray *) user_data;
+	g_ptr_array_add (package_ids, g_strdup (pk_package_get_id (package)));
+}
+
+static void
+pk_test_client_package_callback_resolve_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	GError *error = NULL;
+
+	_package_callback_results = pk_client_generic_finish (PK_CLIENT (object), res, &error);
+	g_assert_no_error (error);
+	g_assert (_package_callback_results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (_package_callback_results), ==, PK_EXIT_ENUM_SUCCESS);
+	_g_test_loop_quit ();
+}
+
+static void
+pk_test_client_package_callback_func (void)
+{
+	guint i;
+	g_auto(GStrv) package_ids = NULL;
+	g_autoptr(GPtrArray) expected = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GPtrArray) streamed = NULL;
+	g_autoptr(PkClient) client = NULL;
+
+	client = pk_client_new ();
+	package_ids = pk_package_ids_from_string ("glib2;2.14.0;i386;fedora&powertop");
+
+	/* the packages as they are kept in the results */
+	pk_client_resolve_async (client, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), package_ids, NULL,
+				 NULL, NULL,
+				 (GAsyncReadyCallback) pk_test_client_package_callback_resolve_cb, NULL);
+	_g_test_loop_run_with_timeout (15000);
+	expected = pk_results_get_package_array (_package_callback_results);
+	g_assert_cmpint (expected->len, ==, 2);
+	g_clear_object (&_package_callback_results);
+
+	/* the same packages handed to the callback instead */
+	streamed = g_ptr_array_new_with_free_func (g_free);
+	pk_client_set_package_callback (client, pk_test_client_package_callback_cb, streamed);
+	pk_client_resolve_async (client, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED), package_ids, NULL,
+				 NULL, NULL,
+				 (GAsyncReadyCallback) pk_test_client_package_callback_resolve_cb, NULL);
+	_g_test_loop_run_with_timeout (15000);
+	packages = pk_results_get_package_array (_package_callback_results);
+	g_assert_cmpint (packages->len, ==, 0);
+	g_assert_cmpint (streamed->len, ==, expected->len);
+	for (i = 0; i < expected->len; i++) {
+		PkPackage *package = g_ptr_array_index (expected, i);
+		g_assert_cmpstr (g_ptr_array_index (streamed, i), ==, pk_package_get_id (package));
+	}
+	g_clear_object (&_package_callback_results);
+
+	pk_client_set_package_callback (client, NULL, NULL);
+}
+
 static void
 pk_test_console_func (void)
 {
@@ -1438,6 +1500,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/transaction-list", pk_test_transaction_list_func);
 	g_test_add_func ("/packagekit-glib2/client-helper", pk_test_client_helper_func);
 	g_test_add_func ("/packagekit-glib2/client", pk_test_client_func);
+	g_test_add_func ("/packagekit-glib2/client-package-callback", pk_test_client_package_callback_func);
 	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/task", pk_test_task_func);
 	g_test_add_func ("/packagekit-glib2/task-wrapper", pk_test_task_wrapper_func);
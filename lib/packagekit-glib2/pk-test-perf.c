@@ -0,0 +1,512 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Starts packagekitd with the test_perf backend on a private bus, drives a
+ * fixed set of workloads through PkClient and prints the throughput,
+ * latency and daemon memory usage as JSON. The result is also written to
+ * $PK_PERF_OUTPUT if that is set.
+ *
+ * It then compares the two IdlePolicy settings: the memory used while idle
+ * after a Debug.Standby call and the time to answer the next request, and
+ * the time to answer a request that has to start the daemon again.
+ *
+ * Usage: pk-test-perf /path/to/packagekitd
+ *
+ * Run it from the build root so the daemon finds backends/test/; the
+ * PK_TEST_PERF_* variables are passed through to the backend.
+ */
+
+#include "config.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "pk-client.h"
+#include "pk-common.h"
+#include "pk-results.h"
+
+#define PK_TEST_PERF_STARTUP_TIMEOUT	10	/* s */
+
+typedef struct _PkTestPerf PkTestPerf;
+
+typedef struct {
+	PkTestPerf		*perf;
+	gint64			 start;
+} PkTestPerfOperation;
+
+typedef void (*PkTestPerfStartFunc)	(PkTestPerf		*perf,
+					 guint			 idx,
+					 PkTestPerfOperation	*op);
+
+typedef struct {
+	const gchar		*name;
+	PkTestPerfStartFunc	 start_func;
+	guint			 count;
+	guint			 concurrency;
+	guint			 started;
+	guint			 pending;
+	guint			 failed;
+	guint64			 packages;
+	gint64			 start;
+	gint64			 elapsed;
+	GArray			*latencies;	/* of gint64, in us */
+} PkTestPerfWorkload;
+
+struct _PkTestPerf {
+	GMainLoop		*loop;
+	PkClient		*client;
+	PkTestPerfWorkload	*workload;
+};
+
+static void pk_test_perf_start_next (PkTestPerf *perf);
+
+static void
+pk_test_perf_finished_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	PkTestPerfOperation *op = (PkTestPerfOperation *) user_data;
+	PkTestPerf *perf = op->perf;
+	PkTestPerfWorkload *workload = perf->workload;
+	gint64 latency = g_get_monotonic_time () - op->start;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	g_free (op);
+	results = pk_client_generic_finish (PK_CLIENT (object), res, &error);
+	if (results == NULL) {
+		g_warning ("%s failed: %s", workload->name, error->message);
+		workload->failed++;
+	} else if (pk_results_get_exit_code (results) != PK_EXIT_ENUM_SUCCESS) {
+		g_warning ("%s failed: %s", workload->name,
+			   pk_exit_enum_to_string (pk_results_get_exit_code (results)));
+		workload->failed++;
+	} else {
+		packages = pk_results_get_package_array (results);
+		workload->packages += packages->len;
+		g_array_append_val (workload->latencies, latency);
+	}
+
+	workload->pending--;
+	pk_test_perf_start_next (perf);
+}
+
+static void
+pk_test_perf_start_next (PkTestPerf *perf)
+{
+	PkTestPerfWorkload *workload = perf->workload;
+	PkTestPerfOperation *op;
+
+	/* keep the configured number of requests in flight */
+	while (workload->started < workload->count &&
+	       workload->pending < workload->concurrency) {
+		op = g_new0 (PkTestPerfOperation, 1);
+		op->perf = perf;
+		op->start = g_get_monotonic_time ();
+		workload->start_func (perf, workload->started++, op);
+		workload->pending++;
+	}
+	if (workload->pending == 0)
+		g_main_loop_quit (perf->loop);
+}
+
+static void
+pk_test_perf_get_packages (PkTestPerf *perf, guint idx, PkTestPerfOperation *op)
+{
+	pk_client_get_packages_async (perf->client,
+				      pk_bitfield_value (PK_FILTER_ENUM_NONE),
+				      NULL, NULL, NULL,
+				      pk_test_perf_finished_cb, op);
+}
+
+static void
+pk_test_perf_search (PkTestPerf *perf, guint idx, PkTestPerfOperation *op)
+{
+	g_auto(GStrv) values = g_new0 (gchar *, 2);
+	values[0] = g_strdup_printf ("perf%u", 100 + idx);
+	pk_client_search_names_async (perf->client,
+				      pk_bitfield_value (PK_FILTER_ENUM_NONE),
+				      values, NULL, NULL, NULL,
+				      pk_test_perf_finished_cb, op);
+}
+
+static void
+pk_test_perf_resolve (PkTestPerf *perf, guint idx, PkTestPerfOperation *op)
+{
+	g_auto(GStrv) packages = g_new0 (gchar *, 2);
+	packages[0] = g_strdup_printf ("perf%u", idx);
+	pk_client_resolve_async (perf->client,
+				 pk_bitfield_value (PK_FILTER_ENUM_NONE),
+				 packages, NULL, NULL, NULL,
+				 pk_test_perf_finished_cb, op);
+}
+
+static void
+pk_test_perf_install_simulate (PkTestPerf *perf, guint idx, PkTestPerfOperation *op)
+{
+	g_auto(GStrv) package_ids = g_new0 (gchar *, 2);
+	package_ids[0] = g_strdup_printf ("perf%u;1.0-%u;x86_64;perf", 2 * idx + 1, 2 * idx + 1);
+	pk_client_install_packages_async (perf->client,
+					  pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE),
+					  package_ids, NULL, NULL, NULL,
+					  pk_test_perf_finished_cb, op);
+}
+
+static gint
+pk_test_perf_latency_sort_cb (gconstpointer a, gconstpointer b)
+{
+	gint64 tmp_a = *((const gint64 *) a);
+	gint64 tmp_b = *((const gint64 *) b);
+	if (tmp_a < tmp_b)
+		return -1;
+	return tmp_a > tmp_b;
+}
+
+static gint64
+pk_test_perf_percentile (GArray *latencies, guint percent)
+{
+	if (latencies->len == 0)
+		return 0;
+	return g_array_index (latencies, gint64, (latencies->len - 1) * percent / 100);
+}
+
+static void
+pk_test_perf_run (PkTestPerf *perf, PkTestPerfWorkload *workload)
+{
+	g_printerr ("running %s (%u requests, %u at a time)...\n",
+		    workload->name, workload->count, workload->concurrency);
+	workload->latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+	workload->start = g_get_monotonic_time ();
+	perf->workload = workload;
+	pk_test_perf_start_next (perf);
+	g_main_loop_run (perf->loop);
+	workload->elapsed = g_get_monotonic_time () - workload->start;
+	g_array_sort (workload->latencies, pk_test_perf_latency_sort_cb);
+}
+
+/* VmRSS and VmHWM of the daemon, in kB */
+static gboolean
+pk_test_perf_get_rss (const gchar *pid, guint64 *rss, guint64 *hwm)
+{
+	guint i;
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	filename = g_build_filename ("/proc", pid, "status", NULL);
+	if (!g_file_get_contents (filename, &contents, NULL, NULL))
+		return FALSE;
+	lines = g_strsplit (contents, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		if (g_str_has_prefix (lines[i], "VmRSS:"))
+			*rss = g_ascii_strtoull (lines[i] + 6, NULL, 10);
+		else if (g_str_has_prefix (lines[i], "VmHWM:"))
+			*hwm = g_ascii_strtoull (lines[i] + 6, NULL, 10);
+	}
+	return TRUE;
+}
+
+typedef struct {
+	GMainLoop		*loop;
+	const gchar		*old_owner;
+	gchar			*owner;
+} PkTestPerfStartup;
+
+static void
+pk_test_perf_name_appeared_cb (GDBusConnection *connection,
+			       const gchar *name,
+			       const gchar *name_owner,
+			       gpointer user_data)
+{
+	PkTestPerfStartup *startup = (PkTestPerfStartup *) user_data;
+
+	/* the bus may not have noticed the previous daemon exit yet */
+	if (g_strcmp0 (name_owner, startup->old_owner) == 0)
+		return;
+	startup->owner = g_strdup (name_owner);
+	g_main_loop_quit (startup->loop);
+}
+
+static gboolean
+pk_test_perf_startup_timeout_cb (gpointer user_data)
+{
+	PkTestPerfStartup *startup = (PkTestPerfStartup *) user_data;
+	g_main_loop_quit (startup->loop);
+	return G_SOURCE_CONTINUE;
+}
+
+/* returns the unique name of the daemon, or %NULL on timeout */
+static gchar *
+pk_test_perf_wait_for_daemon (GMainLoop *loop, const gchar *old_owner)
+{
+	PkTestPerfStartup startup = { loop, old_owner, NULL };
+	guint timeout_id;
+	guint watch_id;
+
+	watch_id = g_bus_watch_name (G_BUS_TYPE_SYSTEM,
+				     PK_DBUS_SERVICE,
+				     G_BUS_NAME_WATCHER_FLAGS_NONE,
+				     pk_test_perf_name_appeared_cb,
+				     NULL, &startup, NULL);
+	timeout_id = g_timeout_add_seconds (PK_TEST_PERF_STARTUP_TIMEOUT,
+					    pk_test_perf_startup_timeout_cb,
+					    &startup);
+	g_main_loop_run (loop);
+	g_source_remove (timeout_id);
+	g_bus_unwatch_name (watch_id);
+	return startup.owner;
+}
+
+static GSubprocess *
+pk_test_perf_start_daemon (PkTestPerf *perf, const gchar *path,
+			   gchar **owner, gint64 *elapsed, GError **error)
+{
+	gint64 start = g_get_monotonic_time ();
+	g_autofree gchar *old_owner = *owner;
+	g_autoptr(GSubprocess) daemon = NULL;
+
+	daemon = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, error,
+				   path,
+				   "--backend=test_perf",
+				   "--keep-environment",
+				   "--disable-timer",
+				   NULL);
+	if (daemon == NULL) {
+		*owner = NULL;
+		return NULL;
+	}
+	*owner = pk_test_perf_wait_for_daemon (perf->loop, old_owner);
+	if (*owner == NULL) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+			     "daemon did not appear on the bus within %is",
+			     PK_TEST_PERF_STARTUP_TIMEOUT);
+		g_subprocess_force_exit (daemon);
+		g_subprocess_wait (daemon, NULL, NULL);
+		return NULL;
+	}
+	*elapsed = g_get_monotonic_time () - start;
+	return g_steal_pointer (&daemon);
+}
+
+static void
+pk_test_perf_stop_daemon (GSubprocess *daemon)
+{
+	g_subprocess_send_signal (daemon, SIGTERM);
+	g_subprocess_wait (daemon, NULL, NULL);
+}
+
+/* what the daemon does after ShutdownTimeout with IdlePolicy=standby */
+static gboolean
+pk_test_perf_standby (GError **error)
+{
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GVariant) reply = NULL;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+	if (connection == NULL)
+		return FALSE;
+	reply = g_dbus_connection_call_sync (connection,
+					     PK_DBUS_SERVICE,
+					     PK_DBUS_PATH,
+					     PK_DBUS_INTERFACE_DEBUG,
+					     "Standby",
+					     NULL, NULL,
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1, NULL, error);
+	return reply != NULL;
+}
+
+/* the time taken by the only request of a workload */
+static gint64
+pk_test_perf_get_latency (PkTestPerfWorkload *workload)
+{
+	if (workload->latencies->len == 0)
+		return 0;
+	return g_array_index (workload->latencies, gint64, 0);
+}
+
+int
+main (int argc, char **argv)
+{
+	PkTestPerf perf = { NULL, NULL, NULL };
+	const gchar *output;
+	const gchar *pid;
+	gint retval = EXIT_SUCCESS;
+	guint64 hwm = 0;
+	guint64 rss = 0;
+	guint64 rss_idle = 0;
+	guint64 rss_standby = 0;
+	gint64 startup = 0;
+	gint64 restart = 0;
+	guint packages;
+	guint i;
+	g_autofree gchar *owner = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) json = NULL;
+	g_autoptr(GSubprocess) daemon = NULL;
+	g_autoptr(GTestDBus) bus = NULL;
+	PkTestPerfWorkload workloads[] = {
+		{ "get-packages",	pk_test_perf_get_packages,	1,	1 },
+		{ "search-burst",	pk_test_perf_search,		50,	10 },
+		{ "resolve-concurrent",	pk_test_perf_resolve,		100,	100 },
+		{ "resolve-sequential",	pk_test_perf_resolve,		1000,	1 },
+		{ "install-simulate",	pk_test_perf_install_simulate,	20,	1 },
+		{ NULL }
+	};
+	PkTestPerfWorkload standby_request = { "standby-first-request", pk_test_perf_resolve, 1, 1 };
+	PkTestPerfWorkload exit_request = { "exit-first-request", pk_test_perf_resolve, 1, 1 };
+
+	if (argc != 2) {
+		g_printerr ("Usage: %s /path/to/packagekitd\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* standard workload unless the caller asked for something else */
+	g_setenv ("PK_TEST_PERF_PACKAGES", "50000", FALSE);
+	g_setenv ("PK_TEST_PERF_SUMMARY_SIZE", "64", FALSE);
+
+	/* parsed the same way as the backend does */
+	packages = (guint) g_ascii_strtoull (g_getenv ("PK_TEST_PERF_PACKAGES"), NULL, 10);
+
+	/* run the daemon on a private bus posing as the system bus */
+	bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+	g_test_dbus_up (bus);
+	g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+	perf.loop = g_main_loop_new (NULL, FALSE);
+	daemon = pk_test_perf_start_daemon (&perf, argv[1], &owner, &startup, &error);
+	if (daemon == NULL) {
+		g_printerr ("failed to start daemon: %s\n", error->message);
+		retval = EXIT_FAILURE;
+		goto out;
+	}
+	pid = g_subprocess_get_identifier (daemon);
+	pk_test_perf_get_rss (pid, &rss_idle, &hwm);
+
+	perf.client = pk_client_new ();
+	pk_client_set_interactive (perf.client, FALSE);
+	for (i = 0; workloads[i].name != NULL; i++) {
+		pk_test_perf_run (&perf, &workloads[i]);
+		if (workloads[i].failed > 0)
+			retval = EXIT_FAILURE;
+	}
+	pk_test_perf_get_rss (pid, &rss, &hwm);
+
+	/* IdlePolicy=standby: the warm daemon after freeing what it can */
+	if (!pk_test_perf_standby (&error)) {
+		g_printerr ("failed to put daemon in standby: %s\n", error->message);
+		retval = EXIT_FAILURE;
+		goto out;
+	}
+	pk_test_perf_get_rss (pid, &rss_standby, &hwm);
+	pk_test_perf_run (&perf, &standby_request);
+
+	/* IdlePolicy=exit: nothing is used while idle, but the next request
+	 * waits for the daemon to start and load the backend again */
+	pk_test_perf_stop_daemon (daemon);
+	g_clear_object (&daemon);
+	daemon = pk_test_perf_start_daemon (&perf, argv[1], &owner, &restart, &error);
+	if (daemon == NULL) {
+		g_printerr ("failed to restart daemon: %s\n", error->message);
+		retval = EXIT_FAILURE;
+		goto out;
+	}
+	pk_test_perf_run (&perf, &exit_request);
+	if (standby_request.failed > 0 || exit_request.failed > 0)
+		retval = EXIT_FAILURE;
+
+	/* hand-rolled to avoid a json-glib dependency */
+	json = g_string_new ("{\n");
+	g_string_append_printf (json, "  \"packages\": %u,\n", packages);
+	g_string_append_printf (json, "  \"startup_us\": %" G_GINT64_FORMAT ",\n",
+				startup);
+	g_string_append (json, "  \"workloads\": [\n");
+	for (i = 0; workloads[i].name != NULL; i++) {
+		PkTestPerfWorkload *workload = &workloads[i];
+		gdouble elapsed = (gdouble) workload->elapsed / G_USEC_PER_SEC;
+		g_string_append_printf (json,
+					"    { \"name\": \"%s\", \"requests\": %u, "
+					"\"failed\": %u, \"concurrency\": %u, "
+					"\"elapsed_s\": %.3f, \"ops_per_s\": %.1f, "
+					"\"packages\": %" G_GUINT64_FORMAT ", "
+					"\"packages_per_s\": %.1f, "
+					"\"p50_us\": %" G_GINT64_FORMAT ", "
+					"\"p99_us\": %" G_GINT64_FORMAT " }%s\n",
+					workload->name,
+					workload->count,
+					workload->failed,
+					workload->concurrency,
+					elapsed,
+					workload->count / elapsed,
+					workload->packages,
+					workload->packages / elapsed,
+					pk_test_perf_percentile (workload->latencies, 50),
+					pk_test_perf_percentile (workload->latencies, 99),
+					workloads[i + 1].name != NULL ? "," : "");
+	}
+	g_string_append (json, "  ],\n");
+	g_string_append_printf (json,
+				"  \"rss_kb\": { \"idle\": %" G_GUINT64_FORMAT ", "
+				"\"final\": %" G_GUINT64_FORMAT ", "
+				"\"peak\": %" G_GUINT64_FORMAT " },\n",
+				rss_idle, rss, hwm);
+	g_string_append_printf (json,
+				"  \"idle\": {\n"
+				"    \"exit\": { \"rss_kb\": 0, "
+				"\"startup_us\": %" G_GINT64_FORMAT ", "
+				"\"first_request_us\": %" G_GINT64_FORMAT " },\n"
+				"    \"standby\": { \"rss_kb\": %" G_GUINT64_FORMAT ", "
+				"\"startup_us\": 0, "
+				"\"first_request_us\": %" G_GINT64_FORMAT " }\n"
+				"  }\n",
+				restart,
+				restart + pk_test_perf_get_latency (&exit_request),
+				rss_standby,
+				pk_test_perf_get_latency (&standby_request));
+	g_string_append (json, "}\n");
+	g_print ("%s", json->str);
+
+	output = g_getenv ("PK_PERF_OUTPUT");
+	if (output != NULL &&
+	    !g_file_set_contents (output, json->str, json->len, &error)) {
+		g_printerr ("failed to write %s: %s\n", output, error->message);
+		retval = EXIT_FAILURE;
+	}
+out:
+	if (daemon != NULL)
+		pk_test_perf_stop_daemon (daemon);
+	for (i = 0; workloads[i].name != NULL; i++) {
+		if (workloads[i].latencies != NULL)
+			g_array_unref (workloads[i].latencies);
+	}
+	if (standby_request.latencies != NULL)
+		g_array_unref (standby_request.latencies);
+	if (exit_request.latencies != NULL)
+		g_array_unref (exit_request.latencies);
+	if (perf.client != NULL)
+		g_object_unref (perf.client);
+	g_main_loop_unref (perf.loop);
+	g_test_dbus_down (bus);
+	return retval;
+}
@@ -24,6 +24,7 @@
 #include <glib-object.h>
 
 #include "pk-common.h"
+#include "pk-common-private.h"
 #include "pk-debug.h"
 #include "pk-enum.h"
 #include "pk-offline.h"
@@ -31,8 +32,10 @@
 #include "pk-package.h"
 #include "pk-package-id.h"
 #include "pk-package-ids.h"
+#include "pk-package-sack.h"
 #include "pk-progress-bar.h"
 #include "pk-results.h"
+#include "pk-results-private.h"
 
 static void
 pk_test_bitfield_func (void)
@@ -164,6 +167,8 @@ gchar *_tid = NULL;
 static void
 pk_test_common_func (void)
 {
+	const gchar *str1;
+	const gchar *str2;
 	gchar *present;
 	GDate *date;
 
@@ -197,6 +202,17 @@ pk_test_common_func (void)
 	g_assert_cmpint (date->month, ==, 2);
 	g_assert_cmpint (date->year, ==, 2004);
 	g_date_free (date);
+
+	/* interned strings are shared */
+	str1 = pk_ref_string_new_intern ("fedora");
+	str2 = pk_ref_string_new_intern ("fedora");
+	g_assert_cmpstr (str1, ==, "fedora");
+	g_assert (str1 == str2);
+	g_assert (pk_ref_string_acquire (str1) == str1);
+	pk_ref_string_release (str1);
+	pk_ref_string_release (str1);
+	pk_ref_string_release (str2);
+	g_assert (pk_ref_string_new_intern (NULL) == NULL);
 }
 
 static void
@@ -404,6 +420,107 @@ pk_test_package_id_func (void)
 	g_assert (sections == NULL);
 }
 
+static void
+pk_test_package_id_view_func (void)
+{
+	PkPackageIdView view;
+	PkPackageIdView view2;
+	const gchar *package_id = "gnome-power-manager;0.1.2;i386;fedora";
+	gboolean ret;
+	gdouble elapsed_split;
+	gdouble elapsed_view;
+	guint i;
+	guint found = 0;
+	g_autoptr(GPtrArray) package_ids = NULL;
+
+	/* parts point into the ID */
+	ret = pk_package_id_view_init (&view, package_id);
+	g_assert (ret);
+	g_assert (view.name == package_id);
+	g_assert_cmpint (view.name_len, ==, 19);
+	g_assert (pk_package_id_part_equal (view.version, view.version_len, "0.1.2"));
+	g_assert (!pk_package_id_part_equal (view.version, view.version_len, "0.1"));
+	g_assert (!pk_package_id_part_equal (view.version, view.version_len, "0.1.23"));
+	g_assert (pk_package_id_part_equal (view.arch, view.arch_len, "i386"));
+	g_assert_cmpstr (view.data, ==, "fedora");
+	g_assert_cmpint (view.data_len, ==, 6);
+
+	/* same result as hashing the whole ID */
+	g_assert_cmpint (pk_package_id_view_hash (&view), ==, g_str_hash (package_id));
+
+	/* equal */
+	ret = pk_package_id_view_init (&view2, "gnome-power-manager;0.1.2;i386;fedora");
+	g_assert (ret);
+	g_assert (pk_package_id_view_equal (&view, &view2));
+	ret = pk_package_id_view_init (&view2, "gnome-power-manager;0.1.2;i386;");
+	g_assert (ret);
+	g_assert_cmpint (view2.data_len, ==, 0);
+	g_assert (!pk_package_id_view_equal (&view, &view2));
+
+	/* invalid */
+	g_assert (!pk_package_id_view_init (&view, NULL));
+	g_assert (!pk_package_id_view_init (&view, "foo;moo"));
+	g_assert (!pk_package_id_view_init (&view, "foo;moo;dave;clive;dan"));
+	g_assert (!pk_package_id_view_init (&view, ";0.1.2;i386;data"));
+
+	/* a view finds the same parts as splitting the ID */
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < 1000; i++) {
+		g_ptr_array_add (package_ids,
+				 g_strdup_printf ("package%04u;1.0-%u.fc30;x86_64;%s",
+						  i, i % 10,
+						  i % 2 == 0 ? "fedora" : "updates"));
+	}
+	for (i = 0; i < package_ids->len; i++) {
+		const gchar *tmp = g_ptr_array_index (package_ids, i);
+		g_auto(GStrv) sections = g_strsplit (tmp, ";", -1);
+		g_assert (pk_package_id_check (tmp));
+		g_assert (pk_package_id_view_init (&view, tmp));
+		g_assert (pk_package_id_part_equal (view.name, view.name_len,
+						    sections[PK_PACKAGE_ID_NAME]));
+		g_assert (pk_package_id_part_equal (view.version, view.version_len,
+						    sections[PK_PACKAGE_ID_VERSION]));
+		g_assert (pk_package_id_part_equal (view.arch, view.arch_len,
+						    sections[PK_PACKAGE_ID_ARCH]));
+		g_assert (pk_package_id_part_equal (view.data, view.data_len,
+						    sections[PK_PACKAGE_ID_DATA]));
+		g_assert_cmpint (pk_package_id_view_hash (&view), ==, g_str_hash (tmp));
+	}
+
+	/* only compare the speed when asked to, e.g. with -m perf */
+	if (!g_test_perf ())
+		return;
+	g_test_timer_start ();
+	for (i = 0; i < 1000000; i++) {
+		const gchar *tmp = g_ptr_array_index (package_ids, i % package_ids->len);
+		g_auto(GStrv) sections = NULL;
+		if (!g_utf8_validate (tmp, -1, NULL))
+			continue;
+		sections = g_strsplit (tmp, ";", -1);
+		if (g_strv_length (sections) != 4 || sections[0][0] == '\0')
+			continue;
+		if (g_strcmp0 (sections[PK_PACKAGE_ID_ARCH], "x86_64") == 0)
+			found++;
+	}
+	elapsed_split = g_test_timer_elapsed ();
+	g_assert_cmpint (found, ==, 1000000);
+
+	found = 0;
+	g_test_timer_start ();
+	for (i = 0; i < 1000000; i++) {
+		const gchar *tmp = g_ptr_array_index (package_ids, i % package_ids->len);
+		if (!pk_package_id_check (tmp))
+			continue;
+		pk_package_id_view_init (&view, tmp);
+		if (pk_package_id_part_equal (view.arch, view.arch_len, "x86_64"))
+			found++;
+	}
+	elapsed_view = g_test_timer_elapsed ();
+	g_assert_cmpint (found, ==, 1000000);
+	g_test_message ("checked 1000000 IDs in %.3fs with split, %.3fs with view",
+			elapsed_split, elapsed_view);
+}
+
 static void
 pk_test_package_ids_func (void)
 {
@@ -535,11 +652,191 @@ pk_test_results_func (void)
 	g_object_unref (results);
 }
 
+static gboolean
+pk_test_results_packed_filter_cb (PkPackage *package, gpointer user_data)
+{
+	return pk_package_get_info (package) == PK_INFO_ENUM_INSTALLED;
+}
+
+static void
+pk_test_results_packed_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	guint i;
+	PkPackage *package;
+	PkRoleEnum role;
+	g_autofree gchar *transaction_id = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkPackage) found1 = NULL;
+	g_autoptr(PkPackage) found2 = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(PkPackageSack) sack_installed = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	results = pk_results_new ();
+
+	/* add invalid package */
+	ret = pk_results_add_package_data (results, PK_INFO_ENUM_AVAILABLE,
+					   "gnome-power-manager;0.1.2;i386",
+					   NULL, PK_ROLE_ENUM_GET_PACKAGES,
+					   NULL, &error);
+	g_assert_error (error, 1, 0);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	/* add as many packages as a large GetPackages */
+	g_test_timer_start ();
+	for (i = 0; i < 60000; i++) {
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("package%05u;1.0-%u;x86_64;%s",
+					      i, i % 10,
+					      i % 2 == 0 ? "fedora" : "updates");
+		ret = pk_results_add_package_data (results,
+						   i % 3 == 0 ? PK_INFO_ENUM_INSTALLED :
+								PK_INFO_ENUM_AVAILABLE,
+						   package_id,
+						   "Test package",
+						   PK_ROLE_ENUM_GET_PACKAGES,
+						   "/1_abcdef",
+						   &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	elapsed = g_test_timer_elapsed ();
+	g_test_message ("added 60000 packages in %.3fs", elapsed);
+
+	/* filter without creating any objects */
+	sack = pk_results_get_package_sack (results);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 60000);
+	sack_installed = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (sack_installed), ==, 20000);
+
+	/* find a package, which is created once */
+	found1 = pk_package_sack_find_by_id (sack, "package00042;1.0-2;x86_64;fedora");
+	g_assert (found1 != NULL);
+	g_assert_cmpint (pk_package_get_info (found1), ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_package_get_summary (found1), ==, "Test package");
+	g_object_get (found1,
+		      "role", &role,
+		      "transaction-id", &transaction_id,
+		      NULL);
+	g_assert_cmpint (role, ==, PK_ROLE_ENUM_GET_PACKAGES);
+	g_assert_cmpstr (transaction_id, ==, "/1_abcdef");
+	found2 = pk_package_sack_find_by_id (sack, "package00042;1.0-2;x86_64;fedora");
+	g_assert (found1 == found2);
+
+	/* create the rest of the objects */
+	g_test_timer_start ();
+	packages = pk_results_get_package_array (results);
+	elapsed = g_test_timer_elapsed ();
+	g_test_message ("created 60000 packages in %.3fs", elapsed);
+	g_assert_cmpint (packages->len, ==, 60000);
+	g_assert (g_ptr_array_index (packages, 42) == found1);
+	package = g_ptr_array_index (packages, 59999);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "package59999;1.0-9;x86_64;updates");
+
+	/* remove packages, keeping the objects with their data */
+	ret = pk_package_sack_remove_by_filter (sack, pk_test_results_packed_filter_cb, NULL);
+	g_assert (ret);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 20000);
+	g_clear_object (&found2);
+	found2 = pk_package_sack_find_by_id (sack, "package00042;1.0-2;x86_64;fedora");
+	g_assert (found1 == found2);
+	g_assert (pk_package_sack_find_by_id (sack, "package00043;1.0-3;x86_64;updates") == NULL);
+}
+
+static gboolean
+pk_test_package_sack_join_cb (PkPackage *package, PkPackage *other, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	g_assert_cmpstr (pk_package_get_name (package), ==, pk_package_get_name (other));
+	g_assert_cmpstr (pk_package_get_arch (package), ==, pk_package_get_arch (other));
+	(*cnt)++;
+	return TRUE;
+}
+
+static void
+pk_test_package_sack_join_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	guint cnt = 0;
+	guint i;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkPackage) package = NULL;
+	g_autoptr(PkPackageSack) installed = NULL;
+	g_autoptr(PkPackageSack) updates = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+
+	/* one sack of installed packages, and one of updates for every other */
+	installed = pk_package_sack_new ();
+	updates = pk_package_sack_new ();
+	for (i = 0; i < 30000; i++) {
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("package%05u;1.0-1;x86_64;installed", i);
+		ret = pk_package_sack_add_package_by_id (installed, package_id, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	for (i = 0; i < 30000; i++) {
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("package%05u;1.0-2;%s;updates",
+					      i / 2 * 2, i % 2 == 0 ? "x86_64" : "i686");
+		ret = pk_package_sack_add_package_by_id (updates, package_id, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+
+	/* find by name and arch */
+	package = pk_package_sack_find_by_id_name_arch (updates, "package00042;1.0-1;x86_64;installed");
+	g_assert (package != NULL);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "package00042;1.0-2;x86_64;updates");
+	g_assert (pk_package_sack_find_by_id_name_arch (updates, "package00043;1.0-1;x86_64;installed") == NULL);
+	g_assert (pk_package_sack_find_by_id_name_arch (updates, "package00042") == NULL);
+
+	/* join the sacks */
+	g_test_timer_start ();
+	sack = pk_package_sack_filter_by_name_arch (installed, updates);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 15000);
+	g_assert_cmpint (pk_package_sack_join_by_name_arch (installed, updates,
+							    pk_test_package_sack_join_cb,
+							    &cnt), ==, 15000);
+	elapsed = g_test_timer_elapsed ();
+	g_test_message ("joined 30000 packages with 30000 in %.3fs", elapsed);
+	g_assert_cmpint (cnt, ==, 15000);
+
+	/* only the installed packages with an update for the same arch */
+	g_clear_object (&package);
+	package = pk_package_sack_find_by_id (sack, "package00042;1.0-1;x86_64;installed");
+	g_assert (package != NULL);
+	g_assert (pk_package_sack_find_by_id (sack, "package00043;1.0-1;x86_64;installed") == NULL);
+
+	/* packages added later are found, with all the versions */
+	ret = pk_package_sack_add_package_by_id (updates, "package00042;1.0-3;x86_64;testing", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	array = pk_package_sack_find_all_by_name_arch (updates, "package00042", "x86_64");
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 1)), ==, "package00042;1.0-3;x86_64;testing");
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* and removed ones are not */
+	ret = pk_package_sack_remove_package_by_id (updates, "package00042;1.0-2;x86_64;updates");
+	g_assert (ret);
+	array = pk_package_sack_find_all_by_name_arch (updates, "package00042", "x86_64");
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==, "package00042;1.0-3;x86_64;testing");
+}
+
 static void
 pk_test_package_func (void)
 {
 	gboolean ret;
 	PkPackage *package;
+	PkPackage *package2;
 	const gchar *id;
 	gchar *text;
 	GError *error = NULL;
@@ -595,6 +892,22 @@ pk_test_package_func (void)
 	g_assert_cmpstr (text, ==, "gnome-power-manager;0.1.2;i386;fedora");
 	g_free (text);
 
+	/* get the parts of the id */
+	g_assert_cmpstr (pk_package_get_name (package), ==, "gnome-power-manager");
+	g_assert_cmpstr (pk_package_get_version (package), ==, "0.1.2");
+	g_assert_cmpstr (pk_package_get_arch (package), ==, "i386");
+	g_assert_cmpstr (pk_package_get_data (package), ==, "fedora");
+
+	/* compare with a package with the same id */
+	package2 = pk_package_new ();
+	ret = pk_package_set_id (package2, "gnome-power-manager;0.1.2;i386;fedora", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (pk_package_equal_id (package, package2));
+	pk_package_set_summary (package2, "Power manager for GNOME");
+	g_assert (!pk_package_equal (package, package2));
+	g_object_unref (package2);
+
 	g_object_unref (package);
 }
 
@@ -925,9 +1238,12 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/enum", pk_test_enum_func);
 	g_test_add_func ("/packagekit-glib2/bitfield", pk_test_bitfield_func);
 	g_test_add_func ("/packagekit-glib2/package-id", pk_test_package_id_func);
+	g_test_add_func ("/packagekit-glib2/package-id-view", pk_test_package_id_view_func);
 	g_test_add_func ("/packagekit-glib2/package-ids", pk_test_package_ids_func);
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
 	g_test_add_func ("/packagekit-glib2/results", pk_test_results_func);
+	g_test_add_func ("/packagekit-glib2/results-packed", pk_test_results_packed_func);
+	g_test_add_func ("/packagekit-glib2/package-sack-join", pk_test_package_sack_join_func);
 	g_test_add_func ("/packagekit-glib2/package", pk_test_package_func);
 	g_test_add_func ("/packagekit-glib2/progress-bar", pk_test_progress_bar);
 	g_test_add_func ("/packagekit-glib2/offline", pk_test_offline_func);
@@ -0,0 +1,448 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <polkit/polkit.h>
+
+#include "pk-auth-cache.h"
+
+#define PK_AUTH_CACHE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_AUTH_CACHE, PkAuthCachePrivate))
+
+/* how long an authorization is reused for */
+#define PK_AUTH_CACHE_TIMEOUT		15 /* s */
+
+/* maximum number of authorizations kept at any one time */
+#define PK_AUTH_CACHE_MAX_ITEMS		64
+
+struct PkAuthCachePrivate
+{
+	GHashTable		*items;		/* key:PkAuthCacheItem */
+	PolkitAuthority		*authority;
+	guint			 changed_id;
+	PkAuthCacheCheckFunc	 check_func;
+	gpointer		 check_func_data;
+};
+
+typedef struct {
+	PolkitAuthorizationResult *result;
+	gint64			 expires;
+} PkAuthCacheItem;
+
+typedef struct {
+	PolkitSubject		*subject;
+	gchar			*action_id;
+	PolkitDetails		*details;
+	PolkitCheckAuthorizationFlags flags;
+	gchar			*key;
+} PkAuthCacheHelper;
+
+static gpointer pk_auth_cache_object = NULL;
+
+G_DEFINE_TYPE (PkAuthCache, pk_auth_cache, G_TYPE_OBJECT)
+
+static void
+pk_auth_cache_item_free (PkAuthCacheItem *item)
+{
+	g_object_unref (item->result);
+	g_free (item);
+}
+
+static void
+pk_auth_cache_helper_free (PkAuthCacheHelper *helper)
+{
+	g_object_unref (helper->subject);
+	g_free (helper->action_id);
+	if (helper->details != NULL)
+		g_object_unref (helper->details);
+	g_free (helper->key);
+	g_free (helper);
+}
+
+static gint
+pk_auth_cache_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	return g_strcmp0 (*((const gchar **) a), *((const gchar **) b));
+}
+
+/**
+ * pk_auth_cache_make_key:
+ *
+ * The details are hashed too, as polkit rules are allowed to look at them
+ * and the same action can be allowed for one package but not another.
+ **/
+static gchar *
+pk_auth_cache_make_key (PolkitSubject *subject,
+			const gchar *action_id,
+			PolkitDetails *details)
+{
+	guint i;
+	g_autofree gchar *subject_str = NULL;
+	g_autoptr(GChecksum) checksum = NULL;
+	g_auto(GStrv) keys = NULL;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	if (details != NULL)
+		keys = polkit_details_get_keys (details);
+	if (keys != NULL) {
+		g_qsort_with_data (keys, g_strv_length (keys), sizeof (gchar *),
+				   pk_auth_cache_sort_cb, NULL);
+		for (i = 0; keys[i] != NULL; i++) {
+			const gchar *value = polkit_details_lookup (details, keys[i]);
+			g_checksum_update (checksum, (const guchar *) keys[i], strlen (keys[i]) + 1);
+			g_checksum_update (checksum, (const guchar *) value, strlen (value) + 1);
+		}
+	}
+	subject_str = polkit_subject_to_string (subject);
+	return g_strdup_printf ("%s\n%s\n%s",
+				subject_str, action_id,
+				g_checksum_get_string (checksum));
+}
+
+static void
+pk_auth_cache_expire (PkAuthCache *cache, gboolean make_room)
+{
+	GHashTableIter iter;
+	PkAuthCacheItem *item;
+	const gchar *key;
+	const gchar *oldest_key = NULL;
+	gint64 now = g_get_monotonic_time ();
+	gint64 oldest = G_MAXINT64;
+
+	g_hash_table_iter_init (&iter, cache->priv->items);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &item)) {
+		if (item->expires <= now) {
+			g_hash_table_iter_remove (&iter);
+			continue;
+		}
+		if (item->expires < oldest) {
+			oldest = item->expires;
+			oldest_key = key;
+		}
+	}
+
+	/* still full, so drop the one that expires first */
+	if (make_room && oldest_key != NULL &&
+	    g_hash_table_size (cache->priv->items) >= PK_AUTH_CACHE_MAX_ITEMS)
+		g_hash_table_remove (cache->priv->items, oldest_key);
+}
+
+static PolkitAuthorizationResult *
+pk_auth_cache_lookup (PkAuthCache *cache, const gchar *key)
+{
+	PkAuthCacheItem *item;
+
+	item = g_hash_table_lookup (cache->priv->items, key);
+	if (item == NULL)
+		return NULL;
+	if (item->expires <= g_get_monotonic_time ()) {
+		g_hash_table_remove (cache->priv->items, key);
+		return NULL;
+	}
+	return item->result;
+}
+
+static void
+pk_auth_cache_add (PkAuthCache *cache,
+		   const gchar *key,
+		   PolkitAuthorizationResult *result)
+{
+	PkAuthCacheItem *item;
+
+	if (g_hash_table_size (cache->priv->items) >= PK_AUTH_CACHE_MAX_ITEMS)
+		pk_auth_cache_expire (cache, TRUE);
+
+	item = g_new0 (PkAuthCacheItem, 1);
+	item->result = g_object_ref (result);
+	item->expires = g_get_monotonic_time () + PK_AUTH_CACHE_TIMEOUT * G_USEC_PER_SEC;
+	g_hash_table_replace (cache->priv->items, g_strdup (key), item);
+}
+
+static void pk_auth_cache_check_authorization (GTask *task,
+					       PolkitCheckAuthorizationFlags flags);
+
+static void
+pk_auth_cache_checked (GTask *task,
+		       PolkitAuthorizationResult *result,
+		       const GError *error)
+{
+	PkAuthCache *cache = PK_AUTH_CACHE (g_task_get_source_object (task));
+	PkAuthCacheHelper *helper = g_task_get_task_data (task);
+
+	if (result == NULL) {
+		g_task_return_error (task, g_error_copy (error));
+		return;
+	}
+
+	/* the user has to be asked, so do exactly what we did before */
+	if (helper->flags == POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE &&
+	    !polkit_authorization_result_get_is_authorized (result) &&
+	    polkit_authorization_result_get_is_challenge (result)) {
+		pk_auth_cache_check_authorization (task, POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION);
+		return;
+	}
+
+	/* only keep what polkit would grant again without asking, so a
+	 * one-shot authentication still prompts the next time */
+	if (polkit_authorization_result_get_is_authorized (result) &&
+	    (helper->flags == POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE ||
+	     polkit_authorization_result_get_retains_authorization (result) ||
+	     polkit_authorization_result_get_temporary_authorization_id (result) != NULL)) {
+		g_debug ("caching authorization for %s", helper->action_id);
+		pk_auth_cache_add (cache, helper->key, result);
+	}
+
+	g_task_return_pointer (task, g_object_ref (result), g_object_unref);
+}
+
+static void
+pk_auth_cache_check_cb (GObject *source_object,
+			GAsyncResult *res,
+			gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	g_autoptr(GError) error = NULL;
+	PolkitAuthorizationResult *result;
+
+	result = polkit_authority_check_authorization_finish (POLKIT_AUTHORITY (source_object),
+							      res, &error);
+	pk_auth_cache_checked (task, result, error);
+	if (result != NULL)
+		g_object_unref (result);
+}
+
+static void
+pk_auth_cache_check_authorization (GTask *task,
+				   PolkitCheckAuthorizationFlags flags)
+{
+	PkAuthCache *cache = PK_AUTH_CACHE (g_task_get_source_object (task));
+	PkAuthCacheHelper *helper = g_task_get_task_data (task);
+
+	helper->flags = flags;
+
+	/* used by the self tests instead of polkitd */
+	if (cache->priv->check_func != NULL) {
+		g_autoptr(GError) error = NULL;
+		PolkitAuthorizationResult *result;
+
+		result = cache->priv->check_func (helper->subject,
+						  helper->action_id,
+						  helper->details,
+						  flags,
+						  cache->priv->check_func_data);
+		if (result == NULL)
+			g_set_error (&error, 1, 0, "no result for %s", helper->action_id);
+		pk_auth_cache_checked (task, result, error);
+		if (result != NULL)
+			g_object_unref (result);
+		return;
+	}
+
+	polkit_authority_check_authorization (cache->priv->authority,
+					      helper->subject,
+					      helper->action_id,
+					      helper->details,
+					      flags,
+					      g_task_get_cancellable (task),
+					      pk_auth_cache_check_cb,
+					      g_object_ref (task));
+}
+
+static void
+pk_auth_cache_authority_changed_cb (PolkitAuthority *authority,
+				    PkAuthCache *cache)
+{
+	g_debug ("polkit configuration changed, flushing authorizations");
+	pk_auth_cache_flush (cache);
+}
+
+/**
+ * pk_auth_cache_check_async:
+ * @cache: a #PkAuthCache
+ * @subject: the #PolkitSubject
+ * @action_id: the polkit action
+ * @details: (allow-none): the #PolkitDetails for the action
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Checks an action with polkit, allowing user interaction, unless the same
+ * subject was recently authorized for the same action and details.
+ *
+ * Only authorizations that polkit would grant again without a prompt are
+ * reused: implicit ones and temporary ones (auth_*_keep). They are kept for
+ * a few seconds at most and flushed when polkit reports a change.
+ **/
+void
+pk_auth_cache_check_async (PkAuthCache *cache,
+			   PolkitSubject *subject,
+			   const gchar *action_id,
+			   PolkitDetails *details,
+			   GCancellable *cancellable,
+			   GAsyncReadyCallback callback,
+			   gpointer user_data)
+{
+	PkAuthCacheHelper *helper;
+	PolkitAuthorizationResult *result;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (PK_IS_AUTH_CACHE (cache));
+	g_return_if_fail (POLKIT_IS_SUBJECT (subject));
+	g_return_if_fail (action_id != NULL);
+
+	task = g_task_new (cache, cancellable, callback, user_data);
+	helper = g_new0 (PkAuthCacheHelper, 1);
+	helper->subject = g_object_ref (subject);
+	helper->action_id = g_strdup (action_id);
+	if (details != NULL)
+		helper->details = g_object_ref (details);
+	helper->key = pk_auth_cache_make_key (subject, action_id, details);
+	g_task_set_task_data (task, helper, (GDestroyNotify) pk_auth_cache_helper_free);
+
+	/* already authorized */
+	result = pk_auth_cache_lookup (cache, helper->key);
+	if (result != NULL) {
+		g_debug ("using cached authorization for %s", action_id);
+		g_task_return_pointer (task, g_object_ref (result), g_object_unref);
+		return;
+	}
+
+	/* create if required */
+	if (cache->priv->authority == NULL && cache->priv->check_func == NULL) {
+		g_autoptr(GError) error = NULL;
+		cache->priv->authority = polkit_authority_get_sync (NULL, &error);
+		if (cache->priv->authority == NULL) {
+			g_task_return_error (task, g_steal_pointer (&error));
+			return;
+		}
+		cache->priv->changed_id =
+			g_signal_connect (cache->priv->authority, "changed",
+					  G_CALLBACK (pk_auth_cache_authority_changed_cb),
+					  cache);
+	}
+
+	/* find out if the user has to be asked at all */
+	pk_auth_cache_check_authorization (task, POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE);
+}
+
+/**
+ * pk_auth_cache_check_finish:
+ * @cache: a #PkAuthCache
+ * @res: the #GAsyncResult
+ * @error: a #GError, or %NULL
+ *
+ * Gets the result from pk_auth_cache_check_async().
+ *
+ * Return value: (transfer full): the #PolkitAuthorizationResult, or %NULL
+ **/
+PolkitAuthorizationResult *
+pk_auth_cache_check_finish (PkAuthCache *cache,
+			    GAsyncResult *res,
+			    GError **error)
+{
+	g_return_val_if_fail (PK_IS_AUTH_CACHE (cache), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, cache), NULL);
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/**
+ * pk_auth_cache_flush:
+ * @cache: a #PkAuthCache
+ *
+ * Forgets all the authorizations.
+ **/
+void
+pk_auth_cache_flush (PkAuthCache *cache)
+{
+	g_return_if_fail (PK_IS_AUTH_CACHE (cache));
+	g_hash_table_remove_all (cache->priv->items);
+}
+
+/**
+ * pk_auth_cache_set_check_func:
+ * @cache: a #PkAuthCache
+ * @func: the function to use instead of polkitd
+ * @user_data: the data to pass to @func
+ *
+ * Replaces the polkit authority, for the self tests.
+ **/
+void
+pk_auth_cache_set_check_func (PkAuthCache *cache,
+			      PkAuthCacheCheckFunc func,
+			      gpointer user_data)
+{
+	g_return_if_fail (PK_IS_AUTH_CACHE (cache));
+	cache->priv->check_func = func;
+	cache->priv->check_func_data = user_data;
+	pk_auth_cache_flush (cache);
+}
+
+static void
+pk_auth_cache_finalize (GObject *object)
+{
+	PkAuthCache *cache;
+
+	g_return_if_fail (PK_IS_AUTH_CACHE (object));
+	cache = PK_AUTH_CACHE (object);
+
+	if (cache->priv->changed_id > 0)
+		g_signal_handler_disconnect (cache->priv->authority, cache->priv->changed_id);
+	if (cache->priv->authority != NULL)
+		g_object_unref (cache->priv->authority);
+	g_hash_table_unref (cache->priv->items);
+
+	G_OBJECT_CLASS (pk_auth_cache_parent_class)->finalize (object);
+}
+
+static void
+pk_auth_cache_class_init (PkAuthCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_auth_cache_finalize;
+
+	g_type_class_add_private (klass, sizeof (PkAuthCachePrivate));
+}
+
+static void
+pk_auth_cache_init (PkAuthCache *cache)
+{
+	cache->priv = PK_AUTH_CACHE_GET_PRIVATE (cache);
+	cache->priv->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free,
+						    (GDestroyNotify) pk_auth_cache_item_free);
+}
+
+PkAuthCache *
+pk_auth_cache_new (void)
+{
+	if (pk_auth_cache_object != NULL) {
+		g_object_ref (pk_auth_cache_object);
+	} else {
+		pk_auth_cache_object = g_object_new (PK_TYPE_AUTH_CACHE, NULL);
+		g_object_add_weak_pointer (pk_auth_cache_object, &pk_auth_cache_object);
+	}
+	return PK_AUTH_CACHE (pk_auth_cache_object);
+}
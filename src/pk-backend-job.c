@@ -24,6 +24,7 @@
 #include <glib.h>
 #include <glib/gprintf.h>
 
+#include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-results.h>
 
 #include "pk-backend.h"
@@ -75,6 +76,7 @@ struct PkBackendJobPrivate
 	gboolean		 set_signature;
 	gchar			*cmdline;
 	gchar			*frontend_socket;
+	gchar			*solution_token;
 	gchar			*locale;
 	gchar			*no_proxy;
 	gchar			*pac;
@@ -107,6 +109,9 @@ struct PkBackendJobPrivate
 	PkStatusEnum		 status;
 	GTimer			*timer;
 	gboolean		 started;
+	gboolean		 suspended;
+	GMutex			 suspend_mutex;
+	GCond			 suspend_cond;
 };
 
 G_DEFINE_TYPE (PkBackendJob, pk_backend_job, G_TYPE_OBJECT)
@@ -161,6 +166,190 @@ pk_backend_job_is_cancelled (PkBackendJob *job)
 	return g_cancellable_is_cancelled (job->priv->cancellable);
 }
 
+typedef struct {
+	PkBackendJob		*job;
+	PkBackendJobCancelFunc	 func;
+	gpointer		 user_data;
+	GDestroyNotify		 destroy_func;
+} PkBackendJobCancelHook;
+
+static void
+pk_backend_job_cancel_hook_cb (GCancellable *cancellable, gpointer user_data)
+{
+	PkBackendJobCancelHook *hook = (PkBackendJobCancelHook *) user_data;
+	hook->func (hook->job, hook->user_data);
+}
+
+static void
+pk_backend_job_cancel_hook_free (gpointer data)
+{
+	PkBackendJobCancelHook *hook = (PkBackendJobCancelHook *) data;
+	if (hook->destroy_func != NULL)
+		hook->destroy_func (hook->user_data);
+	g_free (hook);
+}
+
+/**
+ * pk_backend_job_add_cancel_hook:
+ * @job: a #PkBackendJob
+ * @func: the function to call when the job is cancelled
+ * @user_data: data to pass to @func
+ * @destroy_func: (nullable): called on @user_data when the hook is removed
+ *
+ * Registers a function that aborts whatever the backend is blocked in,
+ * e.g. alpm_trans_interrupt() or sqlite3_interrupt(), so the job does not
+ * have to wait until it next checks pk_backend_job_is_cancelled().
+ *
+ * @func is called in the main thread as soon as the job is cancelled, while
+ * the backend thread is still running, so it must be thread safe and must
+ * not block. If the job is already cancelled @func is called straight away
+ * and 0 is returned.
+ *
+ * Return value: an ID for pk_backend_job_remove_cancel_hook(), or 0
+ **/
+gulong
+pk_backend_job_add_cancel_hook (PkBackendJob *job,
+				PkBackendJobCancelFunc func,
+				gpointer user_data,
+				GDestroyNotify destroy_func)
+{
+	PkBackendJobCancelHook *hook;
+
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), 0);
+	g_return_val_if_fail (func != NULL, 0);
+
+	hook = g_new0 (PkBackendJobCancelHook, 1);
+	hook->job = job;
+	hook->func = func;
+	hook->user_data = user_data;
+	hook->destroy_func = destroy_func;
+	return g_cancellable_connect (job->priv->cancellable,
+				      G_CALLBACK (pk_backend_job_cancel_hook_cb),
+				      hook, pk_backend_job_cancel_hook_free);
+}
+
+/**
+ * pk_backend_job_remove_cancel_hook:
+ * @job: a #PkBackendJob
+ * @hook_id: the ID from pk_backend_job_add_cancel_hook(), or 0
+ *
+ * Removes a cancel hook, typically when the blocking phase it aborts is
+ * over. If the hook is running in the main thread this waits for it to
+ * return, so the resource it touches can be freed safely afterwards.
+ **/
+void
+pk_backend_job_remove_cancel_hook (PkBackendJob *job, gulong hook_id)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_cancellable_disconnect (job->priv->cancellable, hook_id);
+}
+
+/**
+ * pk_backend_job_wait_cancelled:
+ * @job: a #PkBackendJob
+ * @timeout_ms: the longest time to wait
+ *
+ * Sleeps like g_usleep(), but wakes up as soon as the job is cancelled.
+ * Backends that have an fd of their own to wait on can poll it together
+ * with g_cancellable_make_pollfd() on pk_backend_job_get_cancellable().
+ *
+ * Return value: %TRUE if the job has been cancelled
+ **/
+gboolean
+pk_backend_job_wait_cancelled (PkBackendJob *job, guint timeout_ms)
+{
+	GPollFD pollfd;
+
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), FALSE);
+
+	if (!g_cancellable_make_pollfd (job->priv->cancellable, &pollfd)) {
+		g_usleep (timeout_ms * G_TIME_SPAN_MILLISECOND);
+		return pk_backend_job_is_cancelled (job);
+	}
+	g_poll (&pollfd, 1, timeout_ms);
+	g_cancellable_release_fd (job->priv->cancellable);
+	return pk_backend_job_is_cancelled (job);
+}
+
+/**
+ * pk_backend_job_get_suspended:
+ *
+ * Return value: %TRUE if the job has been suspended by the scheduler
+ **/
+gboolean
+pk_backend_job_get_suspended (PkBackendJob *job)
+{
+	gboolean suspended;
+
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), FALSE);
+
+	g_mutex_lock (&job->priv->suspend_mutex);
+	suspended = job->priv->suspended;
+	g_mutex_unlock (&job->priv->suspend_mutex);
+	return suspended;
+}
+
+/**
+ * pk_backend_job_set_suspended:
+ *
+ * Use pk_backend_suspend_job() and pk_backend_resume_job() rather than
+ * calling this directly.
+ **/
+void
+pk_backend_job_set_suspended (PkBackendJob *job, gboolean suspended)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+
+	g_mutex_lock (&job->priv->suspend_mutex);
+	job->priv->suspended = suspended;
+	g_cond_broadcast (&job->priv->suspend_cond);
+	g_mutex_unlock (&job->priv->suspend_mutex);
+}
+
+static void
+pk_backend_job_suspend_cancelled_cb (PkBackendJob *job, gpointer user_data)
+{
+	g_mutex_lock (&job->priv->suspend_mutex);
+	g_cond_broadcast (&job->priv->suspend_cond);
+	g_mutex_unlock (&job->priv->suspend_mutex);
+}
+
+/**
+ * pk_backend_job_check_suspended:
+ * @job: a #PkBackendJob
+ *
+ * Marks a safe point in a resumable role, where everything done so far,
+ * such as partially downloaded files, can be kept while other transactions
+ * run. If the job has been suspended this blocks until it is resumed or
+ * cancelled.
+ *
+ * Return value: %FALSE if the job has been cancelled
+ **/
+gboolean
+pk_backend_job_check_suspended (PkBackendJob *job)
+{
+	gulong hook_id;
+
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), FALSE);
+
+	if (!pk_backend_job_get_suspended (job))
+		return !pk_backend_job_is_cancelled (job);
+
+	g_debug ("job suspended, waiting to be resumed");
+	hook_id = pk_backend_job_add_cancel_hook (job,
+						  pk_backend_job_suspend_cancelled_cb,
+						  NULL, NULL);
+	g_mutex_lock (&job->priv->suspend_mutex);
+	while (job->priv->suspended &&
+	       !g_cancellable_is_cancelled (job->priv->cancellable))
+		g_cond_wait (&job->priv->suspend_cond, &job->priv->suspend_mutex);
+	g_mutex_unlock (&job->priv->suspend_mutex);
+	pk_backend_job_remove_cancel_hook (job, hook_id);
+	g_debug ("job resumed");
+
+	return !pk_backend_job_is_cancelled (job);
+}
+
 /**
  * pk_backend_job_get_backend:
  *
@@ -447,6 +636,35 @@ pk_backend_job_set_cache_age (PkBackendJob *job, guint cache_age)
 	job->priv->cache_age = cache_age;
 }
 
+/**
+ * pk_backend_job_get_solution_token:
+ *
+ * Gets the token of the dependency solution this job works with: either the
+ * one a client passed with the solution-token hint, or the one a simulate
+ * saved using pk_backend_add_solution().
+ *
+ * Return value: the solution token, or %NULL for none
+ **/
+const gchar *
+pk_backend_job_get_solution_token (PkBackendJob *job)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), NULL);
+	return job->priv->solution_token;
+}
+
+void
+pk_backend_job_set_solution_token (PkBackendJob *job, const gchar *solution_token)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+
+	if (g_strcmp0 (job->priv->solution_token, solution_token) == 0)
+		return;
+
+	g_debug ("solution-token changed to %s", solution_token);
+	g_free (job->priv->solution_token);
+	job->priv->solution_token = g_strdup (solution_token);
+}
+
 void
 pk_backend_job_set_user_data (PkBackendJob *job, gpointer user_data)
 {
@@ -987,7 +1205,7 @@ pk_backend_job_package (PkBackendJob *job,
 
 	/* update the emitted package table */
 	g_hash_table_insert (job->priv->emitted,
-	                     g_strdup (pk_package_get_id (item)),
+	                     (gpointer) pk_ref_string_acquire (pk_package_get_id (item)),
 	                     g_object_ref (item));
 
 	/* have we already set an error? */
@@ -1663,12 +1881,15 @@ pk_backend_job_finalize (GObject *object)
 	g_free (job->priv->cmdline);
 	g_free (job->priv->locale);
 	g_free (job->priv->frontend_socket);
+	g_free (job->priv->solution_token);
 	g_hash_table_unref (job->priv->emitted);
 	if (job->priv->params != NULL)
 		g_variant_unref (job->priv->params);
 	g_timer_destroy (job->priv->timer);
 	g_key_file_unref (job->priv->conf);
 	g_object_unref (job->priv->cancellable);
+	g_mutex_clear (&job->priv->suspend_mutex);
+	g_cond_clear (&job->priv->suspend_cond);
 
 	G_OBJECT_CLASS (pk_backend_job_parent_class)->finalize (object);
 }
@@ -1687,6 +1908,8 @@ pk_backend_job_init (PkBackendJob *job)
 	job->priv = PK_BACKEND_JOB_GET_PRIVATE (job);
 	job->priv->timer = g_timer_new ();
 	job->priv->cancellable = g_cancellable_new ();
+	g_mutex_init (&job->priv->suspend_mutex);
+	g_cond_init (&job->priv->suspend_cond);
 	job->priv->last_error_code = PK_ERROR_ENUM_UNKNOWN;
 	job->priv->locale = g_strdup ("C");
 	job->priv->cache_age = G_MAXUINT;
@@ -1695,7 +1918,8 @@ pk_backend_job_init (PkBackendJob *job)
 	job->priv->role = PK_ROLE_ENUM_UNKNOWN;
 	job->priv->status = PK_STATUS_ENUM_UNKNOWN;
 	job->priv->emitted = g_hash_table_new_full (g_str_hash, g_str_equal,
-	                                            g_free, (GDestroyNotify) g_object_unref);
+	                                            (GDestroyNotify) pk_ref_string_release,
+	                                            (GDestroyNotify) g_object_unref);
 }
 
 /**
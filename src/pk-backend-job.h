@@ -78,6 +78,9 @@ typedef struct
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkBackendJob, g_object_unref)
 #endif
 
+typedef void	(*PkBackendJobCancelFunc)		(PkBackendJob	*job,
+							 gpointer	 user_data);
+
 GType		 pk_backend_job_get_type		(void);
 PkBackendJob	*pk_backend_job_new			(GKeyFile		*conf);
 
@@ -87,6 +90,18 @@ void		 pk_backend_job_set_backend		(PkBackendJob	*job,
 							 gpointer	 backend);
 GCancellable	*pk_backend_job_get_cancellable		(PkBackendJob	*job);
 gboolean	 pk_backend_job_is_cancelled		(PkBackendJob	*job);
+gulong		 pk_backend_job_add_cancel_hook		(PkBackendJob	*job,
+							 PkBackendJobCancelFunc func,
+							 gpointer	 user_data,
+							 GDestroyNotify	 destroy_func);
+void		 pk_backend_job_remove_cancel_hook	(PkBackendJob	*job,
+							 gulong		 hook_id);
+gboolean	 pk_backend_job_wait_cancelled		(PkBackendJob	*job,
+							 guint		 timeout_ms);
+gboolean	 pk_backend_job_get_suspended		(PkBackendJob	*job);
+void		 pk_backend_job_set_suspended		(PkBackendJob	*job,
+							 gboolean	 suspended);
+gboolean	 pk_backend_job_check_suspended		(PkBackendJob	*job);
 gpointer	 pk_backend_job_get_user_data		(PkBackendJob	*job);
 void		 pk_backend_job_set_user_data		(PkBackendJob	*job,
 							 gpointer	 user_data);
@@ -135,6 +150,8 @@ void		 pk_backend_job_set_frontend_socket	(PkBackendJob	*job,
 							 const gchar	*frontend_socket);
 void		 pk_backend_job_set_cache_age		(PkBackendJob	*job,
 							 guint		 cache_age);
+void		 pk_backend_job_set_solution_token	(PkBackendJob	*job,
+							 const gchar	*solution_token);
 const gchar	*pk_backend_job_get_proxy_ftp		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_proxy_http		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_proxy_https		(PkBackendJob	*job);
@@ -144,6 +161,7 @@ const gchar	*pk_backend_job_get_pac			(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_locale		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_frontend_socket	(PkBackendJob	*job);
 guint		 pk_backend_job_get_cache_age		(PkBackendJob	*job);
+const gchar	*pk_backend_job_get_solution_token	(PkBackendJob	*job);
 
 /* transaction vfuncs */
 typedef void	 (*PkBackendJobVFunc)			(PkBackendJob	*job,
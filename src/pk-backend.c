@@ -58,12 +58,14 @@ typedef struct {
 	PkBitfield	(*get_provides)			(PkBackend	*backend);
 	gchar		**(*get_mime_types)		(PkBackend	*backend);
 	gboolean	(*supports_parallelization)	(PkBackend	*backend);
+	PkBitfield	(*get_resumable_roles)		(PkBackend	*backend);
 	void		(*job_start)			(PkBackend	*backend,
 							 PkBackendJob	*job);
 	void		(*job_stop)			(PkBackend	*backend,
 							 PkBackendJob	*job);
 	void		(*cancel)			(PkBackend	*backend,
 							 PkBackendJob	*job);
+	void		(*standby)			(PkBackend	*backend);
 	void		(*download_packages)		(PkBackend	*backend,
 							 PkBackendJob	*job,
 							 gchar		**package_ids,
@@ -180,6 +182,14 @@ typedef struct {
 							 PkBitfield	 transaction_flags);
 } PkBackendDesc;
 
+typedef struct {
+	gchar			*token;
+	gchar			*key;
+	gchar			*generation;
+	gpointer		 data;
+	GDestroyNotify		 destroy_func;
+} PkBackendSolution;
+
 struct PkBackendPrivate
 {
 	gboolean		 during_initialize;
@@ -203,6 +213,10 @@ struct PkBackendPrivate
 	guint			 repo_list_changed_id;
 	guint			 installed_db_changed_id;
 	guint			 updates_changed_id;
+	guint			 cache_generation;
+	GHashTable		*results_cache;	/* key:PkResults */
+	PkBackendSolution	*solution;
+	GMutex			 solution_mutex;
 };
 
 G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
@@ -210,6 +224,7 @@ G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
 enum {
 	SIGNAL_REPO_LIST_CHANGED,
 	SIGNAL_UPDATES_CHANGED,
+	SIGNAL_CACHE_INVALIDATED,
 	SIGNAL_LAST
 };
 
@@ -252,6 +267,23 @@ pk_backend_supports_parallelization (PkBackend	*backend)
 	return backend->priv->desc->supports_parallelization (backend);
 }
 
+/**
+ * pk_backend_get_resumable_roles:
+ *
+ * Roles the backend can suspend at a safe point and continue later, rather
+ * than having them cancelled when a foreground transaction arrives.
+ **/
+PkBitfield
+pk_backend_get_resumable_roles (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), 0);
+
+	/* not compulsory */
+	if (backend->priv->desc->get_resumable_roles == NULL)
+		return 0;
+	return backend->priv->desc->get_resumable_roles (backend);
+}
+
 void
 pk_backend_thread_start (PkBackend *backend, PkBackendJob *job, gpointer func)
 {
@@ -512,6 +544,7 @@ pk_backend_load (PkBackend *backend, GError **error)
 		g_module_symbol (handle, "pk_backend_get_groups", (gpointer *)&desc->get_groups);
 		g_module_symbol (handle, "pk_backend_get_mime_types", (gpointer *)&desc->get_mime_types);
 		g_module_symbol (handle, "pk_backend_supports_parallelization", (gpointer *)&desc->supports_parallelization);
+		g_module_symbol (handle, "pk_backend_get_resumable_roles", (gpointer *)&desc->get_resumable_roles);
 		g_module_symbol (handle, "pk_backend_get_packages", (gpointer *)&desc->get_packages);
 		g_module_symbol (handle, "pk_backend_get_repo_list", (gpointer *)&desc->get_repo_list);
 		g_module_symbol (handle, "pk_backend_required_by", (gpointer *)&desc->required_by);
@@ -535,6 +568,7 @@ pk_backend_load (PkBackend *backend, GError **error)
 		g_module_symbol (handle, "pk_backend_search_names", (gpointer *)&desc->search_names);
 		g_module_symbol (handle, "pk_backend_start_job", (gpointer *)&desc->job_start);
 		g_module_symbol (handle, "pk_backend_stop_job", (gpointer *)&desc->job_stop);
+		g_module_symbol (handle, "pk_backend_standby", (gpointer *)&desc->standby);
 		g_module_symbol (handle, "pk_backend_update_packages", (gpointer *)&desc->update_packages);
 		g_module_symbol (handle, "pk_backend_what_provides", (gpointer *)&desc->what_provides);
 		g_module_symbol (handle, "pk_backend_upgrade_system", (gpointer *)&desc->upgrade_system);
@@ -609,6 +643,7 @@ pk_backend_repo_list_changed_cb (gpointer user_data)
 	PkBackend *backend = PK_BACKEND (user_data);
 
 	g_debug ("emitting repo-list-changed");
+	pk_backend_invalidate_results_cache (backend);
 	g_signal_emit (backend, signals [SIGNAL_REPO_LIST_CHANGED], 0);
 	backend->priv->repo_list_changed_id = 0;
 	return FALSE;
@@ -636,6 +671,7 @@ pk_backend_updates_changed (PkBackend *backend)
 	g_return_val_if_fail (pk_is_thread_default (), FALSE);
 
 	g_debug ("emitting updates-changed");
+	pk_backend_invalidate_results_cache (backend);
 	g_signal_emit (backend, signals [SIGNAL_UPDATES_CHANGED], 0);
 	return TRUE;
 }
@@ -668,12 +704,262 @@ pk_backend_updates_changed_delay (PkBackend *backend, guint timeout)
 	return TRUE;
 }
 
+static gchar *
+pk_backend_results_cache_key (PkRoleEnum role, PkBitfield filters, const gchar *locale)
+{
+	return g_strdup_printf ("%s;%" G_GUINT64_FORMAT ";%s",
+				pk_role_enum_to_string (role),
+				filters,
+				locale != NULL ? locale : "");
+}
+
+/**
+ * pk_backend_get_cache_generation:
+ *
+ * The generation changes every time the cached results are dropped, so a
+ * transaction can tell if its results are still current when it finishes.
+ **/
+guint
+pk_backend_get_cache_generation (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), 0);
+	return backend->priv->cache_generation;
+}
+
+/**
+ * pk_backend_invalidate_results_cache:
+ *
+ * Drops the cached GetUpdates and GetPackages results, for instance when a
+ * transaction or a native tool changed the installed packages.
+ **/
+void
+pk_backend_invalidate_results_cache (PkBackend *backend)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+
+	backend->priv->cache_generation++;
+	g_hash_table_remove_all (backend->priv->results_cache);
+	g_debug ("emitting cache-invalidated, generation %u",
+		 backend->priv->cache_generation);
+	g_signal_emit (backend, signals [SIGNAL_CACHE_INVALIDATED], 0);
+}
+
+/**
+ * pk_backend_get_cached_results:
+ *
+ * Return value: (transfer none): the results of the last query with the same
+ * role, filters and locale, or %NULL if they may be out of date
+ **/
+PkResults *
+pk_backend_get_cached_results (PkBackend *backend,
+			       PkRoleEnum role,
+			       PkBitfield filters,
+			       const gchar *locale)
+{
+	g_autofree gchar *key = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+
+	key = pk_backend_results_cache_key (role, filters, locale);
+	return g_hash_table_lookup (backend->priv->results_cache, key);
+}
+
+/**
+ * pk_backend_set_cached_results:
+ * @cache_generation: the generation when the query was started
+ *
+ * Saves the results of a query, unless the cache was invalidated while it
+ * was running.
+ **/
+void
+pk_backend_set_cached_results (PkBackend *backend,
+			       guint cache_generation,
+			       PkRoleEnum role,
+			       PkBitfield filters,
+			       const gchar *locale,
+			       PkResults *results)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	if (cache_generation != backend->priv->cache_generation)
+		return;
+	g_hash_table_insert (backend->priv->results_cache,
+			     pk_backend_results_cache_key (role, filters, locale),
+			     g_object_ref (results));
+}
+
+static void
+pk_backend_solution_free (PkBackendSolution *solution)
+{
+	if (solution->destroy_func != NULL)
+		solution->destroy_func (solution->data);
+	g_free (solution->token);
+	g_free (solution->key);
+	g_free (solution->generation);
+	g_free (solution);
+}
+
+/* the request a solution was made for, ignoring the flags that do not
+ * change what gets solved as the backend applies them at commit time */
+static gchar *
+pk_backend_solution_key (PkBackendJob *job)
+{
+	GString *key;
+	GVariant *params = pk_backend_job_get_parameters (job);
+	PkBitfield transaction_flags = pk_backend_job_get_transaction_flags (job);
+	PkRoleEnum role = pk_backend_job_get_role (job);
+	gsize i;
+
+	if (params == NULL)
+		return NULL;
+	if (role != PK_ROLE_ENUM_INSTALL_PACKAGES &&
+	    role != PK_ROLE_ENUM_INSTALL_FILES &&
+	    role != PK_ROLE_ENUM_REMOVE_PACKAGES &&
+	    role != PK_ROLE_ENUM_UPDATE_PACKAGES)
+		return NULL;
+
+	pk_bitfield_remove (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
+	pk_bitfield_remove (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED);
+	pk_bitfield_remove (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD);
+	key = g_string_new (pk_role_enum_to_string (role));
+	g_string_append_printf (key, ";%" G_GUINT64_FORMAT, transaction_flags);
+
+	/* the first parameter is always the transaction flags */
+	for (i = 1; i < g_variant_n_children (params); i++) {
+		g_autoptr(GVariant) child = g_variant_get_child_value (params, i);
+		g_string_append_c (key, ';');
+		g_variant_print_string (child, key, FALSE);
+	}
+	return g_string_free (key, FALSE);
+}
+
+/**
+ * pk_backend_add_solution:
+ * @job: the simulate job that found the solution
+ * @generation: identifies the state of the installed packages, e.g. the
+ *  rpmdb or dpkg status the solution was found with
+ * @data: (transfer full): the backend specific solution
+ * @destroy_func: used to free @data
+ *
+ * Keeps the dependency solution of a simulate so that the real transaction
+ * for the same request does not have to solve again. Only the last solution
+ * is kept, as clients commit straight after simulating.
+ *
+ * The token is also set on @job, and returned to the client when the
+ * simulate finishes.
+ *
+ * This function can be called on any thread.
+ *
+ * Return value: the token for the solution, or %NULL if the role cannot
+ * reuse solutions, in which case @data has been freed
+ **/
+const gchar *
+pk_backend_add_solution (PkBackend *backend,
+			 PkBackendJob *job,
+			 const gchar *generation,
+			 gpointer data,
+			 GDestroyNotify destroy_func)
+{
+	PkBackendSolution *solution;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autofree gchar *key = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), NULL);
+	g_return_val_if_fail (generation != NULL, NULL);
+
+	key = pk_backend_solution_key (job);
+	if (key == NULL) {
+		if (destroy_func != NULL)
+			destroy_func (data);
+		return NULL;
+	}
+
+	solution = g_new0 (PkBackendSolution, 1);
+	solution->token = g_uuid_string_random ();
+	solution->key = g_steal_pointer (&key);
+	solution->generation = g_strdup (generation);
+	solution->data = data;
+	solution->destroy_func = destroy_func;
+
+	locker = g_mutex_locker_new (&backend->priv->solution_mutex);
+	g_clear_pointer (&backend->priv->solution, pk_backend_solution_free);
+	backend->priv->solution = solution;
+	pk_backend_job_set_solution_token (job, solution->token);
+	return pk_backend_job_get_solution_token (job);
+}
+
+/**
+ * pk_backend_take_solution:
+ * @job: the job doing the real transaction
+ * @generation: identifies the current state of the installed packages
+ *
+ * Gets the solution of the simulate the client passed the token of, if it
+ * was for the same request and nothing changed since. A solution can only
+ * be taken once.
+ *
+ * This function can be called on any thread.
+ *
+ * Return value: (transfer full): the data passed to pk_backend_add_solution(),
+ * or %NULL if the backend has to solve again
+ **/
+gpointer
+pk_backend_take_solution (PkBackend *backend,
+			  PkBackendJob *job,
+			  const gchar *generation)
+{
+	PkBackendSolution *solution;
+	const gchar *token;
+	gpointer data;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autofree gchar *key = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), NULL);
+
+	token = pk_backend_job_get_solution_token (job);
+	if (token == NULL)
+		return NULL;
+
+	locker = g_mutex_locker_new (&backend->priv->solution_mutex);
+	solution = backend->priv->solution;
+	if (solution == NULL || g_strcmp0 (solution->token, token) != 0) {
+		g_debug ("solution %s is not known", token);
+		return NULL;
+	}
+	backend->priv->solution = NULL;
+
+	/* something else was asked for, or the system changed */
+	key = pk_backend_solution_key (job);
+	if (g_strcmp0 (solution->key, key) != 0) {
+		g_debug ("solution %s was for %s, not %s", token, solution->key, key);
+		pk_backend_solution_free (solution);
+		return NULL;
+	}
+	if (g_strcmp0 (solution->generation, generation) != 0) {
+		g_debug ("solution %s is out of date", token);
+		pk_backend_solution_free (solution);
+		return NULL;
+	}
+
+	g_debug ("reusing solution %s", token);
+	data = solution->data;
+	solution->destroy_func = NULL;
+	pk_backend_solution_free (solution);
+	return data;
+}
+
 static gboolean
 pk_backend_installed_db_changed_cb (gpointer user_data)
 {
 	PkBackend *backend = PK_BACKEND (user_data);
 	g_autoptr(GError) error = NULL;
 
+	/* something else changed the installed packages */
+	pk_backend_invalidate_results_cache (backend);
+
 	if (!backend->priv->transaction_in_progress) {
 		g_debug ("invalidating offline updates");
 		if (!pk_offline_auth_invalidate (&error))
@@ -1074,6 +1360,10 @@ pk_backend_finalize (GObject *object)
 	g_mutex_clear (&backend->priv->eulas_mutex);
 	g_mutex_clear (&backend->priv->thread_hash_mutex);
 	g_hash_table_unref (backend->priv->thread_hash);
+	g_hash_table_unref (backend->priv->results_cache);
+	if (backend->priv->solution != NULL)
+		pk_backend_solution_free (backend->priv->solution);
+	g_mutex_clear (&backend->priv->solution_mutex);
 	g_free (backend->priv->desc);
 
 	if (backend->priv->monitor != NULL)
@@ -1104,6 +1394,11 @@ pk_backend_class_init (PkBackendClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
 			      G_TYPE_NONE, 0);
+	signals [SIGNAL_CACHE_INVALIDATED] =
+		g_signal_new ("cache-invalidated",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 
 	g_type_class_add_private (klass, sizeof (PkBackendPrivate));
 }
@@ -1122,10 +1417,73 @@ pk_backend_cancel (PkBackend *backend, PkBackendJob *job)
 		return;
 	g_cancellable_cancel (cancellable);
 
+	/* a cancelled job is no longer waiting to be resumed */
+	if (pk_backend_job_get_suspended (job))
+		pk_backend_resume_job (backend, job);
+
 	/* call into the backend */
 	backend->priv->desc->cancel (backend, job);
 }
 
+/**
+ * pk_backend_suspend_job:
+ *
+ * Pauses a job of a role listed in pk_backend_get_resumable_roles().
+ * The backend thread stops at its next pk_backend_job_check_suspended()
+ * call.
+ */
+void
+pk_backend_suspend_job (PkBackend *backend, PkBackendJob *job)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (pk_is_thread_default ());
+
+	if (pk_backend_job_get_suspended (job))
+		return;
+	pk_backend_job_set_suspended (job, TRUE);
+}
+
+/**
+ * pk_backend_resume_job:
+ *
+ * Continues a job paused with pk_backend_suspend_job().
+ */
+void
+pk_backend_resume_job (PkBackend *backend, PkBackendJob *job)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (pk_is_thread_default ());
+
+	if (!pk_backend_job_get_suspended (job))
+		return;
+	pk_backend_job_set_suspended (job, FALSE);
+}
+
+/**
+ * pk_backend_standby:
+ *
+ * Called when the daemon has been idle for a long time but is configured to
+ * stay running. The results of old queries are dropped, and the backend can
+ * free anything in the optional standby() vfunc it can cheaply recreate, but
+ * should keep whatever makes the first request after waking up fast, e.g.
+ * the loaded package database.
+ */
+void
+pk_backend_standby (PkBackend *backend)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+
+	/* the backend can answer these again from its own caches */
+	g_hash_table_remove_all (backend->priv->results_cache);
+
+	/* optional */
+	if (backend->priv->desc->standby != NULL)
+		backend->priv->desc->standby (backend);
+}
+
 void
 pk_backend_download_packages (PkBackend *backend,
 			      PkBackendJob *job,
@@ -1715,8 +2073,11 @@ pk_backend_init (PkBackend *backend)
 							    g_direct_equal,
 							    NULL,
 							    g_free);
+	backend->priv->results_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+							      g_free, g_object_unref);
 	g_mutex_init (&backend->priv->eulas_mutex);
 	g_mutex_init (&backend->priv->thread_hash_mutex);
+	g_mutex_init (&backend->priv->solution_mutex);
 }
 
 PkBackend *
@@ -33,6 +33,7 @@
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
 #include <packagekit-glib2/pk-bitfield.h>
+#include <packagekit-glib2/pk-results.h>
 
 #include "pk-backend.h"
 #include "pk-backend-job.h"
@@ -90,6 +91,26 @@ void		 pk_backend_installed_db_changed	(PkBackend      *backend);
 gboolean	 pk_backend_updates_changed		(PkBackend	*backend);
 gboolean	 pk_backend_updates_changed_delay	(PkBackend	*backend,
 							 guint		 timeout);
+guint		 pk_backend_get_cache_generation	(PkBackend	*backend);
+void		 pk_backend_invalidate_results_cache	(PkBackend	*backend);
+PkResults	*pk_backend_get_cached_results		(PkBackend	*backend,
+							 PkRoleEnum	 role,
+							 PkBitfield	 filters,
+							 const gchar	*locale);
+void		 pk_backend_set_cached_results		(PkBackend	*backend,
+							 guint		 cache_generation,
+							 PkRoleEnum	 role,
+							 PkBitfield	 filters,
+							 const gchar	*locale,
+							 PkResults	*results);
+const gchar	*pk_backend_add_solution		(PkBackend	*backend,
+							 PkBackendJob	*job,
+							 const gchar	*generation,
+							 gpointer	 data,
+							 GDestroyNotify	 destroy_func);
+gpointer	 pk_backend_take_solution		(PkBackend	*backend,
+							 PkBackendJob	*job,
+							 const gchar	*generation);
 
 void		 pk_backend_transaction_inhibit_start	(PkBackend      *backend);
 void		 pk_backend_transaction_inhibit_end	(PkBackend      *backend);
@@ -119,6 +140,7 @@ PkBitfield	 pk_backend_get_filters			(PkBackend	*backend);
 PkBitfield	 pk_backend_get_roles			(PkBackend	*backend);
 gchar		**pk_backend_get_mime_types		(PkBackend	*backend);
 gboolean	 pk_backend_supports_parallelization	(PkBackend	*backend);
+PkBitfield	 pk_backend_get_resumable_roles		(PkBackend	*backend);
 void		 pk_backend_initialize			(GKeyFile		*conf,
 							 PkBackend	*backend);
 void		 pk_backend_destroy			(PkBackend	*backend);
@@ -128,6 +150,11 @@ void		 pk_backend_stop_job			(PkBackend	*backend,
 							 PkBackendJob	*job);
 void		 pk_backend_cancel			(PkBackend	*backend,
 							 PkBackendJob	*job);
+void		 pk_backend_suspend_job			(PkBackend	*backend,
+							 PkBackendJob	*job);
+void		 pk_backend_resume_job			(PkBackend	*backend,
+							 PkBackendJob	*job);
+void		 pk_backend_standby			(PkBackend	*backend);
 void		 pk_backend_download_packages		(PkBackend	*backend,
 							 PkBackendJob	*job,
 							 gchar		**package_ids,
@@ -39,12 +39,285 @@ struct PkDbusPrivate
 	GDBusProxy		*proxy_pid;
 	GDBusProxy		*proxy_uid;
 	GDBusProxy		*proxy_session;
+	GHashTable		*credentials;	/* sender:PkDbusCredentials */
 };
 
+typedef struct {
+	guint			 uid;
+	guint			 pid;
+	gboolean		 valid;
+	guint			 watch_id;
+	GPtrArray		*tasks;		/* waiting for the reply */
+} PkDbusCredentials;
+
+typedef struct {
+	PkDbus			*dbus;
+	gchar			*sender;
+} PkDbusCredentialsHelper;
+
+enum {
+	SIGNAL_SENDER_VANISHED,
+	SIGNAL_LAST
+};
+
+static guint signals [SIGNAL_LAST] = { 0 };
+
 static gpointer pk_dbus_object = NULL;
 
 G_DEFINE_TYPE (PkDbus, pk_dbus, G_TYPE_OBJECT)
 
+static void
+pk_dbus_credentials_free (PkDbusCredentials *cred)
+{
+	if (cred->watch_id > 0)
+		g_bus_unwatch_name (cred->watch_id);
+	g_ptr_array_unref (cred->tasks);
+	g_free (cred);
+}
+
+static void
+pk_dbus_credentials_fail (PkDbusCredentials *cred, const gchar *sender, const gchar *message)
+{
+	guint i;
+
+	for (i = 0; i < cred->tasks->len; i++) {
+		GTask *task = g_ptr_array_index (cred->tasks, i);
+		g_task_return_new_error (task, 1, 0,
+					 "cannot get credentials for %s: %s",
+					 sender, message);
+	}
+	g_ptr_array_set_size (cred->tasks, 0);
+}
+
+/**
+ * pk_dbus_lookup_credentials:
+ * @dbus: the #PkDbus instance
+ * @sender: the sender
+ * @uid: (out) (allow-none): the process UID
+ * @pid: (out) (allow-none): the process ID
+ *
+ * Gets the credentials of a sender without blocking, if they are already
+ * known from an earlier call to pk_dbus_get_credentials_async().
+ *
+ * Return value: %TRUE if the credentials were known
+ **/
+gboolean
+pk_dbus_lookup_credentials (PkDbus *dbus, const gchar *sender, guint *uid, guint *pid)
+{
+	PkDbusCredentials *cred;
+
+	g_return_val_if_fail (PK_IS_DBUS (dbus), FALSE);
+	g_return_val_if_fail (sender != NULL, FALSE);
+
+	/* set in the test suite */
+	if (g_strcmp0 (sender, ":org.freedesktop.PackageKit") == 0) {
+		if (uid != NULL)
+			*uid = 500;
+		if (pid != NULL)
+			*pid = G_MAXUINT - 1;
+		return TRUE;
+	}
+
+	cred = g_hash_table_lookup (dbus->priv->credentials, sender);
+	if (cred == NULL || !cred->valid)
+		return FALSE;
+	if (uid != NULL)
+		*uid = cred->uid;
+	if (pid != NULL)
+		*pid = cred->pid;
+	return TRUE;
+}
+
+static void
+pk_dbus_sender_vanished_cb (GDBusConnection *connection,
+			    const gchar *name,
+			    gpointer user_data)
+{
+	PkDbus *dbus = PK_DBUS (user_data);
+	PkDbusCredentials *cred;
+
+	/* the unique name is never reused, so forget about it */
+	cred = g_hash_table_lookup (dbus->priv->credentials, name);
+	if (cred != NULL) {
+		pk_dbus_credentials_fail (cred, name, "sender vanished");
+		g_hash_table_remove (dbus->priv->credentials, name);
+	}
+
+	g_debug ("sender %s vanished", name);
+	g_signal_emit (dbus, signals[SIGNAL_SENDER_VANISHED], 0, name);
+}
+
+static void
+pk_dbus_get_credentials_cb (GObject *source_object,
+			    GAsyncResult *res,
+			    gpointer user_data)
+{
+	PkDbusCredentialsHelper *helper = (PkDbusCredentialsHelper *) user_data;
+	PkDbusCredentials *cred;
+	guint i;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) dict = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	value = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+					       res, &error);
+
+	/* the sender vanished before the bus replied */
+	cred = g_hash_table_lookup (helper->dbus->priv->credentials, helper->sender);
+	if (cred == NULL)
+		goto out;
+
+	/* do not cache failures */
+	if (value == NULL) {
+		g_warning ("Failed to get credentials for %s: %s",
+			   helper->sender, error->message);
+		pk_dbus_credentials_fail (cred, helper->sender, error->message);
+		g_hash_table_remove (helper->dbus->priv->credentials, helper->sender);
+		goto out;
+	}
+	dict = g_variant_get_child_value (value, 0);
+	g_variant_lookup (dict, "UnixUserID", "u", &cred->uid);
+	g_variant_lookup (dict, "ProcessID", "u", &cred->pid);
+	cred->valid = TRUE;
+
+	/* wake up everybody that asked while the call was in flight */
+	for (i = 0; i < cred->tasks->len; i++) {
+		GTask *task = g_ptr_array_index (cred->tasks, i);
+		guint *ids = g_new (guint, 2);
+		ids[0] = cred->uid;
+		ids[1] = cred->pid;
+		g_task_return_pointer (task, ids, g_free);
+	}
+	g_ptr_array_set_size (cred->tasks, 0);
+out:
+	g_object_unref (helper->dbus);
+	g_free (helper->sender);
+	g_free (helper);
+}
+
+/**
+ * pk_dbus_get_credentials_async:
+ * @dbus: the #PkDbus instance
+ * @sender: the sender
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets the UID and PID of a sender using a single GetConnectionCredentials
+ * call. The result is cached, and the sender is watched, until the sender
+ * vanishes from the bus; callers asking while the call is in flight share
+ * the same request.
+ **/
+void
+pk_dbus_get_credentials_async (PkDbus *dbus,
+			       const gchar *sender,
+			       GCancellable *cancellable,
+			       GAsyncReadyCallback callback,
+			       gpointer user_data)
+{
+	guint uid;
+	guint pid;
+	PkDbusCredentials *cred;
+	PkDbusCredentialsHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (PK_IS_DBUS (dbus));
+	g_return_if_fail (sender != NULL);
+
+	task = g_task_new (dbus, cancellable, callback, user_data);
+
+	/* already known */
+	if (pk_dbus_lookup_credentials (dbus, sender, &uid, &pid)) {
+		guint *ids = g_new (guint, 2);
+		ids[0] = uid;
+		ids[1] = pid;
+		g_task_return_pointer (task, ids, g_free);
+		return;
+	}
+
+	/* no connection to DBus */
+	if (dbus->priv->connection == NULL) {
+		g_task_return_new_error (task, 1, 0,
+					 "cannot get credentials for %s: not connected",
+					 sender);
+		return;
+	}
+
+	/* a request is already in flight */
+	cred = g_hash_table_lookup (dbus->priv->credentials, sender);
+	if (cred != NULL) {
+		g_ptr_array_add (cred->tasks, g_steal_pointer (&task));
+		return;
+	}
+
+	cred = g_new0 (PkDbusCredentials, 1);
+	cred->uid = G_MAXUINT;
+	cred->pid = G_MAXUINT;
+	cred->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (cred->tasks, g_steal_pointer (&task));
+	g_hash_table_insert (dbus->priv->credentials, g_strdup (sender), cred);
+
+	/* watch the connection once, however many transactions it creates */
+	cred->watch_id =
+		g_bus_watch_name_on_connection (dbus->priv->connection,
+						sender,
+						G_BUS_NAME_WATCHER_FLAGS_NONE,
+						NULL,
+						pk_dbus_sender_vanished_cb,
+						dbus,
+						NULL);
+
+	helper = g_new0 (PkDbusCredentialsHelper, 1);
+	helper->dbus = g_object_ref (dbus);
+	helper->sender = g_strdup (sender);
+	g_dbus_connection_call (dbus->priv->connection,
+				"org.freedesktop.DBus",
+				"/org/freedesktop/DBus",
+				"org.freedesktop.DBus",
+				"GetConnectionCredentials",
+				g_variant_new ("(s)", sender),
+				G_VARIANT_TYPE ("(a{sv})"),
+				G_DBUS_CALL_FLAGS_NONE,
+				2000,
+				NULL,
+				pk_dbus_get_credentials_cb,
+				helper);
+}
+
+/**
+ * pk_dbus_get_credentials_finish:
+ * @dbus: the #PkDbus instance
+ * @res: the #GAsyncResult
+ * @uid: (out) (allow-none): the process UID
+ * @pid: (out) (allow-none): the process ID
+ * @error: a #GError, or %NULL
+ *
+ * Gets the result from pk_dbus_get_credentials_async().
+ *
+ * Return value: %TRUE if the credentials were obtained
+ **/
+gboolean
+pk_dbus_get_credentials_finish (PkDbus *dbus,
+				GAsyncResult *res,
+				guint *uid,
+				guint *pid,
+				GError **error)
+{
+	g_autofree guint *ids = NULL;
+
+	g_return_val_if_fail (PK_IS_DBUS (dbus), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, dbus), FALSE);
+
+	ids = g_task_propagate_pointer (G_TASK (res), error);
+	if (ids == NULL)
+		return FALSE;
+	if (uid != NULL)
+		*uid = ids[0];
+	if (pid != NULL)
+		*pid = ids[1];
+	return TRUE;
+}
+
 /**
  * pk_dbus_get_uid:
  * @dbus: the #PkDbus instance
@@ -69,6 +342,11 @@ pk_dbus_get_uid (PkDbus *dbus, const gchar *sender)
 		g_debug ("using self-check shortcut");
 		return 500;
 	}
+
+	/* already resolved for this connection */
+	if (pk_dbus_lookup_credentials (dbus, sender, &uid, NULL))
+		return uid;
+
 	value = g_dbus_proxy_call_sync (dbus->priv->proxy_uid,
 					"GetConnectionUnixUser",
 					g_variant_new ("(s)",
@@ -111,6 +389,10 @@ pk_dbus_get_pid (PkDbus *dbus, const gchar *sender)
 		return G_MAXUINT - 1;
 	}
 
+	/* already resolved for this connection */
+	if (pk_dbus_lookup_credentials (dbus, sender, NULL, &pid))
+		return pid;
+
 	/* no connection to DBus */
 	if (dbus->priv->proxy_pid == NULL)
 		return G_MAXUINT;
@@ -286,6 +568,7 @@ pk_dbus_finalize (GObject *object)
 		g_object_unref (dbus->priv->proxy_uid);
 	if (dbus->priv->proxy_session != NULL)
 		g_object_unref (dbus->priv->proxy_session);
+	g_hash_table_unref (dbus->priv->credentials);
 
 	G_OBJECT_CLASS (pk_dbus_parent_class)->finalize (object);
 }
@@ -296,6 +579,12 @@ pk_dbus_class_init (PkDbusClass *klass)
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	object_class->finalize = pk_dbus_finalize;
 
+	signals [SIGNAL_SENDER_VANISHED] =
+		g_signal_new ("sender-vanished",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__STRING,
+			      G_TYPE_NONE, 1, G_TYPE_STRING);
+
 	g_type_class_add_private (klass, sizeof (PkDbusPrivate));
 }
 
@@ -376,6 +665,9 @@ static void
 pk_dbus_init (PkDbus *dbus)
 {
 	dbus->priv = PK_DBUS_GET_PRIVATE (dbus);
+	dbus->priv->credentials = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free,
+							 (GDestroyNotify) pk_dbus_credentials_free);
 }
 
 PkDbus *
@@ -23,6 +23,7 @@
 #define __PK_DBUS_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -54,6 +55,20 @@ GType		 pk_dbus_get_type		(void);
 PkDbus		*pk_dbus_new			(void);
 gboolean	 pk_dbus_connect		(PkDbus		*dbus,
 						 GError		**error);
+gboolean	 pk_dbus_lookup_credentials	(PkDbus		*dbus,
+						 const gchar	*sender,
+						 guint		*uid,
+						 guint		*pid);
+void		 pk_dbus_get_credentials_async	(PkDbus		*dbus,
+						 const gchar	*sender,
+						 GCancellable	*cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer	 user_data);
+gboolean	 pk_dbus_get_credentials_finish	(PkDbus		*dbus,
+						 GAsyncResult	*res,
+						 guint		*uid,
+						 guint		*pid,
+						 GError		**error);
 guint		 pk_dbus_get_uid		(PkDbus		*dbus,
 						 const gchar	*sender);
 gchar		*pk_dbus_get_cmdline		(PkDbus		*dbus,
@@ -34,6 +34,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif /* HAVE_UNISTD_H */
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif /* HAVE_MALLOC_TRIM */
 
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
@@ -43,10 +46,12 @@
 #include <packagekit-glib2/pk-version.h>
 #include <polkit/polkit.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
 #include "pk-shared.h"
+#include "pk-stats.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
 #include "pk-scheduler.h"
@@ -78,6 +83,8 @@ struct PkEnginePrivate
 	GNetworkMonitor		*network_monitor;
 	GKeyFile		*conf;
 	PkDbus			*dbus;
+	PkAuthCache		*auth_cache;
+	PkStats			*stats;
 	GFileMonitor		*monitor_conf;
 	GFileMonitor		*monitor_binary;
 	GFileMonitor		*monitor_offline;
@@ -358,6 +365,17 @@ pk_engine_backend_updates_changed_cb (PkBackend *backend, PkEngine *engine)
 				       NULL);
 }
 
+static void
+pk_engine_backend_cache_invalidated_cb (PkBackend *backend, PkEngine *engine)
+{
+	g_return_if_fail (PK_IS_ENGINE (engine));
+
+	/* clients can skip GetUpdates and GetPackages until this changes */
+	pk_engine_emit_property_changed (engine,
+					 "CacheGeneration",
+					 g_variant_new_uint32 (pk_backend_get_cache_generation (backend)));
+}
+
 static gboolean
 pk_engine_state_changed_cb (gpointer data)
 {
@@ -436,6 +454,28 @@ pk_engine_get_seconds_idle (PkEngine *engine)
 	return idle;
 }
 
+/**
+ * pk_engine_standby:
+ *
+ * Frees what the daemon only keeps to answer the next request a little
+ * faster, and returns the freed heap to the kernel, but keeps the backend
+ * loaded. This is the alternative to exiting after ShutdownTimeout, as the
+ * first request after exiting has to load the backend again.
+ **/
+void
+pk_engine_standby (PkEngine *engine)
+{
+	g_return_if_fail (PK_IS_ENGINE (engine));
+	g_return_if_fail (pk_is_thread_default ());
+
+	g_debug ("entering standby");
+	pk_auth_cache_flush (engine->priv->auth_cache);
+	pk_backend_standby (engine->priv->backend);
+#ifdef HAVE_MALLOC_TRIM
+	malloc_trim (0);
+#endif
+}
+
 static gboolean
 pk_engine_set_proxy_internal (PkEngine *engine, const gchar *sender,
 			      const gchar *proxy_http,
@@ -1077,6 +1117,8 @@ pk_engine_daemon_get_property (GDBusConnection *connection_, const gchar *sender
 		return g_variant_new_uint32 (engine->priv->network_state);
 	if (g_strcmp0 (property_name, "DistroId") == 0)
 		return _g_variant_new_maybe_string (engine->priv->distro_id);
+	if (g_strcmp0 (property_name, "CacheGeneration") == 0)
+		return g_variant_new_uint32 (pk_backend_get_cache_generation (engine->priv->backend));
 
 	/* return an error */
 	g_set_error (error,
@@ -1087,173 +1129,39 @@ pk_engine_daemon_get_property (GDBusConnection *connection_, const gchar *sender
 	return NULL;
 }
 
-static gboolean
-pk_engine_package_name_in_strv (gchar **strv, PkPackage *pkg)
-{
-	guint i;
-	for (i = 0; strv[i] != NULL; i++) {
-		if (g_strcmp0 (strv[i], pk_package_get_name (pkg)) == 0)
-			return TRUE;
-	}
-	return FALSE;
-}
-
-static GVariant *
-pk_engine_get_package_history_pkg (PkTransactionPast *item, PkPackage *pkg)
-{
-	GVariantBuilder builder;
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	g_variant_builder_add (&builder, "{sv}", "info",
-			       g_variant_new_uint32 (pk_package_get_info (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "source",
-			       g_variant_new_string (pk_package_get_data (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "version",
-			       g_variant_new_string (pk_package_get_version (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "timestamp",
-			       g_variant_new_uint64 (pk_transaction_past_get_timestamp (item)));
-	g_variant_builder_add (&builder, "{sv}", "user-id",
-			       g_variant_new_uint32 (pk_transaction_past_get_uid (item)));
-	return g_variant_builder_end (&builder);
-}
-
-static gboolean
-pk_engine_is_package_history_interesing (PkPackage *package)
-{
-	gboolean ret;
-
-	switch (pk_package_get_info (package)) {
-	case PK_INFO_ENUM_INSTALLING:
-	case PK_INFO_ENUM_REMOVING:
-	case PK_INFO_ENUM_UPDATING:
-		ret = TRUE;
-		break;
-	default:
-		ret = FALSE;
-		break;
-	}
-	return ret;
-}
-
 static GVariant *
 pk_engine_get_package_history (PkEngine *engine,
 			       gchar **package_names,
 			       guint max_size,
 			       GError **error)
 {
-	const gchar *data;
-	const gchar *pkgname;
-	gboolean ret;
-	gchar *key;
-	gint64 timestamp;
-	GList *l;
-	GList *list;
-	GPtrArray *array = NULL;
 	guint i;
+	GVariant *value;
 	GVariantBuilder builder;
-	GVariant *value = NULL;
-	PkTransactionPast *item;
-	g_autoptr(GHashTable) deduplicate_hash = NULL;
-	g_autoptr(GHashTable) pkgname_hash = NULL;
-	g_autoptr(GList) keys = NULL;
-	g_autoptr(PkPackage) package_tmp = NULL;
-
-	list = pk_transaction_db_get_list (engine->priv->transaction_db, max_size);
-
-	/* simplify the loop */
-	if (max_size == 0)
-		max_size = G_MAXUINT;
-
-	pkgname_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
-	deduplicate_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	package_tmp = pk_package_new ();
-	for (l = list; l != NULL; l = l->next) {
-		g_auto(GStrv) package_lines = NULL;
-		item = PK_TRANSACTION_PAST (l->data);
-
-		/* ignore anything that failed */
-		if (!pk_transaction_past_get_succeeded (item))
-			continue;
 
-		/* split up data */
-		data = pk_transaction_past_get_data (item);
-		if (data == NULL)
+	/* we have a dictionary of pkgname:aa{sv}, newest first */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{saa{sv}}"));
+	for (i = 0; package_names[i] != NULL; i++) {
+
+		/* the name is listed again later */
+		if (g_strv_contains ((const gchar * const *) package_names + i + 1,
+				     package_names[i]))
 			continue;
-		package_lines = g_strsplit (data, "\n", -1);
-		for (i = 0; package_lines[i] != NULL; i++) {
-			g_autoptr(GError) error_local = NULL;
-			ret = pk_package_parse (package_tmp,
-						package_lines[i],
-						&error_local);
-			if (!ret) {
-				g_warning ("Failed to parse package: '%s': %s",
-					   package_lines[i], error_local->message);
-				continue;
-			}
-
-			/* not the package we care about */
-			if (!pk_engine_package_name_in_strv (package_names, package_tmp))
-				continue;
-
-			/* not a state we care about */
-			if (!pk_engine_is_package_history_interesing (package_tmp))
-				continue;
-
-			/* transactions without a timestamp are not interesting */
-			timestamp = pk_transaction_past_get_timestamp (item);
-			if (timestamp == 0)
-				continue;
-
-			/* de-duplicate the entry, in the case of multiarch */
-			key = g_strdup_printf ("%s-%" G_GINT64_FORMAT,
-					       pk_package_get_name (package_tmp),
-					       timestamp);
-			if (g_hash_table_lookup (deduplicate_hash, key) != NULL) {
-				g_free (key);
-				continue;
-			}
-			g_hash_table_insert (deduplicate_hash, key, package_lines[i]);
-
-			/* get the blob for this data item */
-			value = pk_engine_get_package_history_pkg (item, package_tmp);
-			if (value == NULL)
-				continue;
-
-			/* find the array */
-			pkgname = pk_package_get_name (package_tmp);
-			array = g_hash_table_lookup (pkgname_hash, pkgname);
-			if (array == NULL) {
-				array = g_ptr_array_new ();
-				g_hash_table_insert (pkgname_hash,
-						     g_strdup (pkgname),
-						     array);
-			}
-			g_ptr_array_add (array, value);
-		}
-	}
 
-	/* no history returns an empty array */
-	if (g_hash_table_size (pkgname_hash) == 0) {
-		value = g_variant_new_array (G_VARIANT_TYPE ("{saa{sv}}"), NULL, 0);
-		goto out;
-	}
+		value = pk_transaction_db_get_package_history (engine->priv->transaction_db,
+							       package_names[i],
+							       max_size);
+		if (value == NULL)
+			continue;
 
-	/* we have a hash of pkgname:GPtrArray where the GPtrArray is an array
-	 * of GVariants of type a{sv} */
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	keys = g_hash_table_get_keys (pkgname_hash);
-	for (l = keys; l != NULL; l = l->next) {
-		pkgname = l->data;
-		array = g_hash_table_lookup (pkgname_hash, pkgname);
-		/* create aa{sv} */
-		value = g_variant_new_array (NULL,
-					     (GVariant * const *) array->pdata,
-					     MIN (array->len, max_size));
-		g_variant_builder_add (&builder, "{s@aa{sv}}", pkgname, value);
+		/* no history for this package */
+		if (g_variant_n_children (value) == 0) {
+			g_variant_unref (g_variant_ref_sink (value));
+			continue;
+		}
+		g_variant_builder_add (&builder, "{s@aa{sv}}", package_names[i], value);
 	}
-	value = g_variant_builder_end (&builder);
-out:
-	g_list_free_full (list, (GDestroyNotify) g_object_unref);
-	return value;
+	return g_variant_builder_end (&builder);
 }
 
 static void
@@ -1701,6 +1609,115 @@ pk_engine_offline_method_call (GDBusConnection *connection_, const gchar *sender
 	}
 }
 
+typedef enum {
+	PK_ENGINE_DEBUG_ROLE_RESET_STATS,
+	PK_ENGINE_DEBUG_ROLE_STANDBY,
+	PK_ENGINE_DEBUG_ROLE_LAST
+} PkEngineDebugRole;
+
+typedef struct {
+	GDBusMethodInvocation	*invocation;
+	PkEngine		*engine;
+	PkEngineDebugRole	 role;
+} PkEngineDebugAsyncHelper;
+
+static void
+pk_engine_debug_helper_free (PkEngineDebugAsyncHelper *helper)
+{
+	g_object_unref (helper->engine);
+	g_object_unref (helper->invocation);
+	g_free (helper);
+}
+
+static void
+pk_engine_debug_helper_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	PkEngineDebugAsyncHelper *helper = (PkEngineDebugAsyncHelper *) user_data;
+	guint uid = G_MAXUINT;
+	g_autoptr(GError) error = NULL;
+
+	/* finish the call */
+	if (!pk_dbus_get_credentials_finish (PK_DBUS (source), res, &uid, NULL, &error)) {
+		g_dbus_method_invocation_return_error (helper->invocation,
+						       PK_ENGINE_ERROR,
+						       PK_ENGINE_ERROR_DENIED,
+						       "could not get the caller UID: %s",
+						       error->message);
+		pk_engine_debug_helper_free (helper);
+		return;
+	}
+
+	switch (helper->role) {
+	case PK_ENGINE_DEBUG_ROLE_RESET_STATS:
+		/* other users may be looking at the numbers */
+		if (uid != 0) {
+			g_dbus_method_invocation_return_error (helper->invocation,
+							       PK_ENGINE_ERROR,
+							       PK_ENGINE_ERROR_REFUSED_BY_POLICY,
+							       "only root can reset the statistics");
+			pk_engine_debug_helper_free (helper);
+			return;
+		}
+		pk_stats_reset (helper->engine->priv->stats);
+		break;
+	case PK_ENGINE_DEBUG_ROLE_STANDBY:
+		/* the benchmark runs the daemon as the user running it */
+		if (uid != 0 && uid != getuid ()) {
+			g_dbus_method_invocation_return_error (helper->invocation,
+							       PK_ENGINE_ERROR,
+							       PK_ENGINE_ERROR_REFUSED_BY_POLICY,
+							       "only root can put the daemon in standby");
+			pk_engine_debug_helper_free (helper);
+			return;
+		}
+		pk_engine_standby (helper->engine);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+
+	g_dbus_method_invocation_return_value (helper->invocation, NULL);
+	pk_engine_debug_helper_free (helper);
+}
+
+static void
+pk_engine_debug_method_call (GDBusConnection *connection_, const gchar *sender,
+			     const gchar *object_path, const gchar *interface_name,
+			     const gchar *method_name, GVariant *parameters,
+			     GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	PkEngine *engine = PK_ENGINE (user_data);
+	PkEngineDebugAsyncHelper *helper;
+
+	g_return_if_fail (PK_IS_ENGINE (engine));
+
+	if (g_strcmp0 (method_name, "GetStats") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       pk_stats_get_variant (engine->priv->stats));
+		return;
+	}
+	if (g_strcmp0 (method_name, "ResetStats") == 0) {
+		helper = g_new0 (PkEngineDebugAsyncHelper, 1);
+		helper->engine = g_object_ref (engine);
+		helper->role = PK_ENGINE_DEBUG_ROLE_RESET_STATS;
+		helper->invocation = g_object_ref (invocation);
+		pk_dbus_get_credentials_async (engine->priv->dbus, sender, NULL,
+					       pk_engine_debug_helper_cb,
+					       helper);
+		return;
+	}
+	if (g_strcmp0 (method_name, "Standby") == 0) {
+		helper = g_new0 (PkEngineDebugAsyncHelper, 1);
+		helper->engine = g_object_ref (engine);
+		helper->role = PK_ENGINE_DEBUG_ROLE_STANDBY;
+		helper->invocation = g_object_ref (invocation);
+		pk_dbus_get_credentials_async (engine->priv->dbus, sender, NULL,
+					       pk_engine_debug_helper_cb,
+					       helper);
+		return;
+	}
+}
+
 #ifdef HAVE_SYSTEMD_SD_LOGIN_H
 static void
 pk_engine_proxy_logind_cb (GObject *source_object,
@@ -1733,6 +1750,11 @@ pk_engine_on_bus_acquired_cb (GDBusConnection *connection,
 		pk_engine_offline_get_property,
 		NULL
 	};
+	static const GDBusInterfaceVTable iface_debug_vtable = {
+		pk_engine_debug_method_call,
+		NULL,
+		NULL
+	};
 
 	/* save copy for emitting signals */
 	engine->priv->connection = g_object_ref (connection);
@@ -1767,6 +1789,14 @@ pk_engine_on_bus_acquired_cb (GDBusConnection *connection,
 							     NULL,  /* user_data_free_func */
 							     NULL); /* GError** */
 	g_assert (registration_id > 0);
+	registration_id = g_dbus_connection_register_object (connection,
+							     PK_DBUS_PATH,
+							     engine->priv->introspection->interfaces[2],
+							     &iface_debug_vtable,
+							     engine,  /* user_data */
+							     NULL,  /* user_data_free_func */
+							     NULL); /* GError** */
+	g_assert (registration_id > 0);
 }
 
 
@@ -1826,6 +1856,12 @@ pk_engine_init (PkEngine *engine)
 	/* we need the uid and the session for the proxy setting mechanism */
 	engine->priv->dbus = pk_dbus_new ();
 
+	/* keep recent polkit results alive between transactions */
+	engine->priv->auth_cache = pk_auth_cache_new ();
+
+	/* collect transaction timings for the Debug interface */
+	engine->priv->stats = pk_stats_new ();
+
 	/* we need to be able to clear this */
 	engine->priv->timeout_priority_id = 0;
 	engine->priv->timeout_normal_id = 0;
@@ -1904,6 +1940,8 @@ pk_engine_finalize (GObject *object)
 	g_object_unref (engine->priv->backend);
 	g_key_file_unref (engine->priv->conf);
 	g_object_unref (engine->priv->dbus);
+	g_object_unref (engine->priv->auth_cache);
+	g_object_unref (engine->priv->stats);
 	g_strfreev (engine->priv->mime_types);
 	g_free (engine->priv->distro_id);
 
@@ -1921,7 +1959,11 @@ pk_engine_new (GKeyFile *conf)
 			  G_CALLBACK (pk_engine_backend_repo_list_changed_cb), engine);
 	g_signal_connect (engine->priv->backend, "updates-changed",
 			  G_CALLBACK (pk_engine_backend_updates_changed_cb), engine);
-	engine->priv->scheduler = pk_scheduler_new (engine->priv->conf);
+	g_signal_connect (engine->priv->backend, "cache-invalidated",
+			  G_CALLBACK (pk_engine_backend_cache_invalidated_cb), engine);
+	engine->priv->scheduler = pk_scheduler_new (engine->priv->conf,
+						    engine->priv->dbus,
+						    engine->priv->transaction_db);
 	pk_scheduler_set_backend (engine->priv->scheduler,
 				  engine->priv->backend);
 	g_signal_connect (engine->priv->scheduler, "changed",
@@ -75,6 +75,7 @@ GType		 pk_engine_get_type		  	(void);
 PkEngine	*pk_engine_new				(GKeyFile		*conf);
 
 guint		 pk_engine_get_seconds_idle		(PkEngine	*engine);
+void		 pk_engine_standby			(PkEngine	*engine);
 gboolean	 pk_engine_load_backend			(PkEngine	*engine,
 							 GError		**error);
 
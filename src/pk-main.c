@@ -42,6 +42,8 @@ typedef struct {
 	PkEngine	*engine;
 	guint		 exit_idle_time;
 	guint		 timer_id;
+	gboolean	 standby_when_idle;
+	gboolean	 in_standby;
 } PkMainHelper;
 
 /**
@@ -65,12 +67,22 @@ pk_main_timeout_check_cb (PkMainHelper *helper)
 	guint idle;
 	idle = pk_engine_get_seconds_idle (helper->engine);
 	g_debug ("idle is %i", idle);
-	if (idle > helper->exit_idle_time) {
-		g_main_loop_quit (helper->loop);
-		helper->timer_id = 0;
-		return FALSE;
+	if (idle <= helper->exit_idle_time) {
+		helper->in_standby = FALSE;
+		return TRUE;
 	}
-	return TRUE;
+
+	/* still exit when the daemon has been updated and has to restart */
+	if (helper->standby_when_idle && idle != G_MAXUINT) {
+		if (!helper->in_standby) {
+			pk_engine_standby (helper->engine);
+			helper->in_standby = TRUE;
+		}
+		return TRUE;
+	}
+	g_main_loop_quit (helper->loop);
+	helper->timer_id = 0;
+	return FALSE;
 }
 
 static void
@@ -102,9 +114,11 @@ main (int argc, char *argv[])
 	gboolean immediate_exit = FALSE;
 	gboolean keep_environment = FALSE;
 	gint exit_idle_time;
+	gboolean standby_when_idle = FALSE;
 	g_autoptr(GError) error = NULL;
 	g_autofree gchar *backend_name = NULL;
 	g_autofree gchar *conf_filename = NULL;
+	g_autofree gchar *idle_policy = NULL;
 	g_autoptr(GKeyFile) conf = NULL;
 	g_autoptr(PkEngine) engine = NULL;
 
@@ -182,6 +196,14 @@ main (int argc, char *argv[])
 		exit_idle_time = 300;
 	g_debug ("daemon shutdown set to %i seconds", exit_idle_time);
 
+	/* or should we just free what we can? */
+	idle_policy = g_key_file_get_string (conf, "Daemon", "IdlePolicy", NULL);
+	if (g_strcmp0 (idle_policy, "standby") == 0) {
+		standby_when_idle = TRUE;
+	} else if (idle_policy != NULL && g_strcmp0 (idle_policy, "exit") != 0) {
+		g_warning ("unknown IdlePolicy '%s', using 'exit'", idle_policy);
+	}
+
 	/* override the backend name */
 	if (backend_name != NULL) {
 		g_key_file_set_string (conf,
@@ -231,6 +253,8 @@ main (int argc, char *argv[])
 	if (exit_idle_time > 0 && !disable_timer) {
 		helper.engine = engine;
 		helper.exit_idle_time = exit_idle_time;
+		helper.standby_when_idle = standby_when_idle;
+		helper.in_standby = FALSE;
 		helper.loop = loop;
 		helper.timer_id = g_timeout_add_seconds (5, (GSourceFunc) pk_main_timeout_check_cb, &helper);
 		g_source_set_name_by_id (helper.timer_id, "[PkMain] main poll");
@@ -92,7 +92,10 @@ struct PkSchedulerPrivate
 	guint			 unwedge_id;
 	GKeyFile		*conf;
 	PkBackend		*backend;
+	PkDbus			*dbus;
+	PkTransactionDb		*transaction_db;
 	GDBusNodeInfo		*introspection;
+	GDBusConnection		*connection;
 };
 
 typedef struct {
@@ -105,7 +108,7 @@ typedef struct {
 	gulong			 finished_id;
 	gulong			 state_changed_id;
 	gulong			 allow_cancel_changed_id;
-	guint			 uid;
+	gulong			 uid_known_id;
 	guint			 tries;
 } PkSchedulerItem;
 
@@ -198,6 +201,8 @@ pk_scheduler_item_free (PkSchedulerItem *item)
 		g_signal_handler_disconnect (item->transaction, item->state_changed_id);
 	if (item->allow_cancel_changed_id != 0)
 		g_signal_handler_disconnect (item->transaction, item->allow_cancel_changed_id);
+	if (item->uid_known_id != 0)
+		g_signal_handler_disconnect (item->transaction, item->uid_known_id);
 	g_object_unref (item->transaction);
 	if (item->commit_id != 0)
 		g_source_remove (item->commit_id);
@@ -438,6 +443,77 @@ out:
 	return item;
 }
 
+/* suspend what can be resumed later, and cancel the rest */
+static void
+pk_scheduler_preempt_background (PkScheduler *scheduler, PkSchedulerItem *foreground)
+{
+	guint i;
+	gboolean can_suspend;
+	PkSchedulerItem *item;
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* an exclusive transaction would wait for the suspended one forever */
+	can_suspend = pk_backend_supports_parallelization (scheduler->priv->backend) &&
+		      !pk_transaction_is_exclusive (foreground->transaction);
+
+	array = pk_scheduler_get_active_transactions (scheduler);
+	for (i = 0; i < array->len; i++) {
+		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (!pk_transaction_get_background (item->transaction))
+			continue;
+		if (can_suspend && pk_transaction_suspend (item->transaction)) {
+			g_debug ("suspended background transaction %s", item->tid);
+			continue;
+		}
+		g_debug ("cancelling running background transaction %s", item->tid);
+		pk_transaction_cancel_bg (item->transaction);
+	}
+}
+
+/* resume suspended background transactions once no foreground work is left */
+static void
+pk_scheduler_resume_background (PkScheduler *scheduler)
+{
+	guint i;
+	GPtrArray *array = scheduler->priv->array;
+	PkSchedulerItem *item;
+	PkTransactionState state;
+
+	for (i = 0; i < array->len; i++) {
+		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (pk_transaction_get_background (item->transaction))
+			continue;
+		state = pk_transaction_get_state (item->transaction);
+		if (state == PK_TRANSACTION_STATE_READY ||
+		    state == PK_TRANSACTION_STATE_RUNNING)
+			return;
+	}
+	for (i = 0; i < array->len; i++) {
+		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (!pk_transaction_get_suspended (item->transaction))
+			continue;
+		g_debug ("resuming background transaction %s", item->tid);
+		pk_transaction_resume (item->transaction);
+	}
+}
+
+/* a suspended transaction may be holding the lock another one needs */
+static void
+pk_scheduler_cancel_suspended (PkScheduler *scheduler)
+{
+	guint i;
+	GPtrArray *array = scheduler->priv->array;
+	PkSchedulerItem *item;
+
+	for (i = 0; i < array->len; i++) {
+		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (!pk_transaction_get_suspended (item->transaction))
+			continue;
+		g_debug ("cancelling suspended transaction %s", item->tid);
+		pk_transaction_cancel_bg (item->transaction);
+	}
+}
+
 static void
 pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 {
@@ -469,9 +545,9 @@ pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 	 * transaction foreground? */
 	if (!pk_transaction_get_background (item->transaction) &&
 	    pk_scheduler_get_background_running (scheduler)) {
-		g_debug ("cancelling running background transactions and instead running %s",
+		g_debug ("preempting running background transactions and instead running %s",
 			item->tid);
-		pk_scheduler_cancel_background (scheduler);
+		pk_scheduler_preempt_background (scheduler, item);
 	}
 
 	/* do the transaction now, if possible */
@@ -534,6 +610,9 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 		/* increase the number of tries */
 		item->tries++;
 
+		/* don't keep the lock from the transaction that needs it */
+		pk_scheduler_cancel_suspended (scheduler);
+
 		g_debug ("transaction finished and requires lock now, attempt %i", item->tries);
 
 		if (item->tries > PK_SCHEDULER_MAX_LOCK_RETRIES) {
@@ -570,6 +649,9 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 		pk_scheduler_run_item (scheduler, item);
 	}
 
+	/* continue the background work the foreground work preempted */
+	pk_scheduler_resume_background (scheduler);
+
 	/* we have changed what is running */
 	g_signal_emit (scheduler, signals [PK_SCHEDULER_CHANGED], 0);
 }
@@ -597,12 +679,31 @@ pk_scheduler_get_number_transactions_for_uid (PkScheduler *scheduler, guint uid)
 	array = scheduler->priv->array;
 	for (i = 0; i < array->len; i++) {
 		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
-		if (item->uid == uid)
+		if (pk_transaction_get_uid (item->transaction) == uid)
 			count++;
 	}
 	return count;
 }
 
+static void
+pk_scheduler_transaction_uid_known_cb (PkTransaction *transaction,
+				       guint uid,
+				       PkScheduler *scheduler)
+{
+	guint count;
+	g_autofree gchar *reason = NULL;
+
+	/* the same limit as in pk_scheduler_create(), not counting this one */
+	count = pk_scheduler_get_number_transactions_for_uid (scheduler, uid) - 1;
+	if (count <= PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID)
+		return;
+	reason = g_strdup_printf ("failed to allocate %s as uid %u already has "
+				  "%u transactions in progress",
+				  pk_transaction_get_tid (transaction), uid, count);
+	g_warning ("%s", reason);
+	pk_transaction_refuse (transaction, reason);
+}
+
 gboolean
 pk_scheduler_create (PkScheduler *scheduler,
 			    const gchar *tid,
@@ -610,6 +711,7 @@ pk_scheduler_create (PkScheduler *scheduler,
 			    GError **error)
 {
 	guint count;
+	guint uid;
 	gboolean ret = FALSE;
 	PkSchedulerItem *item;
 
@@ -629,7 +731,9 @@ pk_scheduler_create (PkScheduler *scheduler,
 	item->scheduler = g_object_ref (scheduler);
 	item->tid = g_strdup (tid);
 	item->transaction = pk_transaction_new (scheduler->priv->conf,
-						scheduler->priv->introspection);
+						scheduler->priv->introspection,
+						scheduler->priv->dbus,
+						scheduler->priv->transaction_db);
 	item->finished_id =
 		g_signal_connect_after (item->transaction, "finished",
 					G_CALLBACK (pk_scheduler_transaction_finished_cb),
@@ -642,12 +746,27 @@ pk_scheduler_create (PkScheduler *scheduler,
 		g_signal_connect_after (item->transaction, "allow-cancel-changed",
 					G_CALLBACK (pk_scheduler_transaction_allow_cancel_changed_cb),
 					scheduler);
+	item->uid_known_id =
+		g_signal_connect (item->transaction, "uid-known",
+				  G_CALLBACK (pk_scheduler_transaction_uid_known_cb),
+				  scheduler);
 
 	/* set transaction state */
 	pk_transaction_set_state (item->transaction, PK_TRANSACTION_STATE_NEW);
 
+	/* all transactions share the one connection */
+	if (scheduler->priv->connection == NULL) {
+		scheduler->priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+		if (scheduler->priv->connection == NULL) {
+			pk_scheduler_item_free (item);
+			return FALSE;
+		}
+	}
+
 	/* set the TID on the transaction */
-	ret = pk_transaction_set_tid (item->transaction, item->tid);
+	ret = pk_transaction_set_tid (item->transaction,
+				      scheduler->priv->connection,
+				      item->tid);
 	if (!ret) {
 		g_set_error (error, 1, 0, "failed to set TID: %s", tid);
 		return FALSE;
@@ -668,18 +787,22 @@ pk_scheduler_create (PkScheduler *scheduler,
 					    scheduler->priv->backend);
 	}
 
-	/* get the uid for the transaction */
-	item->uid = pk_transaction_get_uid (item->transaction);
+	/* get the uid for the transaction, which is only known here if the
+	 * sender already created a transaction on the same connection, else
+	 * the limit is checked when the transaction emits ::uid-known */
+	uid = pk_transaction_get_uid (item->transaction);
 
 	/* find out the number of transactions this uid already has in progress */
-	count = pk_scheduler_get_number_transactions_for_uid (scheduler, item->uid);
+	count = 0;
+	if (uid != G_MAXUINT)
+		count = pk_scheduler_get_number_transactions_for_uid (scheduler, uid);
 
 	/* would this take us over the maximum number of requests allowed */
 	if (count > PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID) {
 		g_set_error (error, 1, 0,
 			     "failed to allocate %s as uid %i already has "
 			     "%i transactions in progress",
-			     tid, item->uid, count);
+			     tid, uid, count);
 		/* free transaction, as it's never going to be added */
 		pk_scheduler_item_free (item);
 		return FALSE;
@@ -1041,6 +1164,8 @@ pk_scheduler_finalize (GObject *object)
 
 	if (scheduler->priv->unwedge_id != 0)
 		g_source_remove (scheduler->priv->unwedge_id);
+	if (scheduler->priv->connection != NULL)
+		g_object_unref (scheduler->priv->connection);
 
 	g_ptr_array_foreach (scheduler->priv->array, (GFunc) pk_scheduler_item_free, NULL);
 	g_ptr_array_free (scheduler->priv->array, TRUE);
@@ -1048,15 +1173,25 @@ pk_scheduler_finalize (GObject *object)
 	g_key_file_unref (scheduler->priv->conf);
 	if (scheduler->priv->backend != NULL)
 		g_object_unref (scheduler->priv->backend);
+	g_object_unref (scheduler->priv->dbus);
+	g_object_unref (scheduler->priv->transaction_db);
 
 	G_OBJECT_CLASS (pk_scheduler_parent_class)->finalize (object);
 }
 
+/**
+ * pk_scheduler_new:
+ *
+ * The @dbus and @transaction_db instances are handed to every transaction
+ * the scheduler creates, so they are only connected and loaded once.
+ */
 PkScheduler *
-pk_scheduler_new (GKeyFile *conf)
+pk_scheduler_new (GKeyFile *conf, PkDbus *dbus, PkTransactionDb *transaction_db)
 {
 	PkScheduler *scheduler = PK_SCHEDULER (g_object_new (PK_TYPE_SCHEDULER, NULL));
 	scheduler->priv->conf = g_key_file_ref (conf);
+	scheduler->priv->dbus = g_object_ref (dbus);
+	scheduler->priv->transaction_db = g_object_ref (transaction_db);
 	return scheduler;
 }
 
@@ -56,7 +56,9 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkScheduler, g_object_unref)
 #endif
 
 GType		 pk_scheduler_get_type	  	(void);
-PkScheduler	*pk_scheduler_new		(GKeyFile	*conf);
+PkScheduler	*pk_scheduler_new		(GKeyFile	*conf,
+						 PkDbus		*dbus,
+						 PkTransactionDb *transaction_db);
 
 gboolean	 pk_scheduler_create		(PkScheduler	*scheduler,
 						 const gchar	*tid,
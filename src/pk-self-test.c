@@ -21,15 +21,18 @@
 
 #include <config.h>
 
+#include <string.h>
 #include <glib.h>
 #include <glib-object.h>
 #include <glib/gstdio.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
 #include "pk-backend-spawn.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
 #include "pk-spawn.h"
+#include "pk-stats.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
 #include "pk-transaction-private.h"
@@ -132,6 +135,28 @@ pk_test_backend_func_immediate_false (PkBackendJob *job,
 {
 }
 
+static PkBackendJob *
+pk_test_backend_solution_job_new (GKeyFile *conf, PkBitfield transaction_flags, const gchar *package_id)
+{
+	PkBackendJob *job;
+	const gchar *package_ids[] = { package_id, NULL };
+
+	job = pk_backend_job_new (conf);
+	pk_backend_job_set_role (job, PK_ROLE_ENUM_INSTALL_PACKAGES);
+	pk_backend_job_set_transaction_flags (job, transaction_flags);
+	pk_backend_job_set_parameters (job, g_variant_new ("(t^as)",
+							   transaction_flags,
+							   package_ids));
+	return job;
+}
+
+static void
+pk_test_backend_solution_free_cb (gpointer data)
+{
+	guint *freed = data;
+	(*freed)++;
+}
+
 static void
 pk_test_backend_package_cb (PkBackend *backend, PkPackage *package, gpointer user_data)
 {
@@ -147,8 +172,13 @@ pk_test_backend_func (void)
 	const gchar *filename;
 	GError *error = NULL;
 	g_autoptr(GKeyFile) conf = NULL;
+	guint generation;
+	guint solution_freed = 0;
 	g_autoptr(PkBackend) backend = NULL;
 	g_autoptr(PkBackendJob) job = NULL;
+	g_autoptr(PkBackendJob) simulate_job = NULL;
+	g_autoptr(PkBackendJob) commit_job = NULL;
+	g_autoptr(PkResults) results = NULL;
 
 	/* get an backend */
 	conf = g_key_file_new ();
@@ -227,6 +257,70 @@ pk_test_backend_func (void)
 	text = pk_backend_get_name (backend);
 	g_assert_cmpstr (text, ==, "dummy");
 
+	/* cache results for a role, filter and locale */
+	results = pk_results_new ();
+	generation = pk_backend_get_cache_generation (backend);
+	pk_backend_set_cached_results (backend, generation, PK_ROLE_ENUM_GET_UPDATES,
+				       0, "en_GB.utf8", results);
+	g_assert (pk_backend_get_cached_results (backend, PK_ROLE_ENUM_GET_UPDATES,
+						 0, "en_GB.utf8") == results);
+	g_assert (pk_backend_get_cached_results (backend, PK_ROLE_ENUM_GET_UPDATES,
+						 0, "de_DE.utf8") == NULL);
+
+	/* the cache is dropped when the updates change */
+	pk_backend_updates_changed (backend);
+	g_assert_cmpint (pk_backend_get_cache_generation (backend), ==, generation + 1);
+	g_assert (pk_backend_get_cached_results (backend, PK_ROLE_ENUM_GET_UPDATES,
+						 0, "en_GB.utf8") == NULL);
+
+	/* results from before the change are not saved */
+	pk_backend_set_cached_results (backend, generation, PK_ROLE_ENUM_GET_UPDATES,
+				       0, "en_GB.utf8", results);
+	g_assert (pk_backend_get_cached_results (backend, PK_ROLE_ENUM_GET_UPDATES,
+						 0, "en_GB.utf8") == NULL);
+
+	/* standby drops the cache without changing the generation */
+	generation = pk_backend_get_cache_generation (backend);
+	pk_backend_set_cached_results (backend, generation, PK_ROLE_ENUM_GET_UPDATES,
+				       0, "en_GB.utf8", results);
+	pk_backend_standby (backend);
+	g_assert_cmpint (pk_backend_get_cache_generation (backend), ==, generation);
+	g_assert (pk_backend_get_cached_results (backend, PK_ROLE_ENUM_GET_UPDATES,
+						 0, "en_GB.utf8") == NULL);
+
+	/* keep the solution of a simulate */
+	simulate_job = pk_test_backend_solution_job_new (conf,
+							 pk_bitfield_from_enums (PK_TRANSACTION_FLAG_ENUM_SIMULATE,
+										 PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED,
+										 -1),
+							 "vips-doc;7.12.4-2.fc8;noarch;linva");
+	text = pk_backend_add_solution (backend, simulate_job, "1", &solution_freed,
+					pk_test_backend_solution_free_cb);
+	g_assert (text != NULL);
+	g_assert_cmpstr (pk_backend_job_get_solution_token (simulate_job), ==, text);
+
+	/* a different request or a changed system cannot use it */
+	commit_job = pk_test_backend_solution_job_new (conf, 0, "vips;7.12.4-2.fc8;noarch;linva");
+	pk_backend_job_set_solution_token (commit_job, text);
+	g_assert (pk_backend_take_solution (backend, commit_job, "1") == NULL);
+	g_assert_cmpint (solution_freed, ==, 1);
+	g_object_unref (commit_job);
+
+	text = pk_backend_add_solution (backend, simulate_job, "1", &solution_freed,
+					pk_test_backend_solution_free_cb);
+	commit_job = pk_test_backend_solution_job_new (conf, 0, "vips-doc;7.12.4-2.fc8;noarch;linva");
+	pk_backend_job_set_solution_token (commit_job, text);
+	g_assert (pk_backend_take_solution (backend, commit_job, "2") == NULL);
+	g_assert_cmpint (solution_freed, ==, 2);
+
+	/* the real transaction takes it, without only-trusted, once */
+	text = pk_backend_add_solution (backend, simulate_job, "1", &solution_freed,
+					pk_test_backend_solution_free_cb);
+	pk_backend_job_set_solution_token (commit_job, text);
+	g_assert (pk_backend_take_solution (backend, commit_job, "1") == &solution_freed);
+	g_assert (pk_backend_take_solution (backend, commit_job, "1") == NULL);
+	g_assert_cmpint (solution_freed, ==, 2);
+
 	/* unlock an valid backend */
 	ret = pk_backend_unload (backend);
 	g_assert (ret);
@@ -287,6 +381,198 @@ pk_test_backend_func (void)
 
 static guint _backend_spawn_number_packages = 0;
 
+static void
+pk_test_backend_cancel_hook_cb (PkBackendJob *job, gpointer user_data)
+{
+	guint *called = (guint *) user_data;
+	(*called)++;
+}
+
+static void
+pk_test_backend_cancel_hook_free_cb (gpointer user_data)
+{
+	guint *called = (guint *) user_data;
+	(*called) += 100;
+}
+
+static gboolean
+pk_test_backend_cancel_cb (gpointer user_data)
+{
+	PkBackendJob *job = PK_BACKEND_JOB (user_data);
+	g_test_timer_start ();
+	pk_backend_cancel (pk_backend_job_get_backend (job), job);
+	return FALSE;
+}
+
+static void
+pk_test_backend_cancel_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	gulong hook_id;
+	guint called = 0;
+	guint cancel_id;
+	guint i;
+	GError *error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+	/* only roles that are still running when Cancel() arrives */
+	const PkRoleEnum roles[] = { PK_ROLE_ENUM_SEARCH_NAME,
+				     PK_ROLE_ENUM_REFRESH_CACHE,
+				     PK_ROLE_ENUM_INSTALL_PACKAGES,
+				     PK_ROLE_ENUM_UNKNOWN };
+
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
+	backend = pk_backend_new (conf);
+	ret = pk_backend_load (backend, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* hooks run once, when the job is cancelled */
+	for (i = 0; i < 2; i++) {
+		g_autoptr(PkBackendJob) job = pk_backend_job_new (conf);
+		called = 0;
+		hook_id = pk_backend_job_add_cancel_hook (job,
+							  pk_test_backend_cancel_hook_cb,
+							  &called,
+							  pk_test_backend_cancel_hook_free_cb);
+		g_assert_cmpint (hook_id, !=, 0);
+		g_assert_cmpint (called, ==, 0);
+
+		/* a removed hook is never called */
+		if (i == 1) {
+			pk_backend_job_remove_cancel_hook (job, hook_id);
+			g_assert_cmpint (called, ==, 100);
+		}
+		g_cancellable_cancel (pk_backend_job_get_cancellable (job));
+		g_assert_cmpint (called, ==, i == 0 ? 1 : 100);
+		g_assert (pk_backend_job_wait_cancelled (job, 5000));
+
+		/* adding one to a cancelled job calls it straight away */
+		called = 0;
+		hook_id = pk_backend_job_add_cancel_hook (job,
+							  pk_test_backend_cancel_hook_cb,
+							  &called,
+							  pk_test_backend_cancel_hook_free_cb);
+		g_assert_cmpint (hook_id, ==, 0);
+		g_assert_cmpint (called, ==, 101);
+	}
+
+	/* the time from Cancel() to Finished for each role */
+	for (i = 0; roles[i] != PK_ROLE_ENUM_UNKNOWN; i++) {
+		g_auto(GStrv) values = g_strsplit ("power", ";", -1);
+		g_auto(GStrv) package_ids = g_strsplit ("gtkhtml2;2.19.1-4.fc8;i386;fedora", "|", -1);
+		g_autoptr(PkBackendJob) job = pk_backend_job_new (conf);
+
+		pk_backend_job_set_vfunc (job,
+					  PK_BACKEND_SIGNAL_FINISHED,
+					  (PkBackendJobVFunc) pk_test_backend_finished_cb,
+					  NULL);
+		pk_backend_start_job (backend, job);
+		switch (roles[i]) {
+		case PK_ROLE_ENUM_SEARCH_NAME:
+			pk_backend_search_names (backend, job, 0, values);
+			break;
+		case PK_ROLE_ENUM_REFRESH_CACHE:
+			pk_backend_refresh_cache (backend, job, FALSE);
+			break;
+		case PK_ROLE_ENUM_INSTALL_PACKAGES:
+			pk_backend_install_packages (backend, job, 0, package_ids);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+		g_test_timer_start ();
+		cancel_id = g_timeout_add (100, pk_test_backend_cancel_cb, job);
+		_g_test_loop_run_with_timeout (5000);
+		elapsed = g_test_timer_elapsed ();
+
+		/* the job must not be cancelled after it is freed */
+		if (g_main_context_find_source_by_id (NULL, cancel_id) != NULL)
+			g_source_remove (cancel_id);
+		pk_backend_stop_job (backend, job);
+
+		g_test_message ("time to cancel %s: %.1fms",
+				pk_role_enum_to_string (roles[i]), elapsed * 1000);
+		g_assert (pk_backend_job_has_set_error_code (job));
+	}
+}
+
+static void
+pk_test_backend_percentage_cb (PkBackendJob *job, guint percentage, gpointer user_data)
+{
+	guint *last = (guint *) user_data;
+	*last = percentage;
+}
+
+static void
+pk_test_backend_suspend_func (void)
+{
+	gboolean ret;
+	guint i;
+	guint percentage = 0;
+	guint percentage_suspended;
+	GError *error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
+	backend = pk_backend_new (conf);
+	ret = pk_backend_load (backend, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (pk_bitfield_contain (pk_backend_get_resumable_roles (backend),
+				       PK_ROLE_ENUM_REFRESH_CACHE));
+
+	/* suspend a refresh, then resume it and then cancel it while suspended */
+	for (i = 0; i < 2; i++) {
+		g_autoptr(PkBackendJob) job = pk_backend_job_new (conf);
+
+		pk_backend_job_set_vfunc (job,
+					  PK_BACKEND_SIGNAL_PERCENTAGE,
+					  (PkBackendJobVFunc) pk_test_backend_percentage_cb,
+					  &percentage);
+		pk_backend_job_set_vfunc (job,
+					  PK_BACKEND_SIGNAL_FINISHED,
+					  (PkBackendJobVFunc) pk_test_backend_finished_cb,
+					  NULL);
+		pk_backend_start_job (backend, job);
+		pk_backend_refresh_cache (backend, job, FALSE);
+		_g_test_loop_wait (600);
+		g_assert_cmpint (percentage, >, 0);
+
+		/* nothing happens after the next safe point */
+		pk_backend_suspend_job (backend, job);
+		g_assert (pk_backend_job_get_suspended (job));
+		_g_test_loop_wait (600);
+		percentage_suspended = percentage;
+		_g_test_loop_wait (1200);
+		g_assert_cmpint (percentage, ==, percentage_suspended);
+		g_assert (!pk_backend_job_get_is_finished (job));
+
+		if (i == 0) {
+			/* carries on from where it stopped */
+			pk_backend_resume_job (backend, job);
+			g_assert (!pk_backend_job_get_suspended (job));
+			_g_test_loop_run_with_timeout (10000);
+			g_assert (!pk_backend_job_has_set_error_code (job));
+			g_assert_cmpint (percentage, ==, 100);
+		} else {
+			/* a cancel wakes it up straight away */
+			g_test_timer_start ();
+			pk_backend_cancel (backend, job);
+			_g_test_loop_run_with_timeout (5000);
+			g_test_message ("time to cancel while suspended: %.1fms",
+					g_test_timer_elapsed () * 1000);
+			g_assert (pk_backend_job_get_is_finished (job));
+			g_assert (pk_backend_job_has_set_error_code (job));
+		}
+		pk_backend_stop_job (backend, job);
+	}
+}
+
 static void
 pk_test_backend_spawn_finished_cb (PkBackendJob *job,
 				   PkExitEnum exit,
@@ -455,13 +741,256 @@ pk_test_backend_spawn_func (void)
 	g_object_unref (backend_spawn);
 }
 
+static void
+pk_test_dbus_credentials_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	guint *uid = (guint *) user_data;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+
+	ret = pk_dbus_get_credentials_finish (PK_DBUS (source_object), res, uid, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	_g_test_loop_quit ();
+}
+
 static void
 pk_test_dbus_func (void)
 {
+	gboolean ret;
+	guint pid = 0;
+	guint uid = 0;
 	g_autoptr(PkDbus) dbus = NULL;
 
 	dbus = pk_dbus_new ();
 	g_assert (dbus != NULL);
+
+	/* unknown senders are never looked up synchronously */
+	ret = pk_dbus_lookup_credentials (dbus, ":1.999999", &uid, &pid);
+	g_assert (!ret);
+
+	/* the self-check sender is always known */
+	ret = pk_dbus_lookup_credentials (dbus, ":org.freedesktop.PackageKit", &uid, &pid);
+	g_assert (ret);
+	g_assert_cmpint (uid, ==, 500);
+	g_assert_cmpint (pid, ==, G_MAXUINT - 1);
+
+	/* known credentials do not need the bus */
+	uid = 0;
+	pk_dbus_get_credentials_async (dbus, ":org.freedesktop.PackageKit", NULL,
+				       pk_test_dbus_credentials_cb, &uid);
+	_g_test_loop_run_with_timeout (1000);
+	g_assert_cmpint (uid, ==, 500);
+}
+
+typedef enum {
+	PK_TEST_AUTH_IMPLICIT,		/* yes */
+	PK_TEST_AUTH_ONE_SHOT,		/* auth_admin */
+	PK_TEST_AUTH_KEEP,		/* auth_admin_keep */
+	PK_TEST_AUTH_DENIED		/* no */
+} PkTestAuthMode;
+
+static guint auth_check_count = 0;
+
+static PolkitAuthorizationResult *
+pk_test_auth_cache_check_func (PolkitSubject *subject,
+			       const gchar *action_id,
+			       PolkitDetails *details,
+			       PolkitCheckAuthorizationFlags flags,
+			       gpointer user_data)
+{
+	PkTestAuthMode mode = GPOINTER_TO_UINT (user_data);
+	PolkitAuthorizationResult *result;
+	PolkitDetails *result_details;
+
+	auth_check_count++;
+	result_details = polkit_details_new ();
+	if (mode == PK_TEST_AUTH_IMPLICIT) {
+		result = polkit_authorization_result_new (TRUE, FALSE, result_details);
+	} else if (mode == PK_TEST_AUTH_DENIED) {
+		result = polkit_authorization_result_new (FALSE, FALSE, result_details);
+	} else if ((flags & POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION) == 0) {
+		result = polkit_authorization_result_new (FALSE, TRUE, result_details);
+	} else {
+		if (mode == PK_TEST_AUTH_KEEP)
+			polkit_details_insert (result_details, "polkit.retains_authorization_after_challenge", "1");
+		result = polkit_authorization_result_new (TRUE, FALSE, result_details);
+	}
+	g_object_unref (result_details);
+	return result;
+}
+
+static void
+pk_test_auth_cache_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	gboolean *authorized = (gboolean *) user_data;
+	PolkitAuthorizationResult *result;
+	g_autoptr(GError) error = NULL;
+
+	result = pk_auth_cache_check_finish (PK_AUTH_CACHE (source_object), res, &error);
+	g_assert_no_error (error);
+	g_assert (result != NULL);
+	*authorized = polkit_authorization_result_get_is_authorized (result);
+	g_object_unref (result);
+	_g_test_loop_quit ();
+}
+
+static gboolean
+pk_test_auth_cache_check (PkAuthCache *cache, PolkitSubject *subject, const gchar *package_id)
+{
+	gboolean authorized = FALSE;
+	PolkitDetails *details;
+
+	details = polkit_details_new ();
+	polkit_details_insert (details, "package_ids", package_id);
+	pk_auth_cache_check_async (cache, subject,
+				   "org.freedesktop.packagekit.package-install",
+				   details, NULL,
+				   pk_test_auth_cache_cb, &authorized);
+	_g_test_loop_run_with_timeout (1000);
+	g_object_unref (details);
+	return authorized;
+}
+
+static void
+pk_test_auth_cache_func (void)
+{
+	PolkitSubject *subject;
+	PolkitSubject *subject_other;
+	g_autoptr(PkAuthCache) cache = NULL;
+
+	cache = pk_auth_cache_new ();
+	subject = polkit_system_bus_name_new (":1.42");
+	subject_other = polkit_system_bus_name_new (":1.43");
+
+	/* implicit authorizations are reused */
+	pk_auth_cache_set_check_func (cache, pk_test_auth_cache_check_func,
+				      GUINT_TO_POINTER (PK_TEST_AUTH_IMPLICIT));
+	auth_check_count = 0;
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 1);
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 1);
+
+	/* different details or a different subject are a new question */
+	g_assert (pk_test_auth_cache_check (cache, subject, "kernel;2.6.23-0.115.rc3.git1.fc8;i386;installed"));
+	g_assert_cmpint (auth_check_count, ==, 2);
+	g_assert (pk_test_auth_cache_check (cache, subject_other, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 3);
+
+	/* polkit said something changed */
+	pk_auth_cache_flush (cache);
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 4);
+
+	/* a one-shot authentication prompts every time */
+	pk_auth_cache_set_check_func (cache, pk_test_auth_cache_check_func,
+				      GUINT_TO_POINTER (PK_TEST_AUTH_ONE_SHOT));
+	auth_check_count = 0;
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 2);
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 4);
+
+	/* polkit keeps auth_admin_keep, so we can too */
+	pk_auth_cache_set_check_func (cache, pk_test_auth_cache_check_func,
+				      GUINT_TO_POINTER (PK_TEST_AUTH_KEEP));
+	auth_check_count = 0;
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 2);
+	g_assert (pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 2);
+
+	/* denials are never cached */
+	pk_auth_cache_set_check_func (cache, pk_test_auth_cache_check_func,
+				      GUINT_TO_POINTER (PK_TEST_AUTH_DENIED));
+	auth_check_count = 0;
+	g_assert (!pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert (!pk_test_auth_cache_check (cache, subject, "powertop;1.8-1.fc8;i386;fedora"));
+	g_assert_cmpint (auth_check_count, ==, 2);
+
+	g_object_unref (subject);
+	g_object_unref (subject_other);
+}
+
+static void
+pk_test_stats_func (void)
+{
+	const gchar *name;
+	gboolean found_finished = FALSE;
+	gboolean found_queued = FALSE;
+	gint64 timestamps[PK_STATS_PHASE_LAST];
+	guint64 count, p50, p90, p99, max;
+	guint64 bytes;
+	guint i;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(GVariantIter) phases = NULL;
+	g_autoptr(GVariantIter) roles = NULL;
+	g_autoptr(GVariantIter) signals = NULL;
+	g_autoptr(PkStats) stats = NULL;
+
+	stats = pk_stats_new ();
+	pk_stats_reset (stats);
+
+	/* queued after 10us..1000us, then 5ms in the backend */
+	for (i = 1; i <= 100; i++) {
+		memset (timestamps, 0, sizeof (timestamps));
+		timestamps[PK_STATS_PHASE_CREATED] = 1000;
+		timestamps[PK_STATS_PHASE_QUEUED] = 1000 + i * 10;
+		timestamps[PK_STATS_PHASE_FINISHED] = 6000 + i * 10;
+		pk_stats_add_transaction (stats, PK_ROLE_ENUM_GET_UPDATES, timestamps);
+	}
+
+	/* never created, so ignored */
+	memset (timestamps, 0, sizeof (timestamps));
+	timestamps[PK_STATS_PHASE_FINISHED] = 1000;
+	pk_stats_add_transaction (stats, PK_ROLE_ENUM_GET_UPDATES, timestamps);
+
+	for (i = 0; i < 3; i++)
+		pk_stats_add_signal (stats, "Package", 10);
+
+	value = g_variant_ref_sink (pk_stats_get_variant (stats));
+	g_variant_get (value, "(a(sttttt)a(sttttt)a(stt))", &phases, &roles, &signals);
+	while (g_variant_iter_next (phases, "(&sttttt)", &name, &count, &p50, &p90, &p99, &max)) {
+		if (g_strcmp0 (name, "queued") == 0) {
+			g_assert_cmpint (count, ==, 100);
+			g_assert_cmpint (p50, >=, 500);
+			g_assert_cmpint (p50, <=, 500 * 9 / 8);
+			g_assert_cmpint (p90, >=, 900);
+			g_assert_cmpint (p90, <=, 900 * 9 / 8);
+			g_assert_cmpint (p99, >=, 990);
+			g_assert_cmpint (max, ==, 1000);
+			found_queued = TRUE;
+		} else if (g_strcmp0 (name, "finished") == 0) {
+			g_assert_cmpint (count, ==, 100);
+			g_assert_cmpint (p50, ==, 5000);
+			g_assert_cmpint (max, ==, 5000);
+			found_finished = TRUE;
+		} else {
+			g_assert_cmpint (count, ==, 0);
+		}
+	}
+	g_assert (found_queued);
+	g_assert (found_finished);
+
+	g_assert (g_variant_iter_next (roles, "(&sttttt)", &name, &count, &p50, &p90, &p99, &max));
+	g_assert_cmpstr (name, ==, "get-updates");
+	g_assert_cmpint (count, ==, 100);
+	g_assert_cmpint (max, ==, 6000);
+	g_assert (!g_variant_iter_next (roles, "(&sttttt)", &name, &count, &p50, &p90, &p99, &max));
+
+	g_assert (g_variant_iter_next (signals, "(&stt)", &name, &count, &bytes));
+	g_assert_cmpstr (name, ==, "Package");
+	g_assert_cmpint (count, ==, 3);
+	g_assert_cmpint (bytes, ==, 30);
+
+	/* nothing left after a reset */
+	pk_stats_reset (stats);
+	g_variant_unref (value);
+	value = g_variant_ref_sink (pk_stats_get_variant (stats));
+	g_variant_iter_free (roles);
+	g_variant_get_child (value, 1, "a(sttttt)", &roles);
+	g_assert_cmpint (g_variant_iter_n_children (roles), ==, 0);
 }
 
 PkSpawnExitType mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
@@ -701,15 +1230,23 @@ pk_test_transaction_func (void)
 	gboolean ret;
 	GError *error = NULL;
 	GDBusNodeInfo *introspection;
+	g_autoptr(PkDbus) dbus = NULL;
 	g_autoptr(PkTransaction) transaction = NULL;
+	g_autoptr(PkTransactionDb) tdb = NULL;
 	g_autoptr(GKeyFile) conf = NULL;
 
 	introspection = pk_load_introspection (PK_DBUS_INTERFACE_TRANSACTION ".xml", NULL);
 	g_assert (introspection != NULL);
 
+	tdb = pk_transaction_db_new ();
+	ret = pk_transaction_db_load (tdb, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
 	/* get PkTransaction object */
 	conf = g_key_file_new ();
-	transaction = pk_transaction_new (conf, introspection);
+	dbus = pk_dbus_new ();
+	transaction = pk_transaction_new (conf, introspection, dbus, tdb);
 	g_assert (transaction != NULL);
 
 	/* validate incorrect text */
@@ -738,6 +1275,12 @@ pk_test_transaction_db_func (void)
 	g_autoptr(PkTransactionDb) db = NULL;
 	g_autofree gchar *proxy_http = NULL;
 	g_autofree gchar *proxy_ftp = NULL;
+	const gchar *version;
+	guint i;
+	guint length;
+	GList *list;
+	GVariant *entry;
+	GVariant *history;
 
 	/* remove the self check file */
 #if PK_BUILD_LOCAL
@@ -853,6 +1396,81 @@ pk_test_transaction_db_func (void)
 	g_assert (ret);
 	g_assert_cmpstr (proxy_http, ==, "127.0.0.1:80");
 	g_assert_cmpstr (proxy_ftp, ==, "127.0.0.1:21");
+
+	/* save the packages of a transaction */
+	tid = pk_transaction_db_generate_id (db);
+	pk_transaction_db_add (db, tid);
+	ret = pk_transaction_db_set_data (db, tid,
+					  "installing\thal;0.1.2;i386;fedora\tHardware Abstraction Layer\n"
+					  "installing\thal;0.1.2;x86_64;fedora\tHardware Abstraction Layer\n"
+					  "downloading\tglib2;2.14.0;x86_64;fedora\tThe GLib library\n");
+	g_assert (ret);
+
+	/* unfinished transactions have no history */
+	history = pk_transaction_db_get_package_history (db, "hal", 0);
+	g_assert (history != NULL);
+	g_assert_cmpint (g_variant_n_children (history), ==, 0);
+	g_variant_unref (g_variant_ref_sink (history));
+
+	/* both arches are merged into one entry */
+	ret = pk_transaction_db_set_finished (db, tid, TRUE, 100);
+	g_assert (ret);
+	history = pk_transaction_db_get_package_history (db, "hal", 0);
+	g_assert (history != NULL);
+	g_assert_cmpint (g_variant_n_children (history), ==, 1);
+	entry = g_variant_get_child_value (history, 0);
+	g_assert (g_variant_lookup (entry, "version", "&s", &version));
+	g_assert_cmpstr (version, ==, "0.1.2");
+	g_variant_unref (entry);
+	g_variant_unref (g_variant_ref_sink (history));
+	g_free (tid);
+
+	/* downloads are not interesting */
+	history = pk_transaction_db_get_package_history (db, "glib2", 0);
+	g_assert (history != NULL);
+	g_assert_cmpint (g_variant_n_children (history), ==, 0);
+	g_variant_unref (g_variant_ref_sink (history));
+
+	/* transactions without packages are saved too */
+	tid = pk_transaction_db_generate_id (db);
+	pk_transaction_db_add (db, tid);
+	ret = pk_transaction_db_set_data (db, tid, "");
+	g_assert (ret);
+	ret = pk_transaction_db_set_finished (db, tid, TRUE, 100);
+	g_assert (ret);
+	g_free (tid);
+
+	/* saving transactions doesn't stall the main loop */
+	g_test_timer_start ();
+	for (i = 0; i < 100; i++) {
+		tid = pk_transaction_db_generate_id (db);
+		pk_transaction_db_add (db, tid);
+		pk_transaction_db_set_role (db, tid, PK_ROLE_ENUM_INSTALL_PACKAGES);
+		pk_transaction_db_set_uid (db, tid, 500);
+		pk_transaction_db_set_cmdline (db, tid, "pkcon install hal");
+		pk_transaction_db_set_data (db, tid, "installing\thal;0.1.2;i386;fedora\tHardware Abstraction Layer\n");
+		pk_transaction_db_set_finished (db, tid, TRUE, 100);
+		g_free (tid);
+	}
+	ms = g_test_timer_elapsed ();
+	g_test_message ("queued 100 transactions in %.1fms", ms * 1000);
+
+	/* and they are all saved */
+	list = pk_transaction_db_get_list (db, 0);
+	g_assert_cmpint (g_list_length (list), >=, 101);
+	length = g_list_length (list);
+	g_list_free_full (list, (GDestroyNotify) g_object_unref);
+
+	/* a removed transaction is not saved when it finishes later */
+	tid = pk_transaction_db_generate_id (db);
+	pk_transaction_db_add (db, tid);
+	pk_transaction_db_set_role (db, tid, PK_ROLE_ENUM_INSTALL_PACKAGES);
+	pk_transaction_db_remove (db, tid);
+	pk_transaction_db_set_finished (db, tid, TRUE, 100);
+	g_free (tid);
+	list = pk_transaction_db_get_list (db, 0);
+	g_assert_cmpint (g_list_length (list), ==, length);
+	g_list_free_full (list, (GDestroyNotify) g_object_unref);
 }
 
 static PkTransactionDb *db = NULL;
@@ -895,6 +1513,7 @@ pk_test_scheduler_func (void)
 	g_autofree gchar *tid_item3 = NULL;
 	g_autoptr(GKeyFile) conf = NULL;
 	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkDbus) dbus = NULL;
 	g_autoptr(PkScheduler) tlist = NULL;
 
 	/* remove the self check file */
@@ -922,7 +1541,8 @@ pk_test_scheduler_func (void)
 	g_assert (ret);
 
 	/* get a transaction list object */
-	tlist = pk_scheduler_new (conf);
+	dbus = pk_dbus_new ();
+	tlist = pk_scheduler_new (conf, dbus, db);
 	g_assert (tlist != NULL);
 
 	/* make sure we get a valid tid */
@@ -1206,6 +1826,7 @@ pk_test_scheduler_parallel_func (void)
 	g_autofree gchar *tid_item5 = NULL;
 	g_autoptr(GKeyFile) conf = NULL;
 	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkDbus) dbus = NULL;
 	g_autoptr(PkScheduler) tlist = NULL;
 
 	db = pk_transaction_db_new ();
@@ -1222,7 +1843,8 @@ pk_test_scheduler_parallel_func (void)
 	g_assert (ret);
 
 	/* get a transaction list object */
-	tlist = pk_scheduler_new (conf);
+	dbus = pk_dbus_new ();
+	tlist = pk_scheduler_new (conf, dbus, db);
 	g_assert (tlist != NULL);
 
 	pk_scheduler_set_backend (tlist, backend);
@@ -1396,6 +2018,145 @@ pk_test_scheduler_parallel_func (void)
 	g_object_unref (db);
 }
 
+static void
+pk_test_scheduler_latency_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	guint i;
+	GError *error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkDbus) dbus = NULL;
+	g_autoptr(PkScheduler) tlist = NULL;
+
+	db = pk_transaction_db_new ();
+	ret = pk_transaction_db_load (db, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
+	backend = pk_backend_new (conf);
+	ret = pk_backend_load (backend, NULL);
+	g_assert (ret);
+
+	dbus = pk_dbus_new ();
+	tlist = pk_scheduler_new (conf, dbus, db);
+	pk_scheduler_set_backend (tlist, backend);
+
+	/* create, commit and finish no-op transactions one after another,
+	 * staying below the per-uid limit as finished ones are kept around */
+	g_test_timer_start ();
+	for (i = 0; i < 100; i++) {
+		PkTransaction *transaction;
+		g_autofree gchar *tid = NULL;
+
+		tid = pk_test_scheduler_create_transaction (tlist);
+		transaction = pk_scheduler_get_transaction (tlist, tid);
+		g_signal_connect (transaction, "finished",
+				  G_CALLBACK (pk_test_scheduler_finished_cb), NULL);
+		pk_transaction_get_distro_upgrades (transaction, g_variant_new ("()"), NULL);
+		_g_test_loop_run_with_timeout (2000);
+		g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_FINISHED);
+	}
+	elapsed = g_test_timer_elapsed ();
+	g_test_message ("ran 100 transactions, %.2fms per round trip", elapsed * 10);
+
+	g_object_unref (db);
+}
+
+static guint number_properties_changed = 0;
+static guint32 changed_role = PK_ROLE_ENUM_UNKNOWN;
+static guint32 changed_status = PK_STATUS_ENUM_UNKNOWN;
+static gboolean got_finished = FALSE;
+
+static void
+pk_test_transaction_properties_signal_cb (GDBusConnection *connection,
+					  const gchar *sender_name,
+					  const gchar *object_path,
+					  const gchar *interface_name,
+					  const gchar *signal_name,
+					  GVariant *parameters,
+					  gpointer user_data)
+{
+	if (g_strcmp0 (signal_name, "PropertiesChanged") == 0) {
+		const gchar *interface = NULL;
+		g_autoptr(GVariant) changed = NULL;
+		g_autoptr(GVariant) invalidated = NULL;
+
+		/* nothing may arrive after ::Finished() */
+		g_assert (!got_finished);
+		number_properties_changed++;
+		g_variant_get (parameters, "(&s@a{sv}@as)",
+			       &interface, &changed, &invalidated);
+		g_assert_cmpstr (interface, ==, PK_DBUS_INTERFACE_TRANSACTION);
+		g_variant_lookup (changed, "Role", "u", &changed_role);
+		g_variant_lookup (changed, "Status", "u", &changed_status);
+		return;
+	}
+	if (g_strcmp0 (signal_name, "Finished") == 0) {
+		got_finished = TRUE;
+		_g_test_loop_quit ();
+	}
+}
+
+static void
+pk_test_transaction_properties_func (void)
+{
+	gboolean ret;
+	guint subscription_id;
+	PkTransaction *transaction;
+	GError *error = NULL;
+	g_autofree gchar *tid = NULL;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkDbus) dbus = NULL;
+	g_autoptr(PkScheduler) tlist = NULL;
+
+	db = pk_transaction_db_new ();
+	ret = pk_transaction_db_load (db, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* the timer never fires, so only ::Finished() can flush the changes */
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
+	g_key_file_set_integer (conf, "Daemon", "PropertiesChangedInterval", G_MAXINT);
+	backend = pk_backend_new (conf);
+	ret = pk_backend_load (backend, NULL);
+	g_assert (ret);
+
+	dbus = pk_dbus_new ();
+	tlist = pk_scheduler_new (conf, dbus, db);
+	pk_scheduler_set_backend (tlist, backend);
+
+	tid = pk_test_scheduler_create_transaction (tlist);
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+	g_assert_no_error (error);
+	subscription_id = g_dbus_connection_signal_subscribe (connection,
+							      NULL, NULL, NULL,
+							      tid, NULL,
+							      G_DBUS_SIGNAL_FLAGS_NONE,
+							      pk_test_transaction_properties_signal_cb,
+							      NULL, NULL);
+
+	/* every status and role change is sent in one signal, before ::Finished() */
+	transaction = pk_scheduler_get_transaction (tlist, tid);
+	pk_transaction_get_distro_upgrades (transaction, g_variant_new ("()"), NULL);
+	_g_test_loop_run_with_timeout (2000);
+	g_assert (got_finished);
+	g_assert_cmpint (number_properties_changed, ==, 1);
+
+	/* only the latest value of each property is sent */
+	g_assert_cmpint (changed_role, ==, PK_ROLE_ENUM_GET_DISTRO_UPGRADES);
+	g_assert_cmpint (changed_status, ==, PK_STATUS_ENUM_FINISHED);
+
+	g_dbus_connection_signal_unsubscribe (connection, subscription_id);
+	g_object_unref (db);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1413,13 +2174,19 @@ main (int argc, char **argv)
 	/* components */
 	g_test_add_func ("/packagekit/transaction", pk_test_transaction_func);
 	g_test_add_func ("/packagekit/dbus", pk_test_dbus_func);
+	g_test_add_func ("/packagekit/auth-cache", pk_test_auth_cache_func);
+	g_test_add_func ("/packagekit/stats", pk_test_stats_func);
 	g_test_add_func ("/packagekit/spawn", pk_test_spawn_func);
 	g_test_add_func ("/packagekit/scheduler", pk_test_scheduler_func);
 	g_test_add_func ("/packagekit/scheduler-parallel", pk_test_scheduler_parallel_func);
+	g_test_add_func ("/packagekit/scheduler-latency", pk_test_scheduler_latency_func);
+	g_test_add_func ("/packagekit/transaction-properties", pk_test_transaction_properties_func);
 	g_test_add_func ("/packagekit/transaction-db", pk_test_transaction_db_func);
 
 	/* backend stuff */
 	g_test_add_func ("/packagekit/backend", pk_test_backend_func);
+	g_test_add_func ("/packagekit/backend-cancel", pk_test_backend_cancel_func);
+	g_test_add_func ("/packagekit/backend-suspend", pk_test_backend_suspend_func);
 	g_test_add_func ("/packagekit/backend_spawn", pk_test_backend_spawn_func);
 
 	return g_test_run ();
@@ -0,0 +1,326 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+#include <glib.h>
+
+#include "pk-stats.h"
+
+#define PK_STATS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_STATS, PkStatsPrivate))
+
+/*
+ * Latencies are kept in log-linear buckets: values below 8us get a bucket
+ * each, and every power of two above that is split into 8 buckets, so a
+ * percentile is never more than 12.5% above the real value.
+ */
+#define PK_STATS_SUB_BUCKET_BITS	3
+#define PK_STATS_SUB_BUCKETS		(1 << PK_STATS_SUB_BUCKET_BITS)
+#define PK_STATS_BUCKETS		((64 - PK_STATS_SUB_BUCKET_BITS + 1) * PK_STATS_SUB_BUCKETS)
+
+typedef struct {
+	guint64			 count;
+	guint64			 max;
+	guint64			 buckets[PK_STATS_BUCKETS];
+} PkStatsHistogram;
+
+typedef struct {
+	guint64			 count;
+	guint64			 bytes;
+} PkStatsCounter;
+
+struct PkStatsPrivate
+{
+	PkStatsHistogram	 phases[PK_STATS_PHASE_LAST];
+	PkStatsHistogram	*roles[PK_ROLE_ENUM_LAST];
+	GHashTable		*signals;	/* name:PkStatsCounter */
+};
+
+static gpointer pk_stats_object = NULL;
+
+G_DEFINE_TYPE (PkStats, pk_stats, G_TYPE_OBJECT)
+
+/**
+ * pk_stats_phase_to_string:
+ **/
+const gchar *
+pk_stats_phase_to_string (PkStatsPhase phase)
+{
+	if (phase == PK_STATS_PHASE_CREATED)
+		return "created";
+	if (phase == PK_STATS_PHASE_AUTHORIZED)
+		return "authorized";
+	if (phase == PK_STATS_PHASE_QUEUED)
+		return "queued";
+	if (phase == PK_STATS_PHASE_BACKEND_STARTED)
+		return "backend-started";
+	if (phase == PK_STATS_PHASE_FIRST_PACKAGE)
+		return "first-package";
+	if (phase == PK_STATS_PHASE_FINISHED)
+		return "finished";
+	if (phase == PK_STATS_PHASE_FLUSHED)
+		return "dbus-flushed";
+	return NULL;
+}
+
+static guint
+pk_stats_histogram_index (guint64 value)
+{
+	guint magnitude;
+
+	if (value < PK_STATS_SUB_BUCKETS)
+		return value;
+	magnitude = g_bit_storage (value) - 1;
+	return (magnitude - PK_STATS_SUB_BUCKET_BITS + 1) * PK_STATS_SUB_BUCKETS +
+		((value >> (magnitude - PK_STATS_SUB_BUCKET_BITS)) & (PK_STATS_SUB_BUCKETS - 1));
+}
+
+/* the largest value that falls into the bucket */
+static guint64
+pk_stats_histogram_value (guint idx)
+{
+	guint magnitude;
+	guint64 sub;
+
+	if (idx < PK_STATS_SUB_BUCKETS)
+		return idx;
+	magnitude = idx / PK_STATS_SUB_BUCKETS + PK_STATS_SUB_BUCKET_BITS - 1;
+	sub = PK_STATS_SUB_BUCKETS + idx % PK_STATS_SUB_BUCKETS;
+	return ((sub + 1) << (magnitude - PK_STATS_SUB_BUCKET_BITS)) - 1;
+}
+
+static void
+pk_stats_histogram_add (PkStatsHistogram *hist, guint64 value)
+{
+	hist->buckets[pk_stats_histogram_index (value)]++;
+	hist->count++;
+	if (value > hist->max)
+		hist->max = value;
+}
+
+static guint64
+pk_stats_histogram_percentile (PkStatsHistogram *hist, guint percentile)
+{
+	guint64 seen = 0;
+	guint64 wanted;
+	guint i;
+
+	if (hist->count == 0)
+		return 0;
+	wanted = (hist->count * percentile + 99) / 100;
+	for (i = 0; i < PK_STATS_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if (seen >= wanted)
+			return MIN (pk_stats_histogram_value (i), hist->max);
+	}
+	return hist->max;
+}
+
+static void
+pk_stats_histogram_add_to_builder (PkStatsHistogram *hist,
+				   const gchar *name,
+				   GVariantBuilder *builder)
+{
+	g_variant_builder_add (builder, "(sttttt)",
+			       name,
+			       hist->count,
+			       pk_stats_histogram_percentile (hist, 50),
+			       pk_stats_histogram_percentile (hist, 90),
+			       pk_stats_histogram_percentile (hist, 99),
+			       hist->max);
+}
+
+/**
+ * pk_stats_add_transaction:
+ * @stats: a #PkStats
+ * @role: the transaction role
+ * @timestamps: monotonic times in us, indexed by #PkStatsPhase, 0 if not reached
+ *
+ * Records how long the transaction spent before each phase it reached,
+ * and how long it took from being created to finishing.
+ **/
+void
+pk_stats_add_transaction (PkStats *stats,
+			  PkRoleEnum role,
+			  const gint64 *timestamps)
+{
+	PkStatsPrivate *priv = stats->priv;
+	gint64 last;
+	guint i;
+
+	g_return_if_fail (PK_IS_STATS (stats));
+	g_return_if_fail (timestamps != NULL);
+
+	if (timestamps[PK_STATS_PHASE_CREATED] == 0)
+		return;
+
+	/* time spent getting to each phase from the one before it */
+	last = timestamps[PK_STATS_PHASE_CREATED];
+	for (i = PK_STATS_PHASE_CREATED + 1; i < PK_STATS_PHASE_LAST; i++) {
+		if (timestamps[i] == 0)
+			continue;
+		pk_stats_histogram_add (&priv->phases[i], MAX (timestamps[i] - last, 0));
+		last = timestamps[i];
+	}
+
+	if (role >= PK_ROLE_ENUM_LAST || timestamps[PK_STATS_PHASE_FINISHED] == 0)
+		return;
+	if (priv->roles[role] == NULL)
+		priv->roles[role] = g_new0 (PkStatsHistogram, 1);
+	pk_stats_histogram_add (priv->roles[role],
+				MAX (timestamps[PK_STATS_PHASE_FINISHED] -
+				     timestamps[PK_STATS_PHASE_CREATED], 0));
+}
+
+/**
+ * pk_stats_add_signal:
+ * @stats: a #PkStats
+ * @signal_name: the D-Bus signal name, e.g. "Package"
+ * @size: the size of the signal body in bytes
+ **/
+void
+pk_stats_add_signal (PkStats *stats, const gchar *signal_name, gsize size)
+{
+	PkStatsCounter *counter;
+
+	g_return_if_fail (PK_IS_STATS (stats));
+
+	counter = g_hash_table_lookup (stats->priv->signals, signal_name);
+	if (counter == NULL) {
+		counter = g_new0 (PkStatsCounter, 1);
+		g_hash_table_insert (stats->priv->signals, g_strdup (signal_name), counter);
+	}
+	counter->count++;
+	counter->bytes += size;
+}
+
+/**
+ * pk_stats_get_variant:
+ * @stats: a #PkStats
+ *
+ * Gets the statistics in the format returned by the
+ * org.freedesktop.PackageKit.Debug.GetStats() method.
+ *
+ * Return value: (transfer floating): a #GVariant of type "(a(sttttt)a(sttttt)a(stt))"
+ **/
+GVariant *
+pk_stats_get_variant (PkStats *stats)
+{
+	PkStatsPrivate *priv = stats->priv;
+	GHashTableIter iter;
+	GVariantBuilder phases;
+	GVariantBuilder roles;
+	GVariantBuilder signals;
+	gpointer key;
+	gpointer value;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_STATS (stats), NULL);
+
+	g_variant_builder_init (&phases, G_VARIANT_TYPE ("a(sttttt)"));
+	for (i = PK_STATS_PHASE_CREATED + 1; i < PK_STATS_PHASE_LAST; i++) {
+		pk_stats_histogram_add_to_builder (&priv->phases[i],
+						   pk_stats_phase_to_string (i),
+						   &phases);
+	}
+	g_variant_builder_init (&roles, G_VARIANT_TYPE ("a(sttttt)"));
+	for (i = 0; i < PK_ROLE_ENUM_LAST; i++) {
+		if (priv->roles[i] == NULL)
+			continue;
+		pk_stats_histogram_add_to_builder (priv->roles[i],
+						   pk_role_enum_to_string (i),
+						   &roles);
+	}
+	g_variant_builder_init (&signals, G_VARIANT_TYPE ("a(stt)"));
+	g_hash_table_iter_init (&iter, priv->signals);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		PkStatsCounter *counter = value;
+		g_variant_builder_add (&signals, "(stt)",
+				       key, counter->count, counter->bytes);
+	}
+	return g_variant_new ("(a(sttttt)a(sttttt)a(stt))",
+			      &phases, &roles, &signals);
+}
+
+/**
+ * pk_stats_reset:
+ * @stats: a #PkStats
+ **/
+void
+pk_stats_reset (PkStats *stats)
+{
+	PkStatsPrivate *priv = stats->priv;
+	guint i;
+
+	g_return_if_fail (PK_IS_STATS (stats));
+
+	memset (priv->phases, 0, sizeof (priv->phases));
+	for (i = 0; i < PK_ROLE_ENUM_LAST; i++)
+		g_clear_pointer (&priv->roles[i], g_free);
+	g_hash_table_remove_all (priv->signals);
+}
+
+static void
+pk_stats_finalize (GObject *object)
+{
+	PkStats *stats;
+	guint i;
+
+	g_return_if_fail (PK_IS_STATS (object));
+	stats = PK_STATS (object);
+
+	for (i = 0; i < PK_ROLE_ENUM_LAST; i++)
+		g_free (stats->priv->roles[i]);
+	g_hash_table_unref (stats->priv->signals);
+
+	G_OBJECT_CLASS (pk_stats_parent_class)->finalize (object);
+}
+
+static void
+pk_stats_class_init (PkStatsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_stats_finalize;
+
+	g_type_class_add_private (klass, sizeof (PkStatsPrivate));
+}
+
+static void
+pk_stats_init (PkStats *stats)
+{
+	stats->priv = PK_STATS_GET_PRIVATE (stats);
+	stats->priv->signals = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      g_free, g_free);
+}
+
+PkStats *
+pk_stats_new (void)
+{
+	if (pk_stats_object != NULL) {
+		g_object_ref (pk_stats_object);
+	} else {
+		pk_stats_object = g_object_new (PK_TYPE_STATS, NULL);
+		g_object_add_weak_pointer (pk_stats_object, &pk_stats_object);
+	}
+	return PK_STATS (pk_stats_object);
+}
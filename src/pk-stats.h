@@ -0,0 +1,81 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __PK_STATS_H
+#define __PK_STATS_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/pk-enum.h>
+
+G_BEGIN_DECLS
+
+#define PK_TYPE_STATS		(pk_stats_get_type ())
+#define PK_STATS(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), PK_TYPE_STATS, PkStats))
+#define PK_STATS_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), PK_TYPE_STATS, PkStatsClass))
+#define PK_IS_STATS(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), PK_TYPE_STATS))
+#define PK_IS_STATS_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), PK_TYPE_STATS))
+#define PK_STATS_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), PK_TYPE_STATS, PkStatsClass))
+
+typedef struct PkStatsPrivate PkStatsPrivate;
+
+typedef struct
+{
+	GObject			 parent;
+	PkStatsPrivate		*priv;
+} PkStats;
+
+typedef struct
+{
+	GObjectClass		 parent_class;
+} PkStatsClass;
+
+/* the points in the life of a transaction that are timestamped */
+typedef enum {
+	PK_STATS_PHASE_CREATED,
+	PK_STATS_PHASE_AUTHORIZED,
+	PK_STATS_PHASE_QUEUED,
+	PK_STATS_PHASE_BACKEND_STARTED,
+	PK_STATS_PHASE_FIRST_PACKAGE,
+	PK_STATS_PHASE_FINISHED,
+	PK_STATS_PHASE_FLUSHED,
+	PK_STATS_PHASE_LAST
+} PkStatsPhase;
+
+#ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkStats, g_object_unref)
+#endif
+
+GType		 pk_stats_get_type		(void);
+PkStats		*pk_stats_new			(void);
+const gchar	*pk_stats_phase_to_string	(PkStatsPhase	 phase);
+void		 pk_stats_add_transaction	(PkStats	*stats,
+						 PkRoleEnum	 role,
+						 const gint64	*timestamps);
+void		 pk_stats_add_signal		(PkStats	*stats,
+						 const gchar	*signal_name,
+						 gsize		 size);
+GVariant	*pk_stats_get_variant		(PkStats	*stats);
+void		 pk_stats_reset			(PkStats	*stats);
+
+G_END_DECLS
+
+#endif /* __PK_STATS_H */
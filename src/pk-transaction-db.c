@@ -39,6 +39,7 @@
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-package-id.h>
 
 #include "pk-shared.h"
 
@@ -48,12 +49,49 @@ static void     pk_transaction_db_finalize	(GObject        *object);
 
 #define PK_TRANSACTION_DB_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION_DB, PkTransactionDbPrivate))
 
+/* the number of queued writes before the main loop blocks */
+#define PK_TRANSACTION_DB_MAX_PENDING_WRITES	64
+
+/* how long to wait for the other connection to finish writing, in ms */
+#define PK_TRANSACTION_DB_BUSY_TIMEOUT		5000
+
+typedef struct {
+	gchar			*tid;
+	gchar			*timespec;
+	PkRoleEnum		 role;
+	guint			 uid;
+	gchar			*cmdline;
+	gchar			*data;
+	gboolean		 succeeded;
+	guint			 duration;
+} PkTransactionDbItem;
+
+typedef struct {
+	PkTransactionDbItem	*item;		/* or %NULL to save job_count */
+	guint			 job_count;
+} PkTransactionDbWrite;
+
 struct PkTransactionDbPrivate
 {
 	gboolean		 loaded;
 	sqlite3			*db;
 	guint			 job_count;
 	guint			 database_save_id;
+	GHashTable		*items;		/* tid:PkTransactionDbItem, until finished */
+	sqlite3_stmt		*stmt_time_since;
+	sqlite3_stmt		*stmt_time_reset;
+	/* owned by the writer thread */
+	GThread			*writer;
+	sqlite3			*writer_db;
+	sqlite3_stmt		*stmt_add_transaction;
+	sqlite3_stmt		*stmt_add_package;
+	sqlite3_stmt		*stmt_job_count;
+	/* protected by writes_mutex */
+	GMutex			 writes_mutex;
+	GCond			 writes_cond;
+	GQueue			*writes;
+	guint			 writes_pending;
+	gboolean		 writes_shutdown;
 };
 
 G_DEFINE_TYPE (PkTransactionDb, pk_transaction_db, G_TYPE_OBJECT)
@@ -145,25 +183,6 @@ pk_transaction_db_sql_statement (PkTransactionDb *tdb, const gchar *sql)
 	return TRUE;
 }
 
-static gint
-pk_time_action_sqlite_callback (void *data, gint argc, gchar **argv, gchar **col_name)
-{
-	gint i;
-	gchar *col;
-	gchar *value;
-	gchar **timespec = (gchar**) data;
-
-	for (i = 0; i < argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "timespec") == 0)
-			*timespec = g_strdup (value);
-		else
-			g_warning ("%s = %s", col, value);
-	}
-	return 0;
-}
-
 /**
  * pk_transaction_db_iso8601_difference:
  * @isodate: The ISO8601 date to compare
@@ -197,64 +216,80 @@ pk_transaction_db_iso8601_difference (const gchar *isodate)
 guint
 pk_transaction_db_action_time_since (PkTransactionDb *tdb, PkRoleEnum role)
 {
-	gchar *error_msg = NULL;
 	gint rc;
-	const gchar *role_text;
-	g_autofree gchar *statement = NULL;
-	g_autofree gchar *timespec = NULL;
+	guint time_s = G_MAXUINT;
+	sqlite3_stmt *statement;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), 0);
 	g_return_val_if_fail (tdb->priv->db != NULL, 0);
 
-	role_text = pk_role_enum_to_string (role);
-
-	statement = g_strdup_printf ("SELECT timespec FROM last_action WHERE role = '%s'", role_text);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_time_action_sqlite_callback, &timespec, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		return G_MAXUINT;
+	statement = tdb->priv->stmt_time_since;
+	sqlite3_bind_text (statement, 1, pk_role_enum_to_string (role), -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	if (rc == SQLITE_ROW) {
+		/* work out the difference */
+		time_s = pk_transaction_db_iso8601_difference ((const gchar *) sqlite3_column_text (statement, 0));
+	} else if (rc != SQLITE_DONE) {
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
 	}
-	if (timespec == NULL)
-		return G_MAXUINT;
-
-	/* work out the difference */
-	return pk_transaction_db_iso8601_difference (timespec);
+	sqlite3_reset (statement);
+	return time_s;
 }
 
 gboolean
 pk_transaction_db_action_time_reset (PkTransactionDb *tdb, PkRoleEnum role)
 {
-	gchar *error_msg = NULL;
+	gboolean ret = TRUE;
 	gint rc;
-	const gchar *role_text;
-	guint since;
-	g_autofree gchar *statement = NULL;
+	sqlite3_stmt *statement;
 	g_autofree gchar *timespec = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
 
+	/* update or insert the entry */
 	timespec = pk_iso8601_present ();
-	role_text = pk_role_enum_to_string (role);
-
-	/* get the previous entry */
-	since = pk_transaction_db_action_time_since (tdb, role);
-	if (since == G_MAXUINT) {
-		statement = g_strdup_printf ("INSERT INTO last_action (role, timespec) VALUES ('%s', '%s')", role_text, timespec);
-	} else {
-		statement = g_strdup_printf ("UPDATE last_action SET timespec = '%s' WHERE role = '%s'", timespec, role_text);
+	statement = tdb->priv->stmt_time_reset;
+	sqlite3_bind_text (statement, 1, pk_role_enum_to_string (role), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, timespec, -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	if (rc != SQLITE_DONE) {
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+		ret = FALSE;
 	}
+	sqlite3_reset (statement);
+	return ret;
+}
 
-	/* update or insert the entry */
-	rc = sqlite3_exec (tdb->priv->db, statement, NULL, NULL, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		return FALSE;
-	}
-	return TRUE;
+/**
+ * pk_transaction_db_wait_for_writes:
+ * @tdb: the #PkTransactionDb instance
+ *
+ * Waits for the writer thread to save all the queued writes, so that a
+ * query sees the transactions that have already finished.
+ **/
+static void
+pk_transaction_db_wait_for_writes (PkTransactionDb *tdb)
+{
+	g_mutex_lock (&tdb->priv->writes_mutex);
+	while (tdb->priv->writes_pending > 0)
+		g_cond_wait (&tdb->priv->writes_cond, &tdb->priv->writes_mutex);
+	g_mutex_unlock (&tdb->priv->writes_mutex);
+}
+
+static void
+pk_transaction_db_queue_write (PkTransactionDb *tdb, PkTransactionDbWrite *write)
+{
+	g_mutex_lock (&tdb->priv->writes_mutex);
+
+	/* don't queue up unbounded memory if the disk is stuck */
+	while (tdb->priv->writes_pending >= PK_TRANSACTION_DB_MAX_PENDING_WRITES)
+		g_cond_wait (&tdb->priv->writes_cond, &tdb->priv->writes_mutex);
+
+	g_queue_push_tail (tdb->priv->writes, write);
+	tdb->priv->writes_pending++;
+	g_cond_broadcast (&tdb->priv->writes_cond);
+	g_mutex_unlock (&tdb->priv->writes_mutex);
 }
 
 GList *
@@ -267,6 +302,7 @@ pk_transaction_db_get_list (PkTransactionDb *tdb, guint limit)
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
 
+	pk_transaction_db_wait_for_writes (tdb);
 	if (limit == 0) {
 		statement = g_strdup ("SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline "
 				      "FROM transactions ORDER BY timespec DESC");
@@ -288,85 +324,270 @@ out:
 	return list;
 }
 
+/* the timestamp comes from the transaction, which has to be added first */
+#define PK_TRANSACTION_DB_ADD_PACKAGE_SQL \
+	"INSERT INTO transaction_packages " \
+	"(tid, name, version, arch, data, info, timestamp) " \
+	"SELECT ?1, ?2, ?3, ?4, ?5, ?6, CAST(strftime('%s', timespec) AS INTEGER) " \
+	"FROM transactions WHERE transaction_id = ?1"
+
+/**
+ * pk_transaction_db_add_packages:
+ * @statement: a prepared %PK_TRANSACTION_DB_ADD_PACKAGE_SQL statement
+ * @tid: the transaction ID
+ * @data: the package list, as saved in the transactions table
+ *
+ * Adds one row per package in @data to the transaction_packages table, so
+ * the history of a package can be queried without parsing every transaction.
+ *
+ * Return value: %TRUE for success
+ **/
+static gboolean
+pk_transaction_db_add_packages (sqlite3_stmt *statement, const gchar *tid, const gchar *data)
+{
+	gint rc;
+	guint i;
+	g_auto(GStrv) lines = NULL;
+
+	lines = g_strsplit (data, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		g_auto(GStrv) sections = NULL;
+		g_auto(GStrv) split = NULL;
+
+		/* every line ends with a newline */
+		if (lines[i][0] == '\0')
+			continue;
+
+		/* info, package-id and summary */
+		sections = g_strsplit (lines[i], "\t", 3);
+		if (g_strv_length (sections) != 3) {
+			g_warning ("failed to parse package: '%s'", lines[i]);
+			continue;
+		}
+		split = pk_package_id_split (sections[1]);
+		if (split == NULL) {
+			g_warning ("failed to parse package id: '%s'", sections[1]);
+			continue;
+		}
+
+		sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 2, split[PK_PACKAGE_ID_NAME], -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 3, split[PK_PACKAGE_ID_VERSION], -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 4, split[PK_PACKAGE_ID_ARCH], -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 5, split[PK_PACKAGE_ID_DATA], -1, SQLITE_STATIC);
+		sqlite3_bind_int (statement, 6, pk_info_enum_from_string (sections[0]));
+
+		rc = sqlite3_step (statement);
+		sqlite3_reset (statement);
+		if (rc != SQLITE_DONE) {
+			g_warning ("failed to execute statement: %s",
+				   sqlite3_errmsg (sqlite3_db_handle (statement)));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void
+pk_transaction_db_item_free (PkTransactionDbItem *item)
+{
+	g_free (item->tid);
+	g_free (item->timespec);
+	g_free (item->cmdline);
+	g_free (item->data);
+	g_free (item);
+}
+
+static void
+pk_transaction_db_write_free (PkTransactionDbWrite *write)
+{
+	if (write->item != NULL)
+		pk_transaction_db_item_free (write->item);
+	g_free (write);
+}
+
+/*
+ * The details of a transaction are only kept in memory until it finishes,
+ * and then saved with a single write on the writer thread.
+ */
 gboolean
 pk_transaction_db_add (PkTransactionDb *tdb, const gchar *tid)
 {
-	g_autofree gchar *timespec = NULL;
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbItem *item;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 
-	timespec = pk_iso8601_present ();
-	statement = g_strdup_printf ("INSERT INTO transactions (transaction_id, timespec) VALUES ('%s', '%s')", tid, timespec);
-	pk_transaction_db_sql_statement (tdb, statement);
+	item = g_new0 (PkTransactionDbItem, 1);
+	item->tid = g_strdup (tid);
+	item->timespec = pk_iso8601_present ();
+	g_hash_table_replace (tdb->priv->items, item->tid, item);
 	return TRUE;
 }
 
+/**
+ * pk_transaction_db_remove:
+ *
+ * Forgets a transaction that was added but will never finish, e.g. because
+ * it was destroyed first. Finished transactions are not affected.
+ **/
+void
+pk_transaction_db_remove (PkTransactionDb *tdb, const gchar *tid)
+{
+	g_return_if_fail (PK_IS_TRANSACTION_DB (tdb));
+	g_return_if_fail (tid != NULL);
+
+	g_hash_table_remove (tdb->priv->items, tid);
+}
+
 gboolean
 pk_transaction_db_set_role (PkTransactionDb *tdb, const gchar *tid, PkRoleEnum role)
 {
-	const gchar *role_text;
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbItem *item;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 
-	role_text = pk_role_enum_to_string (role);
-	statement = g_strdup_printf ("UPDATE transactions SET role = '%s' WHERE transaction_id = '%s'", role_text, tid);
-	pk_transaction_db_sql_statement (tdb, statement);
+	item = g_hash_table_lookup (tdb->priv->items, tid);
+	if (item != NULL)
+		item->role = role;
 	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_uid (PkTransactionDb *tdb, const gchar *tid, guint uid)
 {
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbItem *item;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 
-	statement = g_strdup_printf ("UPDATE transactions SET uid = '%i' WHERE transaction_id = '%s'", uid, tid);
-	pk_transaction_db_sql_statement (tdb, statement);
+	item = g_hash_table_lookup (tdb->priv->items, tid);
+	if (item != NULL)
+		item->uid = uid;
 	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_cmdline (PkTransactionDb *tdb, const gchar *tid, const gchar *cmdline)
 {
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbItem *item;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 
-	statement = g_strdup_printf ("UPDATE transactions SET cmdline = '%s' WHERE transaction_id = '%s'", cmdline, tid);
-	pk_transaction_db_sql_statement (tdb, statement);
+	item = g_hash_table_lookup (tdb->priv->items, tid);
+	if (item != NULL) {
+		g_free (item->cmdline);
+		item->cmdline = g_strdup (cmdline);
+	}
 	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_data (PkTransactionDb *tdb, const gchar *tid, const gchar *data)
 {
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbItem *item;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 
-	/* TODO: we have to be careful of SQL injection attacks */
-	statement = g_strdup_printf ("UPDATE transactions SET data = \"%s\" WHERE transaction_id = '%s'",
-				     data, tid);
-	pk_transaction_db_sql_statement (tdb, statement);
+	item = g_hash_table_lookup (tdb->priv->items, tid);
+	if (item != NULL) {
+		g_free (item->data);
+		item->data = g_strdup (data);
+	}
 	return TRUE;
 }
 
 gboolean
 pk_transaction_db_set_finished (PkTransactionDb *tdb, const gchar *tid, gboolean success, guint runtime)
 {
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbItem *item;
+	PkTransactionDbWrite *write;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->writer != NULL, FALSE);
 
-	statement = g_strdup_printf ("UPDATE transactions SET succeeded = %i, duration = %i WHERE transaction_id = '%s'",
-				     success, runtime, tid);
-	pk_transaction_db_sql_statement (tdb, statement);
+	/* not a transaction we are logging */
+	item = g_hash_table_lookup (tdb->priv->items, tid);
+	if (item == NULL)
+		return TRUE;
+	g_hash_table_steal (tdb->priv->items, tid);
+	item->succeeded = success;
+	item->duration = runtime;
+
+	write = g_new0 (PkTransactionDbWrite, 1);
+	write->item = item;
+	pk_transaction_db_queue_write (tdb, write);
 	return TRUE;
 }
 
+/**
+ * pk_transaction_db_get_package_history:
+ * @tdb: the #PkTransactionDb instance
+ * @name: the package name
+ * @limit: the maximum number of entries, or 0 for no limit
+ *
+ * Gets the packages installed, removed or updated by successful
+ * transactions, newest first. Entries from the same transaction are merged,
+ * which happens when several arches of a package were changed.
+ *
+ * Return value: a floating #GVariant of type aa{sv}, or %NULL on error
+ **/
+GVariant *
+pk_transaction_db_get_package_history (PkTransactionDb *tdb, const gchar *name, guint limit)
+{
+	gint rc;
+	GVariantBuilder builder;
+	GVariant *value = NULL;
+	sqlite3_stmt *statement = NULL;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
+	g_return_val_if_fail (tdb->priv->db != NULL, NULL);
+
+	pk_transaction_db_wait_for_writes (tdb);
+	rc = sqlite3_prepare_v2 (tdb->priv->db,
+				 "SELECT p.info, p.data, p.version, p.timestamp, t.uid "
+				 "FROM transaction_packages AS p "
+				 "JOIN transactions AS t ON t.transaction_id = p.tid "
+				 "WHERE p.name = ? AND p.info IN (?, ?, ?) "
+				 "AND p.timestamp != 0 AND t.succeeded = 1 "
+				 "GROUP BY p.timestamp "
+				 "ORDER BY p.timestamp DESC LIMIT ?",
+				 -1, &statement, NULL);
+	if (rc != SQLITE_OK) {
+		g_warning ("failed to prepare statement: %s", sqlite3_errmsg (tdb->priv->db));
+		goto out;
+	}
+	sqlite3_bind_text (statement, 1, name, -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 2, PK_INFO_ENUM_INSTALLING);
+	sqlite3_bind_int (statement, 3, PK_INFO_ENUM_REMOVING);
+	sqlite3_bind_int (statement, 4, PK_INFO_ENUM_UPDATING);
+	sqlite3_bind_int (statement, 5, limit == 0 ? -1 : (gint) limit);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	while ((rc = sqlite3_step (statement)) == SQLITE_ROW) {
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&builder, "{sv}", "info",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 0)));
+		g_variant_builder_add (&builder, "{sv}", "source",
+				       g_variant_new_string ((const gchar *) sqlite3_column_text (statement, 1)));
+		g_variant_builder_add (&builder, "{sv}", "version",
+				       g_variant_new_string ((const gchar *) sqlite3_column_text (statement, 2)));
+		g_variant_builder_add (&builder, "{sv}", "timestamp",
+				       g_variant_new_uint64 (sqlite3_column_int64 (statement, 3)));
+		g_variant_builder_add (&builder, "{sv}", "user-id",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 4)));
+		g_variant_builder_close (&builder);
+	}
+	if (rc != SQLITE_DONE) {
+		g_warning ("failed to execute statement: %s", sqlite3_errmsg (tdb->priv->db));
+		g_variant_builder_clear (&builder);
+		goto out;
+	}
+	value = g_variant_builder_end (&builder);
+out:
+	if (statement != NULL)
+		sqlite3_finalize (statement);
+	return value;
+}
+
 gboolean
 pk_transaction_db_print (PkTransactionDb *tdb)
 {
@@ -429,31 +650,18 @@ pk_transaction_db_get_random_hex_string (guint length)
 static gboolean
 pk_transaction_db_defer_write_job_count_cb (PkTransactionDb *tdb)
 {
-	gchar *error_msg = NULL;
-	gint rc;
-	g_autofree gchar *statement = NULL;
+	PkTransactionDbWrite *write;
 
 	/* not loaded! */
-	if (tdb->priv->db == NULL) {
+	if (tdb->priv->writer == NULL) {
 		g_warning ("PkTransactionDb not loaded");
 		goto out;
 	}
 
-	/* force fsync as we don't want to repeat this number */
-	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=ON", NULL, NULL, NULL);
-
 	/* save the job count */
-	statement = g_strdup_printf ("UPDATE config SET value = '%i' WHERE key = 'job_count'",
-				     tdb->priv->job_count);
-	rc = sqlite3_exec (tdb->priv->db, statement, NULL, NULL, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("failed to set job id: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
-	}
-
-	/* turn off fsync */
-	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=OFF", NULL, NULL, NULL);
+	write = g_new0 (PkTransactionDbWrite, 1);
+	write->job_count = tdb->priv->job_count;
+	pk_transaction_db_queue_write (tdb, write);
 out:
 	tdb->priv->database_save_id = 0;
 	return FALSE;
@@ -752,6 +960,105 @@ out:
 	return ret;
 }
 
+static void
+pk_transaction_db_write_item (PkTransactionDb *tdb, PkTransactionDbItem *item)
+{
+	gint rc;
+	sqlite3_stmt *statement = tdb->priv->stmt_add_transaction;
+
+	sqlite3_bind_text (statement, 1, item->tid, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, item->timespec, -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 3, item->duration);
+	sqlite3_bind_int (statement, 4, item->succeeded);
+	sqlite3_bind_text (statement, 5, pk_role_enum_to_string (item->role), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 6, item->data, -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 7, item->uid);
+	sqlite3_bind_text (statement, 8, item->cmdline, -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	sqlite3_reset (statement);
+	if (rc != SQLITE_DONE) {
+		g_warning ("failed to save transaction %s: %s",
+			   item->tid, sqlite3_errmsg (tdb->priv->writer_db));
+		return;
+	}
+
+	if (!pk_strzero (item->data))
+		pk_transaction_db_add_packages (tdb->priv->stmt_add_package, item->tid, item->data);
+}
+
+static void
+pk_transaction_db_write_job_count (PkTransactionDb *tdb, guint job_count)
+{
+	gint rc;
+	sqlite3_stmt *statement = tdb->priv->stmt_job_count;
+
+	sqlite3_bind_int (statement, 1, job_count);
+	rc = sqlite3_step (statement);
+	sqlite3_reset (statement);
+	if (rc != SQLITE_DONE)
+		g_warning ("failed to set job id: %s", sqlite3_errmsg (tdb->priv->writer_db));
+}
+
+static gpointer
+pk_transaction_db_writer_thread (gpointer user_data)
+{
+	PkTransactionDb *tdb = PK_TRANSACTION_DB (user_data);
+	PkTransactionDbPrivate *priv = tdb->priv;
+	PkTransactionDbWrite *write;
+	gboolean sync_job_count;
+	GList *writes;
+	GList *l;
+	guint len;
+
+	g_mutex_lock (&priv->writes_mutex);
+	while (TRUE) {
+		while (g_queue_is_empty (priv->writes) && !priv->writes_shutdown)
+			g_cond_wait (&priv->writes_cond, &priv->writes_mutex);
+		if (g_queue_is_empty (priv->writes))
+			break;
+
+		/* save everything that was queued in one database transaction */
+		writes = priv->writes->head;
+		len = priv->writes->length;
+		g_queue_init (priv->writes);
+		g_mutex_unlock (&priv->writes_mutex);
+
+		/* force fsync as we don't want to repeat the job count */
+		sync_job_count = FALSE;
+		for (l = writes; l != NULL; l = l->next) {
+			write = l->data;
+			if (write->item == NULL)
+				sync_job_count = TRUE;
+		}
+		if (sync_job_count)
+			sqlite3_exec (priv->writer_db, "PRAGMA synchronous=FULL", NULL, NULL, NULL);
+
+		sqlite3_exec (priv->writer_db, "BEGIN", NULL, NULL, NULL);
+		for (l = writes; l != NULL; l = l->next) {
+			write = l->data;
+			if (write->item != NULL)
+				pk_transaction_db_write_item (tdb, write->item);
+			else
+				pk_transaction_db_write_job_count (tdb, write->job_count);
+		}
+		if (sqlite3_exec (priv->writer_db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+			g_warning ("failed to save transactions: %s",
+				   sqlite3_errmsg (priv->writer_db));
+			sqlite3_exec (priv->writer_db, "ROLLBACK", NULL, NULL, NULL);
+		}
+
+		if (sync_job_count)
+			sqlite3_exec (priv->writer_db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+		g_list_free_full (writes, (GDestroyNotify) pk_transaction_db_write_free);
+
+		g_mutex_lock (&priv->writes_mutex);
+		priv->writes_pending -= len;
+		g_cond_broadcast (&priv->writes_cond);
+	}
+	g_mutex_unlock (&priv->writes_mutex);
+	return NULL;
+}
+
 static void
 pk_transaction_db_class_init (PkTransactionDbClass *klass)
 {
@@ -790,6 +1097,108 @@ pk_transaction_db_execute (PkTransactionDb *tdb,
 	return ret;
 }
 
+static gboolean
+pk_transaction_db_backfill_packages (PkTransactionDb *tdb, GError **error)
+{
+	gboolean ret = FALSE;
+	gint rc;
+	sqlite3_stmt *statement = NULL;
+	sqlite3_stmt *statement_add = NULL;
+
+	rc = sqlite3_prepare_v2 (tdb->priv->db,
+				 "SELECT transaction_id, data FROM transactions WHERE data IS NOT NULL",
+				 -1, &statement, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0,
+			     "failed to prepare statement: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		goto out;
+	}
+
+	rc = sqlite3_prepare_v2 (tdb->priv->db, PK_TRANSACTION_DB_ADD_PACKAGE_SQL,
+				 -1, &statement_add, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0,
+			     "failed to prepare statement: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		goto out;
+	}
+
+	/* parse the package lists of all the old transactions in one go */
+	if (!pk_transaction_db_execute (tdb, "BEGIN", error))
+		goto out;
+	while ((rc = sqlite3_step (statement)) == SQLITE_ROW) {
+		pk_transaction_db_add_packages (statement_add,
+						(const gchar *) sqlite3_column_text (statement, 0),
+						(const gchar *) sqlite3_column_text (statement, 1));
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0,
+			     "failed to back-fill package history: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		pk_transaction_db_execute (tdb, "ROLLBACK", NULL);
+		goto out;
+	}
+	if (!pk_transaction_db_execute (tdb, "COMMIT", error))
+		goto out;
+
+	ret = TRUE;
+out:
+	if (statement != NULL)
+		sqlite3_finalize (statement);
+	if (statement_add != NULL)
+		sqlite3_finalize (statement_add);
+	return ret;
+}
+
+static gboolean
+pk_transaction_db_prepare (sqlite3 *db, const gchar *sql, sqlite3_stmt **statement, GError **error)
+{
+	if (sqlite3_prepare_v2 (db, sql, -1, statement, NULL) != SQLITE_OK) {
+		g_set_error (error, 1, 0,
+			     "failed to prepare statement '%s': %s",
+			     sql, sqlite3_errmsg (db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+pk_transaction_db_start_writer (PkTransactionDb *tdb, GError **error)
+{
+	PkTransactionDbPrivate *priv = tdb->priv;
+
+	/* the writer has its own connection, WAL lets the main loop read
+	 * while it writes */
+	if (sqlite3_open (PK_DB_DIR "/transactions.db", &priv->writer_db) != SQLITE_OK) {
+		g_set_error (error, 1, 0,
+			     "Can't open transaction database: %s",
+			     sqlite3_errmsg (priv->writer_db));
+		return FALSE;
+	}
+	sqlite3_busy_timeout (priv->writer_db, PK_TRANSACTION_DB_BUSY_TIMEOUT);
+	sqlite3_exec (priv->writer_db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+
+	if (!pk_transaction_db_prepare (priv->writer_db,
+					"INSERT OR REPLACE INTO transactions "
+					"(transaction_id, timespec, duration, succeeded, role, data, uid, cmdline) "
+					"VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+					&priv->stmt_add_transaction, error))
+		return FALSE;
+	if (!pk_transaction_db_prepare (priv->writer_db,
+					PK_TRANSACTION_DB_ADD_PACKAGE_SQL,
+					&priv->stmt_add_package, error))
+		return FALSE;
+	if (!pk_transaction_db_prepare (priv->writer_db,
+					"UPDATE config SET value = ? WHERE key = 'job_count'",
+					&priv->stmt_job_count, error))
+		return FALSE;
+
+	priv->writer = g_thread_new ("pk-transaction-db",
+				     pk_transaction_db_writer_thread, tdb);
+	return TRUE;
+}
+
 gboolean
 pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 {
@@ -818,9 +1227,12 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 		return FALSE;
 	}
 
-	/* we don't need to keep doing fsync */
-	if (!pk_transaction_db_execute (tdb, "PRAGMA synchronous=OFF", error))
+	/* only fsync the write-ahead log at checkpoints */
+	if (!pk_transaction_db_execute (tdb, "PRAGMA journal_mode=WAL", error))
 		return FALSE;
+	if (!pk_transaction_db_execute (tdb, "PRAGMA synchronous=NORMAL", error))
+		return FALSE;
+	sqlite3_busy_timeout (tdb->priv->db, PK_TRANSACTION_DB_BUSY_TIMEOUT);
 
 	/* check transactions */
 	if (!pk_transaction_db_execute (tdb, "SELECT * FROM transactions LIMIT 1", &error_local)) {
@@ -885,9 +1297,36 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 			return FALSE;
 	}
 
+	/* package history (since 1.2.1) */
+	if (!pk_transaction_db_execute (tdb, "SELECT * FROM transaction_packages LIMIT 1", &error_local)) {
+		g_debug ("adding table transaction_packages: %s", error_local->message);
+		g_clear_error (&error_local);
+		statement = "CREATE TABLE transaction_packages (tid TEXT, name TEXT, version TEXT, arch TEXT, data TEXT, info INTEGER, timestamp INTEGER);"
+			    "CREATE INDEX transaction_packages_name ON transaction_packages (name, timestamp);"
+			    "CREATE INDEX transaction_packages_timestamp ON transaction_packages (timestamp);";
+		if (!pk_transaction_db_execute (tdb, statement, error))
+			return FALSE;
+		if (!pk_transaction_db_backfill_packages (tdb, error))
+			return FALSE;
+	}
+
 	/* try to set correct permissions */
 	g_chmod (PK_DB_DIR "/transactions.db", 0644);
 
+	/* prepare the statements we use all the time */
+	if (!pk_transaction_db_prepare (tdb->priv->db,
+					"SELECT timespec FROM last_action WHERE role = ?",
+					&tdb->priv->stmt_time_since, error))
+		return FALSE;
+	if (!pk_transaction_db_prepare (tdb->priv->db,
+					"INSERT OR REPLACE INTO last_action (role, timespec) VALUES (?, ?)",
+					&tdb->priv->stmt_time_reset, error))
+		return FALSE;
+
+	/* save transactions without blocking the main loop */
+	if (!pk_transaction_db_start_writer (tdb, error))
+		return FALSE;
+
 	/* success */
 	tdb->priv->loaded = TRUE;
 	return TRUE;
@@ -897,6 +1336,11 @@ static void
 pk_transaction_db_init (PkTransactionDb *tdb)
 {
 	tdb->priv = PK_TRANSACTION_DB_GET_PRIVATE (tdb);
+	tdb->priv->items = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+						  (GDestroyNotify) pk_transaction_db_item_free);
+	tdb->priv->writes = g_queue_new ();
+	g_mutex_init (&tdb->priv->writes_mutex);
+	g_cond_init (&tdb->priv->writes_cond);
 }
 
 static void
@@ -909,13 +1353,33 @@ pk_transaction_db_finalize (GObject *object)
 
 	/* if we shutdown with a deferred database write, then enforce it here */
 	if (tdb->priv->database_save_id != 0) {
-		pk_transaction_db_defer_write_job_count_cb (tdb);
 		g_source_remove (tdb->priv->database_save_id);
+		pk_transaction_db_defer_write_job_count_cb (tdb);
+	}
+
+	/* save everything that is queued */
+	if (tdb->priv->writer != NULL) {
+		g_mutex_lock (&tdb->priv->writes_mutex);
+		tdb->priv->writes_shutdown = TRUE;
+		g_cond_broadcast (&tdb->priv->writes_cond);
+		g_mutex_unlock (&tdb->priv->writes_mutex);
+		g_thread_join (tdb->priv->writer);
 	}
 
 	/* close the database */
+	sqlite3_finalize (tdb->priv->stmt_time_since);
+	sqlite3_finalize (tdb->priv->stmt_time_reset);
+	sqlite3_finalize (tdb->priv->stmt_add_transaction);
+	sqlite3_finalize (tdb->priv->stmt_add_package);
+	sqlite3_finalize (tdb->priv->stmt_job_count);
+	sqlite3_close (tdb->priv->writer_db);
 	sqlite3_close (tdb->priv->db);
 
+	g_hash_table_unref (tdb->priv->items);
+	g_queue_free (tdb->priv->writes);
+	g_mutex_clear (&tdb->priv->writes_mutex);
+	g_cond_clear (&tdb->priv->writes_cond);
+
 	G_OBJECT_CLASS (pk_transaction_db_parent_class)->finalize (object);
 }
 
@@ -58,6 +58,8 @@ gboolean	 pk_transaction_db_load			(PkTransactionDb	*tdb,
 gboolean	 pk_transaction_db_empty		(PkTransactionDb	*tdb);
 gboolean	 pk_transaction_db_add			(PkTransactionDb	*tdb,
 							 const gchar		*tid);
+void		 pk_transaction_db_remove		(PkTransactionDb	*tdb,
+							 const gchar		*tid);
 gboolean	 pk_transaction_db_print		(PkTransactionDb	*tdb);
 gboolean	 pk_transaction_db_set_role		(PkTransactionDb	*tdb,
 							 const gchar		*tid,
@@ -77,6 +79,9 @@ gboolean	 pk_transaction_db_set_data		(PkTransactionDb	*tdb,
 							 const gchar		*data);
 GList		*pk_transaction_db_get_list		(PkTransactionDb	*tdb,
 							 guint			 limit);
+GVariant	*pk_transaction_db_get_package_history	(PkTransactionDb	*tdb,
+							 const gchar		*name,
+							 guint			 limit);
 gboolean	 pk_transaction_db_action_time_reset	(PkTransactionDb	*tdb,
 							 PkRoleEnum		 role);
 guint		 pk_transaction_db_action_time_since	(PkTransactionDb	*tdb,
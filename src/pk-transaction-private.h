@@ -28,6 +28,9 @@
 G_BEGIN_DECLS
 
 /* only here for the self test program to use */
+void	pk_transaction_get_distro_upgrades (PkTransaction *transaction,
+					 GVariant	*params,
+					 GDBusMethodInvocation *context);
 void	pk_transaction_get_updates	(PkTransaction	*transaction,
 					 GVariant	*params,
 					 GDBusMethodInvocation *context);
@@ -47,6 +50,7 @@ gboolean	 pk_transaction_filter_check			(const gchar	*filter,
 gboolean	 pk_transaction_strvalidate			(const gchar	*textr,
 								 GError		**error);
 gboolean	 pk_transaction_set_tid				(PkTransaction	*transaction,
+								 GDBusConnection *connection,
 								 const gchar	*tid);
 
 
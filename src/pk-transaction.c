@@ -49,9 +49,11 @@
 #include <packagekit-glib2/pk-results.h>
 #include <polkit/polkit.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
 #include "pk-dbus.h"
 #include "pk-shared.h"
+#include "pk-stats.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
 #include "pk-transaction-private.h"
@@ -66,6 +68,10 @@ static void     pk_transaction_dispose		(GObject	    *object);
 
 static gchar *pk_transaction_get_content_type_for_file (const gchar *filename, GError **error);
 static gboolean pk_transaction_is_supported_content_type (PkTransaction *transaction, const gchar *content_type);
+static void pk_transaction_method_call (GDBusConnection *connection_, const gchar *sender,
+					const gchar *object_path, const gchar *interface_name,
+					const gchar *method_name, GVariant *parameters,
+					GDBusMethodInvocation *invocation, gpointer user_data);
 
 #define PK_TRANSACTION_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION, PkTransactionPrivate))
 #define PK_TRANSACTION_UPDATES_CHANGED_TIMEOUT	100 /* ms */
@@ -79,10 +85,14 @@ static gboolean pk_transaction_is_supported_content_type (PkTransaction *transac
 /* maximum number of packages that can be processed in one go */
 #define PK_TRANSACTION_MAX_PACKAGES_TO_PROCESS	5200
 
+/* how often changed properties are sent to clients, in ms */
+#define PK_TRANSACTION_PROPERTIES_CHANGED_INTERVAL	100
+
 struct PkTransactionPrivate
 {
 	PkRoleEnum		 role;
 	PkStatusEnum		 status;
+	PkStatusEnum		 status_before_suspend;
 	PkTransactionState	 state;
 	guint			 percentage;
 	guint			 elapsed_time;
@@ -97,22 +107,29 @@ struct PkTransactionPrivate
 	gboolean		 caller_active;
 	gboolean		 exclusive;
 	guint			 uid;
-	guint			 watch_id;
+	guint			 vanished_id;
+	gboolean		 credentials_pending;
+	gchar			*refused_reason;
+	GPtrArray		*pending_calls;		/* of PkTransactionCall */
 	PkBackend		*backend;
 	PkBackendJob		*job;
 	GKeyFile		*conf;
 	PkDbus			*dbus;
-	PolkitAuthority		*authority;
+	PkAuthCache		*auth_cache;
+	PkStats			*stats;
+	gint64			 timestamps[PK_STATS_PHASE_LAST];
 	PolkitSubject		*subject;
 	GCancellable		*cancellable;
 	gboolean		 skip_auth_check;
 
 	/* needed for gui coldplugging */
-	gchar			*last_package_id;
+	const gchar		*last_package_id;	/* interned */
 	gchar			*tid;
 	gchar			*sender;
 	gchar			*cmdline;
+	gchar			*solution_token;
 	PkResults		*results;
+	guint			 cache_generation;
 	PkTransactionDb		*transaction_db;
 
 	/* cached */
@@ -134,12 +151,20 @@ struct PkTransactionPrivate
 	gchar			*cached_directory;
 	gchar			*cached_cat_id;
 	PkUpgradeKindEnum	 cached_upgrade_kind;
-	GPtrArray		*supported_content_types;
-	guint			 registration_id;
 	GDBusConnection		*connection;
 	GDBusNodeInfo		*introspection;
+	GHashTable		*changed_properties;	/* name:GVariant */
+	guint			 changed_properties_id;
+	guint			 changed_properties_interval;
 };
 
+/* a method call that arrived before the caller credentials */
+typedef struct {
+	gchar			*method_name;
+	GVariant		*parameters;
+	GDBusMethodInvocation	*invocation;
+} PkTransactionCall;
+
 typedef enum {
 	PK_TRANSACTION_ERROR_DENIED,
 	PK_TRANSACTION_ERROR_NOT_RUNNING,
@@ -170,11 +195,18 @@ enum {
 	SIGNAL_FINISHED,
 	SIGNAL_STATE_CHANGED,
 	SIGNAL_ALLOW_CANCEL_CHANGED,
+	SIGNAL_UID_KNOWN,
 	SIGNAL_LAST
 };
 
 static guint signals[SIGNAL_LAST] = { 0 };
 
+/* every TID is a child of "/", so all the transactions are exported
+ * through one subtree rather than registering an object for each */
+static GDBusConnection *pk_transaction_subtree_connection = NULL;
+static GHashTable *pk_transaction_subtree_nodes = NULL;
+static guint pk_transaction_subtree_id = 0;
+
 G_DEFINE_TYPE (PkTransaction, pk_transaction, G_TYPE_OBJECT)
 
 GQuark
@@ -290,6 +322,9 @@ pk_transaction_finish_invalidate_caches (PkTransaction *transaction)
 	    priv->role == PK_ROLE_ENUM_REPO_REMOVE ||
 	    priv->role == PK_ROLE_ENUM_REFRESH_CACHE) {
 
+		/* the cached results are wrong now, not after the delay */
+		pk_backend_invalidate_results_cache (priv->backend);
+
 		/* this needs to be done after a small delay */
 		pk_backend_updates_changed_delay (priv->backend,
 						  PK_TRANSACTION_UPDATES_CHANGED_TIMEOUT);
@@ -299,30 +334,115 @@ out:
 }
 
 static void
-pk_transaction_emit_property_changed (PkTransaction *transaction,
-				      const gchar *property_name,
-				      GVariant *property_value)
+pk_transaction_emit_signal (PkTransaction *transaction,
+			    const gchar *interface_name,
+			    const gchar *signal_name,
+			    GVariant *parameters)
 {
+	gsize size = 0;
+
+	if (parameters != NULL) {
+		g_variant_ref_sink (parameters);
+		size = g_variant_get_size (parameters);
+	}
+	pk_stats_add_signal (transaction->priv->stats, signal_name, size);
+	g_dbus_connection_emit_signal (transaction->priv->connection,
+				       NULL,
+				       transaction->priv->tid,
+				       interface_name,
+				       signal_name,
+				       parameters,
+				       NULL);
+	if (parameters != NULL)
+		g_variant_unref (parameters);
+}
+
+static void
+pk_transaction_set_timestamp (PkTransaction *transaction, PkStatsPhase phase)
+{
+	if (transaction->priv->timestamps[phase] == 0)
+		transaction->priv->timestamps[phase] = g_get_monotonic_time ();
+}
+
+static void
+pk_transaction_flush_properties (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	GHashTableIter iter;
 	GVariantBuilder builder;
 	GVariantBuilder invalidated_builder;
+	gpointer key;
+	gpointer value;
+
+	if (priv->changed_properties_id > 0) {
+		g_source_remove (priv->changed_properties_id);
+		priv->changed_properties_id = 0;
+	}
+	if (g_hash_table_size (priv->changed_properties) == 0)
+		return;
+
+	/* not exported on the bus yet */
+	if (priv->connection == NULL) {
+		g_hash_table_remove_all (priv->changed_properties);
+		return;
+	}
 
 	/* build the dict */
 	g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	g_variant_builder_add (&builder,
-			       "{sv}",
-			       property_name,
-			       property_value);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       "org.freedesktop.DBus.Properties",
-				       "PropertiesChanged",
-				       g_variant_new ("(sa{sv}as)",
-						      PK_DBUS_INTERFACE_TRANSACTION,
-						      &builder,
-						      &invalidated_builder),
-				       NULL);
+	g_hash_table_iter_init (&iter, priv->changed_properties);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder, "{sv}", key, value);
+	g_hash_table_remove_all (priv->changed_properties);
+	pk_transaction_emit_signal (transaction,
+				    "org.freedesktop.DBus.Properties",
+				    "PropertiesChanged",
+				    g_variant_new ("(sa{sv}as)",
+						   PK_DBUS_INTERFACE_TRANSACTION,
+						   &builder,
+						   &invalidated_builder));
+}
+
+static gboolean
+pk_transaction_flush_properties_cb (gpointer user_data)
+{
+	PkTransaction *transaction = PK_TRANSACTION (user_data);
+	transaction->priv->changed_properties_id = 0;
+	pk_transaction_flush_properties (transaction);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * pk_transaction_emit_property_changed:
+ *
+ * Backends can report progress hundreds of times a second, so changes are
+ * collected and sent as one PropertiesChanged at most once per interval.
+ * Only the latest value of each property is sent.
+ */
+static void
+pk_transaction_emit_property_changed (PkTransaction *transaction,
+				      const gchar *property_name,
+				      GVariant *property_value)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	g_hash_table_insert (priv->changed_properties,
+			     (gpointer) property_name,
+			     g_variant_ref_sink (property_value));
+
+	/* coalescing disabled */
+	if (priv->changed_properties_interval == 0) {
+		pk_transaction_flush_properties (transaction);
+		return;
+	}
+	if (priv->changed_properties_id == 0) {
+		priv->changed_properties_id =
+			g_timeout_add (priv->changed_properties_interval,
+				       pk_transaction_flush_properties_cb,
+				       transaction);
+		g_source_set_name_by_id (priv->changed_properties_id,
+					 "[PkTransaction] properties-changed");
+	}
 }
 
 static void
@@ -387,23 +507,52 @@ pk_transaction_status_changed_emit (PkTransaction *transaction, PkStatusEnum sta
 					      g_variant_new_uint32 (status));
 }
 
+static void
+pk_transaction_flushed_cb (GObject *source_object,
+			   GAsyncResult *res,
+			   gpointer user_data)
+{
+	g_autoptr(PkTransaction) transaction = PK_TRANSACTION (user_data);
+	g_autoptr(GError) error = NULL;
+
+	if (!g_dbus_connection_flush_finish (G_DBUS_CONNECTION (source_object), res, &error))
+		g_debug ("failed to flush %s: %s", transaction->priv->tid, error->message);
+	else
+		pk_transaction_set_timestamp (transaction, PK_STATS_PHASE_FLUSHED);
+	pk_stats_add_transaction (transaction->priv->stats,
+				  transaction->priv->role,
+				  transaction->priv->timestamps);
+}
+
 static void
 pk_transaction_finished_emit (PkTransaction *transaction,
 			      PkExitEnum exit_enum,
 			      guint time_ms)
 {
+	gboolean finished_before;
+
 	g_debug ("emitting finished '%s', %i",
 		 pk_exit_enum_to_string (exit_enum),
 		 time_ms);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Finished",
-				       g_variant_new ("(uu)",
-						      exit_enum,
-						      time_ms),
-				       NULL);
+
+	/* clients expect the final progress before ::Finished() */
+	pk_transaction_flush_properties (transaction);
+	finished_before = transaction->priv->timestamps[PK_STATS_PHASE_FINISHED] != 0;
+	pk_transaction_set_timestamp (transaction, PK_STATS_PHASE_FINISHED);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Finished",
+				    g_variant_new ("(uu)",
+						   exit_enum,
+						   time_ms));
+
+	/* record the timings once ::Finished() has left the daemon */
+	if (!finished_before) {
+		g_dbus_connection_flush (transaction->priv->connection,
+					 NULL,
+					 pk_transaction_flushed_cb,
+					 g_object_ref (transaction));
+	}
 
 	/* For the transaction list */
 	g_signal_emit (transaction, signals[SIGNAL_FINISHED], 0);
@@ -417,15 +566,13 @@ pk_transaction_error_code_emit (PkTransaction *transaction,
 	g_debug ("emitting error-code %s, '%s'",
 		 pk_error_enum_to_string (error_enum),
 		 details);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "ErrorCode",
-				       g_variant_new ("(us)",
-						      error_enum,
-						      details),
-				       NULL);
+	pk_transaction_flush_properties (transaction);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "ErrorCode",
+				    g_variant_new ("(us)",
+						   error_enum,
+						   details));
 }
 
 static void
@@ -501,13 +648,10 @@ pk_transaction_details_cb (PkBackendJob *job,
 		g_variant_builder_add (&builder, "{sv}", "size",
 				       g_variant_new_uint64 (size));
 
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Details",
-				       g_variant_new ("(a{sv})", &builder),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Details",
+				    g_variant_new ("(a{sv})", &builder));
 }
 
 static void
@@ -580,15 +724,12 @@ pk_transaction_files_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting files %s", package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Files",
-				       g_variant_new ("(s^as)",
-						      package_id != NULL ? package_id : "",
-						      files),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Files",
+				    g_variant_new ("(s^as)",
+						   package_id != NULL ? package_id : "",
+						   files));
 }
 
 static void
@@ -619,18 +760,15 @@ pk_transaction_category_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting category %s, %s, %s, %s, %s ", parent_id, cat_id, name, summary, icon);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Category",
-				       g_variant_new ("(sssss)",
-						      parent_id != NULL ? parent_id : "",
-						      cat_id,
-						      name,
-						      summary,
-						      icon != NULL ? icon : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Category",
+				    g_variant_new ("(sssss)",
+						   parent_id != NULL ? parent_id : "",
+						   cat_id,
+						   name,
+						   summary,
+						   icon != NULL ? icon : ""));
 }
 
 static void
@@ -646,16 +784,13 @@ pk_transaction_item_progress_cb (PkBackendJob *job,
 		 pk_item_progress_get_package_id (item_progress),
 		 pk_status_enum_to_string (pk_item_progress_get_status (item_progress)),
 		 pk_item_progress_get_percentage (item_progress));
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "ItemProgress",
-				       g_variant_new ("(suu)",
-						      pk_item_progress_get_package_id (item_progress),
-						      pk_item_progress_get_status (item_progress),
-						      pk_item_progress_get_percentage (item_progress)),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "ItemProgress",
+				    g_variant_new ("(suu)",
+						   pk_item_progress_get_package_id (item_progress),
+						   pk_item_progress_get_status (item_progress),
+						   pk_item_progress_get_percentage (item_progress)));
 }
 
 static void
@@ -684,16 +819,13 @@ pk_transaction_distro_upgrade_cb (PkBackendJob *job,
 	g_debug ("emitting distro-upgrade %s, %s, %s",
 		 pk_distro_upgrade_enum_to_string (state),
 		 name, summary);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "DistroUpgrade",
-				       g_variant_new ("(uss)",
-						      state,
-						      name,
-						      summary != NULL ? summary : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "DistroUpgrade",
+				    g_variant_new ("(uss)",
+						   state,
+						   name,
+						   summary != NULL ? summary : ""));
 }
 
 static gchar *
@@ -765,6 +897,10 @@ pk_transaction_set_state (PkTransaction *transaction, PkTransactionState state)
 
 	g_debug ("transaction now %s", pk_transaction_state_to_string (state));
 	priv->state = state;
+	if (state == PK_TRANSACTION_STATE_READY)
+		pk_transaction_set_timestamp (transaction, PK_STATS_PHASE_QUEUED);
+	else if (state == PK_TRANSACTION_STATE_RUNNING)
+		pk_transaction_set_timestamp (transaction, PK_STATS_PHASE_BACKEND_STARTED);
 	g_signal_emit (transaction, signals[SIGNAL_STATE_CHANGED], 0, state);
 
 	/* only save into the database for useful stuff */
@@ -782,7 +918,9 @@ pk_transaction_set_state (PkTransaction *transaction, PkTransactionState state)
 		/* save uid */
 		pk_transaction_db_set_uid (priv->transaction_db, priv->tid, priv->uid);
 
-		/* save cmdline in db */
+		/* save cmdline in db, the PID is already known */
+		if (priv->cmdline == NULL)
+			priv->cmdline = pk_dbus_get_cmdline (priv->dbus, priv->sender);
 		if (priv->cmdline != NULL)
 			pk_transaction_db_set_cmdline (priv->transaction_db, priv->tid, priv->cmdline);
 
@@ -824,20 +962,6 @@ pk_transaction_get_uid (PkTransaction *transaction)
 	return transaction->priv->uid;
 }
 
-static void
-pk_transaction_setup_mime_types (PkTransaction *transaction)
-{
-	guint i;
-	g_auto(GStrv) mime_types = NULL;
-
-	/* get list of mime types supported by backends */
-	mime_types = pk_backend_get_mime_types (transaction->priv->backend);
-	for (i = 0; mime_types[i] != NULL; i++) {
-		g_ptr_array_add (transaction->priv->supported_content_types,
-				 g_strdup (mime_types[i]));
-	}
-}
-
 void
 pk_transaction_set_backend (PkTransaction *transaction,
 			    PkBackend *backend)
@@ -846,9 +970,6 @@ pk_transaction_set_backend (PkTransaction *transaction,
 	if (transaction->priv->backend != NULL)
 		g_object_unref (transaction->priv->backend);
 	transaction->priv->backend = g_object_ref (backend);
-
-	/* setup supported mime types */
-	pk_transaction_setup_mime_types (transaction);
 }
 
 /**
@@ -1057,6 +1178,28 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
 		pk_transaction_finish_invalidate_caches (transaction);
 
+	/* let the client commit the solution of the simulate */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE) &&
+	    pk_backend_job_get_solution_token (job) != NULL) {
+		transaction->priv->solution_token = g_strdup (pk_backend_job_get_solution_token (job));
+		pk_transaction_emit_property_changed (transaction,
+						      "SolutionToken",
+						      g_variant_new_string (transaction->priv->solution_token));
+	}
+
+	/* save the results so the same query can be answered without the backend */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    (transaction->priv->role == PK_ROLE_ENUM_GET_UPDATES ||
+	     transaction->priv->role == PK_ROLE_ENUM_GET_PACKAGES)) {
+		pk_backend_set_cached_results (transaction->priv->backend,
+					       transaction->priv->cache_generation,
+					       transaction->priv->role,
+					       transaction->priv->cached_filters,
+					       pk_backend_job_get_locale (transaction->priv->job),
+					       transaction->priv->results);
+	}
+
 	/* find the length of time we have been running */
 	time_ms = pk_transaction_get_runtime (transaction);
 	g_debug ("backend was running for %i ms", time_ms);
@@ -1200,8 +1343,8 @@ pk_transaction_package_cb (PkBackend *backend,
 
 	/* emit */
 	package_id = pk_package_get_id (item);
-	g_free (transaction->priv->last_package_id);
-	transaction->priv->last_package_id = g_strdup (package_id);
+	pk_ref_string_release (transaction->priv->last_package_id);
+	transaction->priv->last_package_id = pk_ref_string_acquire (package_id);
 	summary = pk_package_get_summary (item);
 	if (transaction->priv->role != PK_ROLE_ENUM_GET_PACKAGES) {
 		g_debug ("emit package %s, %s, %s",
@@ -1209,16 +1352,14 @@ pk_transaction_package_cb (PkBackend *backend,
 			 package_id,
 			 summary);
 	}
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Package",
-				       g_variant_new ("(uss)",
-						      info,
-						      package_id,
-						      summary ? summary : ""),
-				       NULL);
+	pk_transaction_set_timestamp (transaction, PK_STATS_PHASE_FIRST_PACKAGE);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Package",
+				    g_variant_new ("(uss)",
+						   info,
+						   package_id,
+						   summary ? summary : ""));
 }
 
 static void
@@ -1241,16 +1382,13 @@ pk_transaction_repo_detail_cb (PkBackend *backend,
 	description = pk_repo_detail_get_description (item);
 	enabled = pk_repo_detail_get_enabled (item);
 	g_debug ("emitting repo-detail %s, %s, %i", repo_id, description, enabled);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RepoDetail",
-				       g_variant_new ("(ssb)",
-						      repo_id,
-						      description != NULL ? description : "",
-						      enabled),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "RepoDetail",
+				    g_variant_new ("(ssb)",
+						   repo_id,
+						   description != NULL ? description : "",
+						   enabled));
 }
 
 static void
@@ -1290,21 +1428,18 @@ pk_transaction_repo_signature_required_cb (PkBackend *backend,
 		 package_id, repository_name, key_url, key_userid, key_id,
 		 key_fingerprint, key_timestamp,
 		 pk_sig_type_enum_to_string (type));
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RepoSignatureRequired",
-				       g_variant_new ("(sssssssu)",
-						      package_id,
-						      repository_name,
-						      key_url != NULL ? key_url : "",
-						      key_userid != NULL ? key_userid : "",
-						      key_id != NULL ? key_id : "",
-						      key_fingerprint != NULL ? key_fingerprint : "",
-						      key_timestamp != NULL ? key_timestamp : "",
-						      type),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "RepoSignatureRequired",
+				    g_variant_new ("(sssssssu)",
+						   package_id,
+						   repository_name,
+						   key_url != NULL ? key_url : "",
+						   key_userid != NULL ? key_userid : "",
+						   key_id != NULL ? key_id : "",
+						   key_fingerprint != NULL ? key_fingerprint : "",
+						   key_timestamp != NULL ? key_timestamp : "",
+						   type));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_signature_required = TRUE;
@@ -1335,17 +1470,14 @@ pk_transaction_eula_required_cb (PkBackend *backend,
 	/* emit */
 	g_debug ("emitting eula-required %s, %s, %s, %s",
 		   eula_id, package_id, vendor_name, license_agreement);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "EulaRequired",
-				       g_variant_new ("(ssss)",
-						      eula_id,
-						      package_id,
-						      vendor_name != NULL ? vendor_name : "",
-						      license_agreement != NULL ? license_agreement : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "EulaRequired",
+				    g_variant_new ("(ssss)",
+						   eula_id,
+						   package_id,
+						   vendor_name != NULL ? vendor_name : "",
+						   license_agreement != NULL ? license_agreement : ""));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_eula_required = TRUE;
@@ -1378,16 +1510,13 @@ pk_transaction_media_change_required_cb (PkBackend *backend,
 		 pk_media_type_enum_to_string (media_type),
 		 media_id,
 		 media_text);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "MediaChangeRequired",
-				       g_variant_new ("(uss)",
-						      media_type,
-						      media_id,
-						      media_text != NULL ? media_text : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "MediaChangeRequired",
+				    g_variant_new ("(uss)",
+						   media_type,
+						   media_id,
+						   media_text != NULL ? media_text : ""));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_media_change_required = TRUE;
@@ -1443,15 +1572,12 @@ pk_transaction_require_restart_cb (PkBackend *backend,
 	g_debug ("emitting require-restart %s, '%s'",
 		 pk_restart_enum_to_string (restart),
 		 package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RequireRestart",
-				       g_variant_new ("(us)",
-						      restart,
-						      package_id),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "RequireRestart",
+				    g_variant_new ("(us)",
+						   restart,
+						   package_id));
 }
 
 static void
@@ -1511,25 +1637,22 @@ pk_transaction_update_detail_cb (PkBackend *backend,
 	issued = pk_update_detail_get_issued (item);
 	updated = pk_update_detail_get_updated (item);
 	g_debug ("emitting update-detail for %s", package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "UpdateDetail",
-				       g_variant_new ("(s^as^as^as^as^asussuss)",
-						      package_id,
-						      updates != NULL ? updates : empty,
-						      obsoletes != NULL ? obsoletes : empty,
-						      vendor_urls != NULL ? vendor_urls : empty,
-						      bugzilla_urls != NULL ? bugzilla_urls : empty,
-						      cve_urls != NULL ? cve_urls : empty,
-						      pk_update_detail_get_restart (item),
-						      update_text != NULL ? update_text : "",
-						      changelog != NULL ? changelog : "",
-						      pk_update_detail_get_state (item),
-						      issued != NULL ? issued : "",
-						      updated != NULL ? updated : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "UpdateDetail",
+				    g_variant_new ("(s^as^as^as^as^asussuss)",
+						   package_id,
+						   updates != NULL ? updates : empty,
+						   obsoletes != NULL ? obsoletes : empty,
+						   vendor_urls != NULL ? vendor_urls : empty,
+						   bugzilla_urls != NULL ? bugzilla_urls : empty,
+						   cve_urls != NULL ? cve_urls : empty,
+						   pk_update_detail_get_restart (item),
+						   update_text != NULL ? update_text : "",
+						   changelog != NULL ? changelog : "",
+						   pk_update_detail_get_state (item),
+						   issued != NULL ? issued : "",
+						   updated != NULL ? updated : ""));
 }
 
 static gboolean
@@ -1625,6 +1748,47 @@ pk_transaction_percentage_cb (PkBackendJob *job,
 					      g_variant_new_uint32 (percentage));
 }
 
+/**
+ * pk_transaction_replay_cached_results:
+ *
+ * Emits the results of the last identical query if nothing has changed
+ * since, rather than asking the backend to work them out again.
+ *
+ * Return value: %TRUE if the cached results were used
+ **/
+static gboolean
+pk_transaction_replay_cached_results (PkTransaction *transaction)
+{
+	PkPackage *item;
+	PkResults *results;
+	PkTransactionPrivate *priv = transaction->priv;
+	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* the results we get are only valid for this generation */
+	priv->cache_generation = pk_backend_get_cache_generation (priv->backend);
+	results = pk_backend_get_cached_results (priv->backend,
+						 priv->role,
+						 priv->cached_filters,
+						 pk_backend_job_get_locale (priv->job));
+	if (results == NULL)
+		return FALSE;
+
+	g_debug ("using cached results for %s",
+		 pk_role_enum_to_string (priv->role));
+	pk_backend_job_set_status (priv->job, PK_STATUS_ENUM_QUERY);
+	array = pk_results_get_package_array (results);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		pk_backend_job_package (priv->job,
+					pk_package_get_info (item),
+					pk_package_get_id (item),
+					pk_package_get_summary (item));
+	}
+	pk_backend_job_finished (priv->job);
+	return TRUE;
+}
+
 gboolean
 pk_transaction_run (PkTransaction *transaction)
 {
@@ -1824,11 +1988,15 @@ pk_transaction_run (PkTransaction *transaction)
 					  priv->cached_values);
 		break;
 	case PK_ROLE_ENUM_GET_UPDATES:
+		if (pk_transaction_replay_cached_results (transaction))
+			break;
 		pk_backend_get_updates (priv->backend,
 					priv->job,
 					priv->cached_filters);
 		break;
 	case PK_ROLE_ENUM_GET_PACKAGES:
+		if (pk_transaction_replay_cached_results (transaction))
+			break;
 		pk_backend_get_packages (priv->backend,
 					 priv->job,
 					 priv->cached_filters);
@@ -1979,7 +2147,7 @@ pk_transaction_make_exclusive (PkTransaction *transaction)
 }
 
 static void
-pk_transaction_vanished_cb (GDBusConnection *connection,
+pk_transaction_vanished_cb (PkDbus *dbus,
 			    const gchar *name,
 			    gpointer user_data)
 {
@@ -1987,6 +2155,12 @@ pk_transaction_vanished_cb (GDBusConnection *connection,
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 
+	/* PkDbus watches each sender once for all transactions */
+	if (g_strcmp0 (name, transaction->priv->sender) != 0)
+		return;
+	if (!transaction->priv->caller_active)
+		return;
+
 	transaction->priv->caller_active = FALSE;
 
 	/* emit */
@@ -1995,6 +2169,84 @@ pk_transaction_vanished_cb (GDBusConnection *connection,
 					      g_variant_new_boolean (transaction->priv->caller_active));
 }
 
+static void
+pk_transaction_call_free (PkTransactionCall *call)
+{
+	g_free (call->method_name);
+	g_variant_unref (call->parameters);
+	g_object_unref (call->invocation);
+	g_free (call);
+}
+
+static void
+pk_transaction_get_credentials_cb (GObject *source_object,
+				   GAsyncResult *res,
+				   gpointer user_data)
+{
+	g_autoptr(PkTransaction) transaction = PK_TRANSACTION (user_data);
+	PkTransactionPrivate *priv = transaction->priv;
+	guint i;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) calls = NULL;
+
+	/* keep going as before if we cannot get the UID */
+	if (!pk_dbus_get_credentials_finish (PK_DBUS (source_object), res,
+					     &priv->uid, NULL, &error))
+		g_warning ("cannot get UID: %s", error->message);
+	priv->credentials_pending = FALSE;
+	pk_transaction_emit_property_changed (transaction,
+					      "Uid",
+					      g_variant_new_uint32 (priv->uid));
+
+	/* the scheduler can only now apply the per-uid limit */
+	calls = g_steal_pointer (&priv->pending_calls);
+	priv->pending_calls = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_transaction_call_free);
+	if (priv->uid != PK_TRANSACTION_UID_INVALID)
+		g_signal_emit (transaction, signals[SIGNAL_UID_KNOWN], 0, priv->uid);
+	if (priv->refused_reason != NULL) {
+		for (i = 0; i < calls->len; i++) {
+			PkTransactionCall *call = g_ptr_array_index (calls, i);
+			g_dbus_method_invocation_return_error (call->invocation,
+							       PK_TRANSACTION_ERROR,
+							       PK_TRANSACTION_ERROR_REFUSED_BY_POLICY,
+							       "%s", priv->refused_reason);
+		}
+		pk_transaction_set_state (transaction, PK_TRANSACTION_STATE_ERROR);
+		return;
+	}
+
+	/* run the methods that were called while we were waiting */
+	for (i = 0; i < calls->len; i++) {
+		PkTransactionCall *call = g_ptr_array_index (calls, i);
+		pk_transaction_method_call (priv->connection,
+					    priv->sender,
+					    priv->tid,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    call->method_name,
+					    call->parameters,
+					    call->invocation,
+					    transaction);
+	}
+}
+
+/**
+ * pk_transaction_refuse:
+ * @reason: the error message for the client
+ *
+ * Fails the method calls that were waiting for the credentials of the
+ * caller, for instance from the ::uid-known handler when the caller has
+ * too many transactions.
+ **/
+void
+pk_transaction_refuse (PkTransaction *transaction, const gchar *reason)
+{
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (reason != NULL);
+
+	g_free (transaction->priv->refused_reason);
+	transaction->priv->refused_reason = g_strdup (reason);
+}
+
 gboolean
 pk_transaction_set_sender (PkTransaction *transaction, const gchar *sender)
 {
@@ -2008,30 +2260,26 @@ pk_transaction_set_sender (PkTransaction *transaction, const gchar *sender)
 	g_debug ("setting sender to %s", sender);
 	priv->sender = g_strdup (sender);
 
-	priv->watch_id =
-		g_bus_watch_name (G_BUS_TYPE_SYSTEM,
-				  sender,
-				  G_BUS_NAME_WATCHER_FLAGS_NONE,
-				  NULL,
-				  pk_transaction_vanished_cb,
-				  transaction,
-				  NULL);
-
 	/* we get the UID for all callers as we need to know when to cancel */
 	priv->subject = polkit_system_bus_name_new (sender);
 	if (!pk_dbus_connect (priv->dbus, &error)) {
 		g_warning ("cannot get UID: %s", error->message);
 		return FALSE;
 	}
-	priv->uid = pk_dbus_get_uid (priv->dbus, sender);
+	priv->vanished_id =
+		g_signal_connect (priv->dbus, "sender-vanished",
+				  G_CALLBACK (pk_transaction_vanished_cb),
+				  transaction);
 
-	/* only get when it's going to be saved into the database */
-	if (priv->role == PK_ROLE_ENUM_REMOVE_PACKAGES ||
-	    priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
-	    priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
-		priv->cmdline = pk_dbus_get_cmdline (priv->dbus, sender);
-	}
+	/* the caller already created a transaction on this connection */
+	if (pk_dbus_lookup_credentials (priv->dbus, sender, &priv->uid, NULL))
+		return TRUE;
 
+	/* don't block the main loop, method calls wait for the reply instead */
+	priv->credentials_pending = TRUE;
+	pk_dbus_get_credentials_async (priv->dbus, sender, NULL,
+				       pk_transaction_get_credentials_cb,
+				       g_object_ref (transaction));
 	return TRUE;
 }
 
@@ -2175,7 +2423,7 @@ pk_transaction_authorize_actions_finished_cb (GObject *source_object,
 	action_id = g_ptr_array_index (data->actions, 0);
 
 	/* finish the call */
-	result = polkit_authority_check_authorization_finish (priv->authority, res, &error);
+	result = pk_auth_cache_check_finish (priv->auth_cache, res, &error);
 
 	/* failed because the request was cancelled */
 	if (g_cancellable_is_cancelled (priv->cancellable)) {
@@ -2219,6 +2467,7 @@ pk_transaction_authorize_actions_finished_cb (GObject *source_object,
 	if (data->actions->len <= 1) {
 		/* authentication finished successfully */
 		priv->waiting_for_auth = FALSE;
+		pk_transaction_set_timestamp (data->transaction, PK_STATS_PHASE_AUTHORIZED);
 		pk_transaction_set_state (data->transaction, PK_TRANSACTION_STATE_READY);
 		/* log success too */
 		syslog (LOG_AUTH | LOG_INFO,
@@ -2345,26 +2594,15 @@ pk_transaction_authorize_actions (PkTransaction *transaction,
 	data->role = role;
 	data->actions = g_ptr_array_ref (actions);
 
-	/* create if required */
-	if (priv->authority == NULL) {
-		g_autoptr(GError) error = NULL;
-		priv->authority = polkit_authority_get_sync (NULL, &error);
-		if (priv->authority == NULL) {
-			g_warning ("failed to get polkit authority: %s", error->message);
-			return FALSE;
-		}
-	}
-
 	g_debug ("authorizing action %s", action_id);
-	/* do authorization async */
-	polkit_authority_check_authorization (priv->authority,
-					      priv->subject,
-					      action_id,
-					      details,
-					      POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
-					      priv->cancellable,
-					      (GAsyncReadyCallback) pk_transaction_authorize_actions_finished_cb,
-					      data);
+	/* do authorization async, reusing a recent result for the same subject */
+	pk_auth_cache_check_async (priv->auth_cache,
+				   priv->subject,
+				   action_id,
+				   details,
+				   priv->cancellable,
+				   (GAsyncReadyCallback) pk_transaction_authorize_actions_finished_cb,
+				   data);
 	return TRUE;
 }
 
@@ -2638,6 +2876,64 @@ pk_transaction_cancel_bg (PkTransaction *transaction)
 	pk_backend_cancel (transaction->priv->backend, transaction->priv->job);
 }
 
+/**
+ * pk_transaction_suspend:
+ *
+ * Pauses a running transaction instead of cancelling it, if the backend
+ * can resume its role. The backend job keeps its thread or helper and any
+ * partial downloads until pk_transaction_resume() is called.
+ *
+ * Return value: %FALSE if the transaction cannot be suspended
+ **/
+gboolean
+pk_transaction_suspend (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+
+	if (priv->state != PK_TRANSACTION_STATE_RUNNING ||
+	    !pk_backend_job_get_started (priv->job))
+		return FALSE;
+	if (pk_backend_job_get_suspended (priv->job))
+		return TRUE;
+	if (!pk_bitfield_contain (pk_backend_get_resumable_roles (priv->backend),
+				  priv->role))
+		return FALSE;
+
+	g_debug ("suspending %s", priv->tid);
+	pk_backend_suspend_job (priv->backend, priv->job);
+	priv->status_before_suspend = priv->status;
+	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_WAIT);
+	return TRUE;
+}
+
+/**
+ * pk_transaction_resume:
+ **/
+void
+pk_transaction_resume (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+
+	if (!pk_transaction_get_suspended (transaction))
+		return;
+
+	g_debug ("resuming %s", priv->tid);
+	if (priv->status == PK_STATUS_ENUM_WAIT)
+		pk_transaction_status_changed_emit (transaction, priv->status_before_suspend);
+	pk_backend_resume_job (priv->backend, priv->job);
+}
+
+gboolean
+pk_transaction_get_suspended (PkTransaction *transaction)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+	return pk_backend_job_get_suspended (transaction->priv->job);
+}
+
 static void
 pk_transaction_cancel (PkTransaction *transaction,
 		       GVariant *params,
@@ -3199,7 +3495,7 @@ out:
 	pk_transaction_dbus_return (context, error);
 }
 
-static void
+void
 pk_transaction_get_distro_upgrades (PkTransaction *transaction,
 				    GVariant *params,
 				    GDBusMethodInvocation *context)
@@ -3376,21 +3672,18 @@ pk_transaction_get_old_transactions (PkTransaction *transaction,
 			 tid, modified, succeeded,
 			 pk_role_enum_to_string (role),
 			 duration, data, uid, cmdline);
-		g_dbus_connection_emit_signal (transaction->priv->connection,
-					       NULL,
-					       transaction->priv->tid,
-					       PK_DBUS_INTERFACE_TRANSACTION,
-					       "Transaction",
-					       g_variant_new ("(osbuusus)",
-							      tid,
-							      modified,
-							      succeeded,
-							      role,
-							      duration,
-							      data != NULL ? data : "",
-							      uid,
-							      cmdline != NULL ? cmdline : ""),
-					       NULL);
+		pk_transaction_emit_signal (transaction,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    "Transaction",
+					    g_variant_new ("(osbuusus)",
+							   tid,
+							   modified,
+							   succeeded,
+							   role,
+							   duration,
+							   data != NULL ? data : "",
+							   uid,
+							   cmdline != NULL ? cmdline : ""));
 	}
 	g_list_free_full (transactions, (GDestroyNotify) g_object_unref);
 
@@ -3627,17 +3920,11 @@ static gboolean
 pk_transaction_is_supported_content_type (PkTransaction *transaction,
 					  const gchar *content_type)
 {
-	const gchar *tmp;
-	GPtrArray *array = transaction->priv->supported_content_types;
-	guint i;
+	g_auto(GStrv) mime_types = NULL;
 
-	/* can we support this one? */
-	for (i = 0; i < array->len; i++) {
-		tmp = g_ptr_array_index (array, i);
-		if (g_strcmp0 (tmp, content_type) == 0)
-			return TRUE;
-	}
-	return FALSE;
+	/* only needed for local files, so don't copy them for every transaction */
+	mime_types = pk_backend_get_mime_types (transaction->priv->backend);
+	return g_strv_contains ((const gchar * const *) mime_types, content_type);
 }
 
 static void
@@ -4591,6 +4878,19 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* solution-token=<token from a simulate> */
+	if (g_strcmp0 (key, "solution-token") == 0) {
+		if (value == NULL || value[0] == '\0') {
+			g_set_error_literal (error,
+					     PK_TRANSACTION_ERROR,
+					     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+					     "Could not set solution-token to nothing");
+			return FALSE;
+		}
+		pk_backend_job_set_solution_token (priv->job, value);
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);
@@ -4916,6 +5216,8 @@ pk_transaction_get_property (GDBusConnection *connection_, const gchar *sender,
 		return g_variant_new_uint64 (priv->download_size_remaining);
 	if (g_strcmp0 (property_name, "TransactionFlags") == 0)
 		return g_variant_new_uint64 (priv->cached_transaction_flags);
+	if (g_strcmp0 (property_name, "SolutionToken") == 0)
+		return _g_variant_new_maybe_string (priv->solution_token);
 	return NULL;
 }
 
@@ -4939,6 +5241,16 @@ pk_transaction_method_call (GDBusConnection *connection_, const gchar *sender,
 						       transaction->priv->sender);
 		return;
 	}
+
+	/* nothing moves past NEW until we know who the caller is */
+	if (transaction->priv->credentials_pending) {
+		PkTransactionCall *call = g_new0 (PkTransactionCall, 1);
+		call->method_name = g_strdup (method_name);
+		call->parameters = g_variant_ref (parameters);
+		call->invocation = g_object_ref (invocation);
+		g_ptr_array_add (transaction->priv->pending_calls, call);
+		return;
+	}
 	if (g_strcmp0 (method_name, "SetHints") == 0) {
 		pk_transaction_set_hints (transaction, parameters, invocation);
 		return;
@@ -5084,33 +5396,106 @@ pk_transaction_method_call (GDBusConnection *connection_, const gchar *sender,
 					       sender);
 }
 
-gboolean
-pk_transaction_set_tid (PkTransaction *transaction, const gchar *tid)
+static gchar **
+pk_transaction_subtree_enumerate (GDBusConnection *connection_,
+				  const gchar *sender,
+				  const gchar *object_path,
+				  gpointer user_data)
+{
+	g_autofree gpointer *nodes = NULL;
+	nodes = g_hash_table_get_keys_as_array (pk_transaction_subtree_nodes, NULL);
+	return g_strdupv ((gchar **) nodes);
+}
+
+static GDBusInterfaceInfo **
+pk_transaction_subtree_introspect (GDBusConnection *connection_,
+				   const gchar *sender,
+				   const gchar *object_path,
+				   const gchar *node,
+				   gpointer user_data)
+{
+	GDBusInterfaceInfo **infos;
+	PkTransaction *transaction;
+
+	/* the root node has no interfaces of its own */
+	if (node == NULL)
+		return NULL;
+	transaction = g_hash_table_lookup (pk_transaction_subtree_nodes, node);
+	if (transaction == NULL)
+		return NULL;
+	infos = g_new0 (GDBusInterfaceInfo *, 2);
+	infos[0] = g_dbus_interface_info_ref (transaction->priv->introspection->interfaces[0]);
+	return infos;
+}
+
+static const GDBusInterfaceVTable *
+pk_transaction_subtree_dispatch (GDBusConnection *connection_,
+				 const gchar *sender,
+				 const gchar *object_path,
+				 const gchar *interface_name,
+				 const gchar *node,
+				 gpointer *out_user_data,
+				 gpointer user_data)
 {
 	static const GDBusInterfaceVTable interface_vtable = {
 		pk_transaction_method_call,
 		pk_transaction_get_property,
 		NULL
 	};
+	PkTransaction *transaction;
+
+	if (node == NULL)
+		return NULL;
+	transaction = g_hash_table_lookup (pk_transaction_subtree_nodes, node);
+	if (transaction == NULL)
+		return NULL;
+	*out_user_data = transaction;
+	return &interface_vtable;
+}
+
+gboolean
+pk_transaction_set_tid (PkTransaction *transaction,
+			GDBusConnection *connection,
+			const gchar *tid)
+{
+	static const GDBusSubtreeVTable subtree_vtable = {
+		pk_transaction_subtree_enumerate,
+		pk_transaction_subtree_introspect,
+		pk_transaction_subtree_dispatch
+	};
 
 	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
-	g_return_val_if_fail (tid != NULL, FALSE);
+	g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), FALSE);
+	g_return_val_if_fail (tid != NULL && tid[0] == '/', FALSE);
 	g_return_val_if_fail (transaction->priv->tid == NULL, FALSE);
+	g_return_val_if_fail (pk_transaction_subtree_connection == NULL ||
+			      pk_transaction_subtree_connection == connection, FALSE);
 
 	transaction->priv->tid = g_strdup (tid);
-
-	/* register org.freedesktop.PackageKit.Transaction */
-	transaction->priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, NULL);
-	g_assert (transaction->priv->connection != NULL);
-	transaction->priv->registration_id =
-		g_dbus_connection_register_object (transaction->priv->connection,
-						   tid,
-						   transaction->priv->introspection->interfaces[0],
-						   &interface_vtable,
-						   transaction,  /* user_data */
-						   NULL,  /* user_data_free_func */
-						   NULL); /* GError** */
-	g_assert (transaction->priv->registration_id > 0);
+	pk_transaction_set_timestamp (transaction, PK_STATS_PHASE_CREATED);
+	transaction->priv->connection = g_object_ref (connection);
+
+	/* register org.freedesktop.PackageKit.Transaction for all TIDs,
+	 * looking the node up when a call arrives */
+	if (pk_transaction_subtree_id == 0) {
+		pk_transaction_subtree_connection = g_object_ref (connection);
+		pk_transaction_subtree_nodes = g_hash_table_new_full (g_str_hash,
+								      g_str_equal,
+								      g_free,
+								      NULL);
+		pk_transaction_subtree_id =
+			g_dbus_connection_register_subtree (connection,
+							    "/",
+							    &subtree_vtable,
+							    G_DBUS_SUBTREE_FLAGS_DISPATCH_TO_UNENUMERATED_NODES,
+							    NULL,  /* user_data */
+							    NULL,  /* user_data_free_func */
+							    NULL); /* GError** */
+		g_assert (pk_transaction_subtree_id > 0);
+	}
+	g_hash_table_insert (pk_transaction_subtree_nodes,
+			     g_strdup (tid + 1),
+			     transaction);
 	return TRUE;
 }
 
@@ -5154,6 +5539,11 @@ pk_transaction_class_init (PkTransactionClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__UINT,
 			      G_TYPE_NONE, 1, G_TYPE_UINT);
+	signals[SIGNAL_UID_KNOWN] =
+		g_signal_new ("uid-known",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__UINT,
+			      G_TYPE_NONE, 1, G_TYPE_UINT);
 
 	g_type_class_add_private (klass, sizeof (PkTransactionPrivate));
 }
@@ -5161,8 +5551,6 @@ pk_transaction_class_init (PkTransactionClass *klass)
 static void
 pk_transaction_init (PkTransaction *transaction)
 {
-	gboolean ret;
-	g_autoptr(GError) error = NULL;
 	transaction->priv = PK_TRANSACTION_GET_PRIVATE (transaction);
 	transaction->priv->allow_cancel = TRUE;
 	transaction->priv->caller_active = TRUE;
@@ -5173,15 +5561,14 @@ pk_transaction_init (PkTransaction *transaction)
 	transaction->priv->status = PK_STATUS_ENUM_WAIT;
 	transaction->priv->percentage = PK_BACKEND_PERCENTAGE_INVALID;
 	transaction->priv->state = PK_TRANSACTION_STATE_UNKNOWN;
-	transaction->priv->dbus = pk_dbus_new ();
 	transaction->priv->results = pk_results_new ();
-	transaction->priv->supported_content_types = g_ptr_array_new_with_free_func (g_free);
 	transaction->priv->cancellable = g_cancellable_new ();
-
-	transaction->priv->transaction_db = pk_transaction_db_new ();
-	ret = pk_transaction_db_load (transaction->priv->transaction_db, &error);
-	if (!ret)
-		g_error ("PkEngine: failed to load transaction db: %s", error->message);
+	transaction->priv->auth_cache = pk_auth_cache_new ();
+	transaction->priv->stats = pk_stats_new ();
+	transaction->priv->pending_calls = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_transaction_call_free);
+	transaction->priv->changed_properties = g_hash_table_new_full (g_str_hash, g_str_equal,
+								      NULL, (GDestroyNotify) g_variant_unref);
+	transaction->priv->changed_properties_interval = PK_TRANSACTION_PROPERTIES_CHANGED_INTERVAL;
 }
 
 static void
@@ -5201,22 +5588,30 @@ pk_transaction_dispose (GObject *object)
 		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_FAILED, 0);
 	}
 
-	if (transaction->priv->registration_id > 0) {
-		g_dbus_connection_unregister_object (transaction->priv->connection,
-						     transaction->priv->registration_id);
-		transaction->priv->registration_id = 0;
+	/* send anything still pending before the object goes away */
+	pk_transaction_flush_properties (transaction);
+
+	/* the entry is only saved if the transaction finished */
+	if (transaction->priv->tid != NULL)
+		pk_transaction_db_remove (transaction->priv->transaction_db,
+					  transaction->priv->tid);
+
+	/* no more method calls or property reads */
+	if (transaction->priv->tid != NULL &&
+	    pk_transaction_subtree_nodes != NULL &&
+	    g_hash_table_lookup (pk_transaction_subtree_nodes,
+				 transaction->priv->tid + 1) == transaction) {
+		g_hash_table_remove (pk_transaction_subtree_nodes,
+				     transaction->priv->tid + 1);
 	}
 
 	/* send signal to clients that we are about to be destroyed */
 	if (transaction->priv->connection != NULL) {
 		g_debug ("emitting destroy %s", transaction->priv->tid);
-		g_dbus_connection_emit_signal (transaction->priv->connection,
-					       NULL,
-					       transaction->priv->tid,
-					       PK_DBUS_INTERFACE_TRANSACTION,
-					       "Destroy",
-					       NULL,
-					       NULL);
+		pk_transaction_emit_signal (transaction,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    "Destroy",
+					    NULL);
 	}
 
 	G_OBJECT_CLASS (pk_transaction_parent_class)->dispose (object);
@@ -5233,9 +5628,11 @@ pk_transaction_finalize (GObject *object)
 
 	if (transaction->priv->subject != NULL)
 		g_object_unref (transaction->priv->subject);
-	if (transaction->priv->watch_id > 0)
-		g_bus_unwatch_name (transaction->priv->watch_id);
-	g_free (transaction->priv->last_package_id);
+	if (transaction->priv->vanished_id > 0)
+		g_signal_handler_disconnect (transaction->priv->dbus, transaction->priv->vanished_id);
+	g_ptr_array_unref (transaction->priv->pending_calls);
+	g_hash_table_unref (transaction->priv->changed_properties);
+	pk_ref_string_release (transaction->priv->last_package_id);
 	g_free (transaction->priv->cached_package_id);
 	g_free (transaction->priv->cached_key_id);
 	g_strfreev (transaction->priv->cached_package_ids);
@@ -5248,7 +5645,8 @@ pk_transaction_finalize (GObject *object)
 	g_free (transaction->priv->tid);
 	g_free (transaction->priv->sender);
 	g_free (transaction->priv->cmdline);
-	g_ptr_array_unref (transaction->priv->supported_content_types);
+	g_free (transaction->priv->solution_token);
+	g_free (transaction->priv->refused_reason);
 
 	if (transaction->priv->connection != NULL)
 		g_object_unref (transaction->priv->connection);
@@ -5262,21 +5660,43 @@ pk_transaction_finalize (GObject *object)
 	g_object_unref (transaction->priv->job);
 	g_object_unref (transaction->priv->transaction_db);
 	g_object_unref (transaction->priv->results);
-	if (transaction->priv->authority != NULL)
-		g_object_unref (transaction->priv->authority);
+	g_object_unref (transaction->priv->auth_cache);
+	g_object_unref (transaction->priv->stats);
 	g_object_unref (transaction->priv->cancellable);
 
 	G_OBJECT_CLASS (pk_transaction_parent_class)->finalize (object);
 }
 
+/**
+ * pk_transaction_new:
+ *
+ * The #PkDbus and #PkTransactionDb are owned by the engine and shared by
+ * every transaction, so creating a transaction does not open the database
+ * or connect to the bus again. The database must already be loaded.
+ */
 PkTransaction *
-pk_transaction_new (GKeyFile *conf, GDBusNodeInfo *introspection)
+pk_transaction_new (GKeyFile *conf,
+		    GDBusNodeInfo *introspection,
+		    PkDbus *dbus,
+		    PkTransactionDb *transaction_db)
 {
 	PkTransaction *transaction;
+
+	g_return_val_if_fail (PK_IS_DBUS (dbus), NULL);
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (transaction_db), NULL);
+
 	transaction = g_object_new (PK_TYPE_TRANSACTION, NULL);
 	transaction->priv->conf = g_key_file_ref (conf);
+	transaction->priv->dbus = g_object_ref (dbus);
+	transaction->priv->transaction_db = g_object_ref (transaction_db);
 	transaction->priv->job = pk_backend_job_new (conf);
 	transaction->priv->introspection = g_dbus_node_info_ref (introspection);
+
+	/* 0 sends every change as soon as it happens */
+	if (g_key_file_has_key (conf, "Daemon", "PropertiesChangedInterval", NULL)) {
+		gint interval = g_key_file_get_integer (conf, "Daemon", "PropertiesChangedInterval", NULL);
+		transaction->priv->changed_properties_interval = MAX (interval, 0);
+	}
 	return PK_TRANSACTION (transaction);
 }
 
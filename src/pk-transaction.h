@@ -27,6 +27,8 @@
 #include <packagekit-glib2/pk-results.h>
 
 #include "pk-backend.h"
+#include "pk-dbus.h"
+#include "pk-transaction-db.h"
 
 G_BEGIN_DECLS
 
@@ -66,16 +68,23 @@ typedef enum {
 GQuark		 pk_transaction_error_quark			(void);
 GType		 pk_transaction_get_type			(void);
 PkTransaction	*pk_transaction_new				(GKeyFile		*conf,
-								 GDBusNodeInfo	*introspection);
+								 GDBusNodeInfo	*introspection,
+								 PkDbus		*dbus,
+								 PkTransactionDb *transaction_db);
 
 /* go go go! */
 gboolean	 pk_transaction_run				(PkTransaction	*transaction)
 								 G_GNUC_WARN_UNUSED_RESULT;
 /* internal status */
 void		 pk_transaction_cancel_bg			(PkTransaction	*transaction);
+gboolean	 pk_transaction_suspend				(PkTransaction	*transaction);
+void		 pk_transaction_resume				(PkTransaction	*transaction);
+gboolean	 pk_transaction_get_suspended			(PkTransaction	*transaction);
 gboolean	 pk_transaction_get_background			(PkTransaction	*transaction);
 PkRoleEnum	 pk_transaction_get_role			(PkTransaction	*transaction);
 guint		 pk_transaction_get_uid				(PkTransaction	*transaction);
+void		 pk_transaction_refuse				(PkTransaction	*transaction,
+								 const gchar	*reason);
 void		 pk_transaction_set_backend			(PkTransaction	*transaction,
 								 PkBackend	*backend);
 PkBackendJob	*pk_transaction_get_backend_job 		(PkTransaction	*transaction);